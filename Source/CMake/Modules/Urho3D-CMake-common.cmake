@@ -99,6 +99,7 @@ if (CMAKE_PROJECT_NAME STREQUAL Urho3D)
     option (URHO3D_FILEWATCHER "Enable filewatcher support" TRUE)
 endif ()
 option (URHO3D_PROFILING "Enable profiling support" TRUE)
+option (URHO3D_MEMORY_TRACKING "Enable heap allocation tracking")
 option (URHO3D_LOGGING "Enable logging support" TRUE)
 option (URHO3D_TESTING "Enable testing support")
 if (URHO3D_TESTING)
@@ -180,6 +181,11 @@ if (URHO3D_PROFILING)
     add_definitions (-DURHO3D_PROFILING)
 endif ()
 
+# Enable heap allocation tracking if requested. Replaces the global operator new and delete to count allocations per category.
+if (URHO3D_MEMORY_TRACKING)
+    add_definitions (-DURHO3D_MEMORY_TRACKING)
+endif ()
+
 # Enable logging by default. If disabled, LOGXXXX macros become no-ops and the Log subsystem is not instantiated.
 if (URHO3D_LOGGING)
     add_definitions (-DURHO3D_LOGGING)
@@ -246,6 +252,12 @@ if (NOT URHO3D_LIB_TYPE STREQUAL SHARED)
     add_definitions (-DURHO3D_STATIC_DEFINE)
 endif ()
 
+# Heap allocation tracking replaces the global operator new and delete, which only works when the engine is linked statically.
+# With a shared library, memory freed by inline header code in another module would go to a different allocator
+if (URHO3D_MEMORY_TRACKING AND URHO3D_LIB_TYPE STREQUAL SHARED)
+    message (FATAL_ERROR "URHO3D_MEMORY_TRACKING requires the STATIC library type. Disable it or set URHO3D_LIB_TYPE to STATIC.")
+endif ()
+
 # Find DirectX SDK include & library directories for Visual Studio. It is also possible to compile
 # without if a recent Windows SDK is installed. The SDK is not searched for with MinGW as it is
 # incompatible; rather, it is assumed that MinGW itself comes with the necessary headers & libraries.
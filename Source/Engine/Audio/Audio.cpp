@@ -25,6 +25,7 @@
 #include "Context.h"
 #include "CoreEvents.h"
 #include "Log.h"
+#include "MemoryTracker.h"
 #include "Mutex.h"
 #include "ProcessUtils.h"
 #include "Profiler.h"
@@ -122,6 +123,7 @@ bool Audio::SetMode(int bufferLengthMSec, int mixRate, bool stereo, bool interpo
 void Audio::Update(float timeStep)
 {
     PROFILE(UpdateAudio);
+    MEMORY_CATEGORY(MEMCAT_AUDIO);
     
     // Update in reverse order, because sound sources might remove themselves
     for (unsigned i = soundSources_.Size() - 1; i < soundSources_.Size(); --i)
@@ -22,6 +22,7 @@
 
 #include "Precompiled.h"
 #include "Allocator.h"
+#include "Atomic.h"
 
 #include "stdio.h"
 
@@ -30,12 +31,15 @@
 namespace Urho3D
 {
 
+static volatile int heapAllocations = 0;
+
 AllocatorBlock* AllocatorReserveBlock(AllocatorBlock* allocator, unsigned nodeSize, unsigned capacity)
 {
     if (!capacity)
         capacity = 1;
     
     unsigned char* blockPtr = new unsigned char[sizeof(AllocatorBlock) + capacity * (sizeof(AllocatorNode) + nodeSize)];
+    AllocatorCountHeapAllocation();
     AllocatorBlock* newBlock = reinterpret_cast<AllocatorBlock*>(blockPtr);
     newBlock->nodeSize_ = nodeSize;
     newBlock->capacity_ = capacity;
@@ -122,4 +126,14 @@ void AllocatorFree(AllocatorBlock* allocator, void* ptr)
     allocator->free_ = node;
 }
 
+void AllocatorCountHeapAllocation()
+{
+    AtomicIncrement(&heapAllocations);
+}
+
+unsigned AllocatorGetHeapAllocations()
+{
+    return (unsigned)heapAllocations;
+}
+
 }
@@ -62,6 +62,10 @@ URHO3D_API void AllocatorUninitialize(AllocatorBlock* allocator);
 URHO3D_API void* AllocatorReserve(AllocatorBlock* allocator);
 /// Free a node. Does not free any blocks.
 URHO3D_API void AllocatorFree(AllocatorBlock* allocator, void* ptr);
+/// Count a heap allocation made by a container. Thread-safe.
+URHO3D_API void AllocatorCountHeapAllocation();
+/// Return the number of heap allocations made by the containers since startup.
+URHO3D_API unsigned AllocatorGetHeapAllocations();
 
 /// %Allocator template class. Allocates objects of a specific class.
 template <class T> class Allocator
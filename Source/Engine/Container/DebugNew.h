@@ -22,7 +22,8 @@
 
 #pragma once
 
-#if defined(_MSC_VER) && defined(_DEBUG)
+// The CRT debug allocation functions would bypass the operator new replaced by the memory tracker
+#if defined(_MSC_VER) && defined(_DEBUG) && !defined(URHO3D_MEMORY_TRACKING)
 
 #define _CRTDBG_MAP_ALLOC
 
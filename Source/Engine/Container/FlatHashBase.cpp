@@ -0,0 +1,128 @@
+//
+// Copyright (c) 2008-2014 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "Precompiled.h"
+#include "FlatHashBase.h"
+
+#include "DebugNew.h"
+
+namespace Urho3D
+{
+
+void FlatHashBase::Rehash(unsigned numSlots)
+{
+    PODVector<FlatHashSlot> oldSlots;
+    oldSlots.Swap(slots_);
+    
+    slots_.Resize(numSlots);
+    mask_ = numSlots - 1;
+    ResetSlots();
+    
+    for (PODVector<FlatHashSlot>::ConstIterator i = oldSlots.Begin(); i != oldSlots.End(); ++i)
+    {
+        if (i->index_ != FLAT_HASH_EMPTY)
+            InsertSlot(i->hash_, i->index_);
+    }
+}
+
+void FlatHashBase::InsertSlot(unsigned hash, unsigned index)
+{
+    FlatHashSlot slot;
+    slot.hash_ = hash;
+    slot.index_ = index;
+    
+    unsigned pos = hash & mask_;
+    unsigned distance = 0;
+    for (;;)
+    {
+        FlatHashSlot& current = slots_[pos];
+        if (current.index_ == FLAT_HASH_EMPTY)
+        {
+            current = slot;
+            return;
+        }
+        
+        // Take the place of a slot that is closer to its ideal position, then continue inserting that one
+        unsigned currentDistance = ProbeDistance(current.hash_, pos);
+        if (currentDistance < distance)
+        {
+            Swap(current, slot);
+            distance = currentDistance;
+        }
+        
+        pos = (pos + 1) & mask_;
+        ++distance;
+    }
+}
+
+unsigned FlatHashBase::FindSlot(unsigned hash, unsigned index) const
+{
+    if (slots_.Empty())
+        return FLAT_HASH_EMPTY;
+    
+    unsigned pos = hash & mask_;
+    for (unsigned distance = 0; ; ++distance)
+    {
+        const FlatHashSlot& slot = slots_[pos];
+        if (slot.index_ == FLAT_HASH_EMPTY || distance > ProbeDistance(slot.hash_, pos))
+            return FLAT_HASH_EMPTY;
+        if (slot.index_ == index)
+            return pos;
+        
+        pos = (pos + 1) & mask_;
+    }
+}
+
+void FlatHashBase::EraseSlot(unsigned hash, unsigned index, unsigned lastHash, unsigned lastIndex)
+{
+    unsigned pos = FindSlot(hash, index);
+    if (pos == FLAT_HASH_EMPTY)
+        return;
+    
+    // Shift the following slots back until an empty slot or a slot in its ideal position
+    for (;;)
+    {
+        unsigned next = (pos + 1) & mask_;
+        FlatHashSlot& nextSlot = slots_[next];
+        if (nextSlot.index_ == FLAT_HASH_EMPTY || !ProbeDistance(nextSlot.hash_, next))
+            break;
+        
+        slots_[pos] = nextSlot;
+        pos = next;
+    }
+    slots_[pos].index_ = FLAT_HASH_EMPTY;
+    
+    if (index != lastIndex)
+    {
+        unsigned lastPos = FindSlot(lastHash, lastIndex);
+        if (lastPos != FLAT_HASH_EMPTY)
+            slots_[lastPos].index_ = index;
+    }
+}
+
+void FlatHashBase::ResetSlots()
+{
+    for (PODVector<FlatHashSlot>::Iterator i = slots_.Begin(); i != slots_.End(); ++i)
+        i->index_ = FLAT_HASH_EMPTY;
+}
+
+}
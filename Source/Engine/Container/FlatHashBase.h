@@ -0,0 +1,94 @@
+//
+// Copyright (c) 2008-2014 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "Hash.h"
+#include "Vector.h"
+
+namespace Urho3D
+{
+
+/// Index of an empty slot in a flat hash set/map.
+static const unsigned FLAT_HASH_EMPTY = 0xffffffff;
+/// Minimum slot count of a non-empty flat hash set/map.
+static const unsigned FLAT_HASH_MIN_SLOTS = 8;
+
+/// Flat hash set/map slot.
+struct FlatHashSlot
+{
+    /// Mixed hash of the key.
+    unsigned hash_;
+    /// Index of the element, or FLAT_HASH_EMPTY.
+    unsigned index_;
+};
+
+/// Flat hash set/map base class. Elements are stored contiguously by the subclass, and an open addressing slot table with Robin Hood probing maps the keys to their indices.
+/** Iteration is a linear walk over the elements in insertion order, until an element is erased: erasing moves the last element to its place.
+  */
+class URHO3D_API FlatHashBase
+{
+public:
+    /// Construct.
+    FlatHashBase() :
+        mask_(0)
+    {
+    }
+    
+    /// Return number of slots.
+    unsigned NumSlots() const { return slots_.Size(); }
+    
+protected:
+    /// Mix a key hash so that its low bits are usable for slot indexing.
+    static unsigned MixHash(unsigned hash)
+    {
+        hash *= 0x9e3779b1;
+        return hash ^ (hash >> 15);
+    }
+    
+    /// Return the probe distance of a hash in a slot position.
+    unsigned ProbeDistance(unsigned hash, unsigned pos) const { return (pos - (hash & mask_)) & mask_; }
+    /// Make room for one more element. Grows the slot table if the load factor would exceed 7/8.
+    void ReserveSlot(unsigned size)
+    {
+        if ((size + 1) * 8 > slots_.Size() * 7)
+            Rehash(slots_.Size() ? slots_.Size() << 1 : FLAT_HASH_MIN_SLOTS);
+    }
+    
+    /// Rebuild the slot table with a slot count, which must be a power of two.
+    void Rehash(unsigned numSlots);
+    /// Insert a slot for an element index. The key must not exist yet and there must be room.
+    void InsertSlot(unsigned hash, unsigned index);
+    /// Return the slot position of an element index, or FLAT_HASH_EMPTY if not found.
+    unsigned FindSlot(unsigned hash, unsigned index) const;
+    /// Remove the slot of an element index. The element is removed by moving the last element to its place, so the last element's slot is updated as well.
+    void EraseSlot(unsigned hash, unsigned index, unsigned lastHash, unsigned lastIndex);
+    /// Mark all slots empty.
+    void ResetSlots();
+    
+    /// Slots.
+    PODVector<FlatHashSlot> slots_;
+    /// Slot count minus one.
+    unsigned mask_;
+};
+
+}
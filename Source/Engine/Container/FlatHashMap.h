@@ -0,0 +1,208 @@
+//
+// Copyright (c) 2008-2014 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "FlatHashBase.h"
+#include "Pair.h"
+
+namespace Urho3D
+{
+
+/// Flat hash map template class. Pairs are stored contiguously, so iterators and pointers to values are invalidated by insertion and erasure.
+template <class T, class U> class FlatHashMap : public FlatHashBase
+{
+public:
+    /// Key-value pair.
+    typedef Pair<T, U> KeyValue;
+    /// Iterator.
+    typedef typename Vector<KeyValue>::Iterator Iterator;
+    /// Const iterator.
+    typedef typename Vector<KeyValue>::ConstIterator ConstIterator;
+    
+    /// Index the map. Create a new pair if key not found.
+    U& operator [] (const T& key)
+    {
+        unsigned hash = MixHash(MakeHash(key));
+        unsigned index = FindIndex(key, hash);
+        if (index == FLAT_HASH_EMPTY)
+            index = InsertPair(key, U(), hash);
+        return pairs_[index].second_;
+    }
+    
+    /// Insert a pair. If the key exists, replace its value. Return an iterator to it.
+    Iterator Insert(const Pair<T, U>& pair)
+    {
+        unsigned hash = MixHash(MakeHash(pair.first_));
+        unsigned index = FindIndex(pair.first_, hash);
+        if (index == FLAT_HASH_EMPTY)
+            index = InsertPair(pair.first_, pair.second_, hash);
+        else
+            pairs_[index].second_ = pair.second_;
+        return pairs_.Begin() + index;
+    }
+    
+    /// Insert a map.
+    void Insert(const FlatHashMap<T, U>& map)
+    {
+        for (ConstIterator i = map.Begin(); i != map.End(); ++i)
+            Insert(*i);
+    }
+    
+    /// Erase a pair by key. Return true if was found.
+    bool Erase(const T& key)
+    {
+        unsigned index = FindIndex(key, MixHash(MakeHash(key)));
+        if (index == FLAT_HASH_EMPTY)
+            return false;
+        
+        ErasePair(index);
+        return true;
+    }
+    
+    /// Erase a pair by iterator. The last pair is moved to its place. Return iterator to the next pair to visit, which is the moved pair.
+    Iterator Erase(const Iterator& it)
+    {
+        unsigned index = (unsigned)(it - pairs_.Begin());
+        ErasePair(index);
+        return pairs_.Begin() + index;
+    }
+    
+    /// Clear the map. Memory is retained.
+    void Clear()
+    {
+        pairs_.Clear();
+        ResetSlots();
+    }
+    
+    /// Reserve memory for a number of pairs.
+    void Reserve(unsigned size)
+    {
+        pairs_.Reserve(size);
+        unsigned numSlots = FLAT_HASH_MIN_SLOTS;
+        while (size * 8 > numSlots * 7)
+            numSlots <<= 1;
+        if (numSlots > NumSlots())
+            Rehash(numSlots);
+    }
+    
+    /// Return iterator to the pair with key, or end iterator if not found.
+    Iterator Find(const T& key)
+    {
+        unsigned index = FindIndex(key, MixHash(MakeHash(key)));
+        return index != FLAT_HASH_EMPTY ? pairs_.Begin() + index : pairs_.End();
+    }
+    
+    /// Return const iterator to the pair with key, or end iterator if not found.
+    ConstIterator Find(const T& key) const
+    {
+        unsigned index = FindIndex(key, MixHash(MakeHash(key)));
+        return index != FLAT_HASH_EMPTY ? pairs_.Begin() + index : pairs_.End();
+    }
+    
+    /// Return whether contains a pair with key.
+    bool Contains(const T& key) const { return FindIndex(key, MixHash(MakeHash(key))) != FLAT_HASH_EMPTY; }
+    
+    /// Return all the keys.
+    Vector<T> Keys() const
+    {
+        Vector<T> result;
+        result.Reserve(Size());
+        for (ConstIterator i = Begin(); i != End(); ++i)
+            result.Push(i->first_);
+        return result;
+    }
+    
+    /// Return all the values.
+    Vector<U> Values() const
+    {
+        Vector<U> result;
+        result.Reserve(Size());
+        for (ConstIterator i = Begin(); i != End(); ++i)
+            result.Push(i->second_);
+        return result;
+    }
+    
+    /// Return iterator to the beginning.
+    Iterator Begin() { return pairs_.Begin(); }
+    /// Return const iterator to the beginning.
+    ConstIterator Begin() const { return pairs_.Begin(); }
+    /// Return iterator to the end.
+    Iterator End() { return pairs_.End(); }
+    /// Return const iterator to the end.
+    ConstIterator End() const { return pairs_.End(); }
+    /// Return first pair.
+    const KeyValue& Front() const { return pairs_.Front(); }
+    /// Return last pair.
+    const KeyValue& Back() const { return pairs_.Back(); }
+    /// Return number of pairs.
+    unsigned Size() const { return pairs_.Size(); }
+    /// Return whether map is empty.
+    bool Empty() const { return pairs_.Empty(); }
+    
+private:
+    /// Return index of the pair with key, or FLAT_HASH_EMPTY if not found.
+    unsigned FindIndex(const T& key, unsigned hash) const
+    {
+        if (slots_.Empty())
+            return FLAT_HASH_EMPTY;
+        
+        unsigned pos = hash & mask_;
+        for (unsigned distance = 0; ; ++distance)
+        {
+            const FlatHashSlot& slot = slots_[pos];
+            if (slot.index_ == FLAT_HASH_EMPTY)
+                return FLAT_HASH_EMPTY;
+            if (slot.hash_ == hash && pairs_[slot.index_].first_ == key)
+                return slot.index_;
+            if (distance > ProbeDistance(slot.hash_, pos))
+                return FLAT_HASH_EMPTY;
+            
+            pos = (pos + 1) & mask_;
+        }
+    }
+    
+    /// Append a pair whose key does not exist yet. Return its index.
+    unsigned InsertPair(const T& key, const U& value, unsigned hash)
+    {
+        ReserveSlot(pairs_.Size());
+        unsigned index = pairs_.Size();
+        pairs_.Push(KeyValue(key, value));
+        InsertSlot(hash, index);
+        return index;
+    }
+    
+    /// Erase a pair by index, moving the last pair to its place.
+    void ErasePair(unsigned index)
+    {
+        unsigned lastIndex = pairs_.Size() - 1;
+        EraseSlot(MixHash(MakeHash(pairs_[index].first_)), index, MixHash(MakeHash(pairs_[lastIndex].first_)), lastIndex);
+        if (index != lastIndex)
+            pairs_[index] = pairs_[lastIndex];
+        pairs_.Pop();
+    }
+    
+    /// Pairs in insertion order, until erased.
+    Vector<KeyValue> pairs_;
+};
+
+}
@@ -0,0 +1,168 @@
+//
+// Copyright (c) 2008-2014 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "FlatHashBase.h"
+
+namespace Urho3D
+{
+
+/// Flat hash set template class. Keys are stored contiguously, so iterators are invalidated by insertion and erasure.
+template <class T> class FlatHashSet : public FlatHashBase
+{
+public:
+    /// Iterator.
+    typedef typename Vector<T>::Iterator Iterator;
+    /// Const iterator.
+    typedef typename Vector<T>::ConstIterator ConstIterator;
+    
+    /// Insert a key. Return an iterator to it.
+    Iterator Insert(const T& key)
+    {
+        unsigned hash = MixHash(MakeHash(key));
+        unsigned index = FindIndex(key, hash);
+        if (index == FLAT_HASH_EMPTY)
+        {
+            ReserveSlot(keys_.Size());
+            index = keys_.Size();
+            keys_.Push(key);
+            InsertSlot(hash, index);
+        }
+        return keys_.Begin() + index;
+    }
+    
+    /// Insert a set.
+    void Insert(const FlatHashSet<T>& set)
+    {
+        for (ConstIterator i = set.Begin(); i != set.End(); ++i)
+            Insert(*i);
+    }
+    
+    /// Erase a key. Return true if was found.
+    bool Erase(const T& key)
+    {
+        unsigned index = FindIndex(key, MixHash(MakeHash(key)));
+        if (index == FLAT_HASH_EMPTY)
+            return false;
+        
+        EraseKey(index);
+        return true;
+    }
+    
+    /// Erase a key by iterator. The last key is moved to its place. Return iterator to the next key to visit, which is the moved key.
+    Iterator Erase(const Iterator& it)
+    {
+        unsigned index = (unsigned)(it - keys_.Begin());
+        EraseKey(index);
+        return keys_.Begin() + index;
+    }
+    
+    /// Clear the set. Memory is retained.
+    void Clear()
+    {
+        keys_.Clear();
+        ResetSlots();
+    }
+    
+    /// Reserve memory for a number of keys.
+    void Reserve(unsigned size)
+    {
+        keys_.Reserve(size);
+        unsigned numSlots = FLAT_HASH_MIN_SLOTS;
+        while (size * 8 > numSlots * 7)
+            numSlots <<= 1;
+        if (numSlots > NumSlots())
+            Rehash(numSlots);
+    }
+    
+    /// Return iterator to the key, or end iterator if not found.
+    Iterator Find(const T& key)
+    {
+        unsigned index = FindIndex(key, MixHash(MakeHash(key)));
+        return index != FLAT_HASH_EMPTY ? keys_.Begin() + index : keys_.End();
+    }
+    
+    /// Return const iterator to the key, or end iterator if not found.
+    ConstIterator Find(const T& key) const
+    {
+        unsigned index = FindIndex(key, MixHash(MakeHash(key)));
+        return index != FLAT_HASH_EMPTY ? keys_.Begin() + index : keys_.End();
+    }
+    
+    /// Return whether contains a key.
+    bool Contains(const T& key) const { return FindIndex(key, MixHash(MakeHash(key))) != FLAT_HASH_EMPTY; }
+    
+    /// Return iterator to the beginning.
+    Iterator Begin() { return keys_.Begin(); }
+    /// Return const iterator to the beginning.
+    ConstIterator Begin() const { return keys_.Begin(); }
+    /// Return iterator to the end.
+    Iterator End() { return keys_.End(); }
+    /// Return const iterator to the end.
+    ConstIterator End() const { return keys_.End(); }
+    /// Return first key.
+    const T& Front() const { return keys_.Front(); }
+    /// Return last key.
+    const T& Back() const { return keys_.Back(); }
+    /// Return number of keys.
+    unsigned Size() const { return keys_.Size(); }
+    /// Return whether set is empty.
+    bool Empty() const { return keys_.Empty(); }
+    
+private:
+    /// Return index of the key, or FLAT_HASH_EMPTY if not found.
+    unsigned FindIndex(const T& key, unsigned hash) const
+    {
+        if (slots_.Empty())
+            return FLAT_HASH_EMPTY;
+        
+        unsigned pos = hash & mask_;
+        for (unsigned distance = 0; ; ++distance)
+        {
+            const FlatHashSlot& slot = slots_[pos];
+            if (slot.index_ == FLAT_HASH_EMPTY)
+                return FLAT_HASH_EMPTY;
+            if (slot.hash_ == hash && keys_[slot.index_] == key)
+                return slot.index_;
+            if (distance > ProbeDistance(slot.hash_, pos))
+                return FLAT_HASH_EMPTY;
+            
+            pos = (pos + 1) & mask_;
+        }
+    }
+    
+    /// Erase a key by index, moving the last key to its place.
+    void EraseKey(unsigned index)
+    {
+        unsigned lastIndex = keys_.Size() - 1;
+        EraseSlot(MixHash(MakeHash(keys_[index])), index, MixHash(MakeHash(keys_[lastIndex])), lastIndex);
+        if (index != lastIndex)
+            keys_[index] = keys_[lastIndex];
+        keys_.Pop();
+    }
+    
+    /// Keys in insertion order, until erased.
+    Vector<T> keys_;
+};
+
+}
@@ -0,0 +1,121 @@
+//
+// Copyright (c) 2008-2014 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "Precompiled.h"
+#include "Allocator.h"
+#include "FrameAllocator.h"
+
+#include "DebugNew.h"
+
+namespace Urho3D
+{
+
+static const unsigned FRAME_ALLOCATOR_ALIGNMENT = 16;
+static const unsigned FRAME_ALLOCATOR_MIN_CHUNK_SIZE = 16384;
+
+/// %Frame allocator memory chunk.
+struct FrameAllocatorChunk
+{
+    /// Previously filled chunk.
+    FrameAllocatorChunk* next_;
+    /// Aligned start of data.
+    unsigned char* data_;
+    /// Capacity in bytes.
+    unsigned capacity_;
+    /// Bytes used.
+    unsigned used_;
+    /// Data follows.
+};
+
+FrameAllocator::FrameAllocator(unsigned initialCapacity) :
+    chunk_(0),
+    size_(0),
+    capacity_(0)
+{
+    if (initialCapacity)
+        AllocateChunk(initialCapacity);
+}
+
+FrameAllocator::~FrameAllocator()
+{
+    FreeChunks();
+}
+
+void* FrameAllocator::Allocate(unsigned size)
+{
+    unsigned offset = chunk_ ? (chunk_->used_ + FRAME_ALLOCATOR_ALIGNMENT - 1) & ~(FRAME_ALLOCATOR_ALIGNMENT - 1) : 0;
+    if (!chunk_ || offset + size > chunk_->capacity_)
+    {
+        // Grow geometrically so that the amount of chunks stays low until the next reset consolidates them
+        unsigned capacity = capacity_ > FRAME_ALLOCATOR_MIN_CHUNK_SIZE ? capacity_ : FRAME_ALLOCATOR_MIN_CHUNK_SIZE;
+        AllocateChunk(size > capacity ? size : capacity);
+        offset = 0;
+    }
+    
+    size_ += offset + size - chunk_->used_;
+    chunk_->used_ = offset + size;
+    return chunk_->data_ + offset;
+}
+
+void FrameAllocator::Reset()
+{
+    if (chunk_ && chunk_->next_)
+    {
+        unsigned capacity = capacity_;
+        FreeChunks();
+        AllocateChunk(capacity);
+    }
+    
+    if (chunk_)
+        chunk_->used_ = 0;
+    size_ = 0;
+}
+
+void FrameAllocator::AllocateChunk(unsigned capacity)
+{
+    unsigned char* chunkPtr = new unsigned char[sizeof(FrameAllocatorChunk) + FRAME_ALLOCATOR_ALIGNMENT + capacity];
+    AllocatorCountHeapAllocation();
+    
+    FrameAllocatorChunk* newChunk = reinterpret_cast<FrameAllocatorChunk*>(chunkPtr);
+    size_t dataStart = (size_t)(chunkPtr + sizeof(FrameAllocatorChunk));
+    newChunk->data_ = reinterpret_cast<unsigned char*>((dataStart + FRAME_ALLOCATOR_ALIGNMENT - 1) & ~(size_t)(FRAME_ALLOCATOR_ALIGNMENT - 1));
+    newChunk->capacity_ = capacity;
+    newChunk->used_ = 0;
+    newChunk->next_ = chunk_;
+    
+    chunk_ = newChunk;
+    capacity_ += capacity;
+}
+
+void FrameAllocator::FreeChunks()
+{
+    while (chunk_)
+    {
+        FrameAllocatorChunk* next = chunk_->next_;
+        delete[] reinterpret_cast<unsigned char*>(chunk_);
+        chunk_ = next;
+    }
+    
+    capacity_ = 0;
+}
+
+}
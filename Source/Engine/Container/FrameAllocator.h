@@ -0,0 +1,192 @@
+//
+// Copyright (c) 2008-2014 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "VectorBase.h"
+
+#include <cstring>
+
+namespace Urho3D
+{
+
+struct FrameAllocatorChunk;
+
+/// Linear memory allocator for data that only needs to live until the end of the frame. Allocation is a pointer increment and all memory is reclaimed at once on reset without calling destructors. Not thread-safe.
+class URHO3D_API FrameAllocator
+{
+public:
+    /// Construct with initial capacity in bytes.
+    FrameAllocator(unsigned initialCapacity = 0);
+    /// Destruct. Free all memory.
+    ~FrameAllocator();
+    
+    /// Allocate memory aligned to 16 bytes.
+    void* Allocate(unsigned size);
+    /// Reclaim all allocations. If more than one chunk was needed, replace them with a single chunk of the combined size so that the next frame fits without heap allocations.
+    void Reset();
+    
+    /// Return bytes allocated since the last reset, including alignment padding.
+    unsigned GetSize() const { return size_; }
+    /// Return combined capacity of all chunks in bytes.
+    unsigned GetCapacity() const { return capacity_; }
+    
+private:
+    /// Prevent copy construction.
+    FrameAllocator(const FrameAllocator& rhs);
+    /// Prevent assignment.
+    FrameAllocator& operator = (const FrameAllocator& rhs);
+    
+    /// Allocate a new current chunk with the specified capacity.
+    void AllocateChunk(unsigned capacity);
+    /// Free all chunks.
+    void FreeChunks();
+    
+    /// Current chunk. Previously filled chunks are chained to it.
+    FrameAllocatorChunk* chunk_;
+    /// Bytes allocated since the last reset.
+    unsigned size_;
+    /// Combined capacity of all chunks.
+    unsigned capacity_;
+};
+
+/// %Vector template class for POD types that takes its buffer from a frame allocator. When grown, the old buffer is left to be reclaimed by the allocator's reset. Without an allocator the buffer is allocated from the heap like in PODVector.
+template <class T> class FramePODVector : public VectorBase
+{
+public:
+    typedef RandomAccessIterator<T> Iterator;
+    typedef RandomAccessConstIterator<T> ConstIterator;
+    
+    /// Construct empty with an optional frame allocator.
+    explicit FramePODVector(FrameAllocator* allocator = 0) :
+        allocator_(allocator)
+    {
+    }
+    
+    /// Construct from another vector, using the same allocator.
+    FramePODVector(const FramePODVector<T>& vector) :
+        allocator_(vector.allocator_)
+    {
+        *this = vector;
+    }
+    
+    /// Destruct. Frees the buffer only if it was allocated from the heap.
+    ~FramePODVector()
+    {
+        if (!allocator_)
+            delete[] buffer_;
+    }
+    
+    /// Assign from another vector. The allocator is not changed.
+    FramePODVector<T>& operator = (const FramePODVector<T>& rhs)
+    {
+        size_ = 0;
+        Reserve(rhs.size_);
+        if (rhs.size_)
+            memcpy(buffer_, rhs.buffer_, rhs.size_ * sizeof(T));
+        size_ = rhs.size_;
+        return *this;
+    }
+    
+    /// Return element at index.
+    T& operator [] (unsigned index) { return Buffer()[index]; }
+    /// Return const element at index.
+    const T& operator [] (unsigned index) const { return Buffer()[index]; }
+    
+    /// Add an element at the end.
+    void Push(const T& value)
+    {
+        if (size_ >= capacity_)
+            Reserve(capacity_ ? capacity_ << 1 : 4);
+        Buffer()[size_++] = value;
+    }
+    
+    /// Remove the last element.
+    void Pop()
+    {
+        if (size_)
+            --size_;
+    }
+    
+    /// Clear the vector. The buffer is retained.
+    void Clear() { size_ = 0; }
+    
+    /// Set new capacity. Does not shrink.
+    void Reserve(unsigned newCapacity)
+    {
+        if (newCapacity <= capacity_)
+            return;
+        
+        unsigned char* newBuffer = allocator_ ? static_cast<unsigned char*>(allocator_->Allocate(newCapacity * sizeof(T))) :
+            AllocateBuffer(newCapacity * sizeof(T));
+        if (buffer_)
+        {
+            memcpy(newBuffer, buffer_, size_ * sizeof(T));
+            if (!allocator_)
+                delete[] buffer_;
+        }
+        
+        buffer_ = newBuffer;
+        capacity_ = newCapacity;
+    }
+    
+    /// Swap with another vector, including the allocator.
+    void Swap(FramePODVector<T>& rhs)
+    {
+        VectorBase::Swap(rhs);
+        Urho3D::Swap(allocator_, rhs.allocator_);
+    }
+    
+    /// Return iterator to the beginning.
+    Iterator Begin() { return Iterator(Buffer()); }
+    /// Return const iterator to the beginning.
+    ConstIterator Begin() const { return ConstIterator(Buffer()); }
+    /// Return iterator to the end.
+    Iterator End() { return Iterator(Buffer() + size_); }
+    /// Return const iterator to the end.
+    ConstIterator End() const { return ConstIterator(Buffer() + size_); }
+    /// Return first element.
+    T& Front() { return Buffer()[0]; }
+    /// Return const first element.
+    const T& Front() const { return Buffer()[0]; }
+    /// Return last element.
+    T& Back() { return Buffer()[size_ - 1]; }
+    /// Return const last element.
+    const T& Back() const { return Buffer()[size_ - 1]; }
+    /// Return size of vector.
+    unsigned Size() const { return size_; }
+    /// Return capacity of vector.
+    unsigned Capacity() const { return capacity_; }
+    /// Return whether vector is empty.
+    bool Empty() const { return size_ == 0; }
+    /// Return the frame allocator, or null if using the heap.
+    FrameAllocator* GetAllocator() const { return allocator_; }
+    
+private:
+    /// Return the buffer with right type.
+    T* Buffer() const { return reinterpret_cast<T*>(buffer_); }
+    
+    /// Frame allocator.
+    FrameAllocator* allocator_;
+};
+
+}
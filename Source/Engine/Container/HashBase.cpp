@@ -21,6 +21,7 @@
 //
 
 #include "Precompiled.h"
+#include "Allocator.h"
 #include "HashBase.h"
 
 #include "DebugNew.h"
@@ -34,6 +35,7 @@ void HashBase::AllocateBuckets(unsigned size, unsigned numBuckets)
         delete[] ptrs_;
     
     HashNodeBase** ptrs = new HashNodeBase*[numBuckets + 2];
+    AllocatorCountHeapAllocation();
     unsigned* data = reinterpret_cast<unsigned*>(ptrs);
     data[0] = size;
     data[1] = numBuckets;
@@ -25,6 +25,8 @@
 #include "Swap.h"
 #include "VectorBase.h"
 
+#include <cstring>
+
 namespace Urho3D
 {
 
@@ -141,4 +143,56 @@ template <class T, class U> void Sort(RandomAccessIterator<T> begin, RandomAcces
     InsertionSort(begin, end, compare);
 }
 
+/// Key and value pair for radix sorting.
+template <class T> struct RadixSortItem
+{
+    /// Sort key.
+    unsigned long long key_;
+    /// Value.
+    T value_;
+};
+
+/// Perform a stable LSD radix sort on key-value pairs in ascending key order, one byte per pass. Passes in which all keys have the same byte are skipped. The temporary buffer must be able to hold as many items.
+template <class T> void RadixSort(RadixSortItem<T>* items, RadixSortItem<T>* temp, unsigned count)
+{
+    if (count < 2)
+        return;
+    
+    // Build the histograms of all passes at once
+    unsigned histograms[8][256];
+    memset(histograms, 0, sizeof(histograms));
+    for (unsigned i = 0; i < count; ++i)
+    {
+        unsigned long long key = items[i].key_;
+        for (unsigned j = 0; j < 8; ++j)
+            ++histograms[j][(unsigned)(key >> (j << 3)) & 0xff];
+    }
+    
+    RadixSortItem<T>* src = items;
+    RadixSortItem<T>* dest = temp;
+    for (unsigned j = 0; j < 8; ++j)
+    {
+        unsigned shift = j << 3;
+        unsigned* histogram = histograms[j];
+        if (histogram[(unsigned)(src[0].key_ >> shift) & 0xff] == count)
+            continue;
+        
+        unsigned offset = 0;
+        for (unsigned k = 0; k < 256; ++k)
+        {
+            unsigned bucketSize = histogram[k];
+            histogram[k] = offset;
+            offset += bucketSize;
+        }
+        
+        for (unsigned i = 0; i < count; ++i)
+            dest[histogram[(unsigned)(src[i].key_ >> shift) & 0xff]++] = src[i];
+        
+        Swap(src, dest);
+    }
+    
+    if (src != items)
+        memcpy(items, src, count * sizeof(RadixSortItem<T>));
+}
+
 }
@@ -21,6 +21,7 @@
 //
 
 #include "Precompiled.h"
+#include "Allocator.h"
 #include "Str.h"
 #include "Swap.h"
 
@@ -160,7 +161,7 @@ String::String(char value) :
     buffer_(&endZero)
 {
     Resize(1);
-    buffer_[0] = value;
+    Buffer()[0] = value;
 }
 
 String::String(char value, unsigned length) :
@@ -169,8 +170,9 @@ String::String(char value, unsigned length) :
     buffer_(&endZero)
 {
     Resize(length);
+    char* buffer = Buffer();
     for (unsigned i = 0; i < length; ++i)
-        buffer_[i] = value;
+        buffer[i] = value;
 }
 
 String& String::operator += (int rhs)
@@ -205,12 +207,13 @@ String& String::operator += (bool rhs)
 
 void String::Replace(char replaceThis, char replaceWith, bool caseSensitive)
 {
+    char* buffer = Buffer();
     if (caseSensitive)
     {
         for (unsigned i = 0; i < length_; ++i)
         {
-            if (buffer_[i] == replaceThis)
-                buffer_[i] = replaceWith;
+            if (buffer[i] == replaceThis)
+                buffer[i] = replaceWith;
         }
     }
     else
@@ -218,8 +221,8 @@ void String::Replace(char replaceThis, char replaceWith, bool caseSensitive)
         replaceThis = tolower(replaceThis);
         for (unsigned i = 0; i < length_; ++i)
         {
-            if (tolower(buffer_[i]) == replaceThis)
-                buffer_[i] = replaceWith;
+            if (tolower(buffer[i]) == replaceThis)
+                buffer[i] = replaceWith;
         }
     }
 }
@@ -244,7 +247,7 @@ void String::Replace(unsigned pos, unsigned length, const String& replaceWith)
     if (pos + length > length_)
         return;
     
-    Replace(pos, length, replaceWith.buffer_, replaceWith.length_);
+    Replace(pos, length, replaceWith.Buffer(), replaceWith.length_);
 }
 
 void String::Replace(unsigned pos, unsigned length, const char* replaceWith)
@@ -302,7 +305,7 @@ String& String::Append(const char* str, unsigned length)
     {
         unsigned oldLength = length_;
         Resize(oldLength + length);
-        CopyChars(&buffer_[oldLength], str, length);
+        CopyChars(&Buffer()[oldLength], str, length);
     }
     return *this;
 }
@@ -330,7 +333,7 @@ void String::Insert(unsigned pos, char c)
         unsigned oldLength = length_;
         Resize(length_ + 1);
         MoveRange(pos + 1, pos, oldLength - pos);
-        buffer_[pos] = c;
+        Buffer()[pos] = c;
     }
 }
 
@@ -399,32 +402,44 @@ void String::Resize(unsigned newLength)
         if (!newLength)
             return;
         
-        // Calculate initial capacity
-        capacity_ = newLength + 1;
-        if (capacity_ < MIN_CAPACITY)
-            capacity_ = MIN_CAPACITY;
-        
-        buffer_ = new char[capacity_];
+        // Short strings use the inline buffer without allocating
+        if (newLength < STRING_INLINE_CAPACITY)
+            capacity_ = STRING_INLINE_CAPACITY;
+        else
+        {
+            // Calculate initial capacity
+            capacity_ = newLength + 1;
+            if (capacity_ < MIN_CAPACITY)
+                capacity_ = MIN_CAPACITY;
+            
+            buffer_ = new char[capacity_];
+            AllocatorCountHeapAllocation();
+        }
     }
     else
     {
         if (newLength && capacity_ < newLength + 1)
         {
+            char* oldBuffer = Buffer();
+            bool wasInline = IsInline();
+            
             // Increase the capacity with half each time it is exceeded
             while (capacity_ < newLength + 1)
                 capacity_ += (capacity_ + 1) >> 1;
             
             char* newBuffer = new char[capacity_];
+            AllocatorCountHeapAllocation();
             // Move the existing data to the new buffer, then delete the old buffer
             if (length_)
-                CopyChars(newBuffer, buffer_, length_);
-            delete[] buffer_;
+                CopyChars(newBuffer, oldBuffer, length_);
+            if (!wasInline)
+                delete[] oldBuffer;
             
             buffer_ = newBuffer;
         }
     }
     
-    buffer_[newLength] = 0;
+    Buffer()[newLength] = 0;
     length_ = newLength;
 }
 
@@ -435,14 +450,30 @@ void String::Reserve(unsigned newCapacity)
     if (newCapacity == capacity_)
         return;
     
-    char* newBuffer = new char[newCapacity];
+    char* oldBuffer = Buffer();
+    bool wasInline = IsInline();
+    char* newBuffer;
+    if (newCapacity <= STRING_INLINE_CAPACITY)
+    {
+        // Any capacity that fits is served by the inline buffer
+        if (wasInline)
+            return;
+        newCapacity = STRING_INLINE_CAPACITY;
+        newBuffer = inlineBuffer_;
+    }
+    else
+    {
+        newBuffer = new char[newCapacity];
+        AllocatorCountHeapAllocation();
+    }
+    
     // Move the existing data to the new buffer, then delete the old buffer
-    CopyChars(newBuffer, buffer_, length_ + 1);
-    if (capacity_)
-        delete[] buffer_;
+    CopyChars(newBuffer, oldBuffer, length_ + 1);
+    if (capacity_ && !wasInline)
+        delete[] oldBuffer;
     
     capacity_ = newCapacity;
-    buffer_ = newBuffer;
+    buffer_ = IsInline() ? &endZero : newBuffer;
 }
 
 void String::Compact()
@@ -461,6 +492,15 @@ void String::Swap(String& str)
     Urho3D::Swap(length_, str.length_);
     Urho3D::Swap(capacity_, str.capacity_);
     Urho3D::Swap(buffer_, str.buffer_);
+    
+    // Inline contents can not be swapped by pointer; copy them over
+    if (IsInline() || str.IsInline())
+    {
+        char temp[STRING_INLINE_CAPACITY];
+        CopyChars(temp, inlineBuffer_, STRING_INLINE_CAPACITY);
+        CopyChars(inlineBuffer_, str.inlineBuffer_, STRING_INLINE_CAPACITY);
+        CopyChars(str.inlineBuffer_, temp, STRING_INLINE_CAPACITY);
+    }
 }
 
 String String::Substring(unsigned pos) const
@@ -469,7 +509,7 @@ String String::Substring(unsigned pos) const
     {
         String ret;
         ret.Resize(length_ - pos);
-        CopyChars(ret.buffer_, buffer_ + pos, ret.length_);
+        CopyChars(ret.Buffer(), Buffer() + pos, ret.length_);
         
         return ret;
     }
@@ -485,7 +525,7 @@ String String::Substring(unsigned pos, unsigned length) const
         if (pos + length > length_)
             length = length_ - pos;
         ret.Resize(length);
-        CopyChars(ret.buffer_, buffer_ + pos, ret.length_);
+        CopyChars(ret.Buffer(), Buffer() + pos, ret.length_);
         
         return ret;
     }
@@ -500,14 +540,14 @@ String String::Trimmed() const
     
     while (trimStart < trimEnd)
     {
-        char c = buffer_[trimStart];
+        char c = Buffer()[trimStart];
         if (c != ' ' && c != 9)
             break;
         ++trimStart;
     }
     while (trimEnd > trimStart)
     {
-        char c = buffer_[trimEnd - 1];
+        char c = Buffer()[trimEnd - 1];
         if (c != ' ' && c != 9)
             break;
         --trimEnd;
@@ -519,8 +559,9 @@ String String::Trimmed() const
 String String::ToLower() const
 {
     String ret(*this);
+    char* buffer = ret.Buffer();
     for (unsigned i = 0; i < ret.length_; ++i)
-        ret[i] = tolower(buffer_[i]);
+        buffer[i] = tolower(buffer[i]);
     
     return ret;
 }
@@ -528,8 +569,9 @@ String String::ToLower() const
 String String::ToUpper() const
 {
     String ret(*this);
+    char* buffer = ret.Buffer();
     for (unsigned i = 0; i < ret.length_; ++i)
-        ret[i] = toupper(buffer_[i]);
+        buffer[i] = toupper(buffer[i]);
     
     return ret;
 }
@@ -550,7 +592,7 @@ unsigned String::Find(char c, unsigned startPos, bool caseSensitive) const
     {
         for (unsigned i = startPos; i < length_; ++i)
         {
-            if (buffer_[i] == c)
+            if (Buffer()[i] == c)
                 return i;
         }
     }
@@ -559,7 +601,7 @@ unsigned String::Find(char c, unsigned startPos, bool caseSensitive) const
         c = tolower(c);
         for (unsigned i = startPos; i < length_; ++i)
         {
-            if (tolower(buffer_[i]) == c)
+            if (tolower(Buffer()[i]) == c)
                 return i;
         }
     }
@@ -572,13 +614,13 @@ unsigned String::Find(const String& str, unsigned startPos, bool caseSensitive)
     if (!str.length_ || str.length_ > length_)
         return NPOS;
     
-    char first = str.buffer_[0];
+    char first = str.Buffer()[0];
     if (!caseSensitive)
         first = tolower(first);
 
     for (unsigned i = startPos; i <= length_ - str.length_; ++i)
     {
-        char c = buffer_[i];
+        char c = Buffer()[i];
         if (!caseSensitive)
             c = tolower(c);
 
@@ -588,8 +630,8 @@ unsigned String::Find(const String& str, unsigned startPos, bool caseSensitive)
             bool found = true;
             for (unsigned j = 1; j < str.length_; ++j)
             {
-                c = buffer_[i + j];
-                char d = str.buffer_[j];
+                c = Buffer()[i + j];
+                char d = str.Buffer()[j];
                 if (!caseSensitive)
                 {
                     c = tolower(c);
@@ -624,7 +666,7 @@ unsigned String::FindLast(char c, unsigned startPos, bool caseSensitive) const
     {
         for (unsigned i = startPos; i < length_; --i)
         {
-            if (buffer_[i] == c)
+            if (Buffer()[i] == c)
                 return i;
         }
     }
@@ -633,7 +675,7 @@ unsigned String::FindLast(char c, unsigned startPos, bool caseSensitive) const
         c = tolower(c);
         for (unsigned i = startPos; i < length_; --i)
         {
-            if (tolower(buffer_[i]) == c)
+            if (tolower(Buffer()[i]) == c)
                 return i;
         }
     }
@@ -648,13 +690,13 @@ unsigned String::FindLast(const String& str, unsigned startPos, bool caseSensiti
     if (startPos > length_ - str.length_)
         startPos = length_ - str.length_;
     
-    char first = str.buffer_[0];
+    char first = str.Buffer()[0];
     if (!caseSensitive)
         first = tolower(first);
 
     for (unsigned i = startPos; i < length_; --i)
     {
-        char c = buffer_[i];
+        char c = Buffer()[i];
         if (!caseSensitive)
             c = tolower(c);
 
@@ -663,8 +705,8 @@ unsigned String::FindLast(const String& str, unsigned startPos, bool caseSensiti
             bool found = true;
             for (unsigned j = 1; j < str.length_; ++j)
             {
-                c = buffer_[i + j];
-                char d = str.buffer_[j];
+                c = Buffer()[i + j];
+                char d = str.Buffer()[j];
                 if (!caseSensitive)
                 {
                     c = tolower(c);
@@ -757,10 +799,10 @@ unsigned String::LengthUTF8() const
 {
     unsigned ret = 0;
     
-    const char* src = buffer_;
+    const char* src = Buffer();
     if (!src)
         return ret;
-    const char* end = buffer_ + length_;
+    const char* end = Buffer() + length_;
     
     while (src < end)
     {
@@ -787,12 +829,12 @@ unsigned String::ByteOffsetUTF8(unsigned index) const
 
 unsigned String::NextUTF8Char(unsigned& byteOffset) const
 {
-    if (!buffer_)
+    if (!Buffer())
         return 0;
     
-    const char* src = buffer_ + byteOffset;
+    const char* src = Buffer() + byteOffset;
     unsigned ret = DecodeUTF8(src);
-    byteOffset = src - buffer_;
+    byteOffset = src - Buffer();
     
     return ret;
 }
@@ -1222,7 +1264,7 @@ void String::Replace(unsigned pos, unsigned length, const char* srcStart, unsign
     else
         Resize(length_ + delta);
     
-    CopyChars(buffer_ + pos, srcStart, srcLength);
+    CopyChars(Buffer() + pos, srcStart, srcLength);
 }
 
 WString::WString() :
@@ -33,6 +33,8 @@ namespace Urho3D
 
 static const int CONVERSION_BUFFER_LENGTH = 128;
 static const int MATRIX_CONVERSION_BUFFER_LENGTH = 256;
+/// Inline buffer size of String including the null terminator, chosen so that a String occupies the size of four pointers.
+static const unsigned STRING_INLINE_CAPACITY = 4 * sizeof(void*) - 2 * sizeof(unsigned) - sizeof(char*);
 
 class WString;
 
@@ -85,7 +87,7 @@ public:
         buffer_(&endZero)
     {
         Resize(length);
-        CopyChars(buffer_, str, length);
+        CopyChars(Buffer(), str, length);
     }
     
     /// Construct from a null-terminated wide character array.
@@ -148,7 +150,7 @@ public:
     /// Destruct.
     ~String()
     {
-        if (capacity_)
+        if (capacity_ && !IsInline())
             delete[] buffer_;
     }
     
@@ -156,7 +158,7 @@ public:
     String& operator = (const String& rhs)
     {
         Resize(rhs.length_);
-        CopyChars(buffer_, rhs.buffer_, rhs.length_);
+        CopyChars(Buffer(), rhs.Buffer(), rhs.length_);
         
         return *this;
     }
@@ -166,7 +168,7 @@ public:
     {
         unsigned rhsLength = CStringLength(rhs);
         Resize(rhsLength);
-        CopyChars(buffer_, rhs, rhsLength);
+        CopyChars(Buffer(), rhs, rhsLength);
         
         return *this;
     }
@@ -176,7 +178,7 @@ public:
     {
         unsigned oldLength = length_;
         Resize(length_ + rhs.length_);
-        CopyChars(buffer_ + oldLength, rhs.buffer_, rhs.length_);
+        CopyChars(Buffer() + oldLength, rhs.Buffer(), rhs.length_);
         
         return *this;
     }
@@ -187,7 +189,7 @@ public:
         unsigned rhsLength = CStringLength(rhs);
         unsigned oldLength = length_;
         Resize(length_ + rhsLength);
-        CopyChars(buffer_ + oldLength, rhs, rhsLength);
+        CopyChars(Buffer() + oldLength, rhs, rhsLength);
         
         return *this;
     }
@@ -197,7 +199,7 @@ public:
     {
         unsigned oldLength = length_;
         Resize(length_ + 1);
-        buffer_[oldLength]  = rhs;
+        Buffer()[oldLength]  = rhs;
         
         return *this;
     }
@@ -222,8 +224,8 @@ public:
     {
         String ret;
         ret.Resize(length_ + rhs.length_);
-        CopyChars(ret.buffer_, buffer_, length_);
-        CopyChars(ret.buffer_ + length_, rhs.buffer_, rhs.length_);
+        CopyChars(ret.Buffer(), Buffer(), length_);
+        CopyChars(ret.Buffer() + length_, rhs.Buffer(), rhs.length_);
         
         return ret;
     }
@@ -234,8 +236,8 @@ public:
         unsigned rhsLength = CStringLength(rhs);
         String ret;
         ret.Resize(length_ + rhsLength);
-        CopyChars(ret.buffer_, buffer_, length_);
-        CopyChars(ret.buffer_ + length_, rhs, rhsLength);
+        CopyChars(ret.Buffer(), Buffer(), length_);
+        CopyChars(ret.Buffer() + length_, rhs, rhsLength);
         
         return ret;
     }
@@ -266,13 +268,13 @@ public:
     /// Test if string is greater than a C string.
     bool operator > (const char* rhs) const { return strcmp(CString(), rhs) > 0; }
     /// Return char at index.
-    char& operator [] (unsigned index) { assert(index < length_); return buffer_[index]; }
+    char& operator [] (unsigned index) { assert(index < length_); return Buffer()[index]; }
     /// Return const char at index.
-    const char& operator [] (unsigned index) const { assert(index < length_); return buffer_[index]; }
+    const char& operator [] (unsigned index) const { assert(index < length_); return Buffer()[index]; }
     /// Return char at index.
-    char& At(unsigned index) { assert(index < length_); return buffer_[index]; }
+    char& At(unsigned index) { assert(index < length_); return Buffer()[index]; }
     /// Return const char at index.
-    const char& At(unsigned index) const { assert(index < length_); return buffer_[index]; }
+    const char& At(unsigned index) const { assert(index < length_); return Buffer()[index]; }
     
     /// Replace all occurrences of a character.
     void Replace(char replaceThis, char replaceWith, bool caseSensitive = true);
@@ -324,17 +326,17 @@ public:
     void Swap(String& str);
     
     /// Return iterator to the beginning.
-    Iterator Begin() { return Iterator(buffer_); }
+    Iterator Begin() { return Iterator(Buffer()); }
     /// Return const iterator to the beginning.
-    ConstIterator Begin() const { return ConstIterator(buffer_); }
+    ConstIterator Begin() const { return ConstIterator(Buffer()); }
     /// Return iterator to the end.
-    Iterator End() { return Iterator(buffer_ + length_); }
+    Iterator End() { return Iterator(Buffer() + length_); }
     /// Return const iterator to the end.
-    ConstIterator End() const { return ConstIterator(buffer_ + length_); }
+    ConstIterator End() const { return ConstIterator(Buffer() + length_); }
     /// Return first char, or 0 if empty.
-    char Front() const { return buffer_[0]; }
+    char Front() const { return Buffer()[0]; }
     /// Return last char, or 0 if empty.
-    char Back() const { return length_ ? buffer_[length_ - 1] : buffer_[0]; }
+    char Back() const { return length_ ? Buffer()[length_ - 1] : Buffer()[0]; }
     /// Return a substring from position to end.
     String Substring(unsigned pos) const;
     /// Return a substring with length from position.
@@ -362,7 +364,7 @@ public:
     /// Return whether ends with a string.
     bool EndsWith(const String& str, bool caseSensitive = true) const;
     /// Return the C string.
-    const char* CString() const { return buffer_; }
+    const char* CString() const { return Buffer(); }
     /// Return length.
     unsigned Length() const { return length_; }
     /// Return buffer capacity.
@@ -403,7 +405,7 @@ public:
     unsigned ToHash() const
     {
         unsigned hash = 0;
-        const char* ptr = buffer_;
+        const char* ptr = Buffer();
         while (*ptr)
         {
             hash = *ptr + (hash << 6) + (hash << 16) - hash;
@@ -453,7 +455,7 @@ public:
     
     /// Position for "not found."
     static const unsigned NPOS = 0xffffffff;
-    /// Initial dynamic allocation size.
+    /// Initial dynamic allocation size. Strings that fit the inline buffer do not allocate.
     static const unsigned MIN_CAPACITY = 8;
     /// Empty string.
     static const String EMPTY;
@@ -463,7 +465,7 @@ private:
     void MoveRange(unsigned dest, unsigned src, unsigned count)
     {
         if (count)
-            memmove(buffer_ + dest, buffer_ + src, count);
+            memmove(Buffer() + dest, Buffer() + src, count);
     }
     
     /// Copy chars from one buffer to another.
@@ -486,12 +488,19 @@ private:
     /// Replace a substring with another substring.
     void Replace(unsigned pos, unsigned length, const char* srcStart, unsigned srcLength);
     
+    /// Return whether the string is stored in the inline buffer.
+    bool IsInline() const { return capacity_ == STRING_INLINE_CAPACITY; }
+    /// Return the character buffer. Computed rather than stored, so that a string stays valid when its memory is relocated with memcpy, as script arrays do.
+    char* Buffer() const { return IsInline() ? const_cast<char*>(inlineBuffer_) : buffer_; }
+    
     /// String length.
     unsigned length_;
-    /// Capacity, zero if buffer not allocated.
+    /// Capacity, zero if buffer not allocated. Equal to the inline capacity only when the inline buffer is used.
     unsigned capacity_;
-    /// String buffer, null if not allocated.
+    /// Allocated string buffer, or the end zero if not allocated. Unused while the inline buffer is used.
     char* buffer_;
+    /// Inline buffer for short strings.
+    char inlineBuffer_[STRING_INLINE_CAPACITY];
     
     /// End zero for empty strings.
     static char endZero;
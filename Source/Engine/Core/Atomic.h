@@ -0,0 +1,144 @@
+//
+// Copyright (c) 2008-2014 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "Urho3D.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#pragma intrinsic(_InterlockedIncrement, _InterlockedDecrement, _InterlockedExchangeAdd, _InterlockedCompareExchange, _InterlockedCompareExchange64, _InterlockedExchange, _ReadWriteBarrier)
+#endif
+
+namespace Urho3D
+{
+
+/// Atomically increment an integer and return the new value.
+inline int AtomicIncrement(volatile int* value)
+{
+    #ifdef _MSC_VER
+    return (int)_InterlockedIncrement((volatile long*)value);
+    #else
+    return __sync_add_and_fetch(value, 1);
+    #endif
+}
+
+/// Atomically decrement an integer and return the new value.
+inline int AtomicDecrement(volatile int* value)
+{
+    #ifdef _MSC_VER
+    return (int)_InterlockedDecrement((volatile long*)value);
+    #else
+    return __sync_sub_and_fetch(value, 1);
+    #endif
+}
+
+/// Atomically add to an integer and return the new value.
+inline int AtomicAdd(volatile int* value, int amount)
+{
+    #ifdef _MSC_VER
+    return (int)_InterlockedExchangeAdd((volatile long*)value, amount) + amount;
+    #else
+    return __sync_add_and_fetch(value, amount);
+    #endif
+}
+
+/// Atomically replace a 64-bit integer with the exchange value if it equals the comparand. Return true if replaced.
+inline bool AtomicCompareExchange64(volatile long long* value, long long exchange, long long comparand)
+{
+    #ifdef _MSC_VER
+    return _InterlockedCompareExchange64(value, exchange, comparand) == comparand;
+    #else
+    return __sync_bool_compare_and_swap(value, comparand, exchange);
+    #endif
+}
+
+/// Atomically add to a 64-bit integer and return the new value.
+inline long long AtomicAdd64(volatile long long* value, long long amount)
+{
+    #ifdef _MSC_VER
+    // The 64-bit add intrinsic is not available on 32-bit targets, so use a compare-exchange loop
+    for (;;)
+    {
+        long long oldValue = *value;
+        if (_InterlockedCompareExchange64(value, oldValue + amount, oldValue) == oldValue)
+            return oldValue + amount;
+    }
+    #else
+    return __sync_add_and_fetch(value, amount);
+    #endif
+}
+
+/// Atomically replace an integer and return the previous value.
+inline int AtomicExchange(volatile int* value, int exchange)
+{
+    #ifdef _MSC_VER
+    return (int)_InterlockedExchange((volatile long*)value, exchange);
+    #else
+    return __sync_lock_test_and_set(value, exchange);
+    #endif
+}
+
+/// Atomically replace an integer with the exchange value if it equals the comparand. Return true if replaced.
+inline bool AtomicCompareExchange(volatile int* value, int exchange, int comparand)
+{
+    #ifdef _MSC_VER
+    return _InterlockedCompareExchange((volatile long*)value, exchange, comparand) == comparand;
+    #else
+    return __sync_bool_compare_and_swap(value, comparand, exchange);
+    #endif
+}
+
+/// Atomically replace a pointer with the exchange value if it equals the comparand. Return true if replaced.
+inline bool AtomicCompareExchangePointer(void* volatile* value, void* exchange, void* comparand)
+{
+    #ifdef _MSC_VER
+    return _InterlockedCompareExchangePointer(value, exchange, comparand) == comparand;
+    #else
+    return __sync_bool_compare_and_swap(value, comparand, exchange);
+    #endif
+}
+
+/// Hint the CPU that the thread is spinning on a lock. This saves power and lets a hyperthreaded sibling run.
+inline void SpinPause()
+{
+    #ifdef _MSC_VER
+    _mm_pause();
+    #elif defined(__i386__) || defined(__x86_64__)
+    __asm__ __volatile__("pause");
+    #elif defined(__aarch64__) || (defined(__ARM_ARCH) && __ARM_ARCH >= 7)
+    __asm__ __volatile__("yield");
+    #endif
+}
+
+/// Issue a full memory barrier: no loads or stores are reordered across it by either the compiler or the CPU.
+inline void AtomicFence()
+{
+    #ifdef _MSC_VER
+    _ReadWriteBarrier();
+    _mm_mfence();
+    #else
+    __sync_synchronize();
+    #endif
+}
+
+}
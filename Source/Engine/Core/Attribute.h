@@ -68,7 +68,10 @@ struct AttributeInfo
         offset_(0),
         enumNames_(0),
         mode_(AM_DEFAULT),
-        ptr_(0)
+        ptr_(0),
+        quantizationMin_(0.0f),
+        quantizationMax_(0.0f),
+        quantizationBits_(0)
     {
     }
     
@@ -80,7 +83,10 @@ struct AttributeInfo
         enumNames_(0),
         defaultValue_(defaultValue),
         mode_(mode),
-        ptr_(0)
+        ptr_(0),
+        quantizationMin_(0.0f),
+        quantizationMax_(0.0f),
+        quantizationBits_(0)
     {
     }
     
@@ -92,7 +98,10 @@ struct AttributeInfo
         enumNames_(enumNames),
         defaultValue_(defaultValue),
         mode_(mode),
-        ptr_(0)
+        ptr_(0),
+        quantizationMin_(0.0f),
+        quantizationMax_(0.0f),
+        quantizationBits_(0)
     {
     }
     
@@ -105,7 +114,10 @@ struct AttributeInfo
         accessor_(accessor),
         defaultValue_(defaultValue),
         mode_(mode),
-        ptr_(0)
+        ptr_(0),
+        quantizationMin_(0.0f),
+        quantizationMax_(0.0f),
+        quantizationBits_(0)
     {
     }
     
@@ -118,7 +130,10 @@ struct AttributeInfo
         accessor_(accessor),
         defaultValue_(defaultValue),
         mode_(mode),
-        ptr_(0)
+        ptr_(0),
+        quantizationMin_(0.0f),
+        quantizationMax_(0.0f),
+        quantizationBits_(0)
     {
     }
     
@@ -138,6 +153,12 @@ struct AttributeInfo
     unsigned mode_;
     /// Attribute data pointer if elsewhere than in the Serializable.
     void* ptr_;
+    /// Minimum component value for quantized network replication.
+    float quantizationMin_;
+    /// Maximum component value for quantized network replication.
+    float quantizationMax_;
+    /// Bits per component for quantized network replication of float, vector, color and quaternion attributes. Zero (default) sends full precision.
+    unsigned quantizationBits_;
 };
 
 }
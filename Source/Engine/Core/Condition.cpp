@@ -57,6 +57,7 @@ void Condition::Wait()
 #else
 Condition::Condition() :
     mutex_(new pthread_mutex_t),
+    set_(false),
     event_(new pthread_cond_t)
 {
     pthread_mutex_init((pthread_mutex_t*)mutex_, 0);
@@ -78,7 +79,12 @@ Condition::~Condition()
 
 void Condition::Set()
 {
+    pthread_mutex_t* mutex = (pthread_mutex_t*)mutex_;
+    
+    pthread_mutex_lock(mutex);
+    set_ = true;
     pthread_cond_signal((pthread_cond_t*)event_);
+    pthread_mutex_unlock(mutex);
 }
 
 void Condition::Wait()
@@ -87,7 +93,10 @@ void Condition::Wait()
     pthread_mutex_t* mutex = (pthread_mutex_t*)mutex_;
     
     pthread_mutex_lock(mutex);
-    pthread_cond_wait(cond, mutex);
+    // Loop to ignore spurious wakeups
+    while (!set_)
+        pthread_cond_wait(cond, mutex);
+    set_ = false;
     pthread_mutex_unlock(mutex);
 }
 #endif
@@ -37,7 +37,7 @@ public:
     /// Destruct.
     ~Condition();
     
-    /// Set the condition. Will be automatically reset once a waiting thread wakes up.
+    /// Set the condition. Will be automatically reset once a waiting thread wakes up. If no thread is waiting, the next one to wait returns immediately.
     void Set();
     
     /// Wait on the condition.
@@ -47,6 +47,8 @@ private:
     #ifndef WIN32
     /// Mutex for the event, necessary for pthreads-based implementation.
     void* mutex_;
+    /// Set flag, necessary for pthreads-based implementation to keep the condition set until a thread wakes up.
+    bool set_;
     #endif
     /// Operating system specific event.
     void* event_;
@@ -21,6 +21,7 @@
 //
 
 #include "Precompiled.h"
+#include "Atomic.h"
 #include "Context.h"
 #include "Thread.h"
 
@@ -29,6 +30,8 @@
 namespace Urho3D
 {
 
+static const unsigned POSTED_EVENT_SLOTS = 256;
+
 void RemoveNamedAttribute(HashMap<StringHash, Vector<AttributeInfo> >& attributes, StringHash objectType, const char* name)
 {
     HashMap<StringHash, Vector<AttributeInfo> >::Iterator i = attributes.Find(objectType);
@@ -51,7 +54,29 @@ void RemoveNamedAttribute(HashMap<StringHash, Vector<AttributeInfo> >& attribute
         attributes.Erase(i);
 }
 
+void SetNamedAttributeQuantization(HashMap<StringHash, Vector<AttributeInfo> >& attributes, StringHash objectType, const char* name,
+    float min, float max, unsigned bits)
+{
+    HashMap<StringHash, Vector<AttributeInfo> >::Iterator i = attributes.Find(objectType);
+    if (i == attributes.End())
+        return;
+
+    Vector<AttributeInfo>& infos = i->second_;
+
+    for (Vector<AttributeInfo>::Iterator j = infos.Begin(); j != infos.End(); ++j)
+    {
+        if (!j->name_.Compare(name, true))
+        {
+            j->quantizationMin_ = min;
+            j->quantizationMax_ = max;
+            j->quantizationBits_ = bits;
+            break;
+        }
+    }
+}
+
 Context::Context() :
+    postedEvents_(POSTED_EVENT_SLOTS),
     eventHandler_(0)
 {
     #ifdef ANDROID
@@ -80,6 +105,9 @@ Context::~Context()
     for (PODVector<VariantMap*>::Iterator i = eventDataMaps_.Begin(); i != eventDataMaps_.End(); ++i)
         delete *i;
     eventDataMaps_.Clear();
+    for (PODVector<VariantMap*>::Iterator i = typedEventDataMaps_.Begin(); i != typedEventDataMaps_.End(); ++i)
+        delete *i;
+    typedEventDataMaps_.Clear();
 }
 
 SharedPtr<Object> Context::CreateObject(StringHash objectType)
@@ -149,6 +177,22 @@ void Context::UpdateAttributeDefaultValue(StringHash objectType, const char* nam
         info->defaultValue_ = defaultValue;
 }
 
+void Context::UpdateAttributeQuantization(StringHash objectType, const char* name, float min, float max, unsigned bits)
+{
+    // More bits than a float mantissa would not add precision
+    bits = Min((int)bits, 24);
+    SetNamedAttributeQuantization(attributes_, objectType, name, min, max, bits);
+    SetNamedAttributeQuantization(networkAttributes_, objectType, name, min, max, bits);
+}
+
+unsigned Context::SendPostedEvents()
+{
+    if (!Thread::IsMainThread())
+        return 0;
+    
+    return postedEvents_.Send();
+}
+
 VariantMap& Context::GetEventDataMap()
 {
     unsigned nestingLevel = eventSenders_.Size();
@@ -160,6 +204,18 @@ VariantMap& Context::GetEventDataMap()
     return ret;
 }
 
+VariantMap& Context::GetTypedEventDataMap()
+{
+    // A payload is converted while its event is being sent, so there is always at least one sender on the stack
+    unsigned nestingLevel = eventSenders_.Size();
+    while (typedEventDataMaps_.Size() < nestingLevel)
+        typedEventDataMaps_.Push(new VariantMap());
+    
+    VariantMap& ret = *typedEventDataMaps_[nestingLevel - 1];
+    ret.Clear();
+    return ret;
+}
+
 
 void Context::CopyBaseAttributes(StringHash baseType, StringHash derivedType)
 {
@@ -217,42 +273,345 @@ AttributeInfo* Context::GetAttribute(StringHash objectType, const char* name)
     return 0;
 }
 
-void Context::AddEventReceiver(Object* receiver, StringHash eventType)
+void Context::AddEventReceiver(EventHandler* handler)
 {
-    eventReceivers_[eventType].Insert(receiver);
+    Object* sender = handler->GetSender();
+    SharedPtr<EventReceiverGroup>& group = sender ? specificEventReceivers_[sender][handler->GetEventType()] :
+        eventReceivers_[handler->GetEventType()];
+    if (!group)
+        group = new EventReceiverGroup();
+    group->Add(handler);
 }
 
-void Context::AddEventReceiver(Object* receiver, Object* sender, StringHash eventType)
+void Context::RemoveEventSender(Object* sender)
 {
-    specificEventReceivers_[sender][eventType].Insert(receiver);
+    HashMap<Object*, HashMap<StringHash, SharedPtr<EventReceiverGroup> > >::Iterator i = specificEventReceivers_.Find(sender);
+    if (i != specificEventReceivers_.End())
+    {
+        // Detach the handlers from the groups first, as the groups may be in the middle of sending
+        PODVector<Object*> receivers;
+        for (HashMap<StringHash, SharedPtr<EventReceiverGroup> >::Iterator j = i->second_.Begin(); j != i->second_.End(); ++j)
+            j->second_->RemoveAll(receivers);
+        for (PODVector<Object*>::Iterator j = receivers.Begin(); j != receivers.End(); ++j)
+            (*j)->RemoveEventSender(sender);
+        specificEventReceivers_.Erase(i);
+    }
+    
+    if (Thread::IsMainThread())
+        postedEvents_.RemoveSender(sender);
 }
 
-void Context::RemoveEventSender(Object* sender)
+void Context::RemoveEventReceiver(EventHandler* handler)
 {
-    HashMap<Object*, HashMap<StringHash, HashSet<Object*> > >::Iterator i = specificEventReceivers_.Find(sender);
-    if (i != specificEventReceivers_.End())
+    Object* sender = handler->GetSender();
+    EventReceiverGroup* group = sender ? GetEventReceivers(sender, handler->GetEventType()) :
+        GetEventReceivers(handler->GetEventType());
+    if (group)
+        group->Remove(handler);
+}
+
+EventReceiverGroup::EventReceiverGroup() :
+    version_(0),
+    indicesVersion_(M_MAX_UNSIGNED),
+    nonSpecificVersion_(M_MAX_UNSIGNED),
+    inSend_(0),
+    dirty_(false)
+{
+}
+
+void EventReceiverGroup::EndSendEvent()
+{
+    assert(inSend_ > 0);
+    --inSend_;
+    
+    if (!inSend_ && dirty_)
     {
-        for (HashMap<StringHash, HashSet<Object*> >::Iterator j = i->second_.Begin(); j != i->second_.End(); ++j)
+        // Compact the holes left by handlers removed during send
+        unsigned j = 0;
+        for (unsigned i = 0; i < handlers_.Size(); ++i)
         {
-            for (HashSet<Object*>::Iterator k = j->second_.Begin(); k != j->second_.End(); ++k)
-                (*k)->RemoveEventSender(sender);
+            EventHandler* handler = handlers_[i];
+            if (handler)
+            {
+                handler->groupIndex_ = j;
+                handlers_[j++] = handler;
+            }
         }
-        specificEventReceivers_.Erase(i);
+        handlers_.Resize(j);
+        ++version_;
+        dirty_ = false;
     }
 }
 
-void Context::RemoveEventReceiver(Object* receiver, StringHash eventType)
+void EventReceiverGroup::Add(EventHandler* handler)
 {
-    HashSet<Object*>* group = GetEventReceivers(eventType);
-    if (group)
-        group->Erase(receiver);
+    handler->groupIndex_ = handlers_.Size();
+    handlers_.Push(handler);
+    ++version_;
 }
 
-void Context::RemoveEventReceiver(Object* receiver, Object* sender, StringHash eventType)
+void EventReceiverGroup::Remove(EventHandler* handler)
 {
-    HashSet<Object*>* group = GetEventReceivers(sender, eventType);
-    if (group)
-        group->Erase(receiver);
+    unsigned index = handler->groupIndex_;
+    if (index >= handlers_.Size() || handlers_[index] != handler)
+        return;
+    
+    if (inSend_)
+    {
+        // Leave a hole so that the indices of the handlers not yet invoked stay valid
+        handlers_[index] = 0;
+        dirty_ = true;
+    }
+    else
+    {
+        EventHandler* last = handlers_.Back();
+        last->groupIndex_ = index;
+        handlers_[index] = last;
+        handlers_.Pop();
+    }
+    
+    handler->groupIndex_ = M_MAX_UNSIGNED;
+    ++version_;
+}
+
+void EventReceiverGroup::RemoveAll(PODVector<Object*>& receivers)
+{
+    for (unsigned i = 0; i < handlers_.Size(); ++i)
+    {
+        EventHandler* handler = handlers_[i];
+        if (handler)
+        {
+            receivers.Push(handler->GetReceiver());
+            handler->groupIndex_ = M_MAX_UNSIGNED;
+            handlers_[i] = 0;
+        }
+    }
+    
+    if (inSend_)
+        dirty_ = true;
+    else
+        handlers_.Clear();
+    ++version_;
+}
+
+bool EventReceiverGroup::UpdateNonSpecificIndices(Object* sender, StringHash eventType, EventReceiverGroup* nonSpecific)
+{
+    if (indicesVersion_ == version_ && nonSpecificVersion_ == nonSpecific->version_)
+        return true;
+    // Can not update while the indices are being iterated by an outer send
+    if (inSend_ > 1)
+        return false;
+    
+    nonSpecificIndices_.Clear();
+    for (unsigned i = 0; i < nonSpecific->handlers_.Size(); ++i)
+    {
+        EventHandler* handler = nonSpecific->handlers_[i];
+        if (handler && !handler->GetReceiver()->HasSubscribedToEvent(sender, eventType))
+            nonSpecificIndices_.Push(i);
+    }
+    
+    indicesVersion_ = version_;
+    nonSpecificVersion_ = nonSpecific->version_;
+    return true;
+}
+
+PostedEventQueue::PostedEventQueue(unsigned capacity) :
+    enqueuePosition_(0),
+    dequeuePosition_(0),
+    numOverflow_(0),
+    sending_(false)
+{
+    unsigned size = 1;
+    while (size < capacity)
+        size <<= 1;
+    
+    slots_ = new PostedEvent[size];
+    mask_ = size - 1;
+    for (unsigned i = 0; i < size; ++i)
+        slots_[i].sequence_ = (int)i;
+}
+
+PostedEventQueue::~PostedEventQueue()
+{
+    delete[] slots_;
+    slots_ = 0;
+    
+    for (PODVector<PostedEvent*>::Iterator i = overflow_.Begin(); i != overflow_.End(); ++i)
+        delete *i;
+    for (PODVector<PostedEvent*>::Iterator i = freeOverflow_.Begin(); i != freeOverflow_.End(); ++i)
+        delete *i;
+}
+
+void PostedEventQueue::Post(Object* sender, StringHash eventType, const VariantMap* eventData)
+{
+    if (!numOverflow_ && TryPost(sender, eventType, eventData))
+        return;
+    
+    MutexLock lock(overflowMutex_);
+    
+    PostedEvent* event;
+    if (freeOverflow_.Size())
+    {
+        event = freeOverflow_.Back();
+        freeOverflow_.Pop();
+    }
+    else
+        event = new PostedEvent();
+    
+    event->sender_ = sender;
+    event->eventType_ = eventType;
+    if (eventData)
+        event->eventData_ = *eventData;
+    overflow_.Push(event);
+    AtomicIncrement(&numOverflow_);
+}
+
+unsigned PostedEventQueue::Send()
+{
+    // Do not recurse if a handler sends the posted events
+    if (sending_)
+        return 0;
+    
+    sending_ = true;
+    unsigned numSent = 0;
+    
+    // Send only the events posted so far, so that the events posted by the handlers are left for the next call. Take the
+    // slot end position and the overflow events together, so that the overflow events are newer than the slots before the
+    // end position. As overflowing keeps the posts in the overflow list, they are also older than the slots after it
+    unsigned end;
+    {
+        MutexLock lock(overflowMutex_);
+        end = (unsigned)enqueuePosition_;
+        sendingOverflow_ = overflow_;
+        overflow_.Clear();
+    }
+    
+    unsigned position = (unsigned)dequeuePosition_;
+    while (position != end)
+    {
+        PostedEvent& slot = slots_[position & mask_];
+        int sequence = slot.sequence_;
+        AtomicFence();
+        // Stop at a slot that is still being written to
+        if (sequence != (int)(position + 1))
+            break;
+        
+        if (slot.sender_)
+        {
+            slot.sender_->SendEvent(slot.eventType_, slot.eventData_);
+            ++numSent;
+        }
+        
+        slot.sender_ = 0;
+        slot.eventData_.Clear();
+        ++position;
+        dequeuePosition_ = (int)position;
+        // Hand the slot back to the posting threads only after it has been cleared
+        AtomicFence();
+        slot.sequence_ = (int)(position + mask_);
+    }
+    
+    if (position != end)
+    {
+        // A slot was still being written to. Send the overflow events on a later call after the remaining slots, and keep
+        // posting to the overflow list meanwhile
+        if (sendingOverflow_.Size())
+        {
+            MutexLock lock(overflowMutex_);
+            sendingOverflow_.Push(overflow_);
+            overflow_ = sendingOverflow_;
+            sendingOverflow_.Clear();
+            numOverflow_ = (int)overflow_.Size();
+        }
+    }
+    else if (sendingOverflow_.Size())
+    {
+        for (unsigned i = 0; i < sendingOverflow_.Size(); ++i)
+        {
+            PostedEvent* event = sendingOverflow_[i];
+            if (event->sender_)
+            {
+                event->sender_->SendEvent(event->eventType_, event->eventData_);
+                ++numSent;
+            }
+            event->sender_ = 0;
+            event->eventData_.Clear();
+        }
+        
+        MutexLock lock(overflowMutex_);
+        freeOverflow_.Push(sendingOverflow_);
+        sendingOverflow_.Clear();
+        // Allow posting to the slots again only once the overflow list has been emptied
+        if (overflow_.Empty())
+            numOverflow_ = 0;
+    }
+    
+    sending_ = false;
+    return numSent;
+}
+
+void PostedEventQueue::RemoveSender(Object* sender)
+{
+    unsigned end = (unsigned)enqueuePosition_;
+    for (unsigned position = (unsigned)dequeuePosition_; position != end; ++position)
+    {
+        PostedEvent& slot = slots_[position & mask_];
+        int sequence = slot.sequence_;
+        AtomicFence();
+        if (sequence == (int)(position + 1) && slot.sender_ == sender)
+            slot.sender_ = 0;
+    }
+    
+    for (PODVector<PostedEvent*>::Iterator i = sendingOverflow_.Begin(); i != sendingOverflow_.End(); ++i)
+    {
+        if ((*i)->sender_ == sender)
+            (*i)->sender_ = 0;
+    }
+    
+    if (numOverflow_)
+    {
+        MutexLock lock(overflowMutex_);
+        for (PODVector<PostedEvent*>::Iterator i = overflow_.Begin(); i != overflow_.End(); ++i)
+        {
+            if ((*i)->sender_ == sender)
+                (*i)->sender_ = 0;
+        }
+    }
+}
+
+bool PostedEventQueue::TryPost(Object* sender, StringHash eventType, const VariantMap* eventData)
+{
+    PostedEvent* slot;
+    int position = enqueuePosition_;
+    
+    for (;;)
+    {
+        slot = &slots_[(unsigned)position & mask_];
+        int sequence = slot->sequence_;
+        AtomicFence();
+        int difference = (int)((unsigned)sequence - (unsigned)position);
+        
+        if (!difference)
+        {
+            // The slot is free, try to claim it
+            if (AtomicCompareExchange(&enqueuePosition_, (int)((unsigned)position + 1), position))
+                break;
+            position = enqueuePosition_;
+        }
+        else if (difference < 0)
+            return false;
+        else
+            position = enqueuePosition_;
+    }
+    
+    slot->sender_ = sender;
+    slot->eventType_ = eventType;
+    if (eventData)
+        slot->eventData_ = *eventData;
+    // Publish the slot to the main thread only after its contents have been written
+    AtomicFence();
+    slot->sequence_ = (int)((unsigned)position + 1);
+    return true;
 }
 
 }
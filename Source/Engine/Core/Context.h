@@ -25,10 +25,116 @@
 #include "Attribute.h"
 #include "Object.h"
 #include "HashSet.h"
+#include "Mutex.h"
 
 namespace Urho3D
 {
 
+/// Contiguous dispatch array of the event handlers for an event type, either from any sender or from a specific sender.
+class URHO3D_API EventReceiverGroup : public RefCounted
+{
+public:
+    /// Construct.
+    EventReceiverGroup();
+    
+    /// Begin event send. Handlers removed during send leave holes that are compacted afterward.
+    void BeginSendEvent() { ++inSend_; }
+    /// End event send. Compact if necessary.
+    void EndSendEvent();
+    /// Add an event handler.
+    void Add(EventHandler* handler);
+    /// Remove an event handler.
+    void Remove(EventHandler* handler);
+    /// Remove all event handlers. Return their receivers.
+    void RemoveAll(PODVector<Object*>& receivers);
+    /// Update the indices of the non-specific handlers to invoke after the handlers of this specific sender's group. Return false if they can not be updated during an ongoing send.
+    bool UpdateNonSpecificIndices(Object* sender, StringHash eventType, EventReceiverGroup* nonSpecific);
+    
+    /// Event handlers. Null for handlers removed during send.
+    PODVector<EventHandler*> handlers_;
+    /// Indices of the non-specific handlers whose receivers do not have a handler for this specific sender.
+    PODVector<unsigned> nonSpecificIndices_;
+    /// Version number, incremented whenever handlers are added, removed or moved.
+    unsigned version_;
+    
+private:
+    /// Version number of this group when the non-specific indices were updated.
+    unsigned indicesVersion_;
+    /// Version number of the non-specific group when the non-specific indices were updated.
+    unsigned nonSpecificVersion_;
+    /// Send nesting level.
+    unsigned inSend_;
+    /// Whether handlers were removed during send.
+    bool dirty_;
+};
+
+/// Event posted from any thread, waiting to be sent in the main thread.
+struct PostedEvent
+{
+    /// Construct.
+    PostedEvent() :
+        sequence_(0),
+        sender_(0)
+    {
+    }
+    
+    /// Sequence number used to hand the slot over between the posting threads and the main thread.
+    volatile int sequence_;
+    /// Sender. Null if destroyed before the event was sent.
+    Object* sender_;
+    /// Event type.
+    StringHash eventType_;
+    /// Event parameters. Cleared after sending, keeping the allocated nodes for reuse.
+    VariantMap eventData_;
+};
+
+/// Multiple-producer, single-consumer queue of posted events. Posting is lock-free until the preallocated slots run out, after which events go to a mutex-guarded overflow list until a send has emptied it.
+class URHO3D_API PostedEventQueue
+{
+public:
+    /// Construct with number of slots, rounded up to a power of two.
+    PostedEventQueue(unsigned capacity);
+    /// Destruct.
+    ~PostedEventQueue();
+    
+    /// Post an event. Can be called from any thread.
+    void Post(Object* sender, StringHash eventType, const VariantMap* eventData);
+    /// Send the events posted so far. Return number of events sent. Events posted during the send are left for the next call. Must be called from the main thread.
+    unsigned Send();
+    /// Clear the sender of the pending events from an object being destroyed. Must be called from the main thread.
+    void RemoveSender(Object* sender);
+    
+    /// Return number of preallocated slots.
+    unsigned GetCapacity() const { return mask_ + 1; }
+    /// Return whether there are no pending events.
+    bool IsEmpty() const { return enqueuePosition_ == dequeuePosition_ && !numOverflow_; }
+    
+private:
+    /// Try to post an event to a preallocated slot. Return false if all slots are in use.
+    bool TryPost(Object* sender, StringHash eventType, const VariantMap* eventData);
+    
+    /// Preallocated slots.
+    PostedEvent* slots_;
+    /// Slot index mask.
+    unsigned mask_;
+    /// Position of the next slot to post to.
+    volatile int enqueuePosition_;
+    /// Position of the next slot to send from.
+    volatile int dequeuePosition_;
+    /// Overflow events in posting order.
+    PODVector<PostedEvent*> overflow_;
+    /// Overflow events being sent.
+    PODVector<PostedEvent*> sendingOverflow_;
+    /// Overflow events to reuse.
+    PODVector<PostedEvent*> freeOverflow_;
+    /// Number of overflow events. Once nonzero, events are posted to the overflow list until a send has emptied it, to preserve their order.
+    volatile int numOverflow_;
+    /// Overflow list mutex.
+    Mutex overflowMutex_;
+    /// Send in progress flag.
+    bool sending_;
+};
+
 /// Urho3D execution context. Provides access to subsystems, object factories and attributes, and event receivers.
 class URHO3D_API Context : public RefCounted
 {
@@ -56,8 +162,12 @@ public:
     void RemoveAttribute(StringHash objectType, const char* name);
     /// Update object attribute's default value.
     void UpdateAttributeDefaultValue(StringHash objectType, const char* name, const Variant& defaultValue);
+    /// Update object attribute's network quantization: value range and bits per component. Zero bits sends full precision.
+    void UpdateAttributeQuantization(StringHash objectType, const char* name, float min, float max, unsigned bits);
     /// Return a preallocated map for event data. Used for optimization to avoid constant re-allocation of event data maps.
     VariantMap& GetEventDataMap();
+    /// Send the events posted so far from any thread. Return number of events sent. Must be called from the main thread. Called by Engine once per frame.
+    unsigned SendPostedEvents();
 
     /// Copy base class attributes to derived class.
     void CopyBaseAttributes(StringHash baseType, StringHash derivedType);
@@ -75,6 +185,8 @@ public:
     template <class T, class U> void CopyBaseAttributes();
     /// Template version of updating an object attribute's default value.
     template <class T> void UpdateAttributeDefaultValue(const char* name, const Variant& defaultValue);
+    /// Template version of updating an object attribute's network quantization.
+    template <class T> void UpdateAttributeQuantization(const char* name, float min, float max, unsigned bits);
 
     /// Return subsystem by type.
     Object* GetSubsystem(StringHash type) const;
@@ -115,42 +227,42 @@ public:
     const HashMap<StringHash, Vector<AttributeInfo> >& GetAllAttributes() const { return attributes_; }
 
     /// Return event receivers for a sender and event type, or null if they do not exist.
-    HashSet<Object*>* GetEventReceivers(Object* sender, StringHash eventType)
+    EventReceiverGroup* GetEventReceivers(Object* sender, StringHash eventType)
     {
-        HashMap<Object*, HashMap<StringHash, HashSet<Object*> > >::Iterator i = specificEventReceivers_.Find(sender);
+        HashMap<Object*, HashMap<StringHash, SharedPtr<EventReceiverGroup> > >::Iterator i = specificEventReceivers_.Find(sender);
         if (i != specificEventReceivers_.End())
         {
-            HashMap<StringHash, HashSet<Object*> >::Iterator j = i->second_.Find(eventType);
-            return j != i->second_.End() ? &j->second_ : 0;
+            HashMap<StringHash, SharedPtr<EventReceiverGroup> >::Iterator j = i->second_.Find(eventType);
+            return j != i->second_.End() ? j->second_.Get() : 0;
         }
         else
             return 0;
     }
 
     /// Return event receivers for an event type, or null if they do not exist.
-    HashSet<Object*>* GetEventReceivers(StringHash eventType)
+    EventReceiverGroup* GetEventReceivers(StringHash eventType)
     {
-        HashMap<StringHash, HashSet<Object*> >::Iterator i = eventReceivers_.Find(eventType);
-        return i != eventReceivers_.End() ? &i->second_ : 0;
+        HashMap<StringHash, SharedPtr<EventReceiverGroup> >::Iterator i = eventReceivers_.Find(eventType);
+        return i != eventReceivers_.End() ? i->second_.Get() : 0;
     }
 
 private:
-    /// Add event receiver.
-    void AddEventReceiver(Object* receiver, StringHash eventType);
-    /// Add event receiver for specific event.
-    void AddEventReceiver(Object* receiver, Object* sender, StringHash eventType);
+    /// Add event handler to the receivers of its sender and event type.
+    void AddEventReceiver(EventHandler* handler);
     /// Remove an event sender from all receivers. Called on its destruction.
     void RemoveEventSender(Object* sender);
-    /// Remove event receiver from specific events.
-    void RemoveEventReceiver(Object* receiver, Object* sender, StringHash eventType);
-    /// Remove event receiver from non-specific events.
-    void RemoveEventReceiver(Object* receiver, StringHash eventType);
+    /// Remove event handler from the receivers of its sender and event type.
+    void RemoveEventReceiver(EventHandler* handler);
     /// Set current event handler. Called by Object.
     void SetEventHandler(EventHandler* handler) { eventHandler_ = handler; }
     /// Begin event send.
     void BeginSendEvent(Object* sender) { eventSenders_.Push(sender); }
     /// End event send. Clean up event receivers removed in the meanwhile.
     void EndSendEvent() { eventSenders_.Pop(); }
+    /// Return a preallocated map for converting a typed event payload for handlers that take a VariantMap.
+    VariantMap& GetTypedEventDataMap();
+    /// Post an event to be sent later in the main thread. Called by Object.
+    void PostEvent(Object* sender, StringHash eventType, const VariantMap* eventData) { postedEvents_.Post(sender, eventType, eventData); }
 
     /// Object factories.
     HashMap<StringHash, SharedPtr<ObjectFactory> > factories_;
@@ -161,13 +273,17 @@ private:
     /// Network replication attribute descriptions per object type.
     HashMap<StringHash, Vector<AttributeInfo> > networkAttributes_;
     /// Event receivers for non-specific events.
-    HashMap<StringHash, HashSet<Object*> > eventReceivers_;
+    HashMap<StringHash, SharedPtr<EventReceiverGroup> > eventReceivers_;
     /// Event receivers for specific senders' events.
-    HashMap<Object*, HashMap<StringHash, HashSet<Object*> > > specificEventReceivers_;
+    HashMap<Object*, HashMap<StringHash, SharedPtr<EventReceiverGroup> > > specificEventReceivers_;
     /// Event sender stack.
     PODVector<Object*> eventSenders_;
     /// Event data stack.
     PODVector<VariantMap*> eventDataMaps_;
+    /// Typed event payload conversion map stack.
+    PODVector<VariantMap*> typedEventDataMaps_;
+    /// Events posted from any thread.
+    PostedEventQueue postedEvents_;
     /// Active event handler. Not stored in a stack for performance reasons; is needed only in esoteric cases.
     EventHandler* eventHandler_;
     /// Object categories.
@@ -183,5 +299,6 @@ template <class T, class U> void Context::CopyBaseAttributes() { CopyBaseAttribu
 template <class T> T* Context::GetSubsystem() const { return static_cast<T*>(GetSubsystem(T::GetTypeStatic())); }
 template <class T> AttributeInfo* Context::GetAttribute(const char* name) { return GetAttribute(T::GetTypeStatic(), name); }
 template <class T> void Context::UpdateAttributeDefaultValue(const char* name, const Variant& defaultValue) { UpdateAttributeDefaultValue(T::GetTypeStatic(), name, defaultValue); }
+template <class T> void Context::UpdateAttributeQuantization(const char* name, float min, float max, unsigned bits) { UpdateAttributeQuantization(T::GetTypeStatic(), name, min, max, bits); }
 
 }
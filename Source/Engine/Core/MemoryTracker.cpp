@@ -0,0 +1,264 @@
+//
+// Copyright (c) 2008-2014 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "Precompiled.h"
+#include "Atomic.h"
+#include "MemoryTracker.h"
+#include "Thread.h"
+
+#include <cstdlib>
+#include <new>
+
+// DebugNew.h is not included, as this file replaces the global operator new and delete when tracking is enabled
+
+namespace Urho3D
+{
+
+static const char* memoryCategoryNames[] =
+{
+    "Other",
+    "Resource",
+    "Scene",
+    "Graphics",
+    "Physics",
+    "Network",
+    "UI",
+    "Audio",
+    "Threads",
+    0
+};
+
+#ifdef URHO3D_MEMORY_TRACKING
+
+/// Heap allocation counters of a memory category.
+struct MemoryCounters
+{
+    /// Bytes currently allocated.
+    volatile long long liveBytes_;
+    /// Highest number of bytes allocated at once.
+    volatile long long peakBytes_;
+    /// Bytes allocated since startup.
+    volatile long long totalBytes_;
+    /// Number of allocations currently live.
+    volatile int liveAllocations_;
+    /// Number of allocations made since startup.
+    volatile int totalAllocations_;
+};
+
+/// Header stored before each tracked allocation.
+struct AllocationHeader
+{
+    /// Requested size.
+    size_t size_;
+    /// Memory category.
+    unsigned category_;
+};
+
+/// Space reserved for the header, so that the returned memory keeps the alignment guaranteed by malloc.
+static const size_t ALLOCATION_HEADER_SIZE = 16;
+
+// Static storage is zero-initialized before any dynamic initialization, so the counters are valid for the allocations made
+// during static construction
+static MemoryCounters memoryCounters[MAX_MEMORY_CATEGORIES];
+static MemoryCounters totalMemoryCounters;
+static MemoryCategory currentMemoryCategory = MEMCAT_OTHER;
+
+static void CountAllocation(MemoryCounters& counters, long long size)
+{
+    long long liveBytes = AtomicAdd64(&counters.liveBytes_, size);
+    long long peakBytes = counters.peakBytes_;
+    while (liveBytes > peakBytes && !AtomicCompareExchange64(&counters.peakBytes_, liveBytes, peakBytes))
+        peakBytes = counters.peakBytes_;
+    
+    AtomicAdd64(&counters.totalBytes_, size);
+    AtomicIncrement(&counters.liveAllocations_);
+    AtomicIncrement(&counters.totalAllocations_);
+}
+
+static void CountFree(MemoryCounters& counters, long long size)
+{
+    AtomicAdd64(&counters.liveBytes_, -size);
+    AtomicDecrement(&counters.liveAllocations_);
+}
+
+static MemoryStats GetStats(const MemoryCounters& counters)
+{
+    MemoryStats stats;
+    stats.liveBytes_ = counters.liveBytes_;
+    stats.peakBytes_ = counters.peakBytes_;
+    stats.totalBytes_ = counters.totalBytes_;
+    stats.liveAllocations_ = (unsigned)counters.liveAllocations_;
+    stats.totalAllocations_ = (unsigned)counters.totalAllocations_;
+    return stats;
+}
+
+static void* TrackedAllocate(size_t size)
+{
+    unsigned char* block = static_cast<unsigned char*>(malloc(size + ALLOCATION_HEADER_SIZE));
+    if (!block)
+        return 0;
+    
+    MemoryCategory category = Thread::IsMainThread() ? currentMemoryCategory : MEMCAT_THREADS;
+    AllocationHeader* header = reinterpret_cast<AllocationHeader*>(block);
+    header->size_ = size;
+    header->category_ = category;
+    CountAllocation(memoryCounters[category], (long long)size);
+    CountAllocation(totalMemoryCounters, (long long)size);
+    
+    return block + ALLOCATION_HEADER_SIZE;
+}
+
+static void TrackedFree(void* ptr)
+{
+    if (!ptr)
+        return;
+    
+    unsigned char* block = static_cast<unsigned char*>(ptr) - ALLOCATION_HEADER_SIZE;
+    AllocationHeader* header = reinterpret_cast<AllocationHeader*>(block);
+    CountFree(memoryCounters[header->category_], (long long)header->size_);
+    CountFree(totalMemoryCounters, (long long)header->size_);
+    
+    free(block);
+}
+
+bool IsMemoryTrackingSupported()
+{
+    return true;
+}
+
+MemoryCategory SetMemoryCategory(MemoryCategory category)
+{
+    MemoryCategory previous = currentMemoryCategory;
+    if (Thread::IsMainThread() && category < MAX_MEMORY_CATEGORIES)
+        currentMemoryCategory = category;
+    return previous;
+}
+
+MemoryCategory GetMemoryCategory()
+{
+    return currentMemoryCategory;
+}
+
+MemoryStats GetMemoryStats(MemoryCategory category)
+{
+    return category < MAX_MEMORY_CATEGORIES ? GetStats(memoryCounters[category]) : MemoryStats();
+}
+
+MemoryStats GetTotalMemoryStats()
+{
+    return GetStats(totalMemoryCounters);
+}
+
+#else
+
+bool IsMemoryTrackingSupported()
+{
+    return false;
+}
+
+MemoryCategory SetMemoryCategory(MemoryCategory category)
+{
+    return MEMCAT_OTHER;
+}
+
+MemoryCategory GetMemoryCategory()
+{
+    return MEMCAT_OTHER;
+}
+
+MemoryStats GetMemoryStats(MemoryCategory category)
+{
+    return MemoryStats();
+}
+
+MemoryStats GetTotalMemoryStats()
+{
+    return MemoryStats();
+}
+
+#endif
+
+const char* GetMemoryCategoryName(MemoryCategory category)
+{
+    return category < MAX_MEMORY_CATEGORIES ? memoryCategoryNames[category] : "";
+}
+
+}
+
+#ifdef URHO3D_MEMORY_TRACKING
+
+#if __cplusplus >= 201103L
+#define NEW_THROW_SPEC
+#define NEW_NOTHROW_SPEC noexcept
+#else
+#define NEW_THROW_SPEC throw(std::bad_alloc)
+#define NEW_NOTHROW_SPEC throw()
+#endif
+
+void* operator new(size_t size) NEW_THROW_SPEC
+{
+    void* ptr = Urho3D::TrackedAllocate(size);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](size_t size) NEW_THROW_SPEC
+{
+    void* ptr = Urho3D::TrackedAllocate(size);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) NEW_NOTHROW_SPEC
+{
+    return Urho3D::TrackedAllocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) NEW_NOTHROW_SPEC
+{
+    return Urho3D::TrackedAllocate(size);
+}
+
+void operator delete(void* ptr) NEW_NOTHROW_SPEC
+{
+    Urho3D::TrackedFree(ptr);
+}
+
+void operator delete[](void* ptr) NEW_NOTHROW_SPEC
+{
+    Urho3D::TrackedFree(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) NEW_NOTHROW_SPEC
+{
+    Urho3D::TrackedFree(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) NEW_NOTHROW_SPEC
+{
+    Urho3D::TrackedFree(ptr);
+}
+
+#endif
@@ -0,0 +1,111 @@
+//
+// Copyright (c) 2008-2014 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "Urho3D.h"
+
+namespace Urho3D
+{
+
+/// Subsystem category of tracked heap allocations.
+enum MemoryCategory
+{
+    MEMCAT_OTHER = 0,
+    MEMCAT_RESOURCE,
+    MEMCAT_SCENE,
+    MEMCAT_GRAPHICS,
+    MEMCAT_PHYSICS,
+    MEMCAT_NETWORK,
+    MEMCAT_UI,
+    MEMCAT_AUDIO,
+    MEMCAT_THREADS,
+    MAX_MEMORY_CATEGORIES
+};
+
+/// Heap allocation statistics of a memory category.
+struct MemoryStats
+{
+    /// Construct.
+    MemoryStats() :
+        liveBytes_(0),
+        peakBytes_(0),
+        totalBytes_(0),
+        liveAllocations_(0),
+        totalAllocations_(0)
+    {
+    }
+    
+    /// Bytes currently allocated.
+    long long liveBytes_;
+    /// Highest number of bytes allocated at once.
+    long long peakBytes_;
+    /// Bytes allocated since startup.
+    long long totalBytes_;
+    /// Number of allocations currently live.
+    unsigned liveAllocations_;
+    /// Number of allocations made since startup.
+    unsigned totalAllocations_;
+};
+
+/// Return whether heap allocation tracking has been compiled in.
+URHO3D_API bool IsMemoryTrackingSupported();
+/// Set the category of the main thread's subsequent heap allocations and return the previous category. Allocations in other threads always use MEMCAT_THREADS.
+URHO3D_API MemoryCategory SetMemoryCategory(MemoryCategory category);
+/// Return the category of the main thread's heap allocations.
+URHO3D_API MemoryCategory GetMemoryCategory();
+/// Return heap allocation statistics of a category.
+URHO3D_API MemoryStats GetMemoryStats(MemoryCategory category);
+/// Return heap allocation statistics of all categories combined.
+URHO3D_API MemoryStats GetTotalMemoryStats();
+/// Return the name of a category.
+URHO3D_API const char* GetMemoryCategoryName(MemoryCategory category);
+
+/// Helper class for setting the memory category for the duration of a scope.
+class URHO3D_API MemoryCategoryScope
+{
+public:
+    /// Construct. Set the category.
+    MemoryCategoryScope(MemoryCategory category) :
+        previous_(SetMemoryCategory(category))
+    {
+    }
+    
+    /// Destruct. Restore the previous category.
+    ~MemoryCategoryScope()
+    {
+        SetMemoryCategory(previous_);
+    }
+    
+private:
+    /// Previous category.
+    MemoryCategory previous_;
+};
+
+#ifdef URHO3D_MEMORY_TRACKING
+#define MEMORY_CATEGORY(category) Urho3D::MemoryCategoryScope memoryCategory_(category)
+#else
+#define MEMORY_CATEGORY(category)
+#endif
+
+}
@@ -44,41 +44,39 @@ Object::~Object()
 
 void Object::OnEvent(Object* sender, StringHash eventType, VariantMap& eventData)
 {
+    EventHandler* handler = GetDispatchedEventHandler(sender, eventType);
+    if (handler)
+        InvokeEventHandler(handler, eventData);
+}
+
+void Object::OnTypedEvent(Object* sender, StringHash eventType, EventData& eventData)
+{
+    EventHandler* handler = GetDispatchedEventHandler(sender, eventType);
+    if (!handler)
+        return;
+    
     // Make a copy of the context pointer in case the object is destroyed during event handler invocation
     Context* context = context_;
-    EventHandler* specific = 0;
-    EventHandler* nonSpecific = 0;
-    
-    EventHandler* handler = eventHandlers_.First();
-    while (handler)
-    {
-        if (handler->GetEventType() == eventType)
-        {
-            if (!handler->GetSender())
-                nonSpecific = handler;
-            else if (handler->GetSender() == sender)
-            {
-                specific = handler;
-                break;
-            }
-        }
-        handler = eventHandlers_.Next(handler);
-    }
+    context->SetEventHandler(handler);
     
-    // Specific event handlers have priority, so if found, invoke first
-    if (specific)
+    if (handler->InvokeTyped(eventData))
     {
-        context->SetEventHandler(specific);
-        specific->Invoke(eventData);
+        // The handler may have modified the payload, so a previous conversion is no longer up to date
+        eventData.convertedData_ = 0;
         context->SetEventHandler(0);
-        return;
     }
-    
-    if (nonSpecific)
+    else
     {
-        context->SetEventHandler(nonSpecific);
-        nonSpecific->Invoke(eventData);
-        context->SetEventHandler(0);
+        // The handler takes a VariantMap: convert the payload once per send, handle it through OnEvent(), then copy back
+        // any changes the handler made
+        if (!eventData.convertedData_)
+        {
+            eventData.convertedData_ = &context->GetTypedEventDataMap();
+            eventData.ToVariantMap(*eventData.convertedData_);
+        }
+        VariantMap& convertedData = *eventData.convertedData_;
+        OnEvent(sender, eventType, convertedData);
+        eventData.FromVariantMap(convertedData);
     }
 }
 
@@ -88,15 +86,7 @@ void Object::SubscribeToEvent(StringHash eventType, EventHandler* handler)
         return;
     
     handler->SetSenderAndEventType(0, eventType);
-    // Remove old event handler first
-    EventHandler* previous;
-    EventHandler* oldHandler = FindSpecificEventHandler(0, eventType, &previous);
-    if (oldHandler)
-        eventHandlers_.Erase(oldHandler, previous);
-    
-    eventHandlers_.InsertFront(handler);
-    
-    context_->AddEventReceiver(this, eventType);
+    AddEventHandler(handler);
 }
 
 void Object::SubscribeToEvent(Object* sender, StringHash eventType, EventHandler* handler)
@@ -109,15 +99,7 @@ void Object::SubscribeToEvent(Object* sender, StringHash eventType, EventHandler
     }
     
     handler->SetSenderAndEventType(sender, eventType);
-    // Remove old event handler first
-    EventHandler* previous;
-    EventHandler* oldHandler = FindSpecificEventHandler(sender, eventType, &previous);
-    if (oldHandler)
-        eventHandlers_.Erase(oldHandler, previous);
-    
-    eventHandlers_.InsertFront(handler);
-    
-    context_->AddEventReceiver(this, sender, eventType);
+    AddEventHandler(handler);
 }
 
 void Object::UnsubscribeFromEvent(StringHash eventType)
@@ -127,13 +109,7 @@ void Object::UnsubscribeFromEvent(StringHash eventType)
         EventHandler* previous;
         EventHandler* handler = FindEventHandler(eventType, &previous);
         if (handler)
-        {
-            if (handler->GetSender())
-                context_->RemoveEventReceiver(this, handler->GetSender(), eventType);
-            else
-                context_->RemoveEventReceiver(this, eventType);
-            eventHandlers_.Erase(handler, previous);
-        }
+            RemoveEventHandler(handler, previous);
         else
             break;
     }
@@ -147,10 +123,7 @@ void Object::UnsubscribeFromEvent(Object* sender, StringHash eventType)
     EventHandler* previous;
     EventHandler* handler = FindSpecificEventHandler(sender, eventType, &previous);
     if (handler)
-    {
-        context_->RemoveEventReceiver(this, handler->GetSender(), eventType);
-        eventHandlers_.Erase(handler, previous);
-    }
+        RemoveEventHandler(handler, previous);
 }
 
 void Object::UnsubscribeFromEvents(Object* sender)
@@ -163,10 +136,7 @@ void Object::UnsubscribeFromEvents(Object* sender)
         EventHandler* previous;
         EventHandler* handler = FindSpecificEventHandler(sender, &previous);
         if (handler)
-        {
-            context_->RemoveEventReceiver(this, handler->GetSender(), handler->GetEventType());
-            eventHandlers_.Erase(handler, previous);
-        }
+            RemoveEventHandler(handler, previous);
         else
             break;
     }
@@ -178,13 +148,7 @@ void Object::UnsubscribeFromAllEvents()
     {
         EventHandler* handler = eventHandlers_.First();
         if (handler)
-        {
-            if (handler->GetSender())
-                context_->RemoveEventReceiver(this, handler->GetSender(), handler->GetEventType());
-            else
-                context_->RemoveEventReceiver(this, handler->GetEventType());
-            eventHandlers_.Erase(handler);
-        }
+            RemoveEventHandler(handler, 0);
         else
             break;
     }
@@ -200,14 +164,7 @@ void Object::UnsubscribeFromAllEventsExcept(const PODVector<StringHash>& excepti
         EventHandler* next = eventHandlers_.Next(handler);
         
         if ((!onlyUserData || handler->GetUserData()) && !exceptions.Contains(handler->GetEventType()))
-        {
-            if (handler->GetSender())
-                context_->RemoveEventReceiver(this, handler->GetSender(), handler->GetEventType());
-            else
-                context_->RemoveEventReceiver(this, handler->GetEventType());
-            
-            eventHandlers_.Erase(handler, previous);
-        }
+            RemoveEventHandler(handler, previous);
         else
             previous = handler;
 
@@ -223,110 +180,130 @@ void Object::SendEvent(StringHash eventType)
 }
 
 void Object::SendEvent(StringHash eventType, VariantMap& eventData)
+{
+    SendEvent(eventType, &eventData, 0);
+}
+
+void Object::SendEvent(StringHash eventType, EventData& eventData)
+{
+    eventData.convertedData_ = 0;
+    SendEvent(eventType, 0, &eventData);
+    eventData.convertedData_ = 0;
+}
+
+void Object::SendEvent(StringHash eventType, VariantMap* eventData, EventData* typedEventData)
 {
     if (!Thread::IsMainThread())
     {
-        LOGERROR("Sending events is only supported from the main thread");
+        LOGERROR("Sending events is only supported from the main thread, use PostEvent() from other threads");
         return;
     }
     
+    Context* context = context_;
+    // Hold the receiver groups, as they may be removed as a result of event handling
+    SharedPtr<EventReceiverGroup> specific(context->GetEventReceivers(this, eventType));
+    SharedPtr<EventReceiverGroup> nonSpecific(context->GetEventReceivers(eventType));
+    if (!specific && !nonSpecific)
+        return;
+    
     // Make a weak pointer to self to check for destruction during event handling
     WeakPtr<Object> self(this);
-    Context* context = context_;
-    HashSet<Object*> processed;
     
     context->BeginSendEvent(this);
+    if (specific)
+        specific->BeginSendEvent();
+    if (nonSpecific)
+        nonSpecific->BeginSendEvent();
     
-    // Check first the specific event receivers
-    const HashSet<Object*>* group = context->GetEventReceivers(this, eventType);
-    if (group)
+    // Check first the specific event receivers. Handlers subscribed during the send are not invoked
+    if (specific)
     {
-        for (HashSet<Object*>::ConstIterator i = group->Begin(); i != group->End();)
+        unsigned numHandlers = specific->handlers_.Size();
+        for (unsigned i = 0; i < numHandlers; ++i)
         {
-            HashSet<Object*>::ConstIterator current = i++;
-            Object* receiver = *current;
-            Object* next = 0;
-            if (i != group->End())
-                next = *i;
+            EventHandler* handler = specific->handlers_[i];
+            if (!handler)
+                continue;
             
-            unsigned oldSize = group->Size();
-            receiver->OnEvent(this, eventType, eventData);
+            DispatchEvent(handler, eventType, eventData, typedEventData);
             
             // If self has been destroyed as a result of event handling, exit
             if (self.Expired())
-            {
-                context->EndSendEvent();
-                return;
-            }
-            
-            // If group has changed size during iteration (removed/added subscribers) try to recover
-            /// \todo This is not entirely foolproof, as a subscriber could have been added to make up for the removed one
-            if (group->Size() != oldSize)
-                i = group->Find(next);
-            
-            processed.Insert(receiver);
+                break;
         }
     }
     
     // Then the non-specific receivers
-    group = context->GetEventReceivers(eventType);
-    if (group)
+    if (nonSpecific && !self.Expired())
     {
-        if (processed.Empty())
+        if (!specific || specific->handlers_.Empty())
         {
-            for (HashSet<Object*>::ConstIterator i = group->Begin(); i != group->End();)
+            unsigned numHandlers = nonSpecific->handlers_.Size();
+            for (unsigned i = 0; i < numHandlers; ++i)
             {
-                HashSet<Object*>::ConstIterator current = i++;
-                Object* receiver = *current;
-                Object* next = 0;
-                if (i != group->End())
-                    next = *i;
+                EventHandler* handler = nonSpecific->handlers_[i];
+                if (!handler)
+                    continue;
                 
-                unsigned oldSize = group->Size();
-                receiver->OnEvent(this, eventType, eventData);
+                DispatchEvent(handler, eventType, eventData, typedEventData);
                 
                 if (self.Expired())
-                {
-                    context->EndSendEvent();
-                    return;
-                }
+                    break;
+            }
+        }
+        else if (specific->UpdateNonSpecificIndices(this, eventType, nonSpecific))
+        {
+            // If there were specific receivers, skip them using the cached dispatch indices. The indices of the
+            // non-specific handlers stay valid during the send, as removed handlers only leave holes
+            unsigned numIndices = specific->nonSpecificIndices_.Size();
+            for (unsigned i = 0; i < numIndices; ++i)
+            {
+                EventHandler* handler = nonSpecific->handlers_[specific->nonSpecificIndices_[i]];
+                if (!handler)
+                    continue;
+                
+                DispatchEvent(handler, eventType, eventData, typedEventData);
                 
-                if (group->Size() != oldSize)
-                    i = group->Find(next);
+                if (self.Expired())
+                    break;
             }
         }
         else
         {
-            // If there were specific receivers, check that the event is not sent doubly to them
-            for (HashSet<Object*>::ConstIterator i = group->Begin(); i != group->End();)
+            // The cached indices are in use by an outer send of the same event and can not be updated, so check
+            // each receiver instead
+            unsigned numHandlers = nonSpecific->handlers_.Size();
+            for (unsigned i = 0; i < numHandlers; ++i)
             {
-                HashSet<Object*>::ConstIterator current = i++;
-                Object* receiver = *current;
-                Object* next = 0;
-                if (i != group->End())
-                    next = *i;
+                EventHandler* handler = nonSpecific->handlers_[i];
+                if (!handler || handler->GetReceiver()->HasSubscribedToEvent(this, eventType))
+                    continue;
+                
+                DispatchEvent(handler, eventType, eventData, typedEventData);
                 
-                if (!processed.Contains(receiver))
-                {
-                    unsigned oldSize = group->Size();
-                    receiver->OnEvent(this, eventType, eventData);
-                    
-                    if (self.Expired())
-                    {
-                        context->EndSendEvent();
-                        return;
-                    }
-                    
-                    if (group->Size() != oldSize)
-                        i = group->Find(next);
-                }
+                if (self.Expired())
+                    break;
             }
         }
     }
     
+    if (nonSpecific)
+        nonSpecific->EndSendEvent();
+    if (specific)
+        specific->EndSendEvent();
     context->EndSendEvent();
 }
 
+void Object::PostEvent(StringHash eventType)
+{
+    context_->PostEvent(this, eventType, 0);
+}
+
+void Object::PostEvent(StringHash eventType, const VariantMap& eventData)
+{
+    context_->PostEvent(this, eventType, &eventData);
+}
+
 VariantMap& Object::GetEventDataMap() const
 {
     return context_->GetEventDataMap();
@@ -372,6 +349,77 @@ const String& Object::GetCategory() const
     return String::EMPTY;
 }
 
+void Object::DispatchEvent(EventHandler* handler, StringHash eventType, VariantMap* eventData, EventData* typedEventData)
+{
+    // Go through the receiver's virtual event handling functions. The handler is stored in the context, so that the default
+    // implementations do not need to search for it. Make a copy of the context pointer in case self is destroyed
+    Context* context = context_;
+    Object* receiver = handler->GetReceiver();
+    context->SetEventHandler(handler);
+    if (eventData)
+        receiver->OnEvent(this, eventType, *eventData);
+    else
+        receiver->OnTypedEvent(this, eventType, *typedEventData);
+    context->SetEventHandler(0);
+}
+
+void Object::InvokeEventHandler(EventHandler* handler, VariantMap& eventData)
+{
+    // Make a copy of the context pointer in case the object is destroyed during event handler invocation
+    Context* context = context_;
+    context->SetEventHandler(handler);
+    handler->Invoke(eventData);
+    context->SetEventHandler(0);
+}
+
+void Object::AddEventHandler(EventHandler* handler)
+{
+    // Remove old event handler first
+    EventHandler* previous;
+    EventHandler* oldHandler = FindSpecificEventHandler(handler->GetSender(), handler->GetEventType(), &previous);
+    if (oldHandler)
+        RemoveEventHandler(oldHandler, previous);
+    
+    eventHandlers_.InsertFront(handler);
+    context_->AddEventReceiver(handler);
+}
+
+void Object::RemoveEventHandler(EventHandler* handler, EventHandler* previous)
+{
+    context_->RemoveEventReceiver(handler);
+    eventHandlers_.Erase(handler, previous);
+}
+
+EventHandler* Object::SelectEventHandler(Object* sender, StringHash eventType) const
+{
+    EventHandler* nonSpecific = 0;
+    
+    EventHandler* handler = eventHandlers_.First();
+    while (handler)
+    {
+        if (handler->GetEventType() == eventType)
+        {
+            if (!handler->GetSender())
+                nonSpecific = handler;
+            else if (handler->GetSender() == sender)
+                return handler;
+        }
+        handler = eventHandlers_.Next(handler);
+    }
+    
+    return nonSpecific;
+}
+
+EventHandler* Object::GetDispatchedEventHandler(Object* sender, StringHash eventType) const
+{
+    EventHandler* handler = context_->GetEventHandler();
+    if (handler && handler->GetReceiver() == this && handler->GetEventType() == eventType && (!handler->GetSender() ||
+        handler->GetSender() == sender))
+        return handler;
+    else
+        return SelectEventHandler(sender, eventType);
+}
+
 EventHandler* Object::FindEventHandler(StringHash eventType, EventHandler** previous) const
 {
     EventHandler* handler = eventHandlers_.First();
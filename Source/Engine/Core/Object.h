@@ -29,6 +29,7 @@ namespace Urho3D
 {
 
 class Context;
+class EventData;
 class EventHandler;
 
 #define OBJECT(typeName) \
@@ -65,6 +66,8 @@ public:
     virtual const String& GetTypeName() const = 0;
     /// Handle event.
     virtual void OnEvent(Object* sender, StringHash eventType, VariantMap& eventData);
+    /// Handle event with a typed payload. By default invokes a typed handler directly, or converts the payload to a VariantMap and calls OnEvent() with it.
+    virtual void OnTypedEvent(Object* sender, StringHash eventType, EventData& eventData);
     
     /// Subscribe to an event that can be sent by any sender.
     void SubscribeToEvent(StringHash eventType, EventHandler* handler);
@@ -84,6 +87,12 @@ public:
     void SendEvent(StringHash eventType);
     /// Send event with parameters to all subscribers.
     void SendEvent(StringHash eventType, VariantMap& eventData);
+    /// Send event with a typed payload to all subscribers. Handlers that take a VariantMap receive the payload converted to one.
+    void SendEvent(StringHash eventType, EventData& eventData);
+    /// Post event to be sent later in the main thread. Can be called from any thread. The object must not be destroyed outside the main thread while the event is pending.
+    void PostEvent(StringHash eventType);
+    /// Post event with parameters to be sent later in the main thread. Can be called from any thread. The parameters are copied, so they must not contain object pointers, as reference counts are not thread-safe.
+    void PostEvent(StringHash eventType, const VariantMap& eventData);
     /// Return a preallocated map for event data. Used for optimization to avoid constant re-allocation of event data maps.
     VariantMap& GetEventDataMap() const;
     
@@ -111,6 +120,20 @@ protected:
     Context* context_;
     
 private:
+    /// Send event with either a VariantMap or a typed payload.
+    void SendEvent(StringHash eventType, VariantMap* eventData, EventData* typedEventData);
+    /// Send an event to the receiver of an event handler through its OnEvent() or OnTypedEvent() function.
+    void DispatchEvent(EventHandler* handler, StringHash eventType, VariantMap* eventData, EventData* typedEventData);
+    /// Invoke an event handler with a VariantMap.
+    void InvokeEventHandler(EventHandler* handler, VariantMap& eventData);
+    /// Subscribe an event handler, replacing an old handler with the same sender and event type.
+    void AddEventHandler(EventHandler* handler);
+    /// Unsubscribe and delete an event handler.
+    void RemoveEventHandler(EventHandler* handler, EventHandler* previous);
+    /// Return the event handler to invoke for an event from a sender. A specific handler has priority over a non-specific one.
+    EventHandler* SelectEventHandler(Object* sender, StringHash eventType) const;
+    /// Return the event handler selected by the event dispatch if it matches, otherwise search for it.
+    EventHandler* GetDispatchedEventHandler(Object* sender, StringHash eventType) const;
     /// Find the first event handler with no specific sender.
     EventHandler* FindEventHandler(StringHash eventType, EventHandler** previous = 0) const;
     /// Find the first event handler with specific sender.
@@ -180,12 +203,15 @@ public:
 /// Internal helper class for invoking event handler functions.
 class URHO3D_API EventHandler : public LinkedListNode
 {
+    friend class EventReceiverGroup;
+    
 public:
     /// Construct with specified receiver.
     EventHandler(Object* receiver) :
         receiver_(receiver),
         sender_(0),
-        userData_(0)
+        userData_(0),
+        groupIndex_(M_MAX_UNSIGNED)
     {
         assert(receiver_);
     }
@@ -194,7 +220,8 @@ public:
     EventHandler(Object* receiver, void* userData) :
         receiver_(receiver),
         sender_(0),
-        userData_(userData)
+        userData_(userData),
+        groupIndex_(M_MAX_UNSIGNED)
     {
         assert(receiver_);
     }
@@ -211,6 +238,8 @@ public:
     
     /// Invoke event handler function.
     virtual void Invoke(VariantMap& eventData) = 0;
+    /// Invoke event handler function with a typed payload. Return false if the handler does not take the payload type, in which case it must be invoked with a VariantMap instead.
+    virtual bool InvokeTyped(EventData& eventData) { return false; }
     /// Return a unique copy of the event handler.
     virtual EventHandler* Clone() const = 0;
     
@@ -232,6 +261,10 @@ protected:
     StringHash eventType_;
     /// Userdata.
     void* userData_;
+    
+private:
+    /// Index in the event receiver group.
+    unsigned groupIndex_;
 };
 
 /// Template implementation of the event handler invoke helper (stores a function pointer of specific class.)
@@ -274,6 +307,141 @@ private:
     HandlerFunctionPtr function_;
 };
 
+/// Base class for typed event payloads, which are declared inside an event namespace with the EVENT_DATA macros.
+class URHO3D_API EventData
+{
+    friend class Object;
+    
+public:
+    /// Construct with the type of the event the payload was declared for.
+    EventData(StringHash type) :
+        type_(type),
+        convertedData_(0)
+    {
+    }
+    
+    /// Destruct.
+    virtual ~EventData() {}
+    
+    /// Copy the parameters into a VariantMap.
+    virtual void ToVariantMap(VariantMap& eventData) const = 0;
+    /// Copy the parameters from a VariantMap. Missing parameters are reset to default.
+    virtual void FromVariantMap(const VariantMap& eventData) = 0;
+    
+    /// Return the type of the event the payload was declared for.
+    StringHash GetType() const { return type_; }
+    
+private:
+    /// Event type the payload was declared for.
+    StringHash type_;
+    /// VariantMap holding the converted parameters during sending, null if not converted or no longer up to date.
+    VariantMap* convertedData_;
+};
+
+/// Object pointer in a typed event payload. Stored as a RefCounted pointer so that the pointed to class does not need to be defined where the payload is declared.
+template <class T> class EventPtr
+{
+public:
+    /// Construct null.
+    EventPtr() :
+        ptr_(0)
+    {
+    }
+    
+    /// Assign an object.
+    EventPtr<T>& operator = (T* rhs)
+    {
+        ptr_ = rhs;
+        return *this;
+    }
+    
+    /// Point to the object.
+    T* operator -> () const { return static_cast<T*>(ptr_); }
+    /// Convert to a raw pointer.
+    operator T* () const { return static_cast<T*>(ptr_); }
+    
+    /// Object as a RefCounted pointer.
+    RefCounted* ptr_;
+};
+
+/// Write a typed event parameter into a VariantMap.
+template <class T> void WriteEventParam(VariantMap& eventData, StringHash param, const T& value)
+{
+    eventData[param] = value;
+}
+
+/// Write an object pointer event parameter into a VariantMap.
+template <class T> void WriteEventParam(VariantMap& eventData, StringHash param, const EventPtr<T>& value)
+{
+    eventData[param] = value.ptr_;
+}
+
+/// Read a typed event parameter from a VariantMap.
+template <class T> void ReadEventParam(const VariantMap& eventData, StringHash param, T& value)
+{
+    VariantMap::ConstIterator i = eventData.Find(param);
+    value = i != eventData.End() ? i->second_.Get<T>() : T();
+}
+
+/// Read an object pointer event parameter from a VariantMap.
+template <class T> void ReadEventParam(const VariantMap& eventData, StringHash param, EventPtr<T>& value)
+{
+    VariantMap::ConstIterator i = eventData.Find(param);
+    value.ptr_ = i != eventData.End() ? i->second_.GetPtr() : 0;
+}
+
+/// Template implementation of the event handler invoke helper for handlers that take a typed payload. Handles a VariantMap by converting it to the payload and back.
+template <class T, class D> class TypedEventHandlerImpl : public EventHandler
+{
+public:
+    typedef void (T::*HandlerFunctionPtr)(StringHash, D&);
+    
+    /// Construct with receiver and function pointers.
+    TypedEventHandlerImpl(T* receiver, HandlerFunctionPtr function) :
+        EventHandler(receiver),
+        function_(function)
+    {
+        assert(function_);
+    }
+    
+    /// Invoke event handler function with a VariantMap.
+    virtual void Invoke(VariantMap& eventData)
+    {
+        D data;
+        data.FromVariantMap(eventData);
+        T* receiver = static_cast<T*>(receiver_);
+        (receiver->*function_)(eventType_, data);
+        data.ToVariantMap(eventData);
+    }
+    
+    /// Invoke event handler function with a typed payload.
+    virtual bool InvokeTyped(EventData& eventData)
+    {
+        if (eventData.GetType() != D::GetTypeStatic())
+            return false;
+        
+        T* receiver = static_cast<T*>(receiver_);
+        (receiver->*function_)(eventType_, static_cast<D&>(eventData));
+        return true;
+    }
+    
+    /// Return a unique copy of the event handler.
+    virtual EventHandler* Clone() const
+    {
+        return new TypedEventHandlerImpl(static_cast<T*>(receiver_), function_);
+    }
+    
+private:
+    /// Class-specific pointer to handler function.
+    HandlerFunctionPtr function_;
+};
+
+/// Construct a typed event handler, deducing the payload type from the handler function. The function may be declared in a base class of the receiver, in which case the handler calls it through that base class.
+template <class T, class C, class D> EventHandler* MakeTypedEventHandler(T* receiver, void (C::*function)(StringHash, D&))
+{
+    return new TypedEventHandlerImpl<C, D>(receiver, function);
+}
+
 /// Describe an event's hash ID and begin a namespace in which to define its parameters.
 #define EVENT(eventID, eventName) static const Urho3D::StringHash eventID(#eventName); namespace eventName
 /// Describe an event's parameter hash ID. Should be used inside an event namespace.
@@ -282,5 +450,59 @@ private:
 #define HANDLER(className, function) (new Urho3D::EventHandlerImpl<className>(this, &className::function))
 /// Convenience macro to construct an EventHandler that points to a receiver object and its member function, and also defines a userdata pointer.
 #define HANDLER_USERDATA(className, function, userData) (new Urho3D::EventHandlerImpl<className>(this, &className::function, userData))
+/// Convenience macro to construct an EventHandler that points to a receiver object and its member function taking a typed event payload.
+#define TYPED_HANDLER(className, function) (Urho3D::MakeTypedEventHandler<className>(this, &className::function))
+
+/// Declare a payload struct member. Used by the EVENT_DATA macros.
+#define EVENT_DATA_MEMBER(paramID, type, name) type name;
+/// Default-initialize a payload struct member. Used by the EVENT_DATA macros.
+#define EVENT_DATA_INIT(paramID, type, name) , name()
+/// Copy a payload struct member into a VariantMap. Used by the EVENT_DATA macros.
+#define EVENT_DATA_WRITE(paramID, type, name) Urho3D::WriteEventParam(eventData, paramID, name);
+/// Copy a payload struct member from a VariantMap. Used by the EVENT_DATA macros.
+#define EVENT_DATA_READ(paramID, type, name) Urho3D::ReadEventParam(eventData, paramID, name);
+/// Define the payload struct Data for an event. Used by the EVENT_DATA macros.
+#define EVENT_DATA_STRUCT(eventID, members, inits, writes, reads) \
+    struct Data : public Urho3D::EventData \
+    { \
+        Data() : Urho3D::EventData(eventID) inits {} \
+        static Urho3D::StringHash GetTypeStatic() { return eventID; } \
+        virtual void ToVariantMap(Urho3D::VariantMap& eventData) const { writes } \
+        virtual void FromVariantMap(const Urho3D::VariantMap& eventData) { reads } \
+        members \
+    }
+/// Generate a typed payload struct named Data for an event from its parameters. Should be used inside the event namespace. Each parameter is described by its hash ID, type and member name.
+#define EVENT_DATA1(eventID, p1, t1, n1) \
+    EVENT_DATA_STRUCT(eventID, EVENT_DATA_MEMBER(p1, t1, n1), EVENT_DATA_INIT(p1, t1, n1), \
+        EVENT_DATA_WRITE(p1, t1, n1), EVENT_DATA_READ(p1, t1, n1))
+/// Generate a typed payload struct with two parameters.
+#define EVENT_DATA2(eventID, p1, t1, n1, p2, t2, n2) \
+    EVENT_DATA_STRUCT(eventID, EVENT_DATA_MEMBER(p1, t1, n1) EVENT_DATA_MEMBER(p2, t2, n2), \
+        EVENT_DATA_INIT(p1, t1, n1) EVENT_DATA_INIT(p2, t2, n2), \
+        EVENT_DATA_WRITE(p1, t1, n1) EVENT_DATA_WRITE(p2, t2, n2), \
+        EVENT_DATA_READ(p1, t1, n1) EVENT_DATA_READ(p2, t2, n2))
+/// Generate a typed payload struct with three parameters.
+#define EVENT_DATA3(eventID, p1, t1, n1, p2, t2, n2, p3, t3, n3) \
+    EVENT_DATA_STRUCT(eventID, EVENT_DATA_MEMBER(p1, t1, n1) EVENT_DATA_MEMBER(p2, t2, n2) EVENT_DATA_MEMBER(p3, t3, n3), \
+        EVENT_DATA_INIT(p1, t1, n1) EVENT_DATA_INIT(p2, t2, n2) EVENT_DATA_INIT(p3, t3, n3), \
+        EVENT_DATA_WRITE(p1, t1, n1) EVENT_DATA_WRITE(p2, t2, n2) EVENT_DATA_WRITE(p3, t3, n3), \
+        EVENT_DATA_READ(p1, t1, n1) EVENT_DATA_READ(p2, t2, n2) EVENT_DATA_READ(p3, t3, n3))
+/// Generate a typed payload struct with four parameters.
+#define EVENT_DATA4(eventID, p1, t1, n1, p2, t2, n2, p3, t3, n3, p4, t4, n4) \
+    EVENT_DATA_STRUCT(eventID, EVENT_DATA_MEMBER(p1, t1, n1) EVENT_DATA_MEMBER(p2, t2, n2) EVENT_DATA_MEMBER(p3, t3, n3) \
+        EVENT_DATA_MEMBER(p4, t4, n4), \
+        EVENT_DATA_INIT(p1, t1, n1) EVENT_DATA_INIT(p2, t2, n2) EVENT_DATA_INIT(p3, t3, n3) EVENT_DATA_INIT(p4, t4, n4), \
+        EVENT_DATA_WRITE(p1, t1, n1) EVENT_DATA_WRITE(p2, t2, n2) EVENT_DATA_WRITE(p3, t3, n3) EVENT_DATA_WRITE(p4, t4, n4), \
+        EVENT_DATA_READ(p1, t1, n1) EVENT_DATA_READ(p2, t2, n2) EVENT_DATA_READ(p3, t3, n3) EVENT_DATA_READ(p4, t4, n4))
+/// Generate a typed payload struct with five parameters.
+#define EVENT_DATA5(eventID, p1, t1, n1, p2, t2, n2, p3, t3, n3, p4, t4, n4, p5, t5, n5) \
+    EVENT_DATA_STRUCT(eventID, EVENT_DATA_MEMBER(p1, t1, n1) EVENT_DATA_MEMBER(p2, t2, n2) EVENT_DATA_MEMBER(p3, t3, n3) \
+        EVENT_DATA_MEMBER(p4, t4, n4) EVENT_DATA_MEMBER(p5, t5, n5), \
+        EVENT_DATA_INIT(p1, t1, n1) EVENT_DATA_INIT(p2, t2, n2) EVENT_DATA_INIT(p3, t3, n3) EVENT_DATA_INIT(p4, t4, n4) \
+        EVENT_DATA_INIT(p5, t5, n5), \
+        EVENT_DATA_WRITE(p1, t1, n1) EVENT_DATA_WRITE(p2, t2, n2) EVENT_DATA_WRITE(p3, t3, n3) EVENT_DATA_WRITE(p4, t4, n4) \
+        EVENT_DATA_WRITE(p5, t5, n5), \
+        EVENT_DATA_READ(p1, t1, n1) EVENT_DATA_READ(p2, t2, n2) EVENT_DATA_READ(p3, t3, n3) EVENT_DATA_READ(p4, t4, n4) \
+        EVENT_DATA_READ(p5, t5, n5))
 
 }
@@ -34,16 +34,36 @@ namespace Urho3D
 
 static const int LINE_MAX_LENGTH = 256;
 static const int NAME_MAX_LENGTH = 30;
+static const unsigned DEFAULT_TIMELINE_FRAMES = 120;
 
 Profiler::Profiler(Context* context) :
     Object(context),
     current_(0),
     root_(0),
     intervalFrames_(0),
-    totalFrames_(0)
+    totalFrames_(0),
+    numThreads_(1),
+    nextFrame_(0),
+    numRecordedFrames_(0),
+    frameStartTime_(0),
+    timelineEnabled_(false),
+    timelineRequested_(false)
 {
     root_ = new ProfilerBlock(0, "Root");
     current_ = root_;
+    
+    // Reserve the first timeline buffer for the main thread
+    threads_[0].threadID_ = Thread::GetCurrentThreadID();
+    threads_[0].ready_ = true;
+    
+    timelineFrames_.Resize(DEFAULT_TIMELINE_FRAMES);
+    
+    for (unsigned i = 0; i < MAX_MEMORY_CATEGORIES; ++i)
+    {
+        lastMemoryStats_[i] = GetMemoryStats((MemoryCategory)i);
+        intervalAllocations_[i] = 0;
+        intervalAllocatedBytes_[i] = 0;
+    }
 }
 
 Profiler::~Profiler()
@@ -57,6 +77,24 @@ void Profiler::BeginFrame()
     // End the previous frame if any
     EndFrame();
     
+    if (timelineRequested_ != timelineEnabled_)
+    {
+        if (timelineRequested_)
+        {
+            nextFrame_ = 0;
+            numRecordedFrames_ = 0;
+            // Discard the blocks that ended after the timeline was last disabled
+            unsigned numThreads = GetNumThreads();
+            for (unsigned i = 0; i < numThreads; ++i)
+            {
+                if (threads_[i].ready_)
+                    threads_[i].readPosition_ = threads_[i].writePosition_;
+            }
+        }
+        timelineEnabled_ = timelineRequested_;
+    }
+    frameStartTime_ = timelineTimer_.GetUSec(false);
+    
     BeginBlock("RunFrame");
 }
 
@@ -71,6 +109,13 @@ void Profiler::EndFrame()
             ++totalFrames_;
         root_->EndFrame();
         current_ = root_;
+        // Blocks left open are dropped from the timeline as well
+        threads_[0].depth_ = 0;
+        
+        if (timelineEnabled_)
+            CollectTimeline();
+        if (IsMemoryTrackingSupported())
+            CollectMemoryStats();
     }
 }
 
@@ -78,6 +123,76 @@ void Profiler::BeginInterval()
 {
     root_->BeginInterval();
     intervalFrames_ = 0;
+    
+    for (unsigned i = 0; i < MAX_MEMORY_CATEGORIES; ++i)
+    {
+        intervalAllocations_[i] = 0;
+        intervalAllocatedBytes_[i] = 0;
+    }
+}
+
+void Profiler::SetTimelineEnabled(bool enable)
+{
+    timelineRequested_ = enable;
+}
+
+void Profiler::SetTimelineFrames(unsigned frames)
+{
+    frames = Max((int)frames, 1);
+    if (frames == timelineFrames_.Size())
+        return;
+    
+    timelineFrames_.Clear();
+    timelineFrames_.Resize(frames);
+    nextFrame_ = 0;
+    numRecordedFrames_ = 0;
+}
+
+const ProfilerFrame* Profiler::GetRecordedFrame(unsigned index) const
+{
+    if (index >= numRecordedFrames_)
+        return 0;
+    
+    unsigned numFrames = timelineFrames_.Size();
+    return &timelineFrames_[(nextFrame_ + numFrames - numRecordedFrames_ + index) % numFrames];
+}
+
+String Profiler::GetTraceData() const
+{
+    String output("{\"traceEvents\":[\n");
+    char line[LINE_MAX_LENGTH];
+    
+    unsigned numThreads = GetNumThreads();
+    for (unsigned i = 0; i < numThreads; ++i)
+    {
+        if (i)
+            output.AppendWithFormat(",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"Thread %u\"}}", i, i);
+        else
+            output += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Main thread\"}}";
+    }
+    
+    for (unsigned i = 0; i < numRecordedFrames_; ++i)
+    {
+        const PODVector<ProfilerEvent>& events = GetRecordedFrame(i)->events_;
+        for (PODVector<ProfilerEvent>::ConstIterator j = events.Begin(); j != events.End(); ++j)
+        {
+            // Escape the name only if necessary, as the block names are normally plain identifiers
+            const char* name = j->name_;
+            String escapedName;
+            if (strpbrk(name, "\"\\"))
+            {
+                escapedName = String(name).Replaced("\\", "\\\\").Replaced("\"", "\\\"");
+                name = escapedName.CString();
+            }
+            
+            sprintf(line, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%lld,\"dur\":%lld}", name, j->threadIndex_,
+                j->startTime_, j->duration_);
+            output += String(line);
+        }
+    }
+    
+    output += "\n]}\n";
+    return output;
 }
 
 String Profiler::GetData(bool showUnused, bool showTotal, unsigned maxDepth) const
@@ -85,11 +200,11 @@ String Profiler::GetData(bool showUnused, bool showTotal, unsigned maxDepth) con
     String output;
     
     if (!showTotal)
-        output += String("Block                            Cnt     Avg      Max     Frame     Total\n\n");
+        output += String("Block                            Cnt     Avg      Max     Frame     Total   Alloc\n\n");
     else
     {
         output += String("Block                                       Last frame                       Whole execution time\n\n");
-        output += String("                                 Cnt     Avg      Max      Total      Cnt      Avg       Max        Total\n\n");
+        output += String("                                 Cnt     Avg      Max      Total      Cnt      Avg       Max        Total   Alloc\n\n");
     }
     
     if (!maxDepth)
@@ -100,6 +215,36 @@ String Profiler::GetData(bool showUnused, bool showTotal, unsigned maxDepth) con
     return output;
 }
 
+String Profiler::GetMemoryData() const
+{
+    if (!IsMemoryTrackingSupported())
+        return String::EMPTY;
+    
+    char line[LINE_MAX_LENGTH];
+    sprintf(line, "%-14s %10s %9s %7s %6s %9s\n\n", "Memory", "Live KB", "Peak KB", "Count", "Alloc", "KB/frame");
+    String output(line);
+    unsigned intervalFrames = Max(intervalFrames_, 1);
+    
+    for (unsigned i = 0; i < MAX_MEMORY_CATEGORIES; ++i)
+    {
+        MemoryStats stats = GetMemoryStats((MemoryCategory)i);
+        if (!stats.totalAllocations_)
+            continue;
+        
+        sprintf(line, "%-14s %10.1f %9.1f %7u %6u %9.1f\n", GetMemoryCategoryName((MemoryCategory)i), stats.liveBytes_ / 1024.0f,
+            stats.peakBytes_ / 1024.0f, Min(stats.liveAllocations_, 9999999), Min(intervalAllocations_[i] / intervalFrames, 999999),
+            intervalAllocatedBytes_[i] / intervalFrames / 1024.0f);
+        output += String(line);
+    }
+    
+    MemoryStats total = GetTotalMemoryStats();
+    sprintf(line, "\n%-14s %10.1f %9.1f %7u\n", "Total", total.liveBytes_ / 1024.0f, total.peakBytes_ / 1024.0f,
+        Min(total.liveAllocations_, 9999999));
+    output += String(line);
+    
+    return output;
+}
+
 void Profiler::GetData(ProfilerBlock* block, String& output, unsigned depth, unsigned maxDepth, bool showUnused, bool showTotal) const
 {
     char line[LINE_MAX_LENGTH];
@@ -127,9 +272,10 @@ void Profiler::GetData(ProfilerBlock* block, String& output, unsigned depth, uns
                 float max = block->intervalMaxTime_ / 1000.0f;
                 float frame = block->intervalTime_ / intervalFrames / 1000.0f;
                 float all = block->intervalTime_ / 1000.0f;
+                unsigned allocations = block->intervalAllocations_ / intervalFrames;
         
-                sprintf(line, "%s %5u %8.3f %8.3f %8.3f %9.3f\n", indentedName, Min(block->intervalCount_, 99999),
-                    avg, max, frame, all);
+                sprintf(line, "%s %5u %8.3f %8.3f %8.3f %9.3f %7u\n", indentedName, Min(block->intervalCount_, 99999),
+                    avg, max, frame, all, Min(allocations, 9999999));
             }
             else
             {
@@ -141,8 +287,8 @@ void Profiler::GetData(ProfilerBlock* block, String& output, unsigned depth, uns
                 float totalMax = block->totalMaxTime_ / 1000.0f;
                 float totalAll = block->totalTime_ / 1000.0f;
                 
-                sprintf(line, "%s %5u %8.3f %8.3f %9.3f  %7u %9.3f %9.3f %11.3f\n", indentedName, Min(block->frameCount_, 99999),
-                    avg, max, all, Min(block->totalCount_, 99999), totalAvg, totalMax, totalAll);
+                sprintf(line, "%s %5u %8.3f %8.3f %9.3f  %7u %9.3f %9.3f %11.3f %7u\n", indentedName, Min(block->frameCount_, 99999),
+                    avg, max, all, Min(block->totalCount_, 99999), totalAvg, totalMax, totalAll, Min(block->frameAllocations_, 9999999));
             }
             
             output += String(line);
@@ -155,4 +301,86 @@ void Profiler::GetData(ProfilerBlock* block, String& output, unsigned depth, uns
         GetData(*i, output, depth, maxDepth, showUnused, showTotal);
 }
 
+ProfilerThread* Profiler::GetThread()
+{
+    ThreadID threadID = Thread::GetCurrentThreadID();
+    int numThreads = numThreads_;
+    for (int i = 1; i < numThreads && i < (int)MAX_PROFILER_THREADS; ++i)
+    {
+        if (threads_[i].ready_ && threads_[i].threadID_ == threadID)
+            return &threads_[i];
+    }
+    
+    // Not found: claim a new buffer
+    for (;;)
+    {
+        numThreads = numThreads_;
+        if (numThreads >= (int)MAX_PROFILER_THREADS)
+            return 0;
+        if (AtomicCompareExchange(&numThreads_, numThreads + 1, numThreads))
+            break;
+    }
+    
+    ProfilerThread& thread = threads_[numThreads];
+    thread.threadID_ = threadID;
+    thread.index_ = numThreads;
+    AtomicFence();
+    thread.ready_ = true;
+    return &thread;
+}
+
+void Profiler::BeginThreadBlock(const char* name, bool record)
+{
+    ProfilerThread* thread = GetThread();
+    if (thread)
+        thread->Begin(name, timelineTimer_, record);
+}
+
+void Profiler::EndThreadBlock()
+{
+    ProfilerThread* thread = GetThread();
+    if (thread)
+        thread->End(timelineTimer_);
+}
+
+void Profiler::CollectTimeline()
+{
+    ProfilerFrame& frame = timelineFrames_[nextFrame_];
+    frame.startTime_ = frameStartTime_;
+    frame.endTime_ = timelineTimer_.GetUSec(false);
+    frame.events_.Clear();
+    
+    unsigned numThreads = GetNumThreads();
+    for (unsigned i = 0; i < numThreads; ++i)
+    {
+        ProfilerThread& thread = threads_[i];
+        if (!thread.ready_)
+            continue;
+        
+        AtomicFence();
+        unsigned end = thread.writePosition_;
+        AtomicFence();
+        for (unsigned position = thread.readPosition_; position != end; ++position)
+            frame.events_.Push(thread.events_[position & (PROFILER_EVENT_BUFFER_SIZE - 1)]);
+        // Hand the read events back to the thread only after they have been copied
+        AtomicFence();
+        thread.readPosition_ = end;
+    }
+    
+    nextFrame_ = (nextFrame_ + 1) % timelineFrames_.Size();
+    if (numRecordedFrames_ < timelineFrames_.Size())
+        ++numRecordedFrames_;
+}
+
+void Profiler::CollectMemoryStats()
+{
+    for (unsigned i = 0; i < MAX_MEMORY_CATEGORIES; ++i)
+    {
+        MemoryStats stats = GetMemoryStats((MemoryCategory)i);
+        intervalAllocations_[i] += stats.totalAllocations_ - lastMemoryStats_[i].totalAllocations_;
+        intervalAllocatedBytes_[i] += stats.totalBytes_ - lastMemoryStats_[i].totalBytes_;
+        lastMemoryStats_[i] = stats;
+    }
+}
+
 }
@@ -22,6 +22,9 @@
 
 #pragma once
 
+#include "Allocator.h"
+#include "Atomic.h"
+#include "MemoryTracker.h"
 #include "Str.h"
 #include "Thread.h"
 #include "Timer.h"
@@ -39,16 +42,21 @@ public:
         time_(0),
         maxTime_(0),
         count_(0),
+        allocationsStart_(0),
+        allocations_(0),
         parent_(parent),
         frameTime_(0),
         frameMaxTime_(0),
         frameCount_(0),
+        frameAllocations_(0),
         intervalTime_(0),
         intervalMaxTime_(0),
         intervalCount_(0),
+        intervalAllocations_(0),
         totalTime_(0),
         totalMaxTime_(0),
-        totalCount_(0)
+        totalCount_(0),
+        totalAllocations_(0)
     {
         if (name)
         {
@@ -75,6 +83,7 @@ public:
     {
         timer_.Reset();
         ++count_;
+        allocationsStart_ = AllocatorGetHeapAllocations();
     }
     
     /// End timing.
@@ -84,6 +93,7 @@ public:
         if (time > maxTime_)
             maxTime_ = time;
         time_ += time;
+        allocations_ += AllocatorGetHeapAllocations() - allocationsStart_;
     }
     
     /// End profiling frame and update interval and total values.
@@ -92,17 +102,21 @@ public:
         frameTime_ = time_;
         frameMaxTime_ = maxTime_;
         frameCount_ = count_;
+        frameAllocations_ = allocations_;
         intervalTime_ += time_;
         if (maxTime_ > intervalMaxTime_)
             intervalMaxTime_ = maxTime_;
         intervalCount_ += count_;
+        intervalAllocations_ += allocations_;
         totalTime_ += time_;
         if (maxTime_ > totalMaxTime_)
             totalMaxTime_ = maxTime_;
         totalCount_ += count_;
+        totalAllocations_ += allocations_;
         time_ = 0;
         maxTime_ = 0;
         count_ = 0;
+        allocations_ = 0;
         
         for (PODVector<ProfilerBlock*>::Iterator i = children_.Begin(); i != children_.End(); ++i)
             (*i)->EndFrame();
@@ -114,6 +128,7 @@ public:
         intervalTime_ = 0;
         intervalMaxTime_ = 0;
         intervalCount_ = 0;
+        intervalAllocations_ = 0;
         
         for (PODVector<ProfilerBlock*>::Iterator i = children_.Begin(); i != children_.End(); ++i)
             (*i)->BeginInterval();
@@ -144,6 +159,10 @@ public:
     long long maxTime_;
     /// Calls on current frame.
     unsigned count_;
+    /// Container heap allocation count when the block was begun.
+    unsigned allocationsStart_;
+    /// Container heap allocations on current frame.
+    unsigned allocations_;
     /// Parent block.
     ProfilerBlock* parent_;
     /// Child blocks.
@@ -154,18 +173,153 @@ public:
     long long frameMaxTime_;
     /// Calls on the previous frame.
     unsigned frameCount_;
+    /// Container heap allocations on the previous frame.
+    unsigned frameAllocations_;
     /// Time during current profiler interval.
     long long intervalTime_;
     /// Maximum time during current profiler interval.
     long long intervalMaxTime_;
     /// Calls during current profiler interval.
     unsigned intervalCount_;
+    /// Container heap allocations during current profiler interval.
+    unsigned intervalAllocations_;
     /// Total accumulated time.
     long long totalTime_;
     /// All-time maximum time.
     long long totalMaxTime_;
     /// Total accumulated calls.
     unsigned totalCount_;
+    /// Total accumulated container heap allocations.
+    unsigned totalAllocations_;
+};
+
+/// Maximum number of threads recorded to the profiler timeline.
+static const unsigned MAX_PROFILER_THREADS = 64;
+/// Maximum profiling block nesting depth recorded to the profiler timeline.
+static const unsigned MAX_PROFILER_TIMELINE_DEPTH = 64;
+/// Size of the per-thread profiler timeline event buffer. Must be a power of two.
+static const unsigned PROFILER_EVENT_BUFFER_SIZE = 8192;
+/// Maximum length of a block name recorded to the profiler timeline, including the terminating zero.
+static const unsigned PROFILER_EVENT_NAME_LENGTH = 32;
+
+/// Profiling block recorded to the timeline.
+struct ProfilerEvent
+{
+    /// Block name, truncated if necessary.
+    char name_[PROFILER_EVENT_NAME_LENGTH];
+    /// Start time in microseconds since the profiler was created.
+    long long startTime_;
+    /// Duration in microseconds.
+    long long duration_;
+    /// Index of the thread.
+    unsigned threadIndex_;
+};
+
+/// Profiling blocks recorded to the timeline during one frame.
+struct ProfilerFrame
+{
+    /// Frame start time in microseconds since the profiler was created.
+    long long startTime_;
+    /// Frame end time in microseconds since the profiler was created.
+    long long endTime_;
+    /// Blocks from all threads that ended during the frame.
+    PODVector<ProfilerEvent> events_;
+};
+
+/// Timeline event buffer of one thread. Written only by its own thread and read by the main thread at the end of each frame, without locking.
+class URHO3D_API ProfilerThread
+{
+public:
+    /// Construct.
+    ProfilerThread() :
+        threadID_(0),
+        index_(0),
+        depth_(0),
+        events_(0),
+        writePosition_(0),
+        readPosition_(0),
+        numDropped_(0),
+        ready_(false)
+    {
+    }
+    
+    /// Destruct.
+    ~ProfilerThread()
+    {
+        delete[] events_;
+    }
+    
+    /// Begin a block. The block is always pushed to keep the nesting balanced, but is recorded only if requested.
+    void Begin(const char* name, HiresTimer& timer, bool record)
+    {
+        if (depth_ < MAX_PROFILER_TIMELINE_DEPTH)
+        {
+            names_[depth_] = name;
+            startTimes_[depth_] = record ? timer.GetUSec(false) : 0;
+            record_[depth_] = record;
+        }
+        ++depth_;
+    }
+    
+    /// End the current block and record it to the event buffer if it was begun for recording. If the buffer is full, the block is dropped.
+    void End(HiresTimer& timer)
+    {
+        if (!depth_)
+            return;
+        
+        --depth_;
+        if (depth_ >= MAX_PROFILER_TIMELINE_DEPTH || !record_[depth_])
+            return;
+        
+        long long time = timer.GetUSec(false);
+        unsigned position = writePosition_;
+        if (position - readPosition_ >= PROFILER_EVENT_BUFFER_SIZE)
+        {
+            ++numDropped_;
+            return;
+        }
+        
+        // Allocate the event buffer on the first recorded block, so that threads are not charged for it when the timeline is disabled
+        if (!events_)
+            events_ = new ProfilerEvent[PROFILER_EVENT_BUFFER_SIZE];
+        
+        // Copy the name, as it may be a temporary string
+        ProfilerEvent& event = events_[position & (PROFILER_EVENT_BUFFER_SIZE - 1)];
+        const char* name = names_[depth_];
+        unsigned i = 0;
+        for (; i < PROFILER_EVENT_NAME_LENGTH - 1 && name[i]; ++i)
+            event.name_[i] = name[i];
+        event.name_[i] = 0;
+        event.startTime_ = startTimes_[depth_];
+        event.duration_ = time - startTimes_[depth_];
+        event.threadIndex_ = index_;
+        // Publish the event to the main thread only after it has been written
+        AtomicFence();
+        writePosition_ = position + 1;
+    }
+    
+    /// Thread ID.
+    ThreadID threadID_;
+    /// Index in the profiler's threads.
+    unsigned index_;
+    /// Names of the open blocks.
+    const char* names_[MAX_PROFILER_TIMELINE_DEPTH];
+    /// Start times of the open blocks.
+    long long startTimes_[MAX_PROFILER_TIMELINE_DEPTH];
+    /// Whether the open blocks are recorded, captured when they were begun.
+    bool record_[MAX_PROFILER_TIMELINE_DEPTH];
+    /// Open block nesting depth.
+    unsigned depth_;
+    /// Event buffer.
+    ProfilerEvent* events_;
+    /// Position of the next event to write.
+    volatile unsigned writePosition_;
+    /// Position of the next event to read.
+    volatile unsigned readPosition_;
+    /// Number of blocks dropped due to the buffer being full.
+    unsigned numDropped_;
+    /// Whether the thread ID and event buffer have been set.
+    volatile bool ready_;
 };
 
 /// Hierarchical performance profiler subsystem.
@@ -179,27 +333,37 @@ public:
     /// Destruct.
     virtual ~Profiler();
     
-    /// Begin timing a profiling block.
+    /// Begin timing a profiling block. Outside the main thread the block is only recorded to the timeline.
     void BeginBlock(const char* name)
     {
-        // Profiler supports only the main thread currently
+        // Capture the timeline flag per block, so that enabling or disabling the timeline while blocks are open keeps them balanced
+        bool record = timelineEnabled_;
+        // The block tree supports only the main thread, other threads are recorded only to the timeline
         if (!Thread::IsMainThread())
+        {
+            BeginThreadBlock(name, record);
             return;
+        }
         
         current_ = current_->GetChild(name);
         current_->Begin();
+        threads_[0].Begin(current_->name_, timelineTimer_, record);
     }
     
     /// End timing the current profiling block.
     void EndBlock()
     {
         if (!Thread::IsMainThread())
+        {
+            EndThreadBlock();
             return;
+        }
         
         if (current_ != root_)
         {
             current_->End();
             current_ = current_->parent_;
+            threads_[0].End(timelineTimer_);
         }
     }
     
@@ -209,17 +373,45 @@ public:
     void EndFrame();
     /// Begin a new interval.
     void BeginInterval();
+    /// Set whether to record the blocks of all threads to the timeline. Takes effect on the next frame. Enabling clears the previously recorded timeline.
+    void SetTimelineEnabled(bool enable);
+    /// Set number of frames to keep in the timeline. Default 120.
+    void SetTimelineFrames(unsigned frames);
     
     /// Return profiling data as text output.
     String GetData(bool showUnused = false, bool showTotal = false, unsigned maxDepth = M_MAX_UNSIGNED) const;
+    /// Return heap allocation data per memory category as text output. Empty if memory tracking has not been compiled in.
+    String GetMemoryData() const;
     /// Return the current profiling block.
     const ProfilerBlock* GetCurrentBlock() { return current_; }
     /// Return the root profiling block.
     const ProfilerBlock* GetRootBlock() { return root_; }
+    /// Return whether recording to the timeline is enabled.
+    bool IsTimelineEnabled() const { return timelineRequested_; }
+    /// Return number of frames to keep in the timeline.
+    unsigned GetTimelineFrames() const { return timelineFrames_.Size(); }
+    /// Return number of frames currently recorded in the timeline.
+    unsigned GetNumRecordedFrames() const { return numRecordedFrames_; }
+    /// Return recorded timeline frame by index, from the oldest to the newest. Return null if out of range.
+    const ProfilerFrame* GetRecordedFrame(unsigned index) const;
+    /// Return number of threads that have recorded to the timeline, including the main thread.
+    unsigned GetNumThreads() const { return Min(numThreads_, (int)MAX_PROFILER_THREADS); }
+    /// Return the recorded timeline in the Chrome trace event JSON format, which can be viewed in chrome://tracing or Perfetto.
+    String GetTraceData() const;
     
 private:
     /// Return profiling data as text output for a specified profiling block.
     void GetData(ProfilerBlock* block, String& output, unsigned depth, unsigned maxDepth, bool showUnused, bool showTotal) const;
+    /// Return the timeline buffer of the current thread, or null if there are too many threads.
+    ProfilerThread* GetThread();
+    /// Begin a timeline block outside the main thread.
+    void BeginThreadBlock(const char* name, bool record);
+    /// End a timeline block outside the main thread.
+    void EndThreadBlock();
+    /// Move the blocks recorded by all threads to the timeline frame that just ended.
+    void CollectTimeline();
+    /// Accumulate the heap allocations of the frame that just ended to the interval.
+    void CollectMemoryStats();
     
     /// Current profiling block.
     ProfilerBlock* current_;
@@ -229,6 +421,30 @@ private:
     unsigned intervalFrames_;
     /// Total frames.
     unsigned totalFrames_;
+    /// Timer for the timeline timestamps.
+    HiresTimer timelineTimer_;
+    /// Timeline buffers of each thread. Index 0 is the main thread.
+    ProfilerThread threads_[MAX_PROFILER_THREADS];
+    /// Number of threads that have recorded to the timeline.
+    volatile int numThreads_;
+    /// Recorded timeline frames as a ring buffer.
+    Vector<ProfilerFrame> timelineFrames_;
+    /// Index of the next timeline frame to record.
+    unsigned nextFrame_;
+    /// Number of recorded timeline frames.
+    unsigned numRecordedFrames_;
+    /// Start time of the current frame.
+    long long frameStartTime_;
+    /// Timeline recording flag, applied at the beginning of each frame.
+    volatile bool timelineEnabled_;
+    /// Timeline recording flag requested by the user.
+    bool timelineRequested_;
+    /// Heap allocation statistics per memory category at the end of the previous frame.
+    MemoryStats lastMemoryStats_[MAX_MEMORY_CATEGORIES];
+    /// Heap allocations per memory category during the current interval.
+    unsigned intervalAllocations_[MAX_MEMORY_CATEGORIES];
+    /// Heap bytes allocated per memory category during the current interval.
+    long long intervalAllocatedBytes_[MAX_MEMORY_CATEGORIES];
 };
 
 /// Helper class for automatically beginning and ending a profiling block
@@ -61,7 +61,7 @@ enum VariantType
     MAX_VAR_TYPES
 };
 
-/// Union for the possible variant values. Also stores non-POD objects such as String which must not exceed 16 bytes in size.
+/// Union for the possible variant values. Also stores non-POD objects such as String and ResourceRef which must not exceed the size of five pointers.
 struct VariantValue
 {
     union
@@ -92,6 +92,13 @@ struct VariantValue
         float float4_;
         void* ptr4_;
     };
+
+    union
+    {
+        int int5_;
+        float float5_;
+        void* ptr5_;
+    };
 };
 
 /// Typed resource reference.
@@ -21,6 +21,7 @@
 //
 
 #include "Precompiled.h"
+#include "Atomic.h"
 #include "CoreEvents.h"
 #include "Log.h"
 #include "ProcessUtils.h"
@@ -32,6 +33,8 @@
 namespace Urho3D
 {
 
+static const unsigned INITIAL_DEQUE_CAPACITY = 256;
+
 /// Worker thread managed by the work queue.
 class WorkerThread : public Thread, public RefCounted
 {
@@ -61,15 +64,169 @@ private:
     unsigned index_;
 };
 
+/// Lock-free work-stealing deque (Chase-Lev.) The owning thread pushes and pops at the bottom, other threads steal from the top.
+class WorkStealingDeque
+{
+public:
+    /// Construct.
+    WorkStealingDeque() :
+        top_(0),
+        bottom_(0),
+        buffer_(new Buffer(INITIAL_DEQUE_CAPACITY))
+    {
+    }
+    
+    /// Destruct.
+    ~WorkStealingDeque()
+    {
+        delete buffer_;
+        for (unsigned i = 0; i < retiredBuffers_.Size(); ++i)
+            delete retiredBuffers_[i];
+    }
+    
+    /// Push an item at the bottom. Called only by the owning thread.
+    void Push(WorkItem* item)
+    {
+        int bottom = bottom_;
+        int top = top_;
+        Buffer* buffer = buffer_;
+        if (Distance(top, bottom) >= (int)buffer->mask_)
+            buffer = Grow(top, bottom);
+        
+        buffer->items_[bottom & buffer->mask_] = item;
+        // Make the item visible before publishing the new bottom to thieves
+        AtomicFence();
+        bottom_ = (int)((unsigned)bottom + 1);
+    }
+    
+    /// Pop an item from the bottom. Called only by the owning thread. Return null if empty.
+    WorkItem* Pop()
+    {
+        int bottom = (int)((unsigned)bottom_ - 1);
+        Buffer* buffer = buffer_;
+        bottom_ = bottom;
+        AtomicFence();
+        int top = top_;
+        
+        int size = Distance(top, bottom);
+        if (size < 0)
+        {
+            bottom_ = top;
+            return 0;
+        }
+        
+        WorkItem* item = buffer->items_[bottom & buffer->mask_];
+        if (size == 0)
+        {
+            // Last item: race against the thieves for it
+            if (!AtomicCompareExchange(&top_, (int)((unsigned)top + 1), top))
+                item = 0;
+            bottom_ = (int)((unsigned)top + 1);
+        }
+        
+        return item;
+    }
+    
+    /// Steal an item from the top. Can be called from any thread. Return null if empty or if lost a race to another thread.
+    WorkItem* Steal()
+    {
+        int top = top_;
+        AtomicFence();
+        int bottom = bottom_;
+        if (Distance(top, bottom) <= 0)
+            return 0;
+        
+        Buffer* buffer = buffer_;
+        WorkItem* item = buffer->items_[top & buffer->mask_];
+        if (!AtomicCompareExchange(&top_, (int)((unsigned)top + 1), top))
+            return 0;
+        
+        return item;
+    }
+    
+private:
+    /// Circular item buffer with power of two capacity.
+    struct Buffer
+    {
+        /// Construct with capacity.
+        Buffer(unsigned capacity) :
+            items_(new WorkItem*[capacity]),
+            mask_(capacity - 1)
+        {
+        }
+        
+        /// Destruct.
+        ~Buffer()
+        {
+            delete[] items_;
+        }
+        
+        /// Items.
+        WorkItem* volatile* items_;
+        /// Index mask.
+        unsigned mask_;
+    };
+    
+    /// Return the number of items between top and bottom indices. The indices are allowed to wrap around.
+    static int Distance(int top, int bottom) { return (int)((unsigned)bottom - (unsigned)top); }
+    
+    /// Double the buffer capacity. The old buffer is kept alive, as thieves may still be reading from it.
+    Buffer* Grow(int top, int bottom)
+    {
+        Buffer* oldBuffer = buffer_;
+        Buffer* newBuffer = new Buffer((oldBuffer->mask_ + 1) * 2);
+        for (int i = top; i != bottom; i = (int)((unsigned)i + 1))
+            newBuffer->items_[i & newBuffer->mask_] = oldBuffer->items_[i & oldBuffer->mask_];
+        
+        AtomicFence();
+        buffer_ = newBuffer;
+        retiredBuffers_.Push(oldBuffer);
+        return newBuffer;
+    }
+    
+    /// Top index, advanced by thieves.
+    volatile int top_;
+    /// Bottom index, modified only by the owning thread.
+    volatile int bottom_;
+    /// Current buffer.
+    Buffer* volatile buffer_;
+    /// Buffers replaced by growing. Accessed only by the owning thread.
+    PODVector<Buffer*> retiredBuffers_;
+};
+
+bool ClaimParallelForRange(ParallelForState& state, unsigned& begin, unsigned& end)
+{
+    for (;;)
+    {
+        int next = state.next_;
+        int remaining = state.end_ - next;
+        if (remaining <= 0)
+            return false;
+        
+        // Guided scheduling: claim a share of the remaining work, but no less than the grain size
+        int count = Min(Max(remaining / (state.numThreads_ * 2), state.grainSize_), remaining);
+        if (AtomicCompareExchange(&state.next_, next + count, next))
+        {
+            begin = (unsigned)next;
+            end = (unsigned)(next + count);
+            return true;
+        }
+    }
+}
+
 WorkQueue::WorkQueue(Context* context) :
     Object(context),
+    numPendingImmediate_(0),
+    numQueued_(0),
     shutDown_(false),
-    pausing_(false),
     paused_(false),
     tolerance_(10),
     lastSize_(0),
     maxNonThreadedWorkMs_(5)
 {
+    // Create the main thread's deque
+    deques_.Push(new WorkStealingDeque());
+    
     SubscribeToEvent(E_BEGINFRAME, HANDLER(WorkQueue, HandleBeginFrame));
 }
 
@@ -81,6 +238,9 @@ WorkQueue::~WorkQueue()
     
     for (unsigned i = 0; i < threads_.Size(); ++i)
         threads_[i]->Stop();
+    
+    for (unsigned i = 0; i < deques_.Size(); ++i)
+        delete deques_[i];
 }
 
 void WorkQueue::CreateThreads(unsigned numThreads)
@@ -93,6 +253,10 @@ void WorkQueue::CreateThreads(unsigned numThreads)
     // Start threads in paused mode
     Pause();
     
+    // Create all deques before any thread starts stealing from them
+    for (unsigned i = 0; i < numThreads; ++i)
+        deques_.Push(new WorkStealingDeque());
+    
     for (unsigned i = 0; i < numThreads; ++i)
     {
         SharedPtr<WorkerThread> thread(new WorkerThread(this, i + 1));
@@ -133,30 +297,54 @@ void WorkQueue::AddWorkItem(SharedPtr<WorkItem> item)
     // Clear completed flag in case item is reused
     workItems_.Push(item);
     item->completed_ = false;
+    BeginItem(item);
+    if (item->parent_)
+    {
+        BeginItem(item->parent_);
+        AtomicIncrement(&item->parent_->unfinished_);
+    }
+    if (item->priority_ == M_MAX_UNSIGNED)
+        AtomicIncrement(&numPendingImmediate_);
+    
+    QueueItem(item, 0);
+    
+    if (threads_.Size())
+        Resume();
+}
 
-    // Make sure worker threads' list is safe to modify
-    if (threads_.Size() && !paused_)
-        queueMutex_.Acquire();
+void WorkQueue::AddContinuation(WorkItem* dependency, SharedPtr<WorkItem> item)
+{
+    if (!dependency || !item)
+    {
+        LOGERROR("Null work item or dependency submitted to the work queue");
+        return;
+    }
     
-    // Find position for new item
-    if (queue_.Empty())
-        queue_.Push(item);
-    else
+    assert(!workItems_.Contains(item));
+    
+    // The item is tracked (and counted as pending) already now, but only queued once the dependency completes
+    workItems_.Push(item);
+    item->completed_ = false;
+    BeginItem(item);
+    if (item->parent_)
     {
-        for (List<WorkItem*>::Iterator i = queue_.Begin(); i != queue_.End(); ++i)
-        {
-            if ((*i)->priority_ <= item->priority_)
-            {
-                queue_.Insert(i, item);
-                break;
-            }
-        }
+        BeginItem(item->parent_);
+        AtomicIncrement(&item->parent_->unfinished_);
     }
+    if (item->priority_ == M_MAX_UNSIGNED)
+        AtomicIncrement(&numPendingImmediate_);
     
-    if (threads_.Size())
+    dependency->continuations_.Push(item);
+}
+
+void WorkQueue::BeginItem(WorkItem* item)
+{
+    // The item's own part is counted only once, either when it is added or when it is first referenced as a parent,
+    // so that children finishing before the parent has been added can not complete it prematurely
+    if (!item->begun_)
     {
-        queueMutex_.Release();
-        paused_ = false;
+        item->begun_ = true;
+        AtomicIncrement(&item->unfinished_);
     }
 }
 
@@ -164,12 +352,8 @@ void WorkQueue::Pause()
 {
     if (!paused_)
     {
-        pausing_ = true;
-        
-        queueMutex_.Acquire();
+        pauseMutex_.Acquire();
         paused_ = true;
-        
-        pausing_ = false;
     }
 }
 
@@ -177,7 +361,7 @@ void WorkQueue::Resume()
 {
     if (paused_)
     {
-        queueMutex_.Release();
+        pauseMutex_.Release();
         paused_ = false;
     }
 }
@@ -185,55 +369,42 @@ void WorkQueue::Resume()
 
 void WorkQueue::Complete(unsigned priority)
 {
+    // The time not spent in the ExecuteWorkItem child blocks is spent waiting for the worker threads
+    PROFILE(CompleteWorkItems);
+    
     if (threads_.Size())
-    {
         Resume();
-        
-        // Take work items also in the main thread until queue empty or no high-priority items anymore
-        while (!queue_.Empty())
+    
+    // Immediate items always have the highest priority. Execute them also in the main thread, stealing from the
+    // worker threads when own deque runs empty, until all of them (including children and continuations) are complete
+    while (numPendingImmediate_ > 0)
+        ExecuteImmediateItem(0);
+    
+    if (priority < M_MAX_UNSIGNED)
+    {
+        // Take prioritized work items also in the main thread until no high-priority items anymore
+        while (ExecutePriorityItem(0, priority))
         {
-            queueMutex_.Acquire();
-            if (!queue_.Empty() && queue_.Front()->priority_ >= priority)
-            {
-                WorkItem* item = queue_.Front();
-                queue_.PopFront();
-                queueMutex_.Release();
-                item->workFunction_(item, 0);
-                item->completed_ = true;
-            }
-            else
-            {
-                queueMutex_.Release();
-                break;
-            }
         }
         
         // Wait for threaded work to complete
         while (!IsCompleted(priority))
         {
         }
-        
-        // If no work at all remaining, pause worker threads by leaving the mutex locked
-        if (queue_.Empty())
-            Pause();
-    }
-    else
-    {
-        // No worker threads: ensure all high-priority items are completed in the main thread
-        while (!queue_.Empty() && queue_.Front()->priority_ >= priority)
-        {
-            WorkItem* item = queue_.Front();
-            queue_.PopFront();
-            item->workFunction_(item, 0);
-            item->completed_ = true;
-        }
     }
     
+    // If no work at all remaining, pause worker threads by leaving the mutex locked
+    if (threads_.Size() && !numQueued_ && !numPendingImmediate_)
+        Pause();
+    
     PurgeCompleted(priority);
 }
 
 bool WorkQueue::IsCompleted(unsigned priority) const
 {
+    if (numPendingImmediate_ > 0)
+        return false;
+    
     for (List<SharedPtr<WorkItem> >::ConstIterator i = workItems_.Begin(); i != workItems_.End(); ++i)
     {
         if ((*i)->priority_ >= priority && !(*i)->completed_)
@@ -245,37 +416,109 @@ bool WorkQueue::IsCompleted(unsigned priority) const
 
 void WorkQueue::ProcessItems(unsigned threadIndex)
 {
-    bool wasActive = false;
-    
     for (;;)
     {
         if (shutDown_)
             return;
         
-        if (pausing_ && !wasActive)
-            Time::Sleep(0);
-        else
+        if (ExecuteImmediateItem(threadIndex) || ExecutePriorityItem(threadIndex, 0))
+            continue;
+        
+        // No work found: block here while the main thread holds the queue paused
+        pauseMutex_.Acquire();
+        pauseMutex_.Release();
+        Time::Sleep(0);
+    }
+}
+
+bool WorkQueue::ExecuteImmediateItem(unsigned threadIndex)
+{
+    WorkItem* item = deques_[threadIndex]->Pop();
+    if (!item)
+    {
+        // Own deque empty: try to steal, starting from the next thread so that thieves spread out
+        unsigned numDeques = deques_.Size();
+        for (unsigned i = 1; i < numDeques && !item; ++i)
+            item = deques_[(threadIndex + i) % numDeques]->Steal();
+        if (!item)
+            return false;
+    }
+    
+    ExecuteItem(item, threadIndex);
+    return true;
+}
+
+bool WorkQueue::ExecutePriorityItem(unsigned threadIndex, unsigned priority)
+{
+    if (!numQueued_)
+        return false;
+    
+    WorkItem* item = 0;
+    {
+        MutexLock lock(queueMutex_);
+        if (!queue_.Empty() && queue_.Front()->priority_ >= priority)
         {
-            queueMutex_.Acquire();
-            if (!queue_.Empty())
-            {
-                wasActive = true;
-                
-                WorkItem* item = queue_.Front();
-                queue_.PopFront();
-                queueMutex_.Release();
-                item->workFunction_(item, threadIndex);
-                item->completed_ = true;
-            }
-            else
-            {
-                wasActive = false;
-                
-                queueMutex_.Release();
-                Time::Sleep(0);
-            }
+            item = queue_.Front();
+            queue_.PopFront();
+            AtomicDecrement(&numQueued_);
         }
     }
+    
+    if (!item)
+        return false;
+    
+    ExecuteItem(item, threadIndex);
+    return true;
+}
+
+void WorkQueue::ExecuteItem(WorkItem* item, unsigned threadIndex)
+{
+    // Items without a work function are allowed; they act as synchronization points for their children
+    if (item->workFunction_)
+    {
+        PROFILE(ExecuteWorkItem);
+        item->workFunction_(item, threadIndex);
+    }
+    FinishItem(item, threadIndex);
+}
+
+void WorkQueue::FinishItem(WorkItem* item, unsigned threadIndex)
+{
+    if (AtomicDecrement(&item->unfinished_) > 0)
+        return;
+    
+    // Read everything needed from the item before marking it completed, as the main thread may then recycle it
+    WorkItem* parent = item->parent_;
+    bool immediate = item->priority_ == M_MAX_UNSIGNED;
+    for (unsigned i = 0; i < item->continuations_.Size(); ++i)
+        QueueItem(item->continuations_[i], threadIndex);
+    
+    item->begun_ = false;
+    AtomicFence();
+    item->completed_ = true;
+    if (immediate)
+        AtomicDecrement(&numPendingImmediate_);
+    
+    if (parent)
+        FinishItem(parent, threadIndex);
+}
+
+void WorkQueue::QueueItem(WorkItem* item, unsigned threadIndex)
+{
+    if (item->priority_ == M_MAX_UNSIGNED)
+    {
+        deques_[threadIndex]->Push(item);
+        return;
+    }
+    
+    MutexLock lock(queueMutex_);
+    
+    // Find position for new item
+    List<WorkItem*>::Iterator i = queue_.Begin();
+    while (i != queue_.End() && (*i)->priority_ > item->priority_)
+        ++i;
+    queue_.Insert(i, item);
+    AtomicIncrement(&numQueued_);
 }
 
 void WorkQueue::PurgeCompleted(unsigned priority)
@@ -308,8 +551,12 @@ void WorkQueue::PurgeCompleted(unsigned priority)
                 (*i)->aux_ = NULL;
                 (*i)->workFunction_ = NULL;
                 (*i)->priority_ = M_MAX_UNSIGNED;
+                (*i)->parent_ = NULL;
                 (*i)->sendEvent_ = false;
                 (*i)->completed_ = false;
+                (*i)->unfinished_ = 0;
+                (*i)->begun_ = false;
+                (*i)->continuations_.Clear();
 
                 poolItems_.Push(*i);
             }
@@ -336,18 +583,16 @@ void WorkQueue::PurgePool()
 void WorkQueue::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
 {
     // If no worker threads, complete low-priority work here
-    if (threads_.Empty() && !queue_.Empty())
+    if (threads_.Empty() && (numPendingImmediate_ || numQueued_))
     {
         PROFILE(CompleteWorkNonthreaded);
         
         HiresTimer timer;
         
-        while (!queue_.Empty() && timer.GetUSec(false) < maxNonThreadedWorkMs_ * 1000)
+        while (timer.GetUSec(false) < maxNonThreadedWorkMs_ * 1000)
         {
-            WorkItem* item = queue_.Front();
-            queue_.PopFront();
-            item->workFunction_(item, 0);
-            item->completed_ = true;
+            if (!ExecuteImmediateItem(0) && !ExecutePriorityItem(0, 0))
+                break;
         }
     }
     
@@ -36,6 +36,7 @@ EVENT(E_WORKITEMCOMPLETED, WorkItemCompleted)
 }
 
 class WorkerThread;
+class WorkStealingDeque;
 
 /// Work queue item.
 struct WorkItem : public RefCounted
@@ -46,9 +47,12 @@ public:
     // Construct
     WorkItem() :
         priority_(0),
+        parent_(0),
         sendEvent_(false),
         completed_(false),
-        pooled_(false)
+        pooled_(false),
+        begun_(false),
+        unfinished_(0)
     {
     }
     
@@ -60,17 +64,55 @@ public:
     void* end_;
     /// Auxiliary data pointer.
     void* aux_;
-    /// Priority. Higher value = will be completed first.
+    /// Priority. Higher value = will be completed first. Items with M_MAX_UNSIGNED priority go to the lock-free work-stealing deques.
     unsigned priority_;
+    /// Parent item, which is not considered completed until this item has completed. Must be set before adding the item, and should have the same priority.
+    WorkItem* parent_;
     /// Whether to send event on completion.
     bool sendEvent_;
     /// Completed flag.
     volatile bool completed_;
 
 private:
+    /// Pooled flag.
     bool pooled_;
+    /// Whether the item's own part has been counted as unfinished.
+    bool begun_;
+    /// Number of unfinished parts: the item's own work function plus each unfinished child item.
+    volatile int unfinished_;
+    /// Items to queue once this item has completed.
+    PODVector<WorkItem*> continuations_;
 };
 
+/// Shared state of a parallel for -loop.
+struct ParallelForState
+{
+    /// Next unclaimed index.
+    volatile int next_;
+    /// End index.
+    int end_;
+    /// Minimum number of indices to claim at once.
+    int grainSize_;
+    /// Number of threads taking part.
+    int numThreads_;
+    /// Functor to call for each claimed range.
+    void* functor_;
+};
+
+/// Claim the next range of indices from a parallel for -loop. Ranges start large and shrink toward the grain size as the loop progresses, to balance uneven work. Return false when no indices remain.
+URHO3D_API bool ClaimParallelForRange(ParallelForState& state, unsigned& begin, unsigned& end);
+
+/// Work function for executing a parallel for -loop functor in worker threads.
+template <class T> void ParallelForWork(const WorkItem* item, unsigned threadIndex)
+{
+    ParallelForState& state = *reinterpret_cast<ParallelForState*>(item->aux_);
+    T& functor = *reinterpret_cast<T*>(state.functor_);
+    unsigned begin, end;
+    
+    while (ClaimParallelForRange(state, begin, end))
+        functor(begin, end, threadIndex);
+}
+
 /// Work queue subsystem for multithreading.
 class URHO3D_API WorkQueue : public Object
 {
@@ -88,8 +130,16 @@ public:
     void CreateThreads(unsigned numThreads);
     /// Get pointer to an usable WorkItem from the item pool. Allocate one if no more free items.
     SharedPtr<WorkItem> GetFreeItem();
-    /// Add a work item and resume worker threads.
+    /// Add a work item and resume worker threads. If the item has a parent, it must be added before the parent.
     void AddWorkItem(SharedPtr<WorkItem> item);
+    /// Add a work item that is queued only after the dependency item (and all its children) has completed. Must be called before the dependency is added, and both should use the same priority.
+    void AddContinuation(WorkItem* dependency, SharedPtr<WorkItem> item);
+    /// Call the functor for ranges of indices between begin and end (exclusive) in worker threads and the calling thread, and wait for completion. The functor is called as functor(rangeBegin, rangeEnd, threadIndex), where the thread index can be used to select a per-thread result slot. May also complete other pending immediate work. Call only from the main thread.
+    template <class T> void ParallelFor(unsigned begin, unsigned end, unsigned grainSize, T& functor);
+    /// Start a parallel for -loop in the worker threads without waiting, so that the calling thread can do other work meanwhile. The state and functor must stay valid until FinishParallelFor() is called. Executes immediately if there are no worker threads. Call only from the main thread.
+    template <class T> void BeginParallelFor(ParallelForState& state, unsigned begin, unsigned end, unsigned grainSize, T& functor);
+    /// Take part in the remaining work of a parallel for -loop started with BeginParallelFor() and wait for completion.
+    template <class T> void FinishParallelFor(ParallelForState& state);
     /// Pause worker threads.
     void Pause();
     /// Resume worker threads.
@@ -113,6 +163,18 @@ public:
 private:
     /// Process work items until shut down. Called by the worker threads.
     void ProcessItems(unsigned threadIndex);
+    /// Take one immediate work item from own deque or steal from others and execute it. Return true if an item was executed.
+    bool ExecuteImmediateItem(unsigned threadIndex);
+    /// Take the highest priority item from the shared priority queue if it has at least the specified priority and execute it. Return true if an item was executed.
+    bool ExecutePriorityItem(unsigned threadIndex, unsigned priority);
+    /// Count an item's own part as unfinished if not counted yet.
+    void BeginItem(WorkItem* item);
+    /// Run an item's work function and mark its own part finished.
+    void ExecuteItem(WorkItem* item, unsigned threadIndex);
+    /// Mark one part of an item finished. When all parts are finished, queue continuations, set completed and propagate to the parent.
+    void FinishItem(WorkItem* item, unsigned threadIndex);
+    /// Queue an item to the deque of the specified thread, or to the shared priority queue according to its priority.
+    void QueueItem(WorkItem* item, unsigned threadIndex);
     /// Purge completed work items which have at least the specified priority, and send completion events as necessary.
     void PurgeCompleted(unsigned priority);
     /// Purge the pool to reduce allocation where its unneeded.
@@ -126,15 +188,21 @@ private:
     List<SharedPtr<WorkItem> > poolItems_;
     /// Work item collection. Accessed only by the main thread.
     List<SharedPtr<WorkItem> > workItems_;
-    /// Work item prioritized queue for worker threads. Pointers are guaranteed to be valid (point to workItems.)
+    /// Per-thread work-stealing deques for immediate (M_MAX_UNSIGNED priority) items. Index 0 is the main thread. Pointers are guaranteed to be valid (point to workItems.)
+    Vector<WorkStealingDeque*> deques_;
+    /// Work item prioritized queue for lower priority items. Pointers are guaranteed to be valid (point to workItems.)
     List<WorkItem*> queue_;
-    /// Worker queue mutex.
+    /// Priority queue mutex.
     Mutex queueMutex_;
+    /// Pause mutex. Held by the main thread while paused, so that idle worker threads block on it instead of spinning.
+    Mutex pauseMutex_;
+    /// Number of queued or executing immediate items that have not completed yet.
+    volatile int numPendingImmediate_;
+    /// Number of items in the shared priority queue.
+    volatile int numQueued_;
     /// Shutting down flag.
     volatile bool shutDown_;
-    /// Pausing flag. Indicates the worker threads should not contend for the queue mutex.
-    volatile bool pausing_;
-    /// Paused flag. Indicates the queue mutex being locked to prevent worker threads using up CPU time.
+    /// Paused flag. Indicates the pause mutex being locked to prevent idle worker threads using up CPU time.
     bool paused_;
     /// Tolerance for the shared pool before it begins to deallocate.
     int tolerance_;
@@ -144,4 +212,90 @@ private:
     int maxNonThreadedWorkMs_;
 };
 
+template <class T> void WorkQueue::ParallelFor(unsigned begin, unsigned end, unsigned grainSize, T& functor)
+{
+    if (end <= begin)
+        return;
+    
+    grainSize = Max((int)grainSize, 1);
+    unsigned numRanges = (end - begin + grainSize - 1) / grainSize;
+    
+    // If no worker threads or only one range of work, execute directly
+    if (threads_.Empty() || numRanges < 2)
+    {
+        functor(begin, end, 0);
+        return;
+    }
+    
+    ParallelForState state;
+    state.next_ = begin;
+    state.end_ = end;
+    state.grainSize_ = grainSize;
+    state.numThreads_ = threads_.Size() + 1;
+    state.functor_ = &functor;
+    
+    // Claim the first range for the calling thread before the workers can start
+    unsigned rangeBegin, rangeEnd;
+    ClaimParallelForRange(state, rangeBegin, rangeEnd);
+    
+    // Queue one work item per worker thread which is able to find work. Each claims ranges until none remain
+    unsigned numItems = (unsigned)Min((int)threads_.Size(), (int)numRanges - 1);
+    for (unsigned i = 0; i < numItems; ++i)
+    {
+        SharedPtr<WorkItem> item = GetFreeItem();
+        item->priority_ = M_MAX_UNSIGNED;
+        item->workFunction_ = ParallelForWork<T>;
+        item->aux_ = &state;
+        AddWorkItem(item);
+    }
+    
+    functor(rangeBegin, rangeEnd, 0);
+    while (ClaimParallelForRange(state, rangeBegin, rangeEnd))
+        functor(rangeBegin, rangeEnd, 0);
+    
+    Complete(M_MAX_UNSIGNED);
+}
+
+template <class T> void WorkQueue::BeginParallelFor(ParallelForState& state, unsigned begin, unsigned end, unsigned grainSize, T& functor)
+{
+    grainSize = Max((int)grainSize, 1);
+    state.next_ = begin;
+    state.end_ = end;
+    state.grainSize_ = grainSize;
+    state.numThreads_ = threads_.Size() + 1;
+    state.functor_ = &functor;
+    
+    if (end <= begin)
+        return;
+    
+    // If no worker threads, execute directly and leave nothing to claim
+    if (threads_.Empty())
+    {
+        functor(begin, end, 0);
+        state.next_ = end;
+        return;
+    }
+    
+    unsigned numRanges = (end - begin + grainSize - 1) / grainSize;
+    unsigned numItems = (unsigned)Min((int)threads_.Size(), (int)numRanges);
+    for (unsigned i = 0; i < numItems; ++i)
+    {
+        SharedPtr<WorkItem> item = GetFreeItem();
+        item->priority_ = M_MAX_UNSIGNED;
+        item->workFunction_ = ParallelForWork<T>;
+        item->aux_ = &state;
+        AddWorkItem(item);
+    }
+}
+
+template <class T> void WorkQueue::FinishParallelFor(ParallelForState& state)
+{
+    T& functor = *reinterpret_cast<T*>(state.functor_);
+    unsigned rangeBegin, rangeEnd;
+    while (ClaimParallelForRange(state, rangeBegin, rangeEnd))
+        functor(rangeBegin, rangeEnd, 0);
+    
+    Complete(M_MAX_UNSIGNED);
+}
+
 }
@@ -262,13 +262,16 @@ bool Console::PopulateInterpreter()
 {
     interpreters_->RemoveAllItems();
 
-    HashSet<Object*>* receivers = context_->GetEventReceivers(E_CONSOLECOMMAND);
-    if (!receivers || receivers->Empty())
+    EventReceiverGroup* receivers = context_->GetEventReceivers(E_CONSOLECOMMAND);
+    if (!receivers || receivers->handlers_.Empty())
         return false;
 
     Vector<String> names;
-    for (HashSet<Object*>::ConstIterator iter = receivers->Begin(); iter != receivers->End(); ++iter)
-        names.Push((*iter)->GetTypeName());
+    for (PODVector<EventHandler*>::ConstIterator iter = receivers->handlers_.Begin(); iter != receivers->handlers_.End(); ++iter)
+    {
+        if (*iter)
+            names.Push((*iter)->GetReceiver()->GetTypeName());
+    }
     Sort(names.Begin(), names.End());
 
     unsigned selection = M_MAX_UNSIGNED;
@@ -24,6 +24,7 @@
 #include "CoreEvents.h"
 #include "DebugHud.h"
 #include "Engine.h"
+#include "File.h"
 #include "Font.h"
 #include "Graphics.h"
 #include "Log.h"
@@ -80,6 +81,12 @@ DebugHud::DebugHud(Context* context) :
     profilerText_->SetVisible(false);
     uiRoot->AddChild(profilerText_);
 
+    memoryText_ = new Text(context_);
+    memoryText_->SetAlignment(HA_RIGHT, VA_BOTTOM);
+    memoryText_->SetPriority(100);
+    memoryText_->SetVisible(false);
+    uiRoot->AddChild(memoryText_);
+
     SubscribeToEvent(E_POSTUPDATE, HANDLER(DebugHud, HandlePostUpdate));
 }
 
@@ -88,6 +95,7 @@ DebugHud::~DebugHud()
     statsText_->Remove();
     modeText_->Remove();
     profilerText_->Remove();
+    memoryText_->Remove();
 }
 
 void DebugHud::Update()
@@ -105,6 +113,7 @@ void DebugHud::Update()
         uiRoot->AddChild(statsText_);
         uiRoot->AddChild(modeText_);
         uiRoot->AddChild(profilerText_);
+        uiRoot->AddChild(memoryText_);
     }
 
     if (statsText_->IsVisible())
@@ -174,6 +183,9 @@ void DebugHud::Update()
                 profilerText_->SetText(profilerOutput);
             }
 
+            if (memoryText_->IsVisible())
+                memoryText_->SetText(profiler->GetMemoryData());
+
             profiler->BeginInterval();
         }
     }
@@ -190,6 +202,8 @@ void DebugHud::SetDefaultStyle(XMLFile* style)
     modeText_->SetStyle("DebugHudText");
     profilerText_->SetDefaultStyle(style);
     profilerText_->SetStyle("DebugHudText");
+    memoryText_->SetDefaultStyle(style);
+    memoryText_->SetStyle("DebugHudText");
 }
 
 void DebugHud::SetMode(unsigned mode)
@@ -197,6 +211,7 @@ void DebugHud::SetMode(unsigned mode)
     statsText_->SetVisible((mode & DEBUGHUD_SHOW_STATS) != 0);
     modeText_->SetVisible((mode & DEBUGHUD_SHOW_MODE) != 0);
     profilerText_->SetVisible((mode & DEBUGHUD_SHOW_PROFILER) != 0);
+    memoryText_->SetVisible((mode & DEBUGHUD_SHOW_MEMORY) != 0);
 
     mode_ = mode;
 }
@@ -216,6 +231,27 @@ void DebugHud::SetUseRendererStats(bool enable)
     useRendererStats_ = enable;
 }
 
+void DebugHud::SetProfilerTimeline(bool enable)
+{
+    Profiler* profiler = GetSubsystem<Profiler>();
+    if (profiler)
+        profiler->SetTimelineEnabled(enable);
+}
+
+bool DebugHud::SaveProfilerTrace(const String& fileName)
+{
+    Profiler* profiler = GetSubsystem<Profiler>();
+    if (!profiler)
+        return false;
+    
+    File file(context_, fileName, FILE_WRITE);
+    if (!file.IsOpen())
+        return false;
+    
+    String traceData = profiler->GetTraceData();
+    return file.Write(traceData.CString(), traceData.Length()) == traceData.Length();
+}
+
 void DebugHud::Toggle(unsigned mode)
 {
     SetMode(GetMode() ^ mode);
@@ -236,6 +272,12 @@ float DebugHud::GetProfilerInterval() const
     return (float)profilerInterval_ / 1000.0f;
 }
 
+bool DebugHud::GetProfilerTimeline() const
+{
+    Profiler* profiler = GetSubsystem<Profiler>();
+    return profiler ? profiler->IsTimelineEnabled() : false;
+}
+
 void DebugHud::SetAppStats(const String& label, const Variant& stats)
 {
     SetAppStats(label, stats.ToString());
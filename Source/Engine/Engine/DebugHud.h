@@ -37,6 +37,7 @@ static const unsigned DEBUGHUD_SHOW_NONE = 0x0;
 static const unsigned DEBUGHUD_SHOW_STATS = 0x1;
 static const unsigned DEBUGHUD_SHOW_MODE = 0x2;
 static const unsigned DEBUGHUD_SHOW_PROFILER = 0x4;
+static const unsigned DEBUGHUD_SHOW_MEMORY = 0x8;
 static const unsigned DEBUGHUD_SHOW_ALL = 0x7;
 
 /// Displays rendering stats and profiling information.
@@ -62,6 +63,10 @@ public:
     void SetProfilerInterval(float interval);
     /// Set whether to show 3D geometry primitive/batch count only. Default false.
     void SetUseRendererStats(bool enable);
+    /// Set whether the profiler records the blocks of all threads to its timeline.
+    void SetProfilerTimeline(bool enable);
+    /// Save the profiler timeline to a file in the Chrome trace event JSON format. Return true if successful.
+    bool SaveProfilerTrace(const String& fileName);
     /// Toggle elements.
     void Toggle(unsigned mode);
     /// Toggle all elements.
@@ -75,12 +80,16 @@ public:
     Text* GetModeText() const { return modeText_; }
     /// Return profiler text.
     Text* GetProfilerText() const { return profilerText_; }
+    /// Return memory text.
+    Text* GetMemoryText() const { return memoryText_; }
     /// Return currently shown elements.
     unsigned GetMode() const { return mode_; }
     /// Return maximum profiler block depth.
     unsigned GetProfilerMaxDepth() const { return profilerMaxDepth_; }
     /// Return profiler accumulation interval in seconds
     float GetProfilerInterval() const;
+    /// Return whether the profiler records the blocks of all threads to its timeline.
+    bool GetProfilerTimeline() const;
 
     /// Return whether showing 3D geometry primitive/batch count only.
     bool GetUseRendererStats() const { return useRendererStats_; }
@@ -103,6 +112,8 @@ private:
     SharedPtr<Text> modeText_;
     /// Profiling information text.
     SharedPtr<Text> profilerText_;
+    /// Heap allocation information text.
+    SharedPtr<Text> memoryText_;
     /// Hashmap containing application specific stats.
     HashMap<String, String> appStats_;
     /// Profiler timer.
@@ -87,10 +87,12 @@ Engine::Engine(Context* context) :
     #if defined(ANDROID) || defined(IOS) || defined(RASPI)
     maxFps_(60),
     maxInactiveFps_(10),
+    postedEventDispatch_(DISPATCH_BEGINFRAME),
     pauseMinimized_(true),
     #else
     maxFps_(200),
     maxInactiveFps_(60),
+    postedEventDispatch_(DISPATCH_BEGINFRAME),
     pauseMinimized_(false),
     #endif
 #ifdef URHO3D_TESTING
@@ -425,6 +427,9 @@ void Engine::RunFrame()
 
     time->BeginFrame(timeStep_);
 
+    if (postedEventDispatch_ == DISPATCH_BEGINFRAME)
+        SendPostedEvents();
+
     // If pause when minimized -mode is in use, stop updates and audio as necessary
     if (pauseMinimized_ && input->IsMinimized())
     {
@@ -446,7 +451,14 @@ void Engine::RunFrame()
         Update();
     }
 
+    if (postedEventDispatch_ == DISPATCH_POSTUPDATE)
+        SendPostedEvents();
+
     Render();
+
+    if (postedEventDispatch_ == DISPATCH_ENDFRAME)
+        SendPostedEvents();
+
     ApplyFrameLimit();
 
     time->EndFrame();
@@ -518,6 +530,11 @@ void Engine::SetAutoExit(bool enable)
     autoExit_ = enable;
 }
 
+void Engine::SetPostedEventDispatch(PostedEventDispatch dispatch)
+{
+    postedEventDispatch_ = dispatch;
+}
+
 void Engine::SetNextTimeStep(float seconds)
 {
     timeStep_ = Max(seconds, 0.0f);
@@ -536,14 +553,18 @@ void Engine::DumpProfiler()
 {
     Profiler* profiler = GetSubsystem<Profiler>();
     if (profiler)
+    {
         LOGRAW(profiler->GetData(true, true) + "\n");
+        if (IsMemoryTrackingSupported())
+            LOGRAW(profiler->GetMemoryData() + "\n");
+    }
 }
 
 void Engine::DumpResources(bool dumpFileName)
 {
     #ifdef URHO3D_LOGGING
     ResourceCache* cache = GetSubsystem<ResourceCache>();
-    const HashMap<StringHash, ResourceGroup>& resourceGroups = cache->GetAllResources();
+    const FlatHashMap<StringHash, ResourceGroup>& resourceGroups = cache->GetAllResources();
     LOGRAW("\n");
     
     if (dumpFileName)
@@ -551,13 +572,13 @@ void Engine::DumpResources(bool dumpFileName)
         LOGRAW("Used resources:\n");
     }
     
-    for (HashMap<StringHash, ResourceGroup>::ConstIterator i = resourceGroups.Begin();
+    for (FlatHashMap<StringHash, ResourceGroup>::ConstIterator i = resourceGroups.Begin();
         i != resourceGroups.End(); ++i)
     {
-        const HashMap<StringHash, SharedPtr<Resource> >& resources = i->second_.resources_;
+        const FlatHashMap<StringHash, SharedPtr<Resource> >& resources = i->second_.resources_;
         if (dumpFileName)
         {
-            for (HashMap<StringHash, SharedPtr<Resource> >::ConstIterator j = resources.Begin();
+            for (FlatHashMap<StringHash, SharedPtr<Resource> >::ConstIterator j = resources.Begin();
                 j != resources.End(); ++j)
             {
                 LOGRAW(j->second_->GetName() + "\n");
@@ -645,6 +666,13 @@ void Engine::Update()
     SendEvent(E_POSTRENDERUPDATE, eventData);
 }
 
+void Engine::SendPostedEvents()
+{
+    PROFILE(SendPostedEvents);
+
+    context_->SendPostedEvents();
+}
+
 void Engine::Render()
 {
     if (headless_)
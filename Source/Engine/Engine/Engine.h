@@ -31,6 +31,14 @@ namespace Urho3D
 class Console;
 class DebugHud;
 
+/// Point in the frame where events posted from other threads are sent.
+enum PostedEventDispatch
+{
+    DISPATCH_BEGINFRAME = 0,
+    DISPATCH_POSTUPDATE,
+    DISPATCH_ENDFRAME
+};
+
 /// Urho3D engine. Creates the other subsystems.
 class URHO3D_API Engine : public Object
 {
@@ -62,6 +70,8 @@ public:
     void SetPauseMinimized(bool enable);
     /// Set whether to exit automatically on exit request (window close button.)
     void SetAutoExit(bool enable);
+    /// Set the point in the frame where events posted from other threads are sent. Default is at the beginning, before the update events.
+    void SetPostedEventDispatch(PostedEventDispatch dispatch);
     /// Override timestep of the next frame. Should be called in between RunFrame() calls.
     void SetNextTimeStep(float seconds);
     /// Close the graphics window and set the exit flag. No-op on iOS, as an iOS application can not legally exit.
@@ -87,6 +97,8 @@ public:
     bool GetPauseMinimized() const { return pauseMinimized_; }
     /// Return whether to exit automatically on exit request.
     bool GetAutoExit() const { return autoExit_; }
+    /// Return the point in the frame where events posted from other threads are sent.
+    PostedEventDispatch GetPostedEventDispatch() const { return postedEventDispatch_; }
     /// Return whether engine has been initialized.
     bool IsInitialized() const { return initialized_; }
     /// Return whether exit has been requested.
@@ -96,6 +108,8 @@ public:
     
     /// Send frame update events.
     void Update();
+    /// Send the events posted from other threads.
+    void SendPostedEvents();
     /// Render after frame update.
     void Render();
     /// Get the timestep for the next frame and sleep for frame limiting if necessary.
@@ -128,6 +142,8 @@ private:
     unsigned maxFps_;
     /// Maximum frames per second when the application does not have input focus.
     unsigned maxInactiveFps_;
+    /// Point in the frame where posted events are sent.
+    PostedEventDispatch postedEventDispatch_;
     /// Pause when minimized flag.
     bool pauseMinimized_;
 #ifdef URHO3D_TESTING
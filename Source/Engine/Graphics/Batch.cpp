@@ -43,28 +43,12 @@
 namespace Urho3D
 {
 
-inline bool CompareBatchesState(Batch* lhs, Batch* rhs)
+inline unsigned FloatToSortKey(float value)
 {
-    if (lhs->sortKey_ != rhs->sortKey_)
-        return lhs->sortKey_ < rhs->sortKey_;
-    else
-        return lhs->distance_ < rhs->distance_;
-}
-
-inline bool CompareBatchesFrontToBack(Batch* lhs, Batch* rhs)
-{
-    if (lhs->distance_ != rhs->distance_)
-        return lhs->distance_ < rhs->distance_;
-    else
-        return lhs->sortKey_ < rhs->sortKey_;
-}
-
-inline bool CompareBatchesBackToFront(Batch* lhs, Batch* rhs)
-{
-    if (lhs->distance_ != rhs->distance_)
-        return lhs->distance_ > rhs->distance_;
-    else
-        return lhs->sortKey_ < rhs->sortKey_;
+    // Flip negative values completely and positive values by the sign bit, so that the integers sort in the same order
+    unsigned bits;
+    memcpy(&bits, &value, sizeof bits);
+    return (bits & 0x80000000) ? ~bits : (bits | 0x80000000);
 }
 
 inline bool CompareInstancesFrontToBack(const InstanceData& lhs, const InstanceData& rhs)
@@ -722,13 +706,15 @@ void BatchQueue::SortBackToFront()
     for (unsigned i = 0; i < batches_.Size(); ++i)
         sortedBatches_[i] = &batches_[i];
     
-    Sort(sortedBatches_.Begin(), sortedBatches_.End(), CompareBatchesBackToFront);
+    // Stable sorts, so sort by the secondary key first
+    SortBatchesByKey(sortedBatches_);
+    SortBatchesByDistance(sortedBatches_, true);
     
     // Do not actually sort batch groups, just list them
     sortedBatchGroups_.Resize(batchGroups_.Size());
     
     unsigned index = 0;
-    for (HashMap<BatchGroupKey, BatchGroup>::Iterator i = batchGroups_.Begin(); i != batchGroups_.End(); ++i)
+    for (FlatHashMap<BatchGroupKey, BatchGroup>::Iterator i = batchGroups_.Begin(); i != batchGroups_.End(); ++i)
         sortedBatchGroups_[index++] = &i->second_;
 }
 
@@ -742,7 +728,7 @@ void BatchQueue::SortFrontToBack()
     SortFrontToBack2Pass(sortedBatches_);
     
     // Sort each group front to back
-    for (HashMap<BatchGroupKey, BatchGroup>::Iterator i = batchGroups_.Begin(); i != batchGroups_.End(); ++i)
+    for (FlatHashMap<BatchGroupKey, BatchGroup>::Iterator i = batchGroups_.Begin(); i != batchGroups_.End(); ++i)
     {
         if (i->second_.instances_.Size() <= maxSortedInstances_)
         {
@@ -753,7 +739,7 @@ void BatchQueue::SortFrontToBack()
         else
         {
             float minDistance = M_INFINITY;
-            for (PODVector<InstanceData>::ConstIterator j = i->second_.instances_.Begin(); j != i->second_.instances_.End(); ++j)
+            for (FramePODVector<InstanceData>::ConstIterator j = i->second_.instances_.Begin(); j != i->second_.instances_.End(); ++j)
                 minDistance = Min(minDistance, j->distance_);
             i->second_.distance_ = minDistance;
         }
@@ -762,7 +748,7 @@ void BatchQueue::SortFrontToBack()
     sortedBatchGroups_.Resize(batchGroups_.Size());
     
     unsigned index = 0;
-    for (HashMap<BatchGroupKey, BatchGroup>::Iterator i = batchGroups_.Begin(); i != batchGroups_.End(); ++i)
+    for (FlatHashMap<BatchGroupKey, BatchGroup>::Iterator i = batchGroups_.Begin(); i != batchGroups_.End(); ++i)
         sortedBatchGroups_[index++] = &i->second_;
     
     SortFrontToBack2Pass(reinterpret_cast<PODVector<Batch*>& >(sortedBatchGroups_));
@@ -773,10 +759,12 @@ void BatchQueue::SortFrontToBack2Pass(PODVector<Batch*>& batches)
     // Mobile devices likely use a tiled deferred approach, with which front-to-back sorting is irrelevant. The 2-pass
     // method is also time consuming, so just sort with state having priority
     #ifdef GL_ES_VERSION_2_0
-    Sort(batches.Begin(), batches.End(), CompareBatchesState);
+    SortBatchesByDistance(batches, false);
+    SortBatchesByKey(batches);
     #else
     // For desktop, first sort by distance and remap shader/material/geometry IDs in the sort key
-    Sort(batches.Begin(), batches.End(), CompareBatchesFrontToBack);
+    SortBatchesByKey(batches);
+    SortBatchesByDistance(batches, false);
     
     unsigned freeShaderID = 0;
     unsigned short freeMaterialID = 0;
@@ -796,7 +784,7 @@ void BatchQueue::SortFrontToBack2Pass(PODVector<Batch*>& batches)
             ++freeShaderID;
         }
         
-        unsigned short materialID = (unsigned short)(batch->sortKey_ & 0xffff0000);
+        unsigned short materialID = (unsigned short)(batch->sortKey_ >> 16);
         HashMap<unsigned short, unsigned short>::ConstIterator k = materialRemapping_.Find(materialID);
         if (k != materialRemapping_.End())
             materialID = k->second_;
@@ -816,21 +804,62 @@ void BatchQueue::SortFrontToBack2Pass(PODVector<Batch*>& batches)
             ++freeGeometryID;
         }
         
-        batch->sortKey_ = (((unsigned long long)shaderID) << 32) || (((unsigned long long)materialID) << 16) | geometryID;
+        batch->sortKey_ = (((unsigned long long)shaderID) << 32) | (((unsigned long long)materialID) << 16) | geometryID;
     }
     
     shaderRemapping_.Clear();
     materialRemapping_.Clear();
     geometryRemapping_.Clear();
     
-    // Finally sort again with the rewritten ID's
-    Sort(batches.Begin(), batches.End(), CompareBatchesState);
+    // Finally sort again with the rewritten ID's. The sort is stable, so batches with the same state stay in distance order
+    SortBatchesByKey(batches);
     #endif
 }
 
+void BatchQueue::SortBatchesByKey(PODVector<Batch*>& batches)
+{
+    unsigned count = batches.Size();
+    if (count < 2)
+        return;
+    
+    sortItems_.Resize(count);
+    sortTemp_.Resize(count);
+    for (unsigned i = 0; i < count; ++i)
+    {
+        sortItems_[i].key_ = batches[i]->sortKey_;
+        sortItems_[i].value_ = batches[i];
+    }
+    
+    RadixSort(&sortItems_[0], &sortTemp_[0], count);
+    
+    for (unsigned i = 0; i < count; ++i)
+        batches[i] = sortItems_[i].value_;
+}
+
+void BatchQueue::SortBatchesByDistance(PODVector<Batch*>& batches, bool backToFront)
+{
+    unsigned count = batches.Size();
+    if (count < 2)
+        return;
+    
+    sortItems_.Resize(count);
+    sortTemp_.Resize(count);
+    for (unsigned i = 0; i < count; ++i)
+    {
+        unsigned key = FloatToSortKey(batches[i]->distance_);
+        sortItems_[i].key_ = backToFront ? ~key : key;
+        sortItems_[i].value_ = batches[i];
+    }
+    
+    RadixSort(&sortItems_[0], &sortTemp_[0], count);
+    
+    for (unsigned i = 0; i < count; ++i)
+        batches[i] = sortItems_[i].value_;
+}
+
 void BatchQueue::SetTransforms(void* lockedData, unsigned& freeIndex)
 {
-    for (HashMap<BatchGroupKey, BatchGroup>::Iterator i = batchGroups_.Begin(); i != batchGroups_.End(); ++i)
+    for (FlatHashMap<BatchGroupKey, BatchGroup>::Iterator i = batchGroups_.Begin(); i != batchGroups_.End(); ++i)
         i->second_.SetTransforms(lockedData, freeIndex);
 }
 
@@ -881,7 +910,7 @@ unsigned BatchQueue::GetNumInstances() const
 {
     unsigned total = 0;
     
-    for (HashMap<BatchGroupKey, BatchGroup>::ConstIterator i = batchGroups_.Begin(); i != batchGroups_.End(); ++i)
+    for (FlatHashMap<BatchGroupKey, BatchGroup>::ConstIterator i = batchGroups_.Begin(); i != batchGroups_.End(); ++i)
     {
        if (i->second_.geometryType_ == GEOM_INSTANCED)
             total += i->second_.instances_.Size();
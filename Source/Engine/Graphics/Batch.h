@@ -23,10 +23,13 @@
 #pragma once
 
 #include "Drawable.h"
+#include "FlatHashMap.h"
+#include "FrameAllocator.h"
 #include "MathDefs.h"
 #include "Matrix3x4.h"
 #include "Ptr.h"
 #include "Rect.h"
+#include "Sort.h"
 
 namespace Urho3D
 {
@@ -146,6 +149,14 @@ struct BatchGroup : public Batch
         startIndex_(M_MAX_UNSIGNED)
     {
     }
+    
+    /// Construct from a batch, allocating the instance data from a frame allocator.
+    BatchGroup(const Batch& batch, FrameAllocator* allocator) :
+        Batch(batch),
+        instances_(allocator),
+        startIndex_(M_MAX_UNSIGNED)
+    {
+    }
 
     /// Destruct.
     ~BatchGroup()
@@ -171,7 +182,7 @@ struct BatchGroup : public Batch
     void Draw(View* view) const;
     
     /// Instance data.
-    PODVector<InstanceData> instances_;
+    FramePODVector<InstanceData> instances_;
     /// Instance stream start index, or M_MAX_UNSIGNED if transforms not pre-set.
     unsigned startIndex_;
 };
@@ -226,6 +237,10 @@ public:
     void SortFrontToBack();
     /// Sort batches front to back while also maintaining state sorting.
     void SortFrontToBack2Pass(PODVector<Batch*>& batches);
+    /// Stable sort batches by sort key.
+    void SortBatchesByKey(PODVector<Batch*>& batches);
+    /// Stable sort batches by distance.
+    void SortBatchesByDistance(PODVector<Batch*>& batches, bool backToFront);
     /// Pre-set instance transforms of all groups. The vertex buffer must be big enough to hold all transforms.
     void SetTransforms(void* lockedData, unsigned& freeIndex);
     /// Draw.
@@ -236,7 +251,7 @@ public:
     bool IsEmpty() const { return batches_.Empty() && batchGroups_.Empty(); }
     
     /// Instanced draw calls.
-    HashMap<BatchGroupKey, BatchGroup> batchGroups_;
+    FlatHashMap<BatchGroupKey, BatchGroup> batchGroups_;
     /// Shader remapping table for 2-pass state and distance sort.
     HashMap<unsigned, unsigned> shaderRemapping_;
     /// Material remapping table for 2-pass state and distance sort.
@@ -250,6 +265,10 @@ public:
     PODVector<Batch*> sortedBatches_;
     /// Sorted instanced draw calls.
     PODVector<BatchGroup*> sortedBatchGroups_;
+    /// Radix sort keys and batches.
+    PODVector<RadixSortItem<Batch*> > sortItems_;
+    /// Radix sort temporary buffer.
+    PODVector<RadixSortItem<Batch*> > sortTemp_;
     /// Maximum sorted instances.
     unsigned maxSortedInstances_;
 };
@@ -78,6 +78,7 @@ Drawable::Drawable(Context* context, unsigned char drawableFlags) :
     basePassFlags_(0),
     maxLights_(0),
     octant_(0),
+    octantIndex_(0),
     firstLight_(0),
     zone_(0),
     zoneDirty_(false)
@@ -328,6 +328,8 @@ protected:
     unsigned maxLights_;
     /// Octree octant.
     Octant* octant_;
+    /// Index in the octant's drawable list.
+    unsigned octantIndex_;
     /// First per-pixel light added this frame.
     Light* firstLight_;
     /// Per-pixel lights affecting this drawable.
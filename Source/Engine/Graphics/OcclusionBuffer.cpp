@@ -24,6 +24,7 @@
 #include "Camera.h"
 #include "Log.h"
 #include "OcclusionBuffer.h"
+#include "WorkQueue.h"
 
 #include <cstring>
 
@@ -39,6 +40,60 @@ static const unsigned CLIPMASK_Y_NEG = 0x8;
 static const unsigned CLIPMASK_Z_POS = 0x10;
 static const unsigned CLIPMASK_Z_NEG = 0x20;
 
+/// Threaded occlusion tile rasterization task.
+struct DrawOcclusionTilesTask
+{
+    /// Construct.
+    DrawOcclusionTilesTask(OcclusionBuffer* buffer) :
+        buffer_(buffer)
+    {
+    }
+    
+    /// Rasterize a range of tiles.
+    void operator () (unsigned start, unsigned end, unsigned threadIndex)
+    {
+        for (unsigned i = start; i < end; ++i)
+            buffer_->DrawTile(i);
+    }
+    
+    /// Occlusion buffer.
+    OcclusionBuffer* buffer_;
+};
+
+/// Threaded depth hierarchy build task.
+struct BuildDepthHierarchyTask
+{
+    /// Construct.
+    BuildDepthHierarchyTask(OcclusionBuffer* buffer) :
+        buffer_(buffer)
+    {
+    }
+    
+    /// Build the mip levels for a range of depth hierarchy tiles.
+    void operator () (unsigned start, unsigned end, unsigned threadIndex)
+    {
+        for (unsigned i = start; i < end; ++i)
+            buffer_->BuildDepthHierarchyTile(i);
+    }
+    
+    /// Occlusion buffer.
+    OcclusionBuffer* buffer_;
+};
+
+void DrawOcclusionTileWork(const WorkItem* item, unsigned threadIndex)
+{
+    OcclusionBuffer* buffer = reinterpret_cast<OcclusionBuffer*>(item->aux_);
+    PODVector<unsigned>* tile = reinterpret_cast<PODVector<unsigned>*>(item->start_);
+    buffer->DrawTile(tile - &buffer->tileTriangles_[0]);
+}
+
+void BuildDepthHierarchyWork(const WorkItem* item, unsigned threadIndex)
+{
+    OcclusionBuffer* buffer = reinterpret_cast<OcclusionBuffer*>(item->aux_);
+    int* rows = reinterpret_cast<int*>(item->start_);
+    buffer->BuildDepthHierarchyTile((rows - buffer->buffer_) / (buffer->hierarchyTileHeight_ * buffer->width_));
+}
+
 OcclusionBuffer::OcclusionBuffer(Context* context) :
     Object(context),
     buffer_(0),
@@ -49,8 +104,10 @@ OcclusionBuffer::OcclusionBuffer(Context* context) :
     cullMode_(CULL_CCW),
     depthHierarchyDirty_(true),
     reverseCulling_(false),
+    buildingDepthHierarchy_(false),
     nearClip_(0.0f),
-    farClip_(0.0f)
+    farClip_(0.0f),
+    hierarchyTileHeight_(0)
 {
 }
 
@@ -96,6 +153,13 @@ bool OcclusionBuffer::SetSize(int width, int height)
             break;
     }
     
+    // Split the buffer into horizontal tiles for threaded rasterization. Each depth hierarchy tile must reduce to whole
+    // rows in the last mip level
+    triangles_.Clear();
+    tileTriangles_.Clear();
+    tileTriangles_.Resize((height_ + OCCLUSION_TILE_HEIGHT - 1) / OCCLUSION_TILE_HEIGHT);
+    hierarchyTileHeight_ = 1 << mipBuffers_.Size();
+    
     LOGDEBUG("Set occlusion buffer size " + String(width_) + "x" + String(height_) + " with " + 
         String(mipBuffers_.Size()) + " mip levels");
     
@@ -146,6 +210,10 @@ void OcclusionBuffer::Clear()
     
     Reset();
     
+    triangles_.Clear();
+    for (unsigned i = 0; i < tileTriangles_.Size(); ++i)
+        tileTriangles_[i].Clear();
+    
     int* dest = buffer_;
     int count = width_ * height_;
     
@@ -247,98 +315,100 @@ bool OcclusionBuffer::Draw(const Matrix3x4& model, const void* vertexData, unsig
     return true;
 }
 
+void OcclusionBuffer::DrawTriangles()
+{
+    if (triangles_.Empty())
+        return;
+    
+    DrawOcclusionTilesTask task(this);
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    if (queue)
+        queue->ParallelFor(0, tileTriangles_.Size(), 1, task);
+    else
+        task(0, tileTriangles_.Size(), 0);
+    
+    triangles_.Clear();
+    for (unsigned i = 0; i < tileTriangles_.Size(); ++i)
+        tileTriangles_[i].Clear();
+}
+
 void OcclusionBuffer::BuildDepthHierarchy()
 {
     if (!buffer_)
         return;
     
-    // Build the first mip level from the pixel-level data
-    int width = (width_ + 1) / 2;
-    int height = (height_ + 1) / 2;
-    if (mipBuffers_.Size())
+    DrawTriangles();
+    
+    unsigned numTiles = (height_ + hierarchyTileHeight_ - 1) / hierarchyTileHeight_;
+    BuildDepthHierarchyTask task(this);
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    if (queue)
+        queue->ParallelFor(0, numTiles, 1, task);
+    else
+        task(0, numTiles, 0);
+    
+    depthHierarchyDirty_ = false;
+}
+
+void OcclusionBuffer::BeginBuildDepthHierarchy()
+{
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    if (!buffer_ || !queue || buildingDepthHierarchy_)
+        return;
+    
+    // The first tile is drawn by the parent item. The mip levels are built by one continuation per depth hierarchy tile,
+    // which are queued once the parent item and the other tiles have completed
+    SharedPtr<WorkItem> parentItem = queue->GetFreeItem();
+    parentItem->priority_ = M_MAX_UNSIGNED;
+    parentItem->workFunction_ = DrawOcclusionTileWork;
+    parentItem->aux_ = this;
+    parentItem->start_ = &tileTriangles_[0];
+    
+    unsigned numHierarchyTiles = (height_ + hierarchyTileHeight_ - 1) / hierarchyTileHeight_;
+    for (unsigned i = 0; i < numHierarchyTiles; ++i)
     {
-        for (int y = 0; y < height; ++y)
-        {
-            int* src = buffer_ + (y * 2) * width_;
-            DepthValue* dest = mipBuffers_[0].Get() + y * width;
-            DepthValue* end = dest + width;
-            
-            if (y * 2 + 1 < height_)
-            {
-                int* src2 = src + width_;
-                while (dest < end)
-                {
-                    int minUpper = Min(src[0], src[1]);
-                    int minLower = Min(src2[0], src2[1]);
-                    dest->min_ = Min(minUpper, minLower);
-                    int maxUpper = Max(src[0], src[1]);
-                    int maxLower = Max(src2[0], src2[1]);
-                    dest->max_ = Max(maxUpper, maxLower);
-                    
-                    src += 2;
-                    src2 += 2;
-                    ++dest;
-                }
-            }
-            else
-            {
-                while (dest < end)
-                {
-                    dest->min_ = Min(src[0], src[1]);
-                    dest->max_ = Max(src[0], src[1]);
-                    
-                    src += 2;
-                    ++dest;
-                }
-            }
-        }
+        SharedPtr<WorkItem> item = queue->GetFreeItem();
+        item->priority_ = M_MAX_UNSIGNED;
+        item->workFunction_ = BuildDepthHierarchyWork;
+        item->aux_ = this;
+        item->start_ = buffer_ + i * hierarchyTileHeight_ * width_;
+        queue->AddContinuation(parentItem, item);
     }
     
-    // Build the rest of the mip levels
-    for (unsigned i = 1; i < mipBuffers_.Size(); ++i)
+    for (unsigned i = 1; i < tileTriangles_.Size(); ++i)
     {
-        int prevWidth = width;
-        int prevHeight = height;
-        width = (width + 1) / 2;
-        height = (height + 1) / 2;
+        if (tileTriangles_[i].Empty())
+            continue;
         
-        for (int y = 0; y < height; ++y)
-        {
-            DepthValue* src = mipBuffers_[i - 1].Get() + (y * 2) * prevWidth;
-            DepthValue* dest = mipBuffers_[i].Get() + y * width;
-            DepthValue* end = dest + width;
-            
-            if (y * 2 + 1 < prevHeight)
-            {
-                DepthValue* src2 = src + prevWidth;
-                while (dest < end)
-                {
-                    int minUpper = Min(src[0].min_, src[1].min_);
-                    int minLower = Min(src2[0].min_, src2[1].min_);
-                    dest->min_ = Min(minUpper, minLower);
-                    int maxUpper = Max(src[0].max_, src[1].max_);
-                    int maxLower = Max(src2[0].max_, src2[1].max_);
-                    dest->max_ = Max(maxUpper, maxLower);
-                    
-                    src += 2;
-                    src2 += 2;
-                    ++dest;
-                }
-            }
-            else
-            {
-                while (dest < end)
-                {
-                    dest->min_ = Min(src[0].min_, src[1].min_);
-                    dest->max_ = Max(src[0].max_, src[1].max_);
-                    
-                    src += 2;
-                    ++dest;
-                }
-            }
-        }
+        SharedPtr<WorkItem> item = queue->GetFreeItem();
+        item->priority_ = M_MAX_UNSIGNED;
+        item->workFunction_ = DrawOcclusionTileWork;
+        item->aux_ = this;
+        item->start_ = &tileTriangles_[i];
+        item->parent_ = parentItem;
+        queue->AddWorkItem(item);
+    }
+    
+    queue->AddWorkItem(parentItem);
+    buildingDepthHierarchy_ = true;
+}
+
+void OcclusionBuffer::EndBuildDepthHierarchy()
+{
+    if (!buildingDepthHierarchy_)
+    {
+        if (depthHierarchyDirty_)
+            BuildDepthHierarchy();
+        return;
     }
     
+    GetSubsystem<WorkQueue>()->Complete(M_MAX_UNSIGNED);
+    
+    triangles_.Clear();
+    for (unsigned i = 0; i < tileTriangles_.Size(); ++i)
+        tileTriangles_[i].Clear();
+    
+    buildingDepthHierarchy_ = false;
     depthHierarchyDirty_ = false;
 }
 
@@ -570,7 +640,7 @@ void OcclusionBuffer::DrawTriangle(Vector4* vertices)
         bool clockwise = SignedArea(projected[0], projected[1], projected[2]) < 0.0f;
         if (cullMode_ == CULL_NONE || (cullMode_ == CULL_CCW && clockwise) || (cullMode_ == CULL_CW && !clockwise))
         {
-            DrawTriangle2D(projected, clockwise);
+            AddTriangle2D(projected, clockwise);
             drawOk = true;
         }
     }
@@ -608,7 +678,7 @@ void OcclusionBuffer::DrawTriangle(Vector4* vertices)
                 bool clockwise = SignedArea(projected[0], projected[1], projected[2]) < 0.0f;
                 if (cullMode_ == CULL_NONE || (cullMode_ == CULL_CCW && clockwise) || (cullMode_ == CULL_CW && !clockwise))
                 {
-                    DrawTriangle2D(projected, clockwise);
+                    AddTriangle2D(projected, clockwise);
                     drawOk = true;
                 }
             }
@@ -749,7 +819,69 @@ struct Edge
     int invZStep_;
 };
 
-void OcclusionBuffer::DrawTriangle2D(const Vector3* vertices, bool clockwise)
+/// %Occlusion triangle set up for rasterization.
+struct OcclusionTriangle
+{
+    /// Edge from top to middle vertex.
+    Edge topToMiddle_;
+    /// Edge from top to bottom vertex.
+    Edge topToBottom_;
+    /// Edge from middle to bottom vertex.
+    Edge middleToBottom_;
+    /// Top row.
+    int topY_;
+    /// Middle row.
+    int middleY_;
+    /// Bottom row (exclusive.)
+    int bottomY_;
+    /// Integer horizontal depth gradient.
+    int dInvZdX_;
+    /// Middle vertex is on the right flag.
+    bool middleIsRight_;
+};
+
+/// Draw rows from startY to endY (exclusive) of a triangle half. The edges are stepped from their start rows, and depth is interpolated from the left edge. Spans are clipped to the buffer width.
+static inline void DrawSpans(int* buffer, int width, const Edge& left, int leftY, const Edge& right, int rightY, int dInvZdX,
+    int startY, int endY)
+{
+    if (startY >= endY)
+        return;
+    
+    int leftX = left.x_ + (startY - leftY) * left.xStep_;
+    int leftInvZ = left.invZ_ + (startY - leftY) * left.invZStep_;
+    int rightX = right.x_ + (startY - rightY) * right.xStep_;
+    int* row = buffer + startY * width;
+    int* endRow = buffer + endY * width;
+    
+    while (row < endRow)
+    {
+        int start = leftX >> 16;
+        int end = Min(rightX >> 16, width);
+        int invZ = leftInvZ;
+        if (start < 0)
+        {
+            invZ -= start * dInvZdX;
+            start = 0;
+        }
+        
+        int* dest = row + start;
+        int* destEnd = row + end;
+        while (dest < destEnd)
+        {
+            if (invZ < *dest)
+                *dest = invZ;
+            invZ += dInvZdX;
+            ++dest;
+        }
+        
+        leftX += left.xStep_;
+        leftInvZ += left.invZStep_;
+        rightX += right.xStep_;
+        row += width;
+    }
+}
+
+void OcclusionBuffer::AddTriangle2D(const Vector3* vertices, bool clockwise)
 {
     int top, middle, bottom;
     bool middleIsRight;
@@ -804,8 +936,8 @@ void OcclusionBuffer::DrawTriangle2D(const Vector3* vertices, bool clockwise)
     int middleY = (int)vertices[middle].y_;
     int bottomY = (int)vertices[bottom].y_;
     
-    // Check for degenerate triangle
-    if (topY == bottomY)
+    // Check for degenerate triangle, or no rows inside the buffer
+    if (topY == bottomY || bottomY <= 0 || topY >= height_)
         return;
     
     // Reverse middleIsRight test if triangle is counterclockwise
@@ -813,100 +945,152 @@ void OcclusionBuffer::DrawTriangle2D(const Vector3* vertices, bool clockwise)
         middleIsRight = !middleIsRight;
 
     Gradients gradients(vertices);
-    Edge topToMiddle(gradients, vertices[top], vertices[middle], topY);
-    Edge topToBottom(gradients, vertices[top], vertices[bottom], topY);
-    Edge middleToBottom(gradients, vertices[middle], vertices[bottom], middleY);
     
-    if (middleIsRight)
+    unsigned index = triangles_.Size();
+    triangles_.Resize(index + 1);
+    OcclusionTriangle& triangle = triangles_.Back();
+    triangle.topToMiddle_ = Edge(gradients, vertices[top], vertices[middle], topY);
+    triangle.topToBottom_ = Edge(gradients, vertices[top], vertices[bottom], topY);
+    triangle.middleToBottom_ = Edge(gradients, vertices[middle], vertices[bottom], middleY);
+    triangle.topY_ = topY;
+    triangle.middleY_ = middleY;
+    triangle.bottomY_ = bottomY;
+    triangle.dInvZdX_ = gradients.dInvZdXInt_;
+    triangle.middleIsRight_ = middleIsRight;
+    
+    int lastTile = tileTriangles_.Size() - 1;
+    int firstTriangleTile = Clamp(topY / OCCLUSION_TILE_HEIGHT, 0, lastTile);
+    int lastTriangleTile = Clamp((bottomY - 1) / OCCLUSION_TILE_HEIGHT, 0, lastTile);
+    for (int i = firstTriangleTile; i <= lastTriangleTile; ++i)
+        tileTriangles_[i].Push(index);
+}
+
+void OcclusionBuffer::DrawTriangle2D(const OcclusionTriangle& triangle, int minY, int maxY)
+{
+    // Only the rows belonging to the tile are drawn
+    int topHalfStart = Max(triangle.topY_, minY);
+    int topHalfEnd = Min(triangle.middleY_, maxY);
+    int bottomHalfStart = Max(triangle.middleY_, minY);
+    int bottomHalfEnd = Min(triangle.bottomY_, maxY);
+    
+    if (triangle.middleIsRight_)
     {
-        // Top half
-        int* row = buffer_ + topY * width_;
-        int* endRow = buffer_ + middleY * width_;
-        while (row < endRow)
+        DrawSpans(buffer_, width_, triangle.topToBottom_, triangle.topY_, triangle.topToMiddle_, triangle.topY_,
+            triangle.dInvZdX_, topHalfStart, topHalfEnd);
+        DrawSpans(buffer_, width_, triangle.topToBottom_, triangle.topY_, triangle.middleToBottom_, triangle.middleY_,
+            triangle.dInvZdX_, bottomHalfStart, bottomHalfEnd);
+    }
+    else
+    {
+        DrawSpans(buffer_, width_, triangle.topToMiddle_, triangle.topY_, triangle.topToBottom_, triangle.topY_,
+            triangle.dInvZdX_, topHalfStart, topHalfEnd);
+        DrawSpans(buffer_, width_, triangle.middleToBottom_, triangle.middleY_, triangle.topToBottom_, triangle.topY_,
+            triangle.dInvZdX_, bottomHalfStart, bottomHalfEnd);
+    }
+}
+
+void OcclusionBuffer::DrawTile(unsigned index)
+{
+    int minY = index * OCCLUSION_TILE_HEIGHT;
+    int maxY = Min(minY + OCCLUSION_TILE_HEIGHT, height_);
+    const PODVector<unsigned>& triangles = tileTriangles_[index];
+    
+    for (unsigned i = 0; i < triangles.Size(); ++i)
+        DrawTriangle2D(triangles_[triangles[i]], minY, maxY);
+}
+
+void OcclusionBuffer::BuildDepthHierarchyTile(unsigned index)
+{
+    // The tile height is divisible by the size reduction of the last mip level, so the tiles do not depend on each other
+    int startY = index * hierarchyTileHeight_;
+    int endY = startY + hierarchyTileHeight_;
+    
+    // Build the first mip level from the pixel-level data
+    int width = (width_ + 1) / 2;
+    int height = (height_ + 1) / 2;
+    if (mipBuffers_.Size())
+    {
+        int lastY = Min(endY >> 1, height);
+        for (int y = startY >> 1; y < lastY; ++y)
         {
-            int invZ = topToBottom.invZ_;
-            int* dest = row + (topToBottom.x_ >> 16);
-            int* end = row + (topToMiddle.x_ >> 16);
-            while (dest < end)
+            int* src = buffer_ + (y * 2) * width_;
+            DepthValue* dest = mipBuffers_[0].Get() + y * width;
+            DepthValue* end = dest + width;
+            
+            if (y * 2 + 1 < height_)
             {
-                if (invZ < *dest)
-                    *dest = invZ;
-                invZ += gradients.dInvZdXInt_;
-                ++dest;
+                int* src2 = src + width_;
+                while (dest < end)
+                {
+                    int minUpper = Min(src[0], src[1]);
+                    int minLower = Min(src2[0], src2[1]);
+                    dest->min_ = Min(minUpper, minLower);
+                    int maxUpper = Max(src[0], src[1]);
+                    int maxLower = Max(src2[0], src2[1]);
+                    dest->max_ = Max(maxUpper, maxLower);
+                    
+                    src += 2;
+                    src2 += 2;
+                    ++dest;
+                }
             }
-            
-            topToBottom.x_ += topToBottom.xStep_;
-            topToBottom.invZ_ += topToBottom.invZStep_;
-            topToMiddle.x_ += topToMiddle.xStep_;
-            row += width_;
-        }
-        
-        // Bottom half
-        row = buffer_ + middleY * width_;
-        endRow = buffer_ + bottomY * width_;
-        while (row < endRow)
-        {
-            int invZ = topToBottom.invZ_;
-            int* dest = row + (topToBottom.x_ >> 16);
-            int* end = row + (middleToBottom.x_ >> 16);
-            while (dest < end)
+            else
             {
-                if (invZ < *dest)
-                    *dest = invZ;
-                invZ += gradients.dInvZdXInt_;
-                ++dest;
+                while (dest < end)
+                {
+                    dest->min_ = Min(src[0], src[1]);
+                    dest->max_ = Max(src[0], src[1]);
+                    
+                    src += 2;
+                    ++dest;
+                }
             }
-            
-            topToBottom.x_ += topToBottom.xStep_;
-            topToBottom.invZ_ += topToBottom.invZStep_;
-            middleToBottom.x_ += middleToBottom.xStep_;
-            row += width_;
         }
     }
-    else
+    
+    // Build the rest of the mip levels
+    for (unsigned i = 1; i < mipBuffers_.Size(); ++i)
     {
-        // Top half
-        int* row = buffer_ + topY * width_;
-        int* endRow = buffer_ + middleY * width_;
-        while (row < endRow)
+        int prevWidth = width;
+        int prevHeight = height;
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+        
+        int lastY = Min(endY >> (i + 1), height);
+        for (int y = startY >> (i + 1); y < lastY; ++y)
         {
-            int invZ = topToMiddle.invZ_;
-            int* dest = row + (topToMiddle.x_ >> 16);
-            int* end = row + (topToBottom.x_ >> 16);
-            while (dest < end)
+            DepthValue* src = mipBuffers_[i - 1].Get() + (y * 2) * prevWidth;
+            DepthValue* dest = mipBuffers_[i].Get() + y * width;
+            DepthValue* end = dest + width;
+            
+            if (y * 2 + 1 < prevHeight)
             {
-                if (invZ < *dest)
-                    *dest = invZ;
-                invZ += gradients.dInvZdXInt_;
-                ++dest;
+                DepthValue* src2 = src + prevWidth;
+                while (dest < end)
+                {
+                    int minUpper = Min(src[0].min_, src[1].min_);
+                    int minLower = Min(src2[0].min_, src2[1].min_);
+                    dest->min_ = Min(minUpper, minLower);
+                    int maxUpper = Max(src[0].max_, src[1].max_);
+                    int maxLower = Max(src2[0].max_, src2[1].max_);
+                    dest->max_ = Max(maxUpper, maxLower);
+                    
+                    src += 2;
+                    src2 += 2;
+                    ++dest;
+                }
             }
-            
-            topToMiddle.x_ += topToMiddle.xStep_;
-            topToMiddle.invZ_ += topToMiddle.invZStep_;
-            topToBottom.x_ += topToBottom.xStep_;
-            row += width_;
-        }
-        
-        // Bottom half
-        row = buffer_ + middleY * width_;
-        endRow = buffer_ + bottomY * width_;
-        while (row < endRow)
-        {
-            int invZ = middleToBottom.invZ_;
-            int* dest = row + (middleToBottom.x_ >> 16);
-            int* end = row + (topToBottom.x_ >> 16);
-            while (dest < end)
+            else
             {
-                if (invZ < *dest)
-                    *dest = invZ;
-                invZ += gradients.dInvZdXInt_;
-                ++dest;
+                while (dest < end)
+                {
+                    dest->min_ = Min(src[0].min_, src[1].min_);
+                    dest->max_ = Max(src[0].max_, src[1].max_);
+                    
+                    src += 2;
+                    ++dest;
+                }
             }
-            
-            middleToBottom.x_ += middleToBottom.xStep_;
-            middleToBottom.invZ_ += middleToBottom.invZStep_;
-            topToBottom.x_ += topToBottom.xStep_;
-            row += width_;
         }
     }
 }
@@ -36,8 +36,10 @@ class Camera;
 class IndexBuffer;
 class IntRect;
 class VertexBuffer;
+struct WorkItem;
 struct Edge;
 struct Gradients;
+struct OcclusionTriangle;
 
 /// Occlusion hierarchy depth range.
 struct DepthValue
@@ -49,7 +51,9 @@ struct DepthValue
 };
 
 static const int OCCLUSION_MIN_SIZE = 8;
+static const int OCCLUSION_TILE_HEIGHT = 16;
 static const int OCCLUSION_DEFAULT_MAX_TRIANGLES = 5000;
+static const unsigned OCCLUSION_BATCH_TRIANGLES = 500;
 static const float OCCLUSION_RELATIVE_BIAS = 0.00001f;
 static const int OCCLUSION_FIXED_BIAS = 16;
 static const float OCCLUSION_X_SCALE = 65536.0f;
@@ -58,6 +62,11 @@ static const float OCCLUSION_Z_SCALE = 16777216.0f;
 /// Software renderer for occlusion.
 class URHO3D_API OcclusionBuffer : public Object
 {
+    friend struct DrawOcclusionTilesTask;
+    friend struct BuildDepthHierarchyTask;
+    friend void DrawOcclusionTileWork(const WorkItem* item, unsigned threadIndex);
+    friend void BuildDepthHierarchyWork(const WorkItem* item, unsigned threadIndex);
+    
     OBJECT(OcclusionBuffer);
     
 public:
@@ -78,12 +87,18 @@ public:
     void Reset();
     /// Clear the buffer.
     void Clear();
-    /// Draw a triangle mesh to the buffer using non-indexed geometry.
+    /// Draw a triangle mesh to the buffer using non-indexed geometry. The triangles are binned to tiles and rasterized later.
     bool Draw(const Matrix3x4& model, const void* vertexData, unsigned vertexSize, unsigned vertexStart, unsigned vertexCount);
-    /// Draw a triangle mesh to the buffer using indexed geometry.
+    /// Draw a triangle mesh to the buffer using indexed geometry. The triangles are binned to tiles and rasterized later.
     bool Draw(const Matrix3x4& model, const void* vertexData, unsigned vertexSize, const void* indexData, unsigned indexSize, unsigned indexStart, unsigned indexCount);
-    /// Build reduced size mip levels.
+    /// Rasterize the binned triangles. The tiles are processed in worker threads.
+    void DrawTriangles();
+    /// Rasterize any binned triangles and build reduced size mip levels. The tiles are processed in worker threads.
     void BuildDepthHierarchy();
+    /// Start rasterizing the binned triangles and building the mip levels in worker threads without waiting. The buffer must not be used until EndBuildDepthHierarchy() has been called.
+    void BeginBuildDepthHierarchy();
+    /// Wait for the rasterization and mip level building started by BeginBuildDepthHierarchy() to finish. If not started, build the depth hierarchy now if it is out of date.
+    void EndBuildDepthHierarchy();
     /// Reset last used timer.
     void ResetUseTimer();
     
@@ -99,6 +114,10 @@ public:
     int GetHeight() const { return height_; }
     /// Return number of rendered triangles.
     unsigned GetNumTriangles() const { return numTriangles_; }
+    /// Return number of binned triangles waiting to be rasterized.
+    unsigned GetNumPendingTriangles() const { return triangles_.Size(); }
+    /// Return number of tiles used for rasterization.
+    unsigned GetNumTiles() const { return tileTriangles_.Size(); }
     /// Return maximum number of triangles.
     unsigned GetMaxTriangles() const { return maxTriangles_; }
     /// Return culling mode.
@@ -123,8 +142,14 @@ private:
     void DrawTriangle(Vector4* vertices);
     /// Clip vertices against a plane.
     void ClipVertices(const Vector4& plane, Vector4* vertices, bool* triangles, unsigned& numTriangles);
-    /// Draw a clipped triangle.
-    void DrawTriangle2D(const Vector3* vertices, bool clockwise);
+    /// Set up a clipped triangle for rasterization and bin it to the tiles it covers.
+    void AddTriangle2D(const Vector3* vertices, bool clockwise);
+    /// Rasterize the rows of a clipped triangle that belong to a tile.
+    void DrawTriangle2D(const OcclusionTriangle& triangle, int minY, int maxY);
+    /// Rasterize the binned triangles of a tile.
+    void DrawTile(unsigned index);
+    /// Build the mip levels for the rows of a depth hierarchy tile.
+    void BuildDepthHierarchyTile(unsigned index);
     
     /// Highest level depth buffer.
     int* buffer_;
@@ -142,6 +167,8 @@ private:
     bool depthHierarchyDirty_;
     /// Culling reverse flag.
     bool reverseCulling_;
+    /// Threaded depth hierarchy build in progress flag.
+    bool buildingDepthHierarchy_;
     /// View transform matrix.
     Matrix3x4 view_;
     /// Projection matrix.
@@ -170,6 +197,12 @@ private:
     SharedArrayPtr<int> fullBuffer_;
     /// Reduced size depth buffers.
     Vector<SharedArrayPtr<DepthValue> > mipBuffers_;
+    /// Triangles waiting to be rasterized.
+    PODVector<OcclusionTriangle> triangles_;
+    /// Triangle indices binned per tile.
+    Vector<PODVector<unsigned> > tileTriangles_;
+    /// Height of the tiles used for depth hierarchy building.
+    int hierarchyTileHeight_;
 };
 
 }
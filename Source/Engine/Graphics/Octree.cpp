@@ -45,40 +45,61 @@ namespace Urho3D
 
 static const float DEFAULT_OCTREE_SIZE = 1000.0f;
 static const int DEFAULT_OCTREE_LEVELS = 8;
-static const int RAYCASTS_PER_WORK_ITEM = 4;
+static const unsigned RAYCASTS_PER_WORK_RANGE = 4;
+static const unsigned UPDATES_PER_WORK_RANGE = 8;
 
 extern const char* SUBSYSTEM_CATEGORY;
 
-void RaycastDrawablesWork(const WorkItem* item, unsigned threadIndex)
+/// Threaded raycast task.
+struct RaycastDrawablesTask
 {
-    Octree* octree = reinterpret_cast<Octree*>(item->aux_);
-    Drawable** start = reinterpret_cast<Drawable**>(item->start_);
-    Drawable** end = reinterpret_cast<Drawable**>(item->end_);
-    const RayOctreeQuery& query = *octree->rayQuery_;
-    PODVector<RayQueryResult>& results = octree->rayQueryResults_[threadIndex];
-
-    while (start != end)
+    /// Construct.
+    RaycastDrawablesTask(const Octree* octree) :
+        octree_(octree)
     {
-        Drawable* drawable = *start;
-        drawable->ProcessRayQuery(query, results);
-        ++start;
     }
-}
+    
+    /// Raycast a range of the collected drawables.
+    void operator () (unsigned start, unsigned end, unsigned threadIndex)
+    {
+        const RayOctreeQuery& query = *octree_->rayQuery_;
+        Drawable** drawables = &octree_->rayQueryDrawables_[0];
+        PODVector<RayQueryResult>& results = octree_->rayQueryResults_[threadIndex];
+        
+        for (unsigned i = start; i < end; ++i)
+            drawables[i]->ProcessRayQuery(query, results);
+    }
+    
+    /// Octree.
+    const Octree* octree_;
+};
 
-void UpdateDrawablesWork(const WorkItem* item, unsigned threadIndex)
+/// Threaded drawable update task.
+struct UpdateDrawablesTask
 {
-    const FrameInfo& frame = *(reinterpret_cast<FrameInfo*>(item->aux_));
-    Drawable** start = reinterpret_cast<Drawable**>(item->start_);
-    Drawable** end = reinterpret_cast<Drawable**>(item->end_);
-
-    while (start != end)
+    /// Construct.
+    UpdateDrawablesTask(PODVector<Drawable*>& drawables, const FrameInfo& frame) :
+        drawables_(drawables),
+        frame_(frame)
     {
-        Drawable* drawable = *start;
-        if (drawable)
-            drawable->Update(frame);
-        ++start;
     }
-}
+    
+    /// Update a range of drawables.
+    void operator () (unsigned start, unsigned end, unsigned threadIndex)
+    {
+        for (unsigned i = start; i < end; ++i)
+        {
+            Drawable* drawable = drawables_[i];
+            if (drawable)
+                drawable->Update(frame_);
+        }
+    }
+    
+    /// Drawables to update.
+    PODVector<Drawable*>& drawables_;
+    /// Frame info.
+    const FrameInfo& frame_;
+};
 
 inline bool CompareRayQueryResults(const RayQueryResult& lhs, const RayQueryResult& rhs)
 {
@@ -106,10 +127,11 @@ Octant::~Octant()
         for (PODVector<Drawable*>::Iterator i = drawables_.Begin(); i != drawables_.End(); ++i)
         {
             (*i)->SetOctant(root_);
-            root_->drawables_.Push(*i);
+            root_->PushDrawable(*i);
             root_->QueueUpdate(*i);
         }
         drawables_.Clear();
+        drawableBoxes_.Clear();
         numDrawables_ = 0;
     }
 
@@ -170,10 +192,13 @@ void Octant::InsertDrawable(Drawable* drawable)
         if (oldOctant != this)
         {
             // Add first, then remove, because drawable count going to zero deletes the octree branch in question
+            unsigned oldIndex = drawable->octantIndex_;
             AddDrawable(drawable);
             if (oldOctant)
-                oldOctant->RemoveDrawable(drawable, false);
+                oldOctant->EraseDrawable(oldIndex);
         }
+        
+        SetDrawableBox(drawable->octantIndex_, box);
     }
     else
     {
@@ -264,8 +289,10 @@ void Octant::GetDrawablesInternal(OctreeQuery& query, bool inside) const
     if (drawables_.Size())
     {
         Drawable** start = const_cast<Drawable**>(&drawables_[0]);
-        Drawable** end = start + drawables_.Size();
-        query.TestDrawables(start, end, inside);
+        if (inside)
+            query.TestDrawables(start, start + drawables_.Size(), true);
+        else
+            query.TestDrawableBoxes(start, &drawableBoxes_[0], drawables_.Size());
     }
 
     for (unsigned i = 0; i < NUM_OCTANTS; ++i)
@@ -329,6 +356,39 @@ void Octant::GetDrawablesOnlyInternal(RayOctreeQuery& query, PODVector<Drawable*
     }
 }
 
+void Octant::PushDrawable(Drawable* drawable)
+{
+    unsigned index = drawables_.Size();
+    drawable->octantIndex_ = index;
+    drawables_.Push(drawable);
+    if (!(index % DRAWABLE_BOX_BLOCK_SIZE))
+        drawableBoxes_.Resize(drawableBoxes_.Size() + DRAWABLE_BOX_BLOCK_FLOATS);
+    MarkDrawableBoxDirty(drawable);
+}
+
+void Octant::EraseDrawable(unsigned index)
+{
+    unsigned last = drawables_.Size() - 1;
+    if (index != last)
+    {
+        Drawable* moved = drawables_[last];
+        drawables_[index] = moved;
+        moved->octantIndex_ = index;
+        
+        const float* src = &drawableBoxes_[(last / DRAWABLE_BOX_BLOCK_SIZE) * DRAWABLE_BOX_BLOCK_FLOATS + last %
+            DRAWABLE_BOX_BLOCK_SIZE];
+        float* dest = &drawableBoxes_[(index / DRAWABLE_BOX_BLOCK_SIZE) * DRAWABLE_BOX_BLOCK_FLOATS + index %
+            DRAWABLE_BOX_BLOCK_SIZE];
+        for (unsigned i = 0; i < DRAWABLE_BOX_BLOCK_FLOATS; i += DRAWABLE_BOX_BLOCK_SIZE)
+            dest[i] = src[i];
+    }
+    
+    drawables_.Pop();
+    if (!(last % DRAWABLE_BOX_BLOCK_SIZE))
+        drawableBoxes_.Resize(drawableBoxes_.Size() - DRAWABLE_BOX_BLOCK_FLOATS);
+    DecDrawableCount();
+}
+
 Octree::Octree(Context* context) :
     Component(context),
     Octant(BoundingBox(-DEFAULT_OCTREE_SIZE, DEFAULT_OCTREE_SIZE), 0, 0, this),
@@ -407,30 +467,8 @@ void Octree::Update(const FrameInfo& frame)
         WorkQueue* queue = GetSubsystem<WorkQueue>();
         scene->BeginThreadedUpdate();
         
-        int numWorkItems = queue->GetNumThreads() + 1; // Worker threads + main thread
-        int drawablesPerItem = Max((int)(drawableUpdates_.Size() / numWorkItems), 1);
-        
-        PODVector<Drawable*>::Iterator start = drawableUpdates_.Begin();
-        // Create a work item for each thread
-        for (int i = 0; i < numWorkItems; ++i)
-        {
-            SharedPtr<WorkItem> item = queue->GetFreeItem();
-            item->priority_ = M_MAX_UNSIGNED;
-            item->workFunction_ = UpdateDrawablesWork;
-            item->aux_ = const_cast<FrameInfo*>(&frame);
-
-            PODVector<Drawable*>::Iterator end = drawableUpdates_.End();
-            if (i < numWorkItems - 1 && end - start > drawablesPerItem)
-                end = start + drawablesPerItem;
-
-            item->start_ = &(*start);
-            item->end_ = &(*end);
-            queue->AddWorkItem(item);
-
-            start = end;
-        }
-
-        queue->Complete(M_MAX_UNSIGNED);
+        UpdateDrawablesTask task(drawableUpdates_, frame);
+        queue->ParallelFor(0, drawableUpdates_.Size(), UPDATES_PER_WORK_RANGE, task);
         scene->EndThreadedUpdate();
     }
     
@@ -462,9 +500,12 @@ void Octree::Update(const FrameInfo& frame)
             // Skip if no octant or does not belong to this octree anymore
             if (!octant || octant->GetRoot() != this)
                 continue;
-            // Skip if still fits the current octant
+            // Skip if still fits the current octant, but refresh the packed bounding box
             if (drawable->IsOccludee() && octant->GetCullingBox().IsInside(box) == INSIDE && octant->CheckDrawableFit(box))
+            {
+                octant->SetDrawableBox(drawable->octantIndex_, box);
                 continue;
+            }
 
             InsertDrawable(drawable);
 
@@ -525,41 +566,16 @@ void Octree::Raycast(RayOctreeQuery& query) const
         rayQueryDrawables_.Clear();
         GetDrawablesOnlyInternal(query, rayQueryDrawables_);
 
-        // Check that amount of drawables is large enough to justify threading
-        if (rayQueryDrawables_.Size() >= RAYCASTS_PER_WORK_ITEM * 2)
-        {
-            for (unsigned i = 0; i < rayQueryResults_.Size(); ++i)
-                rayQueryResults_[i].Clear();
-
-            PODVector<Drawable*>::Iterator start = rayQueryDrawables_.Begin();
-            while (start != rayQueryDrawables_.End())
-            {
-                SharedPtr<WorkItem> item = queue->GetFreeItem();
-                item->priority_ = M_MAX_UNSIGNED;
-                item->workFunction_ = RaycastDrawablesWork;
-                item->aux_ = const_cast<Octree*>(this);
-
-                PODVector<Drawable*>::Iterator end = rayQueryDrawables_.End();
-                if (end - start > RAYCASTS_PER_WORK_ITEM)
-                    end = start + RAYCASTS_PER_WORK_ITEM;
-
-                item->start_ = &(*start);
-                item->end_ = &(*end);
-                queue->AddWorkItem(item);
-
-                start = end;
-            }
-
-            // Merge per-thread results
-            queue->Complete(M_MAX_UNSIGNED);
-            for (unsigned i = 0; i < rayQueryResults_.Size(); ++i)
-                query.result_.Insert(query.result_.End(), rayQueryResults_[i].Begin(), rayQueryResults_[i].End());
-        }
-        else
-        {
-            for (PODVector<Drawable*>::Iterator i = rayQueryDrawables_.Begin(); i != rayQueryDrawables_.End(); ++i)
-                (*i)->ProcessRayQuery(query, query.result_);
-        }
+        // Process the drawables in ranges. If the amount is small, the range is executed directly in the main thread
+        for (unsigned i = 0; i < rayQueryResults_.Size(); ++i)
+            rayQueryResults_[i].Clear();
+        
+        RaycastDrawablesTask task(this);
+        queue->ParallelFor(0, rayQueryDrawables_.Size(), RAYCASTS_PER_WORK_RANGE, task);
+        
+        // Merge per-thread results
+        for (unsigned i = 0; i < rayQueryResults_.Size(); ++i)
+            query.result_.Insert(query.result_.End(), rayQueryResults_[i].Begin(), rayQueryResults_[i].End());
     }
 
     Sort(query.result_.Begin(), query.result_.End(), CompareRayQueryResults);
@@ -617,6 +633,9 @@ void Octree::QueueUpdate(Drawable* drawable)
         drawableUpdates_.Push(drawable);
     
     drawable->updateQueued_ = true;
+    // The bounding box may change before the reinsertion, so batched queries must test the drawable individually until then
+    if (drawable->octant_)
+        drawable->octant_->MarkDrawableBoxDirty(drawable);
 }
 
 void Octree::CancelUpdate(Drawable* drawable)
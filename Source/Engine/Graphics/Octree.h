@@ -57,21 +57,41 @@ public:
     void AddDrawable(Drawable* drawable)
     {
         drawable->SetOctant(this);
-        drawables_.Push(drawable);
+        PushDrawable(drawable);
         IncDrawableCount();
     }
     
     /// Remove a drawable object from this octant.
     void RemoveDrawable(Drawable* drawable, bool resetOctant = true)
     {
-        if (drawables_.Remove(drawable))
+        if (drawable->octant_ == this)
         {
             if (resetOctant)
                 drawable->SetOctant(0);
-            DecDrawableCount();
+            EraseDrawable(drawable->octantIndex_);
         }
     }
     
+    /// Set the packed world bounding box of a drawable object by index.
+    void SetDrawableBox(unsigned index, const BoundingBox& box)
+    {
+        float* block = &drawableBoxes_[(index / DRAWABLE_BOX_BLOCK_SIZE) * DRAWABLE_BOX_BLOCK_FLOATS + index %
+            DRAWABLE_BOX_BLOCK_SIZE];
+        block[0] = box.min_.x_;
+        block[DRAWABLE_BOX_BLOCK_SIZE] = box.min_.y_;
+        block[2 * DRAWABLE_BOX_BLOCK_SIZE] = box.min_.z_;
+        block[3 * DRAWABLE_BOX_BLOCK_SIZE] = box.max_.x_;
+        block[4 * DRAWABLE_BOX_BLOCK_SIZE] = box.max_.y_;
+        block[5 * DRAWABLE_BOX_BLOCK_SIZE] = box.max_.z_;
+    }
+    
+    /// Mark the packed world bounding box of a drawable object stale, so that batched queries test it individually.
+    void MarkDrawableBoxDirty(Drawable* drawable)
+    {
+        if (drawable->octant_ == this)
+            SetDrawableBox(drawable->octantIndex_, BoundingBox(-M_LARGE_VALUE, M_LARGE_VALUE));
+    }
+    
     /// Return world-space bounding box.
     const BoundingBox& GetWorldBoundingBox() const { return worldBoundingBox_; }
     /// Return bounding box used for fitting drawable objects.
@@ -101,6 +121,10 @@ protected:
     void GetDrawablesInternal(RayOctreeQuery& query) const;
     /// Return drawable objects only for a threaded ray query, called internally.
     void GetDrawablesOnlyInternal(RayOctreeQuery& query, PODVector<Drawable*>& drawables) const;
+    /// Append a drawable object to the drawable list and the packed bounding boxes. The packed box starts out stale.
+    void PushDrawable(Drawable* drawable);
+    /// Remove a drawable object by index by moving the last drawable object into its place.
+    void EraseDrawable(unsigned index);
     
     /// Increase drawable object count recursively.
     void IncDrawableCount()
@@ -132,6 +156,8 @@ protected:
     BoundingBox cullingBox_;
     /// Drawable objects.
     PODVector<Drawable*> drawables_;
+    /// World bounding boxes of the drawable objects packed in blocks for batched queries, see OctreeQuery::TestDrawableBoxes().
+    PODVector<float> drawableBoxes_;
     /// Child octants.
     Octant* children_[NUM_OCTANTS];
     /// World bounding box center.
@@ -153,7 +179,7 @@ protected:
 /// %Octree component. Should be added only to the root scene node
 class URHO3D_API Octree : public Component, public Octant
 {
-    friend void RaycastDrawablesWork(const WorkItem* item, unsigned threadIndex);
+    friend struct RaycastDrawablesTask;
     
     OBJECT(Octree);
     
@@ -23,11 +23,78 @@
 #include "Precompiled.h"
 #include "OctreeQuery.h"
 
+#ifdef URHO3D_SSE
+#include <xmmintrin.h>
+#endif
+
 #include "DebugNew.h"
 
 namespace Urho3D
 {
 
+static const unsigned MAX_PACKED_SURVIVORS = 64;
+
+/// Collects the drawables that pass a packed bounding box test and forwards them to the query's drawable test.
+class PackedSurvivors
+{
+public:
+    /// Construct.
+    PackedSurvivors(OctreeQuery& query) :
+        query_(query),
+        numSurvivors_(0)
+    {
+    }
+    
+    /// Add the drawables of a packed block whose bits are set in the mask.
+    void Add(Drawable** drawables, const float* block, unsigned mask)
+    {
+        for (unsigned i = 0; i < DRAWABLE_BOX_BLOCK_SIZE; ++i)
+        {
+            if (!(mask & (1 << i)))
+                continue;
+            
+            // A stale box passes any test, so the drawable must be tested with its actual bounding box
+            if (block[i] == -M_LARGE_VALUE)
+                query_.TestDrawables(drawables + i, drawables + i + 1, false);
+            else
+            {
+                survivors_[numSurvivors_++] = drawables[i];
+                if (numSurvivors_ == MAX_PACKED_SURVIVORS)
+                    Flush();
+            }
+        }
+    }
+    
+    /// Forward the collected drawables. Their bounding boxes have already been tested.
+    void Flush()
+    {
+        if (numSurvivors_)
+        {
+            query_.TestDrawables(survivors_, survivors_ + numSurvivors_, true);
+            numSurvivors_ = 0;
+        }
+    }
+    
+private:
+    /// Query.
+    OctreeQuery& query_;
+    /// Collected drawables.
+    Drawable* survivors_[MAX_PACKED_SURVIVORS];
+    /// Number of collected drawables.
+    unsigned numSurvivors_;
+};
+
+/// Return the mask of valid boxes in a packed block.
+static inline unsigned GetBlockMask(unsigned index, unsigned count)
+{
+    return count - index < DRAWABLE_BOX_BLOCK_SIZE ? (1 << (count - index)) - 1 : (1 << DRAWABLE_BOX_BLOCK_SIZE) - 1;
+}
+
+void OctreeQuery::TestDrawableBoxes(Drawable** drawables, const float* boxes, unsigned count)
+{
+    TestDrawables(drawables, drawables + count, false);
+}
+
 Intersection PointOctreeQuery::TestOctant(const BoundingBox& box, bool inside)
 {
     if (inside)
@@ -94,6 +161,49 @@ void BoxOctreeQuery::TestDrawables(Drawable** start, Drawable** end, bool inside
     }
 }
 
+void BoxOctreeQuery::TestDrawableBoxes(Drawable** drawables, const float* boxes, unsigned count)
+{
+    PackedSurvivors survivors(*this);
+    
+    #ifdef URHO3D_SSE
+    __m128 queryMinX = _mm_set1_ps(box_.min_.x_);
+    __m128 queryMinY = _mm_set1_ps(box_.min_.y_);
+    __m128 queryMinZ = _mm_set1_ps(box_.min_.z_);
+    __m128 queryMaxX = _mm_set1_ps(box_.max_.x_);
+    __m128 queryMaxY = _mm_set1_ps(box_.max_.y_);
+    __m128 queryMaxZ = _mm_set1_ps(box_.max_.z_);
+    #endif
+    
+    for (unsigned i = 0; i < count; i += DRAWABLE_BOX_BLOCK_SIZE)
+    {
+        const float* block = boxes + (i / DRAWABLE_BOX_BLOCK_SIZE) * DRAWABLE_BOX_BLOCK_FLOATS;
+        unsigned mask = GetBlockMask(i, count);
+        
+        #ifdef URHO3D_SSE
+        __m128 outside = _mm_or_ps(_mm_cmplt_ps(_mm_loadu_ps(block + 12), queryMinX),
+            _mm_cmpgt_ps(_mm_loadu_ps(block), queryMaxX));
+        outside = _mm_or_ps(outside, _mm_or_ps(_mm_cmplt_ps(_mm_loadu_ps(block + 16), queryMinY),
+            _mm_cmpgt_ps(_mm_loadu_ps(block + 4), queryMaxY)));
+        outside = _mm_or_ps(outside, _mm_or_ps(_mm_cmplt_ps(_mm_loadu_ps(block + 20), queryMinZ),
+            _mm_cmpgt_ps(_mm_loadu_ps(block + 8), queryMaxZ)));
+        mask &= ~_mm_movemask_ps(outside);
+        #else
+        for (unsigned j = 0; j < DRAWABLE_BOX_BLOCK_SIZE; ++j)
+        {
+            const float* lane = block + j;
+            if (lane[12] < box_.min_.x_ || lane[0] > box_.max_.x_ || lane[16] < box_.min_.y_ || lane[4] > box_.max_.y_ ||
+                lane[20] < box_.min_.z_ || lane[8] > box_.max_.z_)
+                mask &= ~(1 << j);
+        }
+        #endif
+        
+        if (mask)
+            survivors.Add(drawables + i, block, mask);
+    }
+    
+    survivors.Flush();
+}
+
 Intersection FrustumOctreeQuery::TestOctant(const BoundingBox& box, bool inside)
 {
     if (inside)
@@ -116,4 +226,60 @@ void FrustumOctreeQuery::TestDrawables(Drawable** start, Drawable** end, bool in
     }
 }
 
+void FrustumOctreeQuery::TestDrawableBoxes(Drawable** drawables, const float* boxes, unsigned count)
+{
+    PackedSurvivors survivors(*this);
+    
+    #ifdef URHO3D_SSE
+    __m128 half = _mm_set1_ps(0.5f);
+    __m128 zero = _mm_setzero_ps();
+    #endif
+    
+    // Same test as Frustum::IsInsideFast(), performed for a block of boxes at a time
+    for (unsigned i = 0; i < count; i += DRAWABLE_BOX_BLOCK_SIZE)
+    {
+        const float* block = boxes + (i / DRAWABLE_BOX_BLOCK_SIZE) * DRAWABLE_BOX_BLOCK_FLOATS;
+        unsigned mask = GetBlockMask(i, count);
+        
+        #ifdef URHO3D_SSE
+        __m128 minX = _mm_loadu_ps(block);
+        __m128 minY = _mm_loadu_ps(block + 4);
+        __m128 minZ = _mm_loadu_ps(block + 8);
+        __m128 centerX = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(block + 12), minX), half);
+        __m128 centerY = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(block + 16), minY), half);
+        __m128 centerZ = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(block + 20), minZ), half);
+        __m128 edgeX = _mm_sub_ps(centerX, minX);
+        __m128 edgeY = _mm_sub_ps(centerY, minY);
+        __m128 edgeZ = _mm_sub_ps(centerZ, minZ);
+        __m128 outside = zero;
+        
+        for (unsigned j = 0; j < NUM_FRUSTUM_PLANES; ++j)
+        {
+            const Plane& plane = frustum_.planes_[j];
+            __m128 dist = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.normal_.x_), centerX),
+                _mm_mul_ps(_mm_set1_ps(plane.normal_.y_), centerY)), _mm_mul_ps(_mm_set1_ps(plane.normal_.z_), centerZ)),
+                _mm_set1_ps(plane.d_));
+            __m128 absDist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.absNormal_.x_), edgeX),
+                _mm_mul_ps(_mm_set1_ps(plane.absNormal_.y_), edgeY)), _mm_mul_ps(_mm_set1_ps(plane.absNormal_.z_), edgeZ));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(dist, _mm_sub_ps(zero, absDist)));
+        }
+        
+        mask &= ~_mm_movemask_ps(outside);
+        #else
+        for (unsigned j = 0; j < DRAWABLE_BOX_BLOCK_SIZE; ++j)
+        {
+            const float* lane = block + j;
+            BoundingBox box(Vector3(lane[0], lane[4], lane[8]), Vector3(lane[12], lane[16], lane[20]));
+            if (frustum_.IsInsideFast(box) == OUTSIDE)
+                mask &= ~(1 << j);
+        }
+        #endif
+        
+        if (mask)
+            survivors.Add(drawables + i, block, mask);
+    }
+    
+    survivors.Flush();
+}
+
 }
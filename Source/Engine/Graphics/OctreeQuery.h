@@ -34,6 +34,11 @@ namespace Urho3D
 class Drawable;
 class Node;
 
+/// Number of drawable bounding boxes in a packed block.
+static const unsigned DRAWABLE_BOX_BLOCK_SIZE = 4;
+/// Number of floats in a packed block: min X, min Y, min Z, max X, max Y and max Z, each for all boxes of the block.
+static const unsigned DRAWABLE_BOX_BLOCK_FLOATS = 6 * DRAWABLE_BOX_BLOCK_SIZE;
+
 /// Base class for octree queries.
 class URHO3D_API OctreeQuery
 {
@@ -55,6 +60,8 @@ public:
     virtual Intersection TestOctant(const BoundingBox& box, bool inside) = 0;
     /// Intersection test for drawables.
     virtual void TestDrawables(Drawable** start, Drawable** end, bool inside) = 0;
+    /// Intersection test for drawables with world bounding boxes packed in blocks. By default tests the drawables individually.
+    virtual void TestDrawableBoxes(Drawable** drawables, const float* boxes, unsigned count);
     
     /// Result vector reference.
     PODVector<Drawable*>& result_;
@@ -128,6 +135,8 @@ public:
     virtual Intersection TestOctant(const BoundingBox& box, bool inside);
     /// Intersection test for drawables.
     virtual void TestDrawables(Drawable** start, Drawable** end, bool inside);
+    /// Intersection test for drawables using their packed world bounding boxes.
+    virtual void TestDrawableBoxes(Drawable** drawables, const float* boxes, unsigned count);
     
     /// Bounding box.
     BoundingBox box_;
@@ -149,6 +158,8 @@ public:
     virtual Intersection TestOctant(const BoundingBox& box, bool inside);
     /// Intersection test for drawables.
     virtual void TestDrawables(Drawable** start, Drawable** end, bool inside);
+    /// Intersection test for drawables using their packed world bounding boxes.
+    virtual void TestDrawableBoxes(Drawable** drawables, const float* boxes, unsigned count);
     
     /// Frustum.
     Frustum frustum_;
@@ -31,6 +31,7 @@
 #include "IndexBuffer.h"
 #include "Log.h"
 #include "Material.h"
+#include "MemoryTracker.h"
 #include "OcclusionBuffer.h"
 #include "Octree.h"
 #include "Profiler.h"
@@ -276,6 +277,7 @@ Renderer::Renderer(Context* context) :
     drawShadows_(true),
     reuseShadowMaps_(true),
     dynamicInstancing_(true),
+    temporalOcclusion_(false),
     shadersDirty_(true),
     initialized_(false),
     resetViews_(false)
@@ -475,6 +477,11 @@ void Renderer::SetOccluderSizeThreshold(float screenSize)
     occluderSizeThreshold_ = Max(screenSize, 0.0f);
 }
 
+void Renderer::SetTemporalOcclusion(bool enable)
+{
+    temporalOcclusion_ = enable;
+}
+
 void Renderer::ReloadShaders()
 {
     shadersDirty_ = true;
@@ -557,6 +564,7 @@ unsigned Renderer::GetNumOccluders(bool allViews) const
 void Renderer::Update(float timeStep)
 {
     PROFILE(UpdateViews);
+    MEMORY_CATEGORY(MEMCAT_GRAPHICS);
     
     views_.Clear();
     
@@ -666,6 +674,7 @@ void Renderer::Render()
     assert(graphics_ && graphics_->IsInitialized() && !graphics_->IsDeviceLost());
     
     PROFILE(RenderViews);
+    MEMORY_CATEGORY(MEMCAT_GRAPHICS);
     
     // If the indirection textures have lost content (OpenGL mode only), restore them now
     if (faceSelectCubeMap_ && faceSelectCubeMap_->IsDataLost())
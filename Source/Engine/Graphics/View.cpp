@@ -51,6 +51,9 @@
 namespace Urho3D
 {
 
+static const unsigned DRAWABLES_PER_WORK_RANGE = 32;
+static const unsigned GEOMETRIES_PER_WORK_RANGE = 8;
+
 static const Vector3* directions[] =
 {
     &Vector3::RIGHT,
@@ -122,11 +125,12 @@ public:
 class OccludedFrustumOctreeQuery : public FrustumOctreeQuery
 {
 public:
-    /// Construct with frustum, occlusion buffer and query parameters.
-    OccludedFrustumOctreeQuery(PODVector<Drawable*>& result, const Frustum& frustum, OcclusionBuffer* buffer, unsigned char
-        drawableFlags = DRAWABLE_ANY, unsigned viewMask = DEFAULT_VIEWMASK) :
+    /// Construct with frustum, occlusion buffers and query parameters.
+    OccludedFrustumOctreeQuery(PODVector<Drawable*>& result, const Frustum& frustum, OcclusionBuffer* buffer, OcclusionBuffer*
+        previousBuffer, unsigned char drawableFlags = DRAWABLE_ANY, unsigned viewMask = DEFAULT_VIEWMASK) :
         FrustumOctreeQuery(result, frustum, drawableFlags, viewMask),
-        buffer_(buffer)
+        buffer_(buffer),
+        previousBuffer_(previousBuffer)
     {
     }
     
@@ -134,16 +138,30 @@ public:
     virtual Intersection TestOctant(const BoundingBox& box, bool inside)
     {
         if (inside)
-            return buffer_->IsVisible(box) ? INSIDE : OUTSIDE;
+            return IsVisible(box) ? INSIDE : OUTSIDE;
         else
         {
             Intersection result = frustum_.IsInside(box);
-            if (result != OUTSIDE && !buffer_->IsVisible(box))
+            if (result != OUTSIDE && !IsVisible(box))
                 result = OUTSIDE;
             return result;
         }
     }
     
+    /// Test an octant for visibility. With temporal occlusion, the current buffer may still be drawn in worker threads, so
+    /// test against the previous frame's buffer first and wait for the current buffer only if that fails.
+    bool IsVisible(const BoundingBox& box)
+    {
+        if (previousBuffer_)
+        {
+            if (previousBuffer_->IsVisible(box))
+                return true;
+            buffer_->EndBuildDepthHierarchy();
+        }
+        
+        return buffer_->IsVisible(box);
+    }
+    
     /// Intersection test for drawables. Note: drawable occlusion is performed later in worker threads.
     virtual void TestDrawables(Drawable** start, Drawable** end, bool inside)
     {
@@ -161,14 +179,14 @@ public:
     
     /// Occlusion buffer.
     OcclusionBuffer* buffer_;
+    /// Previous frame's occlusion buffer when using temporal occlusion.
+    OcclusionBuffer* previousBuffer_;
 };
 
-void CheckVisibilityWork(const WorkItem* item, unsigned threadIndex)
+void CheckVisibilityWork(View* view, Drawable** start, Drawable** end, unsigned threadIndex)
 {
-    View* view = reinterpret_cast<View*>(item->aux_);
-    Drawable** start = reinterpret_cast<Drawable**>(item->start_);
-    Drawable** end = reinterpret_cast<Drawable**>(item->end_);
     OcclusionBuffer* buffer = view->occlusionBuffer_;
+    OcclusionBuffer* previousBuffer = view->previousOcclusionBuffer_;
     const Matrix3x4& viewMatrix = view->camera_->GetView();
     Vector3 viewZ = Vector3(viewMatrix.m20_, viewMatrix.m21_, viewMatrix.m22_);
     Vector3 absViewZ = viewZ.Abs();
@@ -191,7 +209,9 @@ void CheckVisibilityWork(const WorkItem* item, unsigned threadIndex)
                 continue;
         }
         
-        if (!buffer || !drawable->IsOccludee() || buffer->IsVisible(drawable->GetWorldBoundingBox()))
+        // With temporal occlusion, drawables visible in the previous frame's buffer are accepted without testing the current
+        const BoundingBox& box = drawable->GetWorldBoundingBox();
+        if (!buffer || !drawable->IsOccludee() || (previousBuffer && previousBuffer->IsVisible(box)) || buffer->IsVisible(box))
         {
             if (!batchesUpdated)
                 drawable->UpdateBatches(view->frame_);
@@ -236,6 +256,28 @@ void CheckVisibilityWork(const WorkItem* item, unsigned threadIndex)
     }
 }
 
+/// Threaded visibility check task.
+struct CheckVisibilityTask
+{
+    /// Construct.
+    CheckVisibilityTask(View* view, PODVector<Drawable*>& drawables) :
+        view_(view),
+        drawables_(drawables)
+    {
+    }
+    
+    /// Check a range of drawables.
+    void operator () (unsigned start, unsigned end, unsigned threadIndex)
+    {
+        CheckVisibilityWork(view_, &drawables_[start], &drawables_[0] + end, threadIndex);
+    }
+    
+    /// View.
+    View* view_;
+    /// Drawables to check.
+    PODVector<Drawable*>& drawables_;
+};
+
 void ProcessLightWork(const WorkItem* item, unsigned threadIndex)
 {
     View* view = reinterpret_cast<View*>(item->aux_);
@@ -244,20 +286,33 @@ void ProcessLightWork(const WorkItem* item, unsigned threadIndex)
     view->ProcessLight(*query, threadIndex);
 }
 
-void UpdateDrawableGeometriesWork(const WorkItem* item, unsigned threadIndex)
+/// Threaded geometry update task.
+struct UpdateDrawableGeometriesTask
 {
-    const FrameInfo& frame = *(reinterpret_cast<FrameInfo*>(item->aux_));
-    Drawable** start = reinterpret_cast<Drawable**>(item->start_);
-    Drawable** end = reinterpret_cast<Drawable**>(item->end_);
+    /// Construct.
+    UpdateDrawableGeometriesTask(PODVector<Drawable*>& drawables, const FrameInfo& frame) :
+        drawables_(drawables),
+        frame_(frame)
+    {
+    }
     
-    while (start != end)
+    /// Update geometries for a range of drawables.
+    void operator () (unsigned start, unsigned end, unsigned threadIndex)
     {
-        Drawable* drawable = *start++;
-        // We may leave null pointer holes in the queue if a drawable is found out to require a main thread update
-        if (drawable)
-            drawable->UpdateGeometry(frame);
+        for (unsigned i = start; i < end; ++i)
+        {
+            Drawable* drawable = drawables_[i];
+            // We may leave null pointer holes in the queue if a drawable is found out to require a main thread update
+            if (drawable)
+                drawable->UpdateGeometry(frame_);
+        }
     }
-}
+    
+    /// Drawables to update.
+    PODVector<Drawable*>& drawables_;
+    /// Frame info.
+    const FrameInfo& frame_;
+};
 
 void SortBatchQueueFrontToBackWork(const WorkItem* item, unsigned threadIndex)
 {
@@ -296,6 +351,9 @@ View::View(Context* context) :
     camera_(0),
     cameraZone_(0),
     farClipZone_(0),
+    occlusionBuffer_(0),
+    previousOcclusionBuffer_(0),
+    temporalOcclusionFrame_(0),
     renderTarget_(0),
     substituteRenderTarget_(0)
 {
@@ -495,6 +553,16 @@ void View::Update(const FrameInfo& frame)
     vertexLightQueues_.Clear();
     for (HashMap<StringHash, BatchQueue>::Iterator i = batchQueues_.Begin(); i != batchQueues_.End(); ++i)
         i->second_.Clear(maxSortedInstances);
+    for (Vector<LightBatchQueue>::Iterator i = lightQueues_.Begin(); i != lightQueues_.End(); ++i)
+    {
+        i->litBaseBatches_.Clear(maxSortedInstances);
+        i->litBatches_.Clear(maxSortedInstances);
+        for (Vector<ShadowBatchQueue>::Iterator j = i->shadowSplits_.Begin(); j != i->shadowSplits_.End(); ++j)
+            j->shadowBatches_.Clear(maxSortedInstances);
+    }
+    
+    // No batch group refers to the previous frame's instance data anymore, so the frame allocator can be reset
+    frameAllocator_.Reset();
     
     if (hasScenePasses_ && (!camera_ || !octree_))
         return;
@@ -602,6 +670,7 @@ void View::Render()
     cameraZone_ = 0;
     farClipZone_ = 0;
     occlusionBuffer_ = 0;
+    previousOcclusionBuffer_ = 0;
     frame_.camera_ = 0;
 }
 
@@ -768,6 +837,7 @@ void View::GetDrawables()
     
     // If occlusion in use, get & render the occluders
     occlusionBuffer_ = 0;
+    previousOcclusionBuffer_ = 0;
     if (maxOccluderTriangles_ > 0)
     {
         UpdateOccluders(occluders_, camera_);
@@ -775,16 +845,44 @@ void View::GetDrawables()
         {
             PROFILE(DrawOcclusion);
             
-            occlusionBuffer_ = renderer_->GetOcclusionBuffer(camera_);
+            if (renderer_->GetTemporalOcclusion())
+            {
+                // Use the view's own buffers, so that the previous frame's buffer is retained. It is only used if it was
+                // drawn on the previous frame
+                Swap(temporalOcclusionBuffers_[0], temporalOcclusionBuffers_[1]);
+                if (temporalOcclusionBuffers_[1] && temporalOcclusionFrame_ + 1 == frame_.frameNumber_)
+                    previousOcclusionBuffer_ = temporalOcclusionBuffers_[1];
+                if (!temporalOcclusionBuffers_[0])
+                    temporalOcclusionBuffers_[0] = new OcclusionBuffer(context_);
+                temporalOcclusionFrame_ = frame_.frameNumber_;
+                
+                occlusionBuffer_ = temporalOcclusionBuffers_[0];
+                int width = renderer_->GetOcclusionBufferSize();
+                occlusionBuffer_->SetSize(width, (int)((float)width / camera_->GetAspectRatio() + 0.5f));
+                occlusionBuffer_->SetView(camera_);
+            }
+            else
+            {
+                temporalOcclusionBuffers_[0].Reset();
+                temporalOcclusionBuffers_[1].Reset();
+                occlusionBuffer_ = renderer_->GetOcclusionBuffer(camera_);
+            }
+            
             DrawOccluders(occlusionBuffer_, occluders_);
+            
+            // With a previous buffer to test against, let the current buffer be drawn in worker threads meanwhile
+            if (previousOcclusionBuffer_)
+                occlusionBuffer_->BeginBuildDepthHierarchy();
+            else
+                occlusionBuffer_->BuildDepthHierarchy();
         }
     }
     
     // Get lights and geometries. Coarse occlusion for octants is used at this point
     if (occlusionBuffer_)
     {
-        OccludedFrustumOctreeQuery query(tempDrawables, camera_->GetFrustum(), occlusionBuffer_, DRAWABLE_GEOMETRY |
-            DRAWABLE_LIGHT, camera_->GetViewMask());
+        OccludedFrustumOctreeQuery query(tempDrawables, camera_->GetFrustum(), occlusionBuffer_, previousOcclusionBuffer_,
+            DRAWABLE_GEOMETRY | DRAWABLE_LIGHT, camera_->GetViewMask());
         octree_->GetDrawables(query);
     }
     else
@@ -794,6 +892,10 @@ void View::GetDrawables()
         octree_->GetDrawables(query);
     }
     
+    // With temporal occlusion, the current buffer must be finished before the drawables are tested in worker threads
+    if (previousOcclusionBuffer_)
+        occlusionBuffer_->EndBuildDepthHierarchy();
+    
     // Check drawable occlusion, find zones for moved drawables and collect geometries & lights in worker threads
     {
         for (unsigned i = 0; i < sceneResults_.Size(); ++i)
@@ -806,30 +908,8 @@ void View::GetDrawables()
             result.maxZ_ = 0.0f;
         }
         
-        int numWorkItems = queue->GetNumThreads() + 1; // Worker threads + main thread
-        int drawablesPerItem = tempDrawables.Size() / numWorkItems;
-        
-        PODVector<Drawable*>::Iterator start = tempDrawables.Begin();
-        // Create a work item for each thread
-        for (int i = 0; i < numWorkItems; ++i)
-        {
-            SharedPtr<WorkItem> item = queue->GetFreeItem();
-            item->priority_ = M_MAX_UNSIGNED;
-            item->workFunction_ = CheckVisibilityWork;
-            item->aux_ = this;
-
-            PODVector<Drawable*>::Iterator end = tempDrawables.End();
-            if (i < numWorkItems - 1 && end - start > drawablesPerItem)
-                end = start + drawablesPerItem;
-            
-            item->start_ = &(*start);
-            item->end_ = &(*end);
-            queue->AddWorkItem(item);
-            
-            start = end;
-        }
-        
-        queue->Complete(M_MAX_UNSIGNED);
+        CheckVisibilityTask task(this, tempDrawables);
+        queue->ParallelFor(0, tempDrawables.Size(), DRAWABLES_PER_WORK_RANGE, task);
     }
     
     // Combine lights, geometries & scene Z range from the threads
@@ -1241,31 +1321,19 @@ void View::UpdateGeometries()
                 }
             }
             
-            int numWorkItems = queue->GetNumThreads() + 1; // Worker threads + main thread
-            int drawablesPerItem = threadedGeometries_.Size() / numWorkItems;
-            
-            PODVector<Drawable*>::Iterator start = threadedGeometries_.Begin();
-            for (int i = 0; i < numWorkItems; ++i)
-            {
-                PODVector<Drawable*>::Iterator end = threadedGeometries_.End();
-                if (i < numWorkItems - 1 && end - start > drawablesPerItem)
-                    end = start + drawablesPerItem;
-                
-                SharedPtr<WorkItem> item = queue->GetFreeItem();
-                item->priority_ = M_MAX_UNSIGNED;
-                item->workFunction_ = UpdateDrawableGeometriesWork;
-                item->aux_ = const_cast<FrameInfo*>(&frame_);
-                item->start_ = &(*start);
-                item->end_ = &(*end);
-                queue->AddWorkItem(item);
-                
-                start = end;
-            }
         }
         
-        // While the work queue is processed, update non-threaded geometries
+        // Queue threaded geometry updates first, then update non-threaded geometries while the workers process them
+        // along with the sorting work items
+        UpdateDrawableGeometriesTask task(threadedGeometries_, frame_);
+        ParallelForState state;
+        queue->BeginParallelFor(state, 0, threadedGeometries_.Size(), GEOMETRIES_PER_WORK_RANGE, task);
+        
         for (PODVector<Drawable*>::ConstIterator i = nonThreadedGeometries_.Begin(); i != nonThreadedGeometries_.End(); ++i)
             (*i)->UpdateGeometry(frame_);
+        
+        // Join the threaded updates
+        queue->FinishParallelFor<UpdateDrawableGeometriesTask>(state);
     }
     
     // Finally ensure all threaded work has completed
@@ -2041,6 +2109,11 @@ void View::DrawOccluders(OcclusionBuffer* buffer, const PODVector<Drawable*>& oc
         Drawable* occluder = occluders[i];
         if (i > 0)
         {
+            // The triangles are only binned when drawn. Rasterize them in batches, always including the first and largest
+            // occluder, so that the subsequent occluders can be tested against the pixel-level occlusion buffer
+            if (i == 1 || buffer->GetNumPendingTriangles() >= OCCLUSION_BATCH_TRIANGLES)
+                buffer->DrawTriangles();
+            
             // For subsequent occluders, do a test against the pixel-level occlusion buffer to see if rendering is necessary
             if (!buffer->IsVisible(occluder->GetWorldBoundingBox()))
                 continue;
@@ -2050,8 +2123,6 @@ void View::DrawOccluders(OcclusionBuffer* buffer, const PODVector<Drawable*>& oc
         if (!occluder->DrawOcclusion(buffer))
             break;
     }
-    
-    buffer->BuildDepthHierarchy();
 }
 
 void View::ProcessLight(LightQueryResult& query, unsigned threadIndex)
@@ -2682,12 +2753,12 @@ void View::AddBatchToQueue(BatchQueue& batchQueue, Batch& batch, Technique* tech
     {
         BatchGroupKey key(batch);
         
-        HashMap<BatchGroupKey, BatchGroup>::Iterator i = batchQueue.batchGroups_.Find(key);
+        FlatHashMap<BatchGroupKey, BatchGroup>::Iterator i = batchQueue.batchGroups_.Find(key);
         if (i == batchQueue.batchGroups_.End())
         {
             // Create a new group based on the batch
             // In case the group remains below the instancing limit, do not enable instancing shaders yet
-            BatchGroup newGroup(batch);
+            BatchGroup newGroup(batch, &frameAllocator_);
             newGroup.geometryType_ = GEOM_STATIC;
             renderer_->SetBatchShaders(newGroup, tech, allowShadows);
             newGroup.CalculateSortKey();
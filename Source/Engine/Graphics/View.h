@@ -108,7 +108,7 @@ static const unsigned MAX_VIEWPORT_TEXTURES = 2;
 /// Internal structure for 3D rendering work. Created for each backbuffer and texture viewport, but not for shadow cameras.
 class URHO3D_API View : public Object
 {
-    friend void CheckVisibilityWork(const WorkItem* item, unsigned threadIndex);
+    friend void CheckVisibilityWork(View* view, Drawable** start, Drawable** end, unsigned threadIndex);
     friend void ProcessLightWork(const WorkItem* item, unsigned threadIndex);
     
     OBJECT(View);
@@ -273,6 +273,12 @@ private:
     Zone* farClipZone_;
     /// Occlusion buffer for the main camera.
     OcclusionBuffer* occlusionBuffer_;
+    /// Previous frame's occlusion buffer for the main camera when using temporal occlusion.
+    OcclusionBuffer* previousOcclusionBuffer_;
+    /// Occlusion buffers owned by the view when using temporal occlusion. The first is drawn on the current frame and the second is the previous frame's.
+    SharedPtr<OcclusionBuffer> temporalOcclusionBuffers_[2];
+    /// Frame number on which the first temporal occlusion buffer was drawn.
+    unsigned temporalOcclusionFrame_;
     /// Destination color rendertarget.
     RenderSurface* renderTarget_;
     /// Substitute rendertarget for deferred rendering. Allocated if necessary.
@@ -343,6 +349,8 @@ private:
     Vector<LightQueryResult> lightQueryResults_;
     /// Info for scene render passes defined by the renderpath.
     Vector<ScenePassInfo> scenePasses_;
+    /// Allocator for per-frame batch data. Reset at the beginning of the view update.
+    FrameAllocator frameAllocator_;
     /// Per-pixel light queues.
     Vector<LightBatchQueue> lightQueues_;
     /// Per-vertex light queues.
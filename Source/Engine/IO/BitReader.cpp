@@ -0,0 +1,142 @@
+//
+// Copyright (c) 2008-2014 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "Precompiled.h"
+#include "BitReader.h"
+#include "Deserializer.h"
+
+#include <cstring>
+
+#include "DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Range of the three smallest components of a normalized quaternion.
+static const float QUATERNION_COMPONENT_RANGE = 0.70710678f;
+
+BitReader::BitReader(Deserializer& source) :
+    source_(source),
+    current_(0),
+    bitsLeft_(0)
+{
+}
+
+unsigned BitReader::ReadBits(unsigned numBits)
+{
+    unsigned ret = 0;
+    unsigned shift = 0;
+    
+    while (numBits)
+    {
+        if (!bitsLeft_)
+        {
+            if (source_.IsEof())
+                break;
+            current_ = source_.ReadUByte();
+            bitsLeft_ = 8;
+        }
+        
+        unsigned bits = Min((int)bitsLeft_, (int)numBits);
+        ret |= ((unsigned)current_ & ((1 << bits) - 1)) << shift;
+        current_ >>= bits;
+        bitsLeft_ -= bits;
+        numBits -= bits;
+        shift += bits;
+    }
+    
+    return ret;
+}
+
+bool BitReader::ReadBool()
+{
+    return ReadBits(1) != 0;
+}
+
+float BitReader::ReadFloat()
+{
+    unsigned bits = ReadBits(32);
+    float ret;
+    memcpy(&ret, &bits, sizeof ret);
+    return ret;
+}
+
+unsigned BitReader::ReadVLE()
+{
+    unsigned ret = 0;
+    unsigned shift = 0;
+    
+    for (;;)
+    {
+        unsigned byte = ReadBits(8);
+        ret |= (byte & 0x7f) << shift;
+        shift += 7;
+        if (!(byte & 0x80) || shift >= 32 || IsEof())
+            break;
+    }
+    
+    return ret;
+}
+
+int BitReader::ReadSignedVLE()
+{
+    unsigned value = ReadVLE();
+    return (int)(value >> 1) ^ -(int)(value & 1);
+}
+
+float BitReader::ReadQuantizedFloat(float min, float max, unsigned numBits)
+{
+    unsigned maxValue = (1 << numBits) - 1;
+    return min + (max - min) * (float)ReadBits(numBits) / (float)maxValue;
+}
+
+Quaternion BitReader::ReadQuantizedQuaternion(unsigned numBits)
+{
+    unsigned largest = ReadBits(2);
+    float components[4];
+    float sumSquares = 0.0f;
+    
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        if (i != largest)
+        {
+            components[i] = ReadQuantizedFloat(-QUATERNION_COMPONENT_RANGE, QUATERNION_COMPONENT_RANGE, numBits);
+            sumSquares += components[i] * components[i];
+        }
+    }
+    components[largest] = sqrtf(Max(1.0f - sumSquares, 0.0f));
+    
+    return Quaternion(components[0], components[1], components[2], components[3]).Normalized();
+}
+
+bool BitReader::IsEof() const
+{
+    return !bitsLeft_ && source_.IsEof();
+}
+
+void BitReader::Align()
+{
+    current_ = 0;
+    bitsLeft_ = 0;
+}
+
+}
@@ -0,0 +1,69 @@
+//
+// Copyright (c) 2008-2014 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "Urho3D.h"
+
+namespace Urho3D
+{
+
+class Deserializer;
+class Quaternion;
+
+/// Bit-granular reader on top of a byte stream, counterpart of BitWriter. Call Align() before reading byte-aligned data directly from the source stream.
+class URHO3D_API BitReader
+{
+public:
+    /// Construct with source stream.
+    BitReader(Deserializer& source);
+    
+    /// Read up to 32 bits into the low end of an unsigned integer.
+    unsigned ReadBits(unsigned numBits);
+    /// Read a bool from one bit.
+    bool ReadBool();
+    /// Read a full precision float.
+    float ReadFloat();
+    /// Read a variable-length encoded unsigned integer.
+    unsigned ReadVLE();
+    /// Read a variable-length zigzag encoded signed integer.
+    int ReadSignedVLE();
+    /// Read a float quantized to a range with the given amount of bits.
+    float ReadQuantizedFloat(float min, float max, unsigned numBits);
+    /// Read a quaternion written as the smallest three components.
+    Quaternion ReadQuantizedQuaternion(unsigned numBits);
+    /// Skip the rest of the current byte.
+    void Align();
+    
+    /// Return whether no more bits can be read.
+    bool IsEof() const;
+    
+private:
+    /// Source stream.
+    Deserializer& source_;
+    /// Byte being consumed.
+    unsigned char current_;
+    /// Number of unread bits in the current byte.
+    unsigned bitsLeft_;
+};
+
+}
@@ -0,0 +1,141 @@
+//
+// Copyright (c) 2008-2014 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "Precompiled.h"
+#include "BitWriter.h"
+#include "BoundingBox.h"
+#include "Serializer.h"
+
+#include <cstring>
+
+#include "DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Range of the three smallest components of a normalized quaternion.
+static const float QUATERNION_COMPONENT_RANGE = 0.70710678f;
+
+BitWriter::BitWriter(Serializer& dest) :
+    dest_(dest),
+    current_(0),
+    bitPosition_(0),
+    numBits_(0)
+{
+}
+
+BitWriter::~BitWriter()
+{
+    Flush();
+}
+
+void BitWriter::WriteBits(unsigned value, unsigned numBits)
+{
+    numBits_ += numBits;
+    
+    while (numBits)
+    {
+        unsigned bits = Min((int)(8 - bitPosition_), (int)numBits);
+        current_ |= (unsigned char)((value & ((1 << bits) - 1)) << bitPosition_);
+        value >>= bits;
+        numBits -= bits;
+        bitPosition_ += bits;
+        
+        if (bitPosition_ == 8)
+        {
+            dest_.WriteUByte(current_);
+            current_ = 0;
+            bitPosition_ = 0;
+        }
+    }
+}
+
+void BitWriter::WriteBool(bool value)
+{
+    WriteBits(value ? 1 : 0, 1);
+}
+
+void BitWriter::WriteFloat(float value)
+{
+    unsigned bits;
+    memcpy(&bits, &value, sizeof bits);
+    WriteBits(bits, 32);
+}
+
+void BitWriter::WriteVLE(unsigned value)
+{
+    while (value >= 0x80)
+    {
+        WriteBits((value & 0x7f) | 0x80, 8);
+        value >>= 7;
+    }
+    WriteBits(value, 8);
+}
+
+void BitWriter::WriteSignedVLE(int value)
+{
+    WriteVLE(((unsigned)value << 1) ^ (unsigned)(value >> 31));
+}
+
+void BitWriter::WriteQuantizedFloat(float value, float min, float max, unsigned numBits)
+{
+    unsigned maxValue = (1 << numBits) - 1;
+    float range = max - min;
+    float normalized = range > 0.0f ? (Clamp(value, min, max) - min) / range : 0.0f;
+    WriteBits((unsigned)(normalized * (float)maxValue + 0.5f), numBits);
+}
+
+void BitWriter::WriteQuantizedQuaternion(const Quaternion& value, unsigned numBits)
+{
+    Quaternion norm = value.Normalized();
+    float components[4] = { norm.w_, norm.x_, norm.y_, norm.z_ };
+    
+    // Leave out the largest component, it is reconstructed from the others. Negate the quaternion if necessary so that
+    // the largest component is positive, as q and -q represent the same rotation
+    unsigned largest = 0;
+    for (unsigned i = 1; i < 4; ++i)
+    {
+        if (Abs(components[i]) > Abs(components[largest]))
+            largest = i;
+    }
+    float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+    
+    WriteBits(largest, 2);
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        if (i != largest)
+            WriteQuantizedFloat(sign * components[i], -QUATERNION_COMPONENT_RANGE, QUATERNION_COMPONENT_RANGE, numBits);
+    }
+}
+
+void BitWriter::Flush()
+{
+    if (bitPosition_)
+    {
+        dest_.WriteUByte(current_);
+        numBits_ += 8 - bitPosition_;
+        current_ = 0;
+        bitPosition_ = 0;
+    }
+}
+
+}
@@ -0,0 +1,73 @@
+//
+// Copyright (c) 2008-2014 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "Urho3D.h"
+
+namespace Urho3D
+{
+
+class Quaternion;
+class Serializer;
+
+/// Bit-granular writer on top of a byte stream. Bits are written least significant first. Call Flush() before writing byte-aligned data directly to the destination stream.
+class URHO3D_API BitWriter
+{
+public:
+    /// Construct with destination stream.
+    BitWriter(Serializer& dest);
+    /// Destruct. Flush the remaining bits.
+    ~BitWriter();
+    
+    /// Write up to 32 bits from the low end of an unsigned integer.
+    void WriteBits(unsigned value, unsigned numBits);
+    /// Write a bool as one bit.
+    void WriteBool(bool value);
+    /// Write a full precision float.
+    void WriteFloat(float value);
+    /// Write a variable-length encoded unsigned integer, 7 bits per group.
+    void WriteVLE(unsigned value);
+    /// Write a variable-length encoded signed integer using zigzag encoding so that small negative values stay short.
+    void WriteSignedVLE(int value);
+    /// Write a float quantized to a range with the given amount of bits (1-24.)
+    void WriteQuantizedFloat(float value, float min, float max, unsigned numBits);
+    /// Write a normalized quaternion as the smallest three components with the given amount of bits each (1-24.)
+    void WriteQuantizedQuaternion(const Quaternion& value, unsigned numBits);
+    /// Pad to a byte boundary and write the pending bits.
+    void Flush();
+    
+    /// Return number of bits written.
+    unsigned GetNumBits() const { return numBits_; }
+    
+private:
+    /// Destination stream.
+    Serializer& dest_;
+    /// Byte being assembled.
+    unsigned char current_;
+    /// Number of bits used in the current byte.
+    unsigned bitPosition_;
+    /// Total number of bits written.
+    unsigned numBits_;
+};
+
+}
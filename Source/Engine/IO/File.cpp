@@ -66,6 +66,9 @@ File::File(Context* context) :
     #ifdef ANDROID
     assetHandle_(0),
     #endif
+    mappedPackage_(0),
+    mappedData_(0),
+    blockSize_(0),
     readBufferOffset_(0),
     readBufferSize_(0),
     offset_(0),
@@ -83,6 +86,9 @@ File::File(Context* context, const String& fileName, FileMode mode) :
     #ifdef ANDROID
     assetHandle_(0),
     #endif
+    mappedPackage_(0),
+    mappedData_(0),
+    blockSize_(0),
     readBufferOffset_(0),
     readBufferSize_(0),
     offset_(0),
@@ -101,6 +107,9 @@ File::File(Context* context, PackageFile* package, const String& fileName) :
     #ifdef ANDROID
     assetHandle_(0),
     #endif
+    mappedPackage_(0),
+    mappedData_(0),
+    blockSize_(0),
     readBufferOffset_(0),
     readBufferSize_(0),
     offset_(0),
@@ -193,6 +202,7 @@ bool File::Open(const String& fileName, FileMode mode)
     offset_ = 0;
     checksum_ = 0;
     compressed_ = false;
+    blockSize_ = 0;
     readSyncNeeded_ = false;
     writeSyncNeeded_ = false;
 
@@ -213,15 +223,25 @@ bool File::Open(PackageFile* package, const String& fileName)
     if (!entry)
         return false;
 
-    #ifdef WIN32
-    handle_ = _wfopen(GetWideNativePath(package->GetName()).CString(), L"rb");
-    #else
-    handle_ = fopen(GetNativePath(package->GetName()).CString(), "rb");
-    #endif
-    if (!handle_)
+    // If the package is memory-mapped, read directly from the mapping
+    if (package->IsMemoryMapped())
     {
-        LOGERROR("Could not open package file " + fileName);
-        return false;
+        mappedPackage_ = package;
+        mappedData_ = package->GetMappedData() + entry->offset_;
+        package->AddMappedFile();
+    }
+    else
+    {
+        #ifdef WIN32
+        handle_ = _wfopen(GetWideNativePath(package->GetName()).CString(), L"rb");
+        #else
+        handle_ = fopen(GetNativePath(package->GetName()).CString(), "rb");
+        #endif
+        if (!handle_)
+        {
+            LOGERROR("Could not open package file " + fileName);
+            return false;
+        }
     }
 
     fileName_ = fileName;
@@ -231,20 +251,44 @@ bool File::Open(PackageFile* package, const String& fileName)
     position_ = 0;
     size_ = entry->size_;
     compressed_ = package->IsCompressed();
+    blockSize_ = package->GetBlockSize();
+    readBufferOffset_ = 0;
+    readBufferSize_ = 0;
     readSyncNeeded_ = false;
     writeSyncNeeded_ = false;
     
-    fseek((FILE*)handle_, offset_, SEEK_SET);
+    if (handle_)
+        fseek((FILE*)handle_, offset_, SEEK_SET);
+    
+    if (blockSize_)
+    {
+        // Read the block index, which has one more offset than there are blocks to also give the end of the last block
+        blockOffsets_.Resize((size_ + blockSize_ - 1) / blockSize_ + 1);
+        unsigned indexSize = blockOffsets_.Size() * sizeof(unsigned);
+        bool success;
+        if (mappedData_)
+        {
+            success = offset_ + indexSize <= package->GetTotalSize();
+            if (success)
+                memcpy(&blockOffsets_[0], mappedData_, indexSize);
+        }
+        else
+            success = fread(&blockOffsets_[0], indexSize, 1, (FILE*)handle_) == 1;
+        
+        if (!success)
+        {
+            LOGERROR("Could not read block index of packaged file " + fileName);
+            Close();
+            return false;
+        }
+    }
+    
     return true;
 }
 
 unsigned File::Read(void* dest, unsigned size)
 {
-    #ifdef ANDROID
-    if (!handle_ && !assetHandle_)
-    #else
-    if (!handle_)
-    #endif
+    if (!IsOpen())
     {
         // Do not log the error further here to prevent spamming the stderr stream
         return 0;
@@ -287,6 +331,56 @@ unsigned File::Read(void* dest, unsigned size)
         return size;
     }
     #endif
+    if (mappedData_ && !compressed_)
+    {
+        memcpy(dest, mappedData_ + position_, size);
+        position_ += size;
+        return size;
+    }
+    if (blockSize_)
+    {
+        unsigned sizeLeft = size;
+        unsigned char* destPtr = (unsigned char*)dest;
+        
+        while (sizeLeft)
+        {
+            if (readBufferOffset_ >= readBufferSize_)
+            {
+                unsigned index = position_ / blockSize_;
+                unsigned blockOffset = position_ - index * blockSize_;
+                unsigned unpackedSize = Min((int)(size_ - index * blockSize_), (int)blockSize_);
+                
+                // Decompress whole blocks directly to the destination
+                if (!blockOffset && sizeLeft >= unpackedSize)
+                {
+                    if (!ReadBlock(index, destPtr))
+                        return 0;
+                    destPtr += unpackedSize;
+                    sizeLeft -= unpackedSize;
+                    position_ += unpackedSize;
+                    readBufferOffset_ = 0;
+                    readBufferSize_ = 0;
+                    continue;
+                }
+                
+                if (!readBuffer_)
+                    readBuffer_ = new unsigned char[blockSize_];
+                if (!ReadBlock(index, readBuffer_.Get()))
+                    return 0;
+                readBufferOffset_ = blockOffset;
+                readBufferSize_ = unpackedSize;
+            }
+            
+            unsigned copySize = Min((int)(readBufferSize_ - readBufferOffset_), (int)sizeLeft);
+            memcpy(destPtr, readBuffer_.Get() + readBufferOffset_, copySize);
+            destPtr += copySize;
+            sizeLeft -= copySize;
+            readBufferOffset_ += copySize;
+            position_ += copySize;
+        }
+        
+        return size;
+    }
     if (compressed_)
     {
         unsigned sizeLeft = size;
@@ -351,11 +445,7 @@ unsigned File::Read(void* dest, unsigned size)
 
 unsigned File::Seek(unsigned position)
 {
-    #ifdef ANDROID
-    if (!handle_ && !assetHandle_)
-    #else
-    if (!handle_)
-    #endif
+    if (!IsOpen())
     {
         // Do not log the error further here to prevent spamming the stderr stream
         return 0;
@@ -375,25 +465,41 @@ unsigned File::Seek(unsigned position)
         return position_;
     }
     #endif
+    if (blockSize_)
+    {
+        // Keep the decompressed block if the new position is within it. Otherwise the block containing the new position
+        // is decompressed on the next read
+        unsigned blockStart = position_ - readBufferOffset_;
+        if (readBufferSize_ && position >= blockStart && position < blockStart + readBufferSize_)
+            readBufferOffset_ = position - blockStart;
+        else
+        {
+            readBufferOffset_ = 0;
+            readBufferSize_ = 0;
+        }
+        position_ = position;
+        return position_;
+    }
+    if (mappedData_)
+    {
+        position_ = position;
+        return position_;
+    }
     if (compressed_)
     {
-        // Start over from the beginning
-        if (position == 0)
+        // The sequential compressed format can only be read forward, so start over from the beginning when seeking backward
+        if (position < position_ || position == 0)
         {
             position_ = 0;
             readBufferOffset_ = 0;
             readBufferSize_ = 0;
             fseek((FILE*)handle_, offset_, SEEK_SET);
         }
+        
         // Skip bytes
-        else if (position >= position_)
-        {
-            unsigned char skipBuffer[SKIP_BUFFER_SIZE];
-            while (position > position_)
-                Read(skipBuffer, Min((int)position - position_, (int)SKIP_BUFFER_SIZE));
-        }
-        else
-            LOGERROR("Seeking backward in a compressed file is not supported");
+        unsigned char skipBuffer[SKIP_BUFFER_SIZE];
+        while (position > position_)
+            Read(skipBuffer, Min((int)position - position_, (int)SKIP_BUFFER_SIZE));
 
         return position_;
     }
@@ -486,6 +592,18 @@ void File::Close()
 
     readBuffer_.Reset();
     inputBuffer_.Reset();
+    blockOffsets_.Clear();
+
+    if (mappedData_)
+    {
+        mappedData_ = 0;
+        mappedPackage_->RemoveMappedFile();
+        mappedPackage_ = 0;
+        position_ = 0;
+        size_ = 0;
+        offset_ = 0;
+        checksum_ = 0;
+    }
 
     if (handle_)
     {
@@ -509,12 +627,53 @@ void File::SetName(const String& name)
     fileName_ = name;
 }
 
+bool File::ReadBlock(unsigned index, unsigned char* dest)
+{
+    unsigned packedOffset = blockOffsets_[index];
+    unsigned packedEnd = blockOffsets_[index + 1];
+    unsigned packedSize = packedEnd - packedOffset;
+    unsigned unpackedSize = Min((int)(size_ - index * blockSize_), (int)blockSize_);
+    if (packedEnd < packedOffset || packedSize > (unsigned)LZ4_compressBound(blockSize_) ||
+        (mappedData_ && offset_ + packedEnd > mappedPackage_->GetTotalSize()))
+    {
+        LOGERROR("Corrupt block index in packaged file " + GetName());
+        return false;
+    }
+    
+    const unsigned char* src;
+    if (mappedData_)
+        src = mappedData_ + packedOffset;
+    else
+    {
+        if (!inputBuffer_)
+            inputBuffer_ = new unsigned char[LZ4_compressBound(blockSize_)];
+        fseek((FILE*)handle_, offset_ + packedOffset, SEEK_SET);
+        if (fread(inputBuffer_.Get(), packedSize, 1, (FILE*)handle_) != 1)
+        {
+            LOGERROR("Error while reading from file " + GetName());
+            return false;
+        }
+        src = inputBuffer_.Get();
+    }
+    
+    // Blocks that did not compress are stored as is
+    if (packedSize == unpackedSize)
+        memcpy(dest, src, unpackedSize);
+    else if (LZ4_decompress_safe((const char*)src, (char*)dest, packedSize, unpackedSize) != (int)unpackedSize)
+    {
+        LOGERROR("Error while decompressing file " + GetName());
+        return false;
+    }
+    
+    return true;
+}
+
 bool File::IsOpen() const
 {
     #ifdef ANDROID
-        return handle_ != 0 || assetHandle_ != 0;
+        return handle_ != 0 || assetHandle_ != 0 || mappedData_ != 0;
     #else
-        return handle_ != 0;
+        return handle_ != 0 || mappedData_ != 0;
     #endif
 }
 
@@ -89,8 +89,13 @@ public:
     void* GetHandle() const { return handle_; }
     /// Return whether the file originates from a package.
     bool IsPackaged() const { return offset_ != 0; }
+    /// Return the file contents if read from an uncompressed memory-mapped package file, or null otherwise. Valid while the file is open.
+    const unsigned char* GetMappedData() const { return compressed_ ? 0 : mappedData_; }
     
 private:
+    /// Decompress a block of a block indexed compressed package file entry. Return true if successful.
+    bool ReadBlock(unsigned index, unsigned char* dest);
+    
     /// File name.
     String fileName_;
     /// Open mode.
@@ -101,10 +106,18 @@ private:
     /// SDL RWops context for Android asset loading.
     SDL_RWops* assetHandle_;
     #endif
+    /// Memory-mapped package file. Not referenced, as files are opened and closed from several threads; the package counts the open files instead.
+    PackageFile* mappedPackage_;
+    /// File contents within a memory-mapped package file.
+    const unsigned char* mappedData_;
     /// Read buffer for Android asset or compressed file loading.
     SharedArrayPtr<unsigned char> readBuffer_;
     /// Decompression input buffer for compressed file loading.
     SharedArrayPtr<unsigned char> inputBuffer_;
+    /// Compressed block offsets from the start of a block indexed package file entry, followed by the end offset.
+    PODVector<unsigned> blockOffsets_;
+    /// Uncompressed block size of a block indexed package file entry, 0 otherwise.
+    unsigned blockSize_;
     /// Read buffer position.
     unsigned readBufferOffset_;
     /// Bytes in the current read buffer.
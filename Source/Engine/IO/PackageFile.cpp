@@ -22,16 +22,33 @@
 
 #include "Precompiled.h"
 #include "File.h"
+#include "FileSystem.h"
 #include "Log.h"
 #include "PackageFile.h"
 
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 namespace Urho3D
 {
 
+static bool IsPackageID(const String& id)
+{
+    return id == "UPAK" || id == "ULZ4" || id == "ULZ2";
+}
+
 PackageFile::PackageFile(Context* context) :
     Object(context),
     totalSize_(0),
     checksum_(0),
+    blockSize_(0),
+    mappedData_(0),
+    numMappedFiles_(0),
     compressed_(false)
 {
 }
@@ -40,6 +57,9 @@ PackageFile::PackageFile(Context* context, const String& fileName, unsigned star
     Object(context),
     totalSize_(0),
     checksum_(0),
+    blockSize_(0),
+    mappedData_(0),
+    numMappedFiles_(0),
     compressed_(false)
 {
     Open(fileName, startOffset);
@@ -47,6 +67,9 @@ PackageFile::PackageFile(Context* context, const String& fileName, unsigned star
 
 PackageFile::~PackageFile()
 {
+    if (numMappedFiles_)
+        LOGERROR("Package file " + fileName_ + " destroyed while files are open from it");
+    UnmapFile();
 }
 
 bool PackageFile::Open(const String& fileName, unsigned startOffset)
@@ -59,6 +82,14 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
     }
     #endif
     
+    if (numMappedFiles_)
+    {
+        LOGERROR("Can not reopen package file " + fileName_ + " while files are open from it");
+        return false;
+    }
+    
+    UnmapFile();
+    
     SharedPtr<File> file(new File(context_, fileName));
     if (!file->IsOpen())
         return false;
@@ -66,7 +97,7 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
     // Check ID, then read the directory
     file->Seek(startOffset);
     String id = file->ReadFileID();
-    if (id != "UPAK" && id != "ULZ4")
+    if (!IsPackageID(id))
     {
         // If start offset has not been explicitly specified, also try to read package size from the end of file
         // to know how much we must rewind to find the package start
@@ -83,7 +114,7 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
             }
         }
         
-        if (id != "UPAK" && id != "ULZ4")
+        if (!IsPackageID(id))
         {
             LOGERROR(fileName + " is not a valid package file");
             return false;
@@ -93,10 +124,17 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
     fileName_ = fileName;
     nameHash_ = fileName_;
     totalSize_ = file->GetSize();
-    compressed_ = id == "ULZ4";
+    compressed_ = id != "UPAK";
     
     unsigned numFiles = file->ReadUInt();
     checksum_ = file->ReadUInt();
+    // The block indexed compressed format stores the block size after the checksum
+    blockSize_ = id == "ULZ2" ? file->ReadUInt() : 0;
+    if (id == "ULZ2" && !blockSize_)
+    {
+        LOGERROR(fileName + " has invalid compressed block size");
+        return false;
+    }
     
     for (unsigned i = 0; i < numFiles; ++i)
     {
@@ -111,6 +149,12 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
             entries_[entryName.ToLower()] = newEntry;
     }
     
+    // Map the package into memory so that files can be read without stdio buffering and copying. On failure fall back to
+    // reading through a file handle. The old sequential compressed format is always read through a file handle
+    file->Close();
+    if ((!compressed_ || blockSize_) && !MapFile())
+        LOGWARNING("Could not memory-map package file " + fileName + ", reading through file handles instead");
+    
     return true;
 }
 
@@ -128,4 +172,50 @@ const PackageEntry* PackageFile::GetEntry(const String& fileName) const
         return 0;
 }
 
+bool PackageFile::MapFile()
+{
+    if (!totalSize_)
+        return false;
+    
+    #ifdef WIN32
+    HANDLE fileHandle = CreateFileW(GetWideNativePath(fileName_).CString(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, 0);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+        return false;
+    
+    // The view keeps the file and the mapping object alive, so the handles can be closed immediately
+    HANDLE mappingHandle = CreateFileMappingW(fileHandle, 0, PAGE_READONLY, 0, 0, 0);
+    CloseHandle(fileHandle);
+    if (!mappingHandle)
+        return false;
+    
+    mappedData_ = (unsigned char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mappingHandle);
+    #else
+    int fd = open(GetNativePath(fileName_).CString(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    
+    void* data = mmap(0, totalSize_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data != MAP_FAILED)
+        mappedData_ = (unsigned char*)data;
+    #endif
+    
+    return mappedData_ != 0;
+}
+
+void PackageFile::UnmapFile()
+{
+    if (!mappedData_)
+        return;
+    
+    #ifdef WIN32
+    UnmapViewOfFile(mappedData_);
+    #else
+    munmap(mappedData_, totalSize_);
+    #endif
+    mappedData_ = 0;
+}
+
 }
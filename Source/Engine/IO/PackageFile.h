@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include "Atomic.h"
 #include "Object.h"
 
 namespace Urho3D
@@ -71,10 +72,27 @@ public:
     unsigned GetChecksum() const { return checksum_; }
     /// Return whether the files are compressed.
     bool IsCompressed() const { return compressed_; }
+    /// Return uncompressed size of the compressed blocks, or 0 if the package does not have a block index.
+    unsigned GetBlockSize() const { return blockSize_; }
+    /// Return whether the package file is mapped into memory.
+    bool IsMemoryMapped() const { return mappedData_ != 0; }
+    /// Return the memory-mapped package file contents, or null if not mapped.
+    const unsigned char* GetMappedData() const { return mappedData_; }
+    /// Return number of open files reading from the memory mapping. The package must not be destroyed while nonzero.
+    unsigned GetNumMappedFiles() const { return numMappedFiles_; }
+    /// Increment number of open files reading from the memory mapping. Called by File. Can be called from any thread.
+    void AddMappedFile() { AtomicIncrement(&numMappedFiles_); }
+    /// Decrement number of open files reading from the memory mapping. Called by File. Can be called from any thread.
+    void RemoveMappedFile() { AtomicDecrement(&numMappedFiles_); }
     /// Return list of entry names
     const Vector<String> GetEntryNames() const { return entries_.Keys(); }
     
 private:
+    /// Map the whole package file into memory. Return true if successful.
+    bool MapFile();
+    /// Unmap the package file.
+    void UnmapFile();
+    
     /// File entries.
     HashMap<String, PackageEntry> entries_;
     /// File name.
@@ -85,6 +103,12 @@ private:
     unsigned totalSize_;
     /// Package file checksum.
     unsigned checksum_;
+    /// Uncompressed size of the compressed blocks. 0 if the package does not have a block index.
+    unsigned blockSize_;
+    /// Memory-mapped package file contents. Packages in the old sequential compressed format are not mapped.
+    unsigned char* mappedData_;
+    /// Number of open files reading from the memory mapping.
+    volatile int numMappedFiles_;
     /// Compressed flag.
     bool compressed_;
 };
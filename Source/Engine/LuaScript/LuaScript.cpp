@@ -299,8 +299,7 @@ void LuaScript::ScriptSubscribeToEvent(void* sender, const String& eventName, in
         LuaFunctionVector& functions = objectHandleFunctions_[object][eventType];
 
         // Fix issue #256
-        HashSet<Object*>* receivers = context_->GetEventReceivers(object, eventType);
-        if ((!receivers || !receivers->Contains(this)) && !functions.Empty())
+        if (!HasSubscribedToEvent(object, eventType) && !functions.Empty())
             functions.Clear();
 
         SubscribeToEvent(object, eventType, HANDLER(LuaScript, HandleObjectEvent));
@@ -321,8 +320,7 @@ void LuaScript::ScriptSubscribeToEvent(void* sender, const String& eventName, co
         LuaFunctionVector& functions = objectHandleFunctions_[object][eventType];
 
         // Fix issue #256
-        HashSet<Object*>* receivers = context_->GetEventReceivers(object, eventType);
-        if ((!receivers || !receivers->Contains(this)) && !functions.Empty())
+        if (!HasSubscribedToEvent(object, eventType) && !functions.Empty())
             functions.Clear();
 
         SubscribeToEvent(object, eventType, HANDLER(LuaScript, HandleObjectEvent));
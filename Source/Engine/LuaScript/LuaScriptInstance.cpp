@@ -621,7 +621,7 @@ void LuaScriptInstance::SubscribeToScriptMethodEvents()
     Scene* scene = GetScene();
 
     if (scene && scriptObjectMethods_[LSOM_UPDATE])
-        SubscribeToEvent(scene, E_SCENEUPDATE, HANDLER(LuaScriptInstance, HandleUpdate));
+        SubscribeToEvent(scene, E_SCENEUPDATE, TYPED_HANDLER(LuaScriptInstance, HandleUpdate));
 
     if (scene && scriptObjectMethods_[LSOM_POSTUPDATE])
         SubscribeToEvent(scene, E_SCENEPOSTUPDATE, HANDLER(LuaScriptInstance, HandlePostUpdate));
@@ -663,10 +663,9 @@ void LuaScriptInstance::UnsubscribeFromScriptMethodEvents()
         node_->RemoveListener(this);
 }
 
-void LuaScriptInstance::HandleUpdate(StringHash eventType, VariantMap& eventData)
+void LuaScriptInstance::HandleUpdate(StringHash eventType, SceneUpdate::Data& eventData)
 {
-    using namespace Update;
-    float timeStep = eventData[P_TIMESTEP].GetFloat();
+    float timeStep = eventData.timeStep_;
 
     WeakPtr<LuaFunction> function = scriptObjectMethods_[LSOM_UPDATE];
     if (function && function->BeginCall(this))
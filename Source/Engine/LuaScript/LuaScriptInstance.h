@@ -23,6 +23,7 @@
 #pragma once
 
 #include "Component.h"
+#include "SceneEvents.h"
 
 struct lua_State;
 
@@ -136,7 +137,7 @@ private:
     /// Unsubscribe from script method events.
     void UnsubscribeFromScriptMethodEvents();
     /// Handle the logic update event.
-    void HandleUpdate(StringHash eventType, VariantMap& eventData);
+    void HandleUpdate(StringHash eventType, SceneUpdate::Data& eventData);
     /// Handle the logic post update event.
     void HandlePostUpdate(StringHash eventType, VariantMap& eventData);
 #ifdef URHO3D_PHYSICS
@@ -24,6 +24,10 @@
 #include "Frustum.h"
 #include "Polyhedron.h"
 
+#ifdef URHO3D_SSE
+#include <xmmintrin.h>
+#endif
+
 namespace Urho3D
 {
 
@@ -127,6 +131,38 @@ BoundingBox BoundingBox::Transformed(const Matrix3& transform) const
 
 BoundingBox BoundingBox::Transformed(const Matrix3x4& transform) const
 {
+#ifdef URHO3D_SSE
+    // Transpose the matrix to columns so that the center and edge can be transformed with multiply-adds. The terms are
+    // added in the same order as in the scalar version, so that the results are identical
+    __m128 c0 = _mm_loadu_ps(&transform.m00_);
+    __m128 c1 = _mm_loadu_ps(&transform.m10_);
+    __m128 c2 = _mm_loadu_ps(&transform.m20_);
+    __m128 c3 = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+    
+    __m128 half = _mm_set1_ps(0.5f);
+    __m128 absMask = _mm_set1_ps(-0.0f);
+    __m128 minVec = _mm_set_ps(0.0f, min_.z_, min_.y_, min_.x_);
+    __m128 maxVec = _mm_set_ps(0.0f, max_.z_, max_.y_, max_.x_);
+    __m128 center = _mm_mul_ps(_mm_add_ps(maxVec, minVec), half);
+    __m128 edge = _mm_mul_ps(_mm_sub_ps(maxVec, minVec), half);
+    
+    __m128 newCenter = _mm_mul_ps(c0, _mm_shuffle_ps(center, center, _MM_SHUFFLE(0, 0, 0, 0)));
+    newCenter = _mm_add_ps(newCenter, _mm_mul_ps(c1, _mm_shuffle_ps(center, center, _MM_SHUFFLE(1, 1, 1, 1))));
+    newCenter = _mm_add_ps(newCenter, _mm_mul_ps(c2, _mm_shuffle_ps(center, center, _MM_SHUFFLE(2, 2, 2, 2))));
+    newCenter = _mm_add_ps(newCenter, c3);
+    
+    __m128 newEdge = _mm_mul_ps(_mm_andnot_ps(absMask, c0), _mm_shuffle_ps(edge, edge, _MM_SHUFFLE(0, 0, 0, 0)));
+    newEdge = _mm_add_ps(newEdge, _mm_mul_ps(_mm_andnot_ps(absMask, c1), _mm_shuffle_ps(edge, edge, _MM_SHUFFLE(1, 1, 1, 1))));
+    newEdge = _mm_add_ps(newEdge, _mm_mul_ps(_mm_andnot_ps(absMask, c2), _mm_shuffle_ps(edge, edge, _MM_SHUFFLE(2, 2, 2, 2))));
+    
+    float newMin[4];
+    float newMax[4];
+    _mm_storeu_ps(newMin, _mm_sub_ps(newCenter, newEdge));
+    _mm_storeu_ps(newMax, _mm_add_ps(newCenter, newEdge));
+    
+    return BoundingBox(Vector3(newMin[0], newMin[1], newMin[2]), Vector3(newMax[0], newMax[1], newMax[2]));
+#else
     Vector3 newCenter = transform * Center();
     Vector3 oldEdge = Size() * 0.5f;
     Vector3 newEdge = Vector3(
@@ -136,6 +172,7 @@ BoundingBox BoundingBox::Transformed(const Matrix3x4& transform) const
     );
     
     return BoundingBox(newCenter - newEdge, newCenter + newEdge);
+#endif
 }
 
 Rect BoundingBox::Projected(const Matrix4& projection) const
@@ -24,6 +24,10 @@
 
 #include "Matrix4.h"
 
+#ifdef URHO3D_SSE
+#include <xmmintrin.h>
+#endif
+
 namespace Urho3D
 {
 
@@ -292,6 +296,39 @@ public:
     /// Multiply a matrix.
     Matrix3x4 operator * (const Matrix3x4& rhs) const
     {
+#ifdef URHO3D_SSE
+        // Each result row is a sum of the right-hand rows weighted by the left-hand row, added in the same order as in
+        // the scalar version so that the results are identical. The left-hand translation is added to the last lane only,
+        // as adding zero products to the other lanes would turn negative zeros positive and infinities into NaNs
+        Matrix3x4 ret;
+        __m128 r0 = _mm_loadu_ps(&rhs.m00_);
+        __m128 r1 = _mm_loadu_ps(&rhs.m10_);
+        __m128 r2 = _mm_loadu_ps(&rhs.m20_);
+        __m128 u;
+        
+        __m128 l = _mm_loadu_ps(&m00_);
+        __m128 t = _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(0, 0, 0, 0)), r0);
+        t = _mm_add_ps(t, _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(1, 1, 1, 1)), r1));
+        t = _mm_add_ps(t, _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(2, 2, 2, 2)), r2));
+        u = _mm_shuffle_ps(t, _mm_add_ps(t, l), _MM_SHUFFLE(3, 3, 2, 2));
+        _mm_storeu_ps(&ret.m00_, _mm_shuffle_ps(t, u, _MM_SHUFFLE(2, 0, 1, 0)));
+        
+        l = _mm_loadu_ps(&m10_);
+        t = _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(0, 0, 0, 0)), r0);
+        t = _mm_add_ps(t, _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(1, 1, 1, 1)), r1));
+        t = _mm_add_ps(t, _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(2, 2, 2, 2)), r2));
+        u = _mm_shuffle_ps(t, _mm_add_ps(t, l), _MM_SHUFFLE(3, 3, 2, 2));
+        _mm_storeu_ps(&ret.m10_, _mm_shuffle_ps(t, u, _MM_SHUFFLE(2, 0, 1, 0)));
+        
+        l = _mm_loadu_ps(&m20_);
+        t = _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(0, 0, 0, 0)), r0);
+        t = _mm_add_ps(t, _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(1, 1, 1, 1)), r1));
+        t = _mm_add_ps(t, _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(2, 2, 2, 2)), r2));
+        u = _mm_shuffle_ps(t, _mm_add_ps(t, l), _MM_SHUFFLE(3, 3, 2, 2));
+        _mm_storeu_ps(&ret.m20_, _mm_shuffle_ps(t, u, _MM_SHUFFLE(2, 0, 1, 0)));
+        
+        return ret;
+#else
         return Matrix3x4(
             m00_ * rhs.m00_ + m01_ * rhs.m10_ + m02_ * rhs.m20_,
             m00_ * rhs.m01_ + m01_ * rhs.m11_ + m02_ * rhs.m21_,
@@ -306,11 +343,40 @@ public:
             m20_ * rhs.m02_ + m21_ * rhs.m12_ + m22_ * rhs.m22_,
             m20_ * rhs.m03_ + m21_ * rhs.m13_ + m22_ * rhs.m23_ + m23_
         );
+#endif
     }
     
     /// Multiply a 4x4 matrix.
     Matrix4 operator * (const Matrix4& rhs) const
     {
+#ifdef URHO3D_SSE
+        Matrix4 ret;
+        __m128 r0 = _mm_loadu_ps(&rhs.m00_);
+        __m128 r1 = _mm_loadu_ps(&rhs.m10_);
+        __m128 r2 = _mm_loadu_ps(&rhs.m20_);
+        __m128 r3 = _mm_loadu_ps(&rhs.m30_);
+        
+        __m128 l = _mm_loadu_ps(&m00_);
+        __m128 t = _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(0, 0, 0, 0)), r0);
+        t = _mm_add_ps(t, _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(1, 1, 1, 1)), r1));
+        t = _mm_add_ps(t, _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(2, 2, 2, 2)), r2));
+        _mm_storeu_ps(&ret.m00_, _mm_add_ps(t, _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(3, 3, 3, 3)), r3)));
+        
+        l = _mm_loadu_ps(&m10_);
+        t = _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(0, 0, 0, 0)), r0);
+        t = _mm_add_ps(t, _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(1, 1, 1, 1)), r1));
+        t = _mm_add_ps(t, _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(2, 2, 2, 2)), r2));
+        _mm_storeu_ps(&ret.m10_, _mm_add_ps(t, _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(3, 3, 3, 3)), r3)));
+        
+        l = _mm_loadu_ps(&m20_);
+        t = _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(0, 0, 0, 0)), r0);
+        t = _mm_add_ps(t, _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(1, 1, 1, 1)), r1));
+        t = _mm_add_ps(t, _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(2, 2, 2, 2)), r2));
+        _mm_storeu_ps(&ret.m20_, _mm_add_ps(t, _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(3, 3, 3, 3)), r3)));
+        
+        _mm_storeu_ps(&ret.m30_, r3);
+        return ret;
+#else
         return Matrix4(
             m00_ * rhs.m00_ + m01_ * rhs.m10_ + m02_ * rhs.m20_ + m03_ * rhs.m30_,
             m00_ * rhs.m01_ + m01_ * rhs.m11_ + m02_ * rhs.m21_ + m03_ * rhs.m31_,
@@ -329,6 +395,7 @@ public:
             rhs.m32_,
             rhs.m33_
         );
+#endif
     }
     
     /// Set translation elements.
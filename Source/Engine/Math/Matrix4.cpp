@@ -41,6 +41,28 @@ const Matrix4 Matrix4::IDENTITY;
 
 Matrix4 Matrix4::operator * (const Matrix3x4& rhs) const
 {
+#ifdef URHO3D_SSE
+    // The implicit last row of the right-hand matrix only adds the left-hand w column to the last lane. Adding zero
+    // products to the other lanes would turn negative zeros positive and infinities into NaNs
+    Matrix4 ret;
+    __m128 r0 = _mm_loadu_ps(&rhs.m00_);
+    __m128 r1 = _mm_loadu_ps(&rhs.m10_);
+    __m128 r2 = _mm_loadu_ps(&rhs.m20_);
+    const float* lhs = &m00_;
+    float* dest = &ret.m00_;
+    
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        __m128 l = _mm_loadu_ps(lhs + i * 4);
+        __m128 t = _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(0, 0, 0, 0)), r0);
+        t = _mm_add_ps(t, _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(1, 1, 1, 1)), r1));
+        t = _mm_add_ps(t, _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(2, 2, 2, 2)), r2));
+        __m128 u = _mm_shuffle_ps(t, _mm_add_ps(t, l), _MM_SHUFFLE(3, 3, 2, 2));
+        _mm_storeu_ps(dest + i * 4, _mm_shuffle_ps(t, u, _MM_SHUFFLE(2, 0, 1, 0)));
+    }
+    
+    return ret;
+#else
     return Matrix4(
         m00_ * rhs.m00_ + m01_ * rhs.m10_ + m02_ * rhs.m20_,
         m00_ * rhs.m01_ + m01_ * rhs.m11_ + m02_ * rhs.m21_,
@@ -59,6 +81,7 @@ Matrix4 Matrix4::operator * (const Matrix3x4& rhs) const
         m30_ * rhs.m02_ + m31_ * rhs.m12_ + m32_ * rhs.m22_,
         m30_ * rhs.m03_ + m31_ * rhs.m13_ + m32_ * rhs.m23_ + m33_
     );
+#endif
 }
 
 void Matrix4::Decompose(Vector3& translation, Quaternion& rotation, Vector3& scale) const
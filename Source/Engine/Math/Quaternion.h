@@ -24,6 +24,10 @@
 
 #include "Matrix3.h"
 
+#ifdef URHO3D_SSE
+#include <xmmintrin.h>
+#endif
+
 namespace Urho3D
 {
 
@@ -149,12 +153,32 @@ public:
     /// Multiply a quaternion.
     Quaternion operator * (const Quaternion& rhs) const
     {
+#ifdef URHO3D_SSE
+        // Lanes are in w, x, y, z order. Terms are added in the same order as in the scalar version, with subtractions
+        // done by negating the products, so that the results are identical
+        Quaternion ret;
+        __m128 l = _mm_loadu_ps(&w_);
+        __m128 r = _mm_loadu_ps(&rhs.w_);
+        __m128 signW = _mm_set_ps(0.0f, 0.0f, 0.0f, -0.0f);
+        
+        __m128 t = _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(0, 0, 0, 0)), r);
+        t = _mm_add_ps(t, _mm_xor_ps(_mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(3, 2, 1, 1)),
+            _mm_shuffle_ps(r, r, _MM_SHUFFLE(0, 0, 0, 1))), signW));
+        t = _mm_add_ps(t, _mm_xor_ps(_mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(1, 3, 2, 2)),
+            _mm_shuffle_ps(r, r, _MM_SHUFFLE(2, 1, 3, 2))), signW));
+        t = _mm_sub_ps(t, _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(2, 1, 3, 3)),
+            _mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 3, 2, 3))));
+        _mm_storeu_ps(&ret.w_, t);
+        
+        return ret;
+#else
         return Quaternion(
             w_ * rhs.w_ - x_ * rhs.x_ - y_ * rhs.y_ - z_ * rhs.z_,
             w_ * rhs.x_ + x_ * rhs.w_ + y_ * rhs.z_ - z_ * rhs.y_,
             w_ * rhs.y_ + y_ * rhs.w_ + z_ * rhs.x_ - x_ * rhs.z_,
             w_ * rhs.z_ + z_ * rhs.w_ + x_ * rhs.y_ - y_ * rhs.x_
         );
+#endif
     }
     
     /// Multiply a Vector3.
@@ -21,6 +21,8 @@
 //
 
 #include "Precompiled.h"
+#include "BitReader.h"
+#include "BitWriter.h"
 #include "Component.h"
 #include "Connection.h"
 #include "File.h"
@@ -33,6 +35,7 @@
 #include "PackageFile.h"
 #include "Profiler.h"
 #include "Protocol.h"
+#include "RelevanceGrid.h"
 #include "ResourceCache.h"
 #include "Scene.h"
 #include "SceneEvents.h"
@@ -46,6 +49,7 @@ namespace Urho3D
 {
 
 static const int STATS_INTERVAL_MSEC = 2000;
+static const unsigned CONTROLS_ROTATION_BITS = 15;
 
 PackageDownload::PackageDownload() :
     totalFragments_(0),
@@ -63,11 +67,15 @@ PackageUpload::PackageUpload() :
 Connection::Connection(Context* context, bool isClient, kNet::SharedPtr<kNet::MessageConnection> connection) :
     Object(context),
     connection_(connection),
+    relevanceGrid_(0),
     sendMode_(OPSM_NONE),
+    snapshotID_(0),
     isClient_(isClient),
     connectPending_(false),
     sceneLoaded_(false),
-    logStatistics_(false)
+    logStatistics_(false),
+    batchMessages_(false),
+    snapshotUpdates_(false)
 {
     sceneState_.connection_ = this;
     
@@ -106,6 +114,21 @@ void Connection::SendMessage(int msgID, bool reliable, bool inOrder, const unsig
         return;
     }
     
+    // During a threaded server update, buffer the message and queue it to kNet later in the main thread
+    if (batchMessages_)
+    {
+        BatchedMessage batched;
+        batched.msgID_ = msgID;
+        batched.contentID_ = contentID;
+        batched.offset_ = batchedData_.GetSize();
+        batched.size_ = numBytes;
+        batched.reliable_ = reliable;
+        batched.inOrder_ = inOrder;
+        batchedMessages_.Push(batched);
+        batchedData_.Write(data, numBytes);
+        return;
+    }
+    
     kNet::NetworkMessage *msg = connection_->StartNewMessage(msgID, numBytes);
     if (!msg)
     {
@@ -245,6 +268,20 @@ void Connection::SendServerUpdate()
     if (!scene_ || !sceneLoaded_)
         return;
     
+    Network* network = GetSubsystem<Network>();
+    
+    // Begin a new snapshot if attribute updates are sent as unreliable deltas against the last update acknowledged per object
+    snapshotUpdates_ = network->GetSnapshotUpdates();
+    if (snapshotUpdates_)
+        ++snapshotID_;
+    
+    // Update node relevance first, if the scene has nodes with limited relevance distance
+    relevanceGrid_ = network->GetRelevanceGrid(scene_);
+    if (relevanceGrid_)
+        ProcessRelevance();
+    else if (sceneState_.relevanceNodes_.Size())
+        sceneState_.relevanceNodes_.Clear();
+    
     // Always check the root node (scene) first so that the scene-wide components get sent first,
     // and all other replicated nodes get added to the dirty set for sending the initial state
     unsigned sceneID = scene_->GetID();
@@ -268,15 +305,42 @@ void Connection::SendClientUpdate()
         return;
     
     msg_.Clear();
-    msg_.WriteUInt(controls_.buttons_);
-    msg_.WriteFloat(controls_.yaw_);
-    msg_.WriteFloat(controls_.pitch_);
+    {
+        // Bit-pack the fixed part of the controls, then write the extra data byte-aligned
+        BitWriter writer(msg_);
+        writer.WriteVLE(controls_.buttons_);
+        writer.WriteFloat(controls_.yaw_);
+        writer.WriteFloat(controls_.pitch_);
+        writer.WriteBool(sendMode_ >= OPSM_POSITION);
+        writer.WriteBool(sendMode_ >= OPSM_POSITION_ROTATION);
+        if (sendMode_ >= OPSM_POSITION)
+        {
+            writer.WriteFloat(position_.x_);
+            writer.WriteFloat(position_.y_);
+            writer.WriteFloat(position_.z_);
+        }
+        if (sendMode_ >= OPSM_POSITION_ROTATION)
+            writer.WriteQuantizedQuaternion(rotation_, CONTROLS_ROTATION_BITS);
+    }
     msg_.WriteVariantMap(controls_.extraData_);
-    if (sendMode_ >= OPSM_POSITION)
-        msg_.WriteVector3(position_);
-    if (sendMode_ >= OPSM_POSITION_ROTATION)
-        msg_.WritePackedQuaternion(rotation_);
     SendMessage(MSG_CONTROLS, false, false, msg_, CONTROLS_CONTENT_ID);
+    
+    SendSnapshotAcks();
+}
+
+void Connection::SetBatchMessages(bool enable)
+{
+    batchMessages_ = enable;
+    
+    if (!enable && batchedMessages_.Size())
+    {
+        const unsigned char* data = batchedData_.GetData();
+        for (PODVector<BatchedMessage>::ConstIterator i = batchedMessages_.Begin(); i != batchedMessages_.End(); ++i)
+            SendMessage(i->msgID_, i->reliable_, i->inOrder_, data + i->offset_, i->size_, i->contentID_);
+        
+        batchedMessages_.Clear();
+        batchedData_.Clear();
+    }
 }
 
 void Connection::SendRemoteEvents()
@@ -395,6 +459,10 @@ bool Connection::ProcessMessage(int msgID, MemoryBuffer &msg)
             ProcessControls(msgID, msg);
             break;
             
+        case MSG_SNAPSHOTACK:
+            ProcessSnapshotAck(msgID, msg);
+            break;
+            
         case MSG_SCENELOADED:
             ProcessSceneLoaded(msgID, msg);
             break;
@@ -420,6 +488,8 @@ bool Connection::ProcessMessage(int msgID, MemoryBuffer &msg)
         case MSG_COMPONENTDELTAUPDATE:
         case MSG_COMPONENTLATESTDATA:
         case MSG_REMOVECOMPONENT:
+        case MSG_NODESNAPSHOTUPDATE:
+        case MSG_COMPONENTSNAPSHOTUPDATE:
             ProcessSceneUpdate(msgID, msg);
             break;
             
@@ -460,6 +530,10 @@ void Connection::ProcessLoadScene(int msgID, MemoryBuffer& msg)
     // Clear previous pending latest data and package downloads if any
     nodeLatestData_.Clear();
     componentLatestData_.Clear();
+    appliedNodeSnapshots_.Clear();
+    appliedComponentSnapshots_.Clear();
+    nodeSnapshotAcks_.Clear();
+    componentSnapshotAcks_.Clear();
     downloads_.Clear();
     
     // In case we have joined other scenes in this session, remove first all downloaded package files from the resource system
@@ -578,9 +652,12 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
     case MSG_NODEDELTAUPDATE:
         {
             unsigned nodeID = msg.ReadNetID();
+            unsigned snapshotID = msg.ReadVLE();
             Node* node = scene_->GetNode(nodeID);
             if (node)
             {
+                // A delayed snapshot update sent before this update would revert its values, so skip it
+                SkipOlderSnapshots(appliedNodeSnapshots_, nodeID, snapshotID);
                 node->ReadDeltaUpdate(msg);
                 // ApplyAttributes() is deliberately skipped, as Node has no attributes that require late applying.
                 // Furthermore it would propagate to components and child nodes, which is not desired in this case
@@ -624,6 +701,7 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
             if (node)
                 node->Remove();
             nodeLatestData_.Erase(nodeID);
+            appliedNodeSnapshots_.Erase(nodeID);
         }
         break;
         
@@ -664,9 +742,11 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
     case MSG_COMPONENTDELTAUPDATE:
         {
             unsigned componentID = msg.ReadNetID();
+            unsigned snapshotID = msg.ReadVLE();
             Component* component = scene_->GetComponent(componentID);
             if (component)
             {
+                SkipOlderSnapshots(appliedComponentSnapshots_, componentID, snapshotID);
                 component->ReadDeltaUpdate(msg);
                 component->ApplyAttributes();
             }
@@ -701,6 +781,36 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
             if (component)
                 component->Remove();
             componentLatestData_.Erase(componentID);
+            appliedComponentSnapshots_.Erase(componentID);
+        }
+        break;
+        
+    case MSG_NODESNAPSHOTUPDATE:
+        {
+            unsigned nodeID = msg.ReadNetID();
+            unsigned snapshotID = msg.ReadVLE();
+            Node* node = scene_->GetNode(nodeID);
+            // An update for a node that has not been created yet is not acknowledged, so that the server sends the changes
+            // again. An update older than the applied one would revert newer values, so it is skipped
+            if (node && CheckSnapshotUpdate(appliedNodeSnapshots_, nodeSnapshotAcks_, nodeID, snapshotID))
+            {
+                node->ReadDeltaUpdate(msg);
+                // ApplyAttributes() is deliberately skipped, as Node has no attributes that require late applying.
+                // Furthermore it would propagate to components and child nodes, which is not desired in this case
+            }
+        }
+        break;
+        
+    case MSG_COMPONENTSNAPSHOTUPDATE:
+        {
+            unsigned componentID = msg.ReadNetID();
+            unsigned snapshotID = msg.ReadVLE();
+            Component* component = scene_->GetComponent(componentID);
+            if (component && CheckSnapshotUpdate(appliedComponentSnapshots_, componentSnapshotAcks_, componentID, snapshotID))
+            {
+                component->ReadDeltaUpdate(msg);
+                component->ApplyAttributes();
+            }
         }
         break;
     }
@@ -875,17 +985,65 @@ void Connection::ProcessControls(int msgID, MemoryBuffer& msg)
     }
     
     Controls newControls;
-    newControls.buttons_ = msg.ReadUInt();
-    newControls.yaw_ = msg.ReadFloat();
-    newControls.pitch_ = msg.ReadFloat();
+    BitReader reader(msg);
+    newControls.buttons_ = reader.ReadVLE();
+    newControls.yaw_ = reader.ReadFloat();
+    newControls.pitch_ = reader.ReadFloat();
+    // Client may or may not send observer position & rotation for interest management
+    bool hasPosition = reader.ReadBool();
+    bool hasRotation = reader.ReadBool();
+    if (hasPosition)
+    {
+        position_.x_ = reader.ReadFloat();
+        position_.y_ = reader.ReadFloat();
+        position_.z_ = reader.ReadFloat();
+    }
+    if (hasRotation)
+        rotation_ = reader.ReadQuantizedQuaternion(CONTROLS_ROTATION_BITS);
+    reader.Align();
     newControls.extraData_ = msg.ReadVariantMap();
     
     SetControls(newControls);
-    // Client may or may not send observer position & rotation for interest management
-    if (!msg.IsEof())
-        position_ = msg.ReadVector3();
-    if (!msg.IsEof())
-        rotation_ = msg.ReadPackedQuaternion();
+}
+
+void Connection::ProcessSnapshotAck(int msgID, MemoryBuffer& msg)
+{
+    if (!IsClient())
+    {
+        LOGWARNING("Received unexpected SnapshotAck message from server");
+        return;
+    }
+    
+    if (!scene_)
+        return;
+    
+    // Acknowledgements from the future or for objects no longer replicated to the client are ignored
+    unsigned numNodes = msg.ReadVLE();
+    for (unsigned i = 0; i < numNodes && !msg.IsEof(); ++i)
+    {
+        unsigned nodeID = msg.ReadNetID();
+        unsigned snapshotID = msg.ReadVLE();
+        HashMap<unsigned, NodeReplicationState>::Iterator j = sceneState_.nodeStates_.Find(nodeID);
+        if (j != sceneState_.nodeStates_.End() && snapshotID <= snapshotID_ && snapshotID > j->second_.ackedSnapshotID_)
+            j->second_.ackedSnapshotID_ = snapshotID;
+    }
+    
+    unsigned numComponents = msg.ReadVLE();
+    for (unsigned i = 0; i < numComponents && !msg.IsEof(); ++i)
+    {
+        unsigned componentID = msg.ReadNetID();
+        unsigned snapshotID = msg.ReadVLE();
+        Component* component = scene_->GetComponent(componentID);
+        Node* node = component ? component->GetNode() : 0;
+        if (!node || snapshotID > snapshotID_)
+            continue;
+        HashMap<unsigned, NodeReplicationState>::Iterator j = sceneState_.nodeStates_.Find(node->GetID());
+        if (j == sceneState_.nodeStates_.End())
+            continue;
+        HashMap<unsigned, ComponentReplicationState>::Iterator k = j->second_.componentStates_.Find(componentID);
+        if (k != j->second_.componentStates_.End() && snapshotID > k->second_.ackedSnapshotID_)
+            k->second_.ackedSnapshotID_ = snapshotID;
+    }
 }
 
 void Connection::ProcessSceneLoaded(int msgID, MemoryBuffer& msg)
@@ -1043,6 +1201,9 @@ void Connection::ProcessNode(unsigned nodeID)
             // would be enough. However, this may be better due to the client not possibly having updated parenting
             // information at the time of receiving this message
             SendMessage(MSG_REMOVENODE, true, true, msg_);
+            
+            // Releasing the weak references is not thread-safe, as other connections refer to the same objects
+            MutexLock lock(scene_->GetReplicationMutex());
             sceneState_.nodeStates_.Erase(nodeID);
         }
         else
@@ -1052,11 +1213,17 @@ void Connection::ProcessNode(unsigned nodeID)
     {
         // Replication state not found: this is a new node
         Node* node = scene_->GetNode(nodeID);
-        if (node)
+        bool limited = false;
+        if (node && (!relevanceGrid_ || IsRelevant(node, false, limited)))
+        {
             ProcessNewNode(node);
+            if (limited)
+                sceneState_.relevanceNodes_.Insert(nodeID);
+        }
         else
         {
-            // Did not find the new node (may have been created, then removed immediately): erase from dirty set.
+            // Did not find the new node (may have been created, then removed immediately), or it is not relevant to this
+            // connection: erase from dirty set. A node coming into relevance is added back by ProcessRelevance()
             sceneState_.dirtyNodes_.Erase(nodeID);
         }
     }
@@ -1076,11 +1243,17 @@ void Connection::ProcessNewNode(Node* node)
     msg_.Clear();
     msg_.WriteNetID(node->GetID());
     
+    // Registering the replication states modifies the node and components, which other connections may be doing at
+    // the same time in worker threads
+    Mutex& replicationMutex = scene_->GetReplicationMutex();
     NodeReplicationState& nodeState = sceneState_.nodeStates_[node->GetID()];
-    nodeState.connection_ = this;
-    nodeState.sceneState_ = &sceneState_;
-    nodeState.node_ = node;
-    node->AddReplicationState(&nodeState);
+    {
+        MutexLock lock(replicationMutex);
+        nodeState.connection_ = this;
+        nodeState.sceneState_ = &sceneState_;
+        nodeState.node_ = node;
+        node->AddReplicationState(&nodeState);
+    }
     
     // Write node's attributes
     node->WriteInitialDeltaUpdate(msg_);
@@ -1105,10 +1278,13 @@ void Connection::ProcessNewNode(Node* node)
             continue;
         
         ComponentReplicationState& componentState = nodeState.componentStates_[component->GetID()];
-        componentState.connection_ = this;
-        componentState.nodeState_ = &nodeState;
-        componentState.component_ = component;
-        component->AddReplicationState(&componentState);
+        {
+            MutexLock lock(replicationMutex);
+            componentState.connection_ = this;
+            componentState.nodeState_ = &nodeState;
+            componentState.component_ = component;
+            component->AddReplicationState(&componentState);
+        }
         
         msg_.WriteStringHash(component->GetType());
         msg_.WriteNetID(component->GetID());
@@ -1142,8 +1318,8 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
             return;
     }
     
-    // Check if attributes have changed
-    if (nodeState.dirtyAttributes_.Count() || nodeState.dirtyVars_.Size())
+    // Check if attributes have changed, or there are changes the client has not acknowledged
+    if (nodeState.dirtyAttributes_.Count() || nodeState.dirtyVars_.Size() || nodeState.unackedSnapshots_.Size())
     {
         const Vector<AttributeInfo>* attributes = node->GetNetworkAttributes();
         unsigned numAttributes = attributes->Size();
@@ -1168,11 +1344,26 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
             SendMessage(MSG_NODELATESTDATA, true, false, msg_, node->GetID());
         }
         
+        // Send snapshot update unreliably if snapshot updates are enabled. User variables still go to the delta update
+        UpdateSnapshotBits(nodeState.unackedSnapshots_, nodeState.ackedSnapshotID_, nodeState.dirtyAttributes_);
+        if (snapshotUpdates_ && nodeState.dirtyAttributes_.Count())
+        {
+            msg_.Clear();
+            msg_.WriteNetID(node->GetID());
+            msg_.WriteVLE(snapshotID_);
+            node->WriteDeltaUpdate(msg_, nodeState.dirtyAttributes_);
+            
+            SendMessage(MSG_NODESNAPSHOTUPDATE, false, false, msg_, node->GetID());
+            
+            nodeState.dirtyAttributes_.ClearAll();
+        }
+        
         // Send deltaupdate if remaining dirty bits, or vars have changed
         if (nodeState.dirtyAttributes_.Count() || nodeState.dirtyVars_.Size())
         {
             msg_.Clear();
             msg_.WriteNetID(node->GetID());
+            msg_.WriteVLE(GetDeltaUpdateSnapshotID());
             node->WriteDeltaUpdate(msg_, nodeState.dirtyAttributes_);
             
             // Write changed variables
@@ -1202,6 +1393,8 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
         }
     }
     
+    bool unacked = nodeState.unackedSnapshots_.Size() > 0;
+    
     // Check for removed or changed components
     for (HashMap<unsigned, ComponentReplicationState>::Iterator i = nodeState.componentStates_.Begin();
         i != nodeState.componentStates_.End(); )
@@ -1216,12 +1409,14 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
             msg_.WriteNetID(current->first_);
             
             SendMessage(MSG_REMOVECOMPONENT, true, true, msg_);
+            
+            MutexLock lock(scene_->GetReplicationMutex());
             nodeState.componentStates_.Erase(current);
         }
         else
         {
-            // Existing component. Check if attributes have changed
-            if (componentState.dirtyAttributes_.Count())
+            // Existing component. Check if attributes have changed, or there are changes the client has not acknowledged
+            if (componentState.dirtyAttributes_.Count() || componentState.unackedSnapshots_.Size())
             {
                 const Vector<AttributeInfo>* attributes = component->GetNetworkAttributes();
                 unsigned numAttributes = attributes->Size();
@@ -1246,17 +1441,32 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                     SendMessage(MSG_COMPONENTLATESTDATA, true, false, msg_, component->GetID());
                 }
                 
-                // Send deltaupdate if remaining dirty bits
+                // Send snapshot update unreliably, or deltaupdate if remaining dirty bits
+                UpdateSnapshotBits(componentState.unackedSnapshots_, componentState.ackedSnapshotID_, componentState.dirtyAttributes_);
                 if (componentState.dirtyAttributes_.Count())
                 {
                     msg_.Clear();
                     msg_.WriteNetID(component->GetID());
-                    component->WriteDeltaUpdate(msg_, componentState.dirtyAttributes_);
-                    
-                    SendMessage(MSG_COMPONENTDELTAUPDATE, true, true, msg_);
+                    if (snapshotUpdates_)
+                    {
+                        msg_.WriteVLE(snapshotID_);
+                        component->WriteDeltaUpdate(msg_, componentState.dirtyAttributes_);
+                        
+                        SendMessage(MSG_COMPONENTSNAPSHOTUPDATE, false, false, msg_, component->GetID());
+                    }
+                    else
+                    {
+                        msg_.WriteVLE(GetDeltaUpdateSnapshotID());
+                        component->WriteDeltaUpdate(msg_, componentState.dirtyAttributes_);
+                        
+                        SendMessage(MSG_COMPONENTDELTAUPDATE, true, true, msg_);
+                    }
                     
                     componentState.dirtyAttributes_.ClearAll();
                 }
+                
+                if (componentState.unackedSnapshots_.Size())
+                    unacked = true;
             }
         }
     }
@@ -1277,10 +1487,13 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
             {
                 // New component
                 ComponentReplicationState& componentState = nodeState.componentStates_[component->GetID()];
-                componentState.connection_ = this;
-                componentState.nodeState_ = &nodeState;
-                componentState.component_ = component;
-                component->AddReplicationState(&componentState);
+                {
+                    MutexLock lock(scene_->GetReplicationMutex());
+                    componentState.connection_ = this;
+                    componentState.nodeState_ = &nodeState;
+                    componentState.component_ = component;
+                    component->AddReplicationState(&componentState);
+                }
                 
                 msg_.Clear();
                 msg_.WriteNetID(node->GetID());
@@ -1293,8 +1506,238 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
         }
     }
     
-    nodeState.markedDirty_ = false;
-    sceneState_.dirtyNodes_.Erase(node->GetID());
+    // Keep sending the snapshot updates until the client acknowledges them
+    if (!unacked)
+    {
+        nodeState.markedDirty_ = false;
+        sceneState_.dirtyNodes_.Erase(node->GetID());
+    }
+}
+
+void Connection::ProcessRelevance()
+{
+    // Check the replicated nodes whose relevance depends on distance. Collect the nodes to remove first, as removing
+    // modifies the set
+    PODVector<Node*> leavingNodes;
+    PODVector<unsigned> unlimitedNodeIDs;
+    for (HashSet<unsigned>::ConstIterator i = sceneState_.relevanceNodes_.Begin(); i != sceneState_.relevanceNodes_.End(); ++i)
+    {
+        HashMap<unsigned, NodeReplicationState>::ConstIterator j = sceneState_.nodeStates_.Find(*i);
+        Node* node = j != sceneState_.nodeStates_.End() ? j->second_.node_.Get() : (Node*)0;
+        bool limited = false;
+        // A removed node is handled by ProcessNode()
+        if (!node)
+            unlimitedNodeIDs.Push(*i);
+        else if (!IsRelevant(node, true, limited))
+            leavingNodes.Push(node);
+        else if (!limited)
+            unlimitedNodeIDs.Push(*i);
+    }
+    
+    for (unsigned i = 0; i < unlimitedNodeIDs.Size(); ++i)
+        sceneState_.relevanceNodes_.Erase(unlimitedNodeIDs[i]);
+    for (unsigned i = 0; i < leavingNodes.Size(); ++i)
+    {
+        // May have already been removed along with a parent node
+        if (sceneState_.nodeStates_.Contains(leavingNodes[i]->GetID()))
+            RemoveIrrelevantNode(leavingNodes[i]);
+    }
+    
+    // Find the nodes that have come into relevance. Add them and their child nodes to the dirty set to be created on the client
+    PODVector<Node*> nearNodes;
+    PODVector<Node*> children;
+    relevanceGrid_->GetNodes(nearNodes, position_);
+    for (unsigned i = 0; i < nearNodes.Size(); ++i)
+    {
+        Node* node = nearNodes[i];
+        unsigned nodeID = node->GetID();
+        bool limited = false;
+        if (sceneState_.nodeStates_.Contains(nodeID) || !IsRelevant(node, false, limited))
+            continue;
+        
+        // The node may also be local, in which case only its replicated children are sent
+        if (nodeID < FIRST_LOCAL_ID)
+            sceneState_.dirtyNodes_.Insert(nodeID);
+        
+        children.Clear();
+        node->GetChildren(children, true);
+        for (unsigned j = 0; j < children.Size(); ++j)
+        {
+            unsigned childID = children[j]->GetID();
+            if (childID < FIRST_LOCAL_ID && !sceneState_.nodeStates_.Contains(childID))
+                sceneState_.dirtyNodes_.Insert(childID);
+        }
+    }
+}
+
+void Connection::RemoveIrrelevantNode(Node* node)
+{
+    unsigned nodeID = node->GetID();
+    msg_.Clear();
+    msg_.WriteNetID(nodeID);
+    SendMessage(MSG_REMOVENODE, true, true, msg_);
+    
+    // The client removes the child nodes along with the node, so forget their replication states too
+    PODVector<Node*> children;
+    node->GetChildren(children, true);
+    RemoveNodeState(nodeID);
+    for (unsigned i = 0; i < children.Size(); ++i)
+    {
+        unsigned childID = children[i]->GetID();
+        if (childID < FIRST_LOCAL_ID)
+            RemoveNodeState(childID);
+    }
+}
+
+void Connection::RemoveNodeState(unsigned nodeID)
+{
+    HashMap<unsigned, NodeReplicationState>::Iterator i = sceneState_.nodeStates_.Find(nodeID);
+    if (i == sceneState_.nodeStates_.End())
+        return;
+    
+    {
+        // The node and its components stay in the scene, so they must stop tracking the replication states. Other
+        // connections may be modifying them at the same time
+        MutexLock lock(scene_->GetReplicationMutex());
+        NodeReplicationState& nodeState = i->second_;
+        Node* node = nodeState.node_;
+        if (node)
+            node->RemoveReplicationState(&nodeState);
+        for (HashMap<unsigned, ComponentReplicationState>::Iterator j = nodeState.componentStates_.Begin();
+            j != nodeState.componentStates_.End(); ++j)
+        {
+            Component* component = j->second_.component_;
+            if (component)
+                component->RemoveReplicationState(&j->second_);
+        }
+        
+        sceneState_.nodeStates_.Erase(i);
+    }
+    
+    sceneState_.dirtyNodes_.Erase(nodeID);
+    sceneState_.relevanceNodes_.Erase(nodeID);
+    nodesToProcess_.Erase(nodeID);
+}
+
+bool Connection::IsRelevant(Node* node, bool replicated, bool& limited) const
+{
+    // A node can not be created on the client without its parent, so it is relevant only if its parent nodes are
+    while (node && node != scene_)
+    {
+        // The owner connection always receives its nodes
+        if (node->GetOwner() == this)
+            return true;
+        
+        NetworkPriority* priority = node->GetComponent<NetworkPriority>();
+        if (priority && priority->GetRelevanceDistance() > 0.0f)
+        {
+            limited = true;
+            float distance = (node->GetWorldPosition() - position_).Length();
+            if (!priority->CheckRelevance(distance, replicated))
+                return false;
+        }
+        
+        node = node->GetParent();
+    }
+    
+    return true;
+}
+
+void Connection::UpdateSnapshotBits(Vector<UnackedSnapshot>& snapshots, unsigned ackedSnapshotID, DirtyBits& attributeBits)
+{
+    if (!snapshotUpdates_)
+    {
+        // Snapshot updates have been disabled: resend the unacknowledged changes reliably
+        for (unsigned i = 0; i < snapshots.Size(); ++i)
+            attributeBits |= snapshots[i].attributeBits_;
+        snapshots.Clear();
+        return;
+    }
+    
+    // Forget the changes the client has acknowledged
+    unsigned numAcked = 0;
+    while (numAcked < snapshots.Size() && snapshots[numAcked].snapshotID_ <= ackedSnapshotID)
+        ++numAcked;
+    if (numAcked)
+        snapshots.Erase(0, numAcked);
+    
+    // Record the new changes. If the client has not acknowledged for a long time, merge them to the newest snapshot
+    if (attributeBits.Count())
+    {
+        if (snapshots.Size() >= MAX_UNACKED_SNAPSHOTS)
+        {
+            UnackedSnapshot& newest = snapshots.Back();
+            newest.snapshotID_ = snapshotID_;
+            newest.attributeBits_ |= attributeBits;
+        }
+        else
+        {
+            UnackedSnapshot snapshot;
+            snapshot.snapshotID_ = snapshotID_;
+            snapshot.attributeBits_ = attributeBits;
+            snapshots.Push(snapshot);
+        }
+    }
+    
+    // Send all the changes since the last acknowledged snapshot. The update is then valid regardless of which of
+    // the unacknowledged updates the client has received
+    for (unsigned i = 0; i < snapshots.Size(); ++i)
+        attributeBits |= snapshots[i].attributeBits_;
+}
+
+bool Connection::CheckSnapshotUpdate(HashMap<unsigned, unsigned>& appliedSnapshots, PODVector<Pair<unsigned, unsigned> >& acks,
+    unsigned id, unsigned snapshotID)
+{
+    HashMap<unsigned, unsigned>::Iterator i = appliedSnapshots.Find(id);
+    if (i != appliedSnapshots.End() && i->second_ >= snapshotID)
+        return false;
+    
+    appliedSnapshots[id] = snapshotID;
+    acks.Push(MakePair(id, snapshotID));
+    return true;
+}
+
+void Connection::SkipOlderSnapshots(HashMap<unsigned, unsigned>& appliedSnapshots, unsigned id, unsigned snapshotID)
+{
+    // Snapshot IDs begin from 1, so there is nothing to skip before the second snapshot
+    if (snapshotID <= 1)
+        return;
+    
+    unsigned& appliedSnapshotID = appliedSnapshots[id];
+    if (appliedSnapshotID < snapshotID - 1)
+        appliedSnapshotID = snapshotID - 1;
+}
+
+void Connection::SendSnapshotAcks()
+{
+    // Acknowledge each applied update of a node or component separately, so that a lost or superseded update of one object
+    // does not hold back the others. Acknowledgements may be lost too, in which case the server keeps sending the changes
+    // until a later update is acknowledged
+    unsigned nodeIndex = 0;
+    unsigned componentIndex = 0;
+    while (nodeIndex < nodeSnapshotAcks_.Size() || componentIndex < componentSnapshotAcks_.Size())
+    {
+        unsigned numNodes = Min((int)(nodeSnapshotAcks_.Size() - nodeIndex), (int)MAX_SNAPSHOT_ACKS);
+        unsigned numComponents = Min((int)(componentSnapshotAcks_.Size() - componentIndex), (int)(MAX_SNAPSHOT_ACKS - numNodes));
+        
+        msg_.Clear();
+        msg_.WriteVLE(numNodes);
+        for (unsigned i = 0; i < numNodes; ++i, ++nodeIndex)
+        {
+            msg_.WriteNetID(nodeSnapshotAcks_[nodeIndex].first_);
+            msg_.WriteVLE(nodeSnapshotAcks_[nodeIndex].second_);
+        }
+        msg_.WriteVLE(numComponents);
+        for (unsigned i = 0; i < numComponents; ++i, ++componentIndex)
+        {
+            msg_.WriteNetID(componentSnapshotAcks_[componentIndex].first_);
+            msg_.WriteVLE(componentSnapshotAcks_[componentIndex].second_);
+        }
+        SendMessage(MSG_SNAPSHOTACK, false, false, msg_);
+    }
+    
+    nodeSnapshotAcks_.Clear();
+    componentSnapshotAcks_.Clear();
 }
 
 bool Connection::RequestNeededPackages(unsigned numPackages, MemoryBuffer& msg)
@@ -45,6 +45,7 @@ class Node;
 class Scene;
 class Serializable;
 class PackageFile;
+class RelevanceGrid;
 
 /// Queued remote event.
 struct RemoteEvent
@@ -93,6 +94,23 @@ struct PackageUpload
     unsigned totalFragments_;
 };
 
+/// Message buffered for sending after a threaded server update.
+struct BatchedMessage
+{
+    /// Message ID.
+    int msgID_;
+    /// Content ID.
+    unsigned contentID_;
+    /// Offset of the message data in the batch buffer.
+    unsigned offset_;
+    /// Message data size.
+    unsigned size_;
+    /// Reliable flag.
+    bool reliable_;
+    /// In order flag.
+    bool inOrder_;
+};
+
 /// Send modes for observer position/rotation. Activated by the client setting either position or rotation.
 enum ObserverPositionSendMode
 {
@@ -136,12 +154,14 @@ public:
     void SetLogStatistics(bool enable);
     /// Disconnect. If wait time is non-zero, will block while waiting for disconnect to finish.
     void Disconnect(int waitMSec = 0);
-    /// Send scene update messages. Called by Network.
+    /// Send scene update messages. Called by Network, possibly in a worker thread.
     void SendServerUpdate();
     /// Send latest controls from the client. Called by Network.
     void SendClientUpdate();
-    /// Send queued remote events. Called by Network.
+    /// Send queued remote events. Called by Network, possibly in a worker thread.
     void SendRemoteEvents();
+    /// Set whether to buffer sent messages instead of queuing them to kNet. Disabling queues the buffered messages. Called by Network.
+    void SetBatchMessages(bool enable);
     /// Send package files to client. Called by network.
     void SendPackages();
     /// Process pending latest data for nodes and components.
@@ -206,6 +226,8 @@ private:
     void ProcessIdentity(int msgID, MemoryBuffer& msg);
     /// Process a Controls message from the client. Called by Network.
     void ProcessControls(int msgID, MemoryBuffer& msg);
+    /// Process a SnapshotAck message from the client. Called by Network.
+    void ProcessSnapshotAck(int msgID, MemoryBuffer& msg);
     /// Process a SceneLoaded message from the client. Called by Network.
     void ProcessSceneLoaded(int msgID, MemoryBuffer& msg);
     /// Process a remote event message from the client or server. Called by Network.
@@ -216,6 +238,24 @@ private:
     void ProcessNewNode(Node* node);
     /// Process a node that the client has already received.
     void ProcessExistingNode(Node* node, NodeReplicationState& nodeState);
+    /// Add the nodes that have come into relevance to the dirty set, and remove the nodes that have gone out of relevance from the client.
+    void ProcessRelevance();
+    /// Remove a node that has gone out of relevance from the client, along with its child nodes.
+    void RemoveIrrelevantNode(Node* node);
+    /// Forget the replication state of a node without notifying the client.
+    void RemoveNodeState(unsigned nodeID);
+    /// Check whether a node and its parent nodes are within their relevance distance. Also return whether the relevance depends on distance.
+    bool IsRelevant(Node* node, bool replicated, bool& limited) const;
+    /// Record attribute changes in the current snapshot and replace the bits with all the changes that the client has not acknowledged. If snapshot updates are disabled, return the unacknowledged changes for a reliable delta update.
+    void UpdateSnapshotBits(Vector<UnackedSnapshot>& snapshots, unsigned ackedSnapshotID, DirtyBits& attributeBits);
+    /// Check whether a snapshot update of a node or component is newer than the one applied on the client. If it is, record it for acknowledgement.
+    bool CheckSnapshotUpdate(HashMap<unsigned, unsigned>& appliedSnapshots, PODVector<Pair<unsigned, unsigned> >& acks, unsigned id, unsigned snapshotID);
+    /// Skip the snapshot updates of a node or component older than a snapshot ID on the client, as a reliable delta update has superseded them.
+    void SkipOlderSnapshots(HashMap<unsigned, unsigned>& appliedSnapshots, unsigned id, unsigned snapshotID);
+    /// Return the oldest snapshot ID that a reliable delta update sent now does not supersede. While snapshot updates are enabled, delta updates carry no snapshot attributes and supersede nothing.
+    unsigned GetDeltaUpdateSnapshotID() const { return snapshotUpdates_ ? 0 : snapshotID_ + 1; }
+    /// Send the acknowledgements of the applied snapshot updates from the client.
+    void SendSnapshotAcks();
     /// Process a SyncPackagesInfo message from server.
     void ProcessPackageInfo(int msgID, MemoryBuffer& msg);
     /// Check a package list received from server and initiate package downloads as necessary. Return true on success, or false if failed to initialze downloads (cache dir not set)
@@ -237,6 +277,8 @@ private:
     WeakPtr<Scene> scene_;
     /// Network replication state of the scene.
     SceneReplicationState sceneState_;
+    /// Relevance grid of the scene during a server update. Null if the scene has no nodes with limited relevance.
+    const RelevanceGrid* relevanceGrid_;
     /// Waiting or ongoing package file receive transfers.
     HashMap<StringHash, PackageDownload> downloads_;
     /// Ongoing package send transfers.
@@ -249,8 +291,20 @@ private:
     HashSet<unsigned> nodesToProcess_;
     /// Reusable message buffer.
     VectorBuffer msg_;
+    /// Messages buffered during a threaded server update.
+    PODVector<BatchedMessage> batchedMessages_;
+    /// Data of the buffered messages.
+    VectorBuffer batchedData_;
     /// Queued remote events.
     Vector<RemoteEvent> remoteEvents_;
+    /// Newest snapshot update applied to each node on the client.
+    HashMap<unsigned, unsigned> appliedNodeSnapshots_;
+    /// Newest snapshot update applied to each component on the client.
+    HashMap<unsigned, unsigned> appliedComponentSnapshots_;
+    /// Node IDs and snapshot IDs to acknowledge from the client.
+    PODVector<Pair<unsigned, unsigned> > nodeSnapshotAcks_;
+    /// Component IDs and snapshot IDs to acknowledge from the client.
+    PODVector<Pair<unsigned, unsigned> > componentSnapshotAcks_;
     /// Scene file to load once all packages (if any) have been downloaded.
     String sceneFileName_;
     /// Statistics timer.
@@ -265,6 +319,8 @@ private:
     Quaternion rotation_;
     /// Send mode for the observer position & rotation.
     ObserverPositionSendMode sendMode_;
+    /// Current snapshot ID on the server.
+    unsigned snapshotID_;
     /// Client connection flag.
     bool isClient_;
     /// Connection pending flag.
@@ -273,6 +329,10 @@ private:
     bool sceneLoaded_;
     /// Show statistics flag.
     bool logStatistics_;
+    /// Buffer sent messages flag.
+    bool batchMessages_;
+    /// Send attribute updates as unreliable snapshot deltas during the current server update flag.
+    bool snapshotUpdates_;
 };
 
 }
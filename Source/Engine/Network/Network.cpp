@@ -30,12 +30,15 @@
 #include "IOEvents.h"
 #include "Log.h"
 #include "MemoryBuffer.h"
+#include "MemoryTracker.h"
 #include "Network.h"
 #include "NetworkEvents.h"
 #include "NetworkPriority.h"
 #include "Profiler.h"
 #include "Protocol.h"
+#include "RelevanceGrid.h"
 #include "Scene.h"
+#include "WorkQueue.h"
 
 #include <kNet.h>
 
@@ -46,11 +49,35 @@ namespace Urho3D
 
 static const int DEFAULT_UPDATE_FPS = 30;
 
+/// Threaded server update task for client connections.
+struct SendServerUpdateTask
+{
+    /// Construct.
+    SendServerUpdateTask(const PODVector<Connection*>& connections) :
+        connections_(connections)
+    {
+    }
+    
+    /// Write the scene updates and remote events of a range of connections.
+    void operator () (unsigned start, unsigned end, unsigned threadIndex)
+    {
+        for (unsigned i = start; i < end; ++i)
+        {
+            connections_[i]->SendServerUpdate();
+            connections_[i]->SendRemoteEvents();
+        }
+    }
+    
+    /// Client connections.
+    const PODVector<Connection*>& connections_;
+};
+
 Network::Network(Context* context) :
     Object(context),
     updateFps_(DEFAULT_UPDATE_FPS),
     updateInterval_(1.0f / (float)DEFAULT_UPDATE_FPS),
-    updateAcc_(0.0f)
+    updateAcc_(0.0f),
+    snapshotUpdates_(false)
 {
     network_ = new kNet::Network();
     
@@ -149,6 +176,8 @@ u32 Network::ComputeContentID(kNet::message_id_t msgId, const char* data, size_t
         
     case MSG_NODELATESTDATA:
     case MSG_COMPONENTLATESTDATA:
+    case MSG_NODESNAPSHOTUPDATE:
+    case MSG_COMPONENTSNAPSHOTUPDATE:
         {
             // Return the node or component ID, which is first in the message
             MemoryBuffer msg(data, numBytes);
@@ -335,6 +364,11 @@ void Network::SetUpdateFps(int fps)
     updateAcc_ = 0.0f;
 }
 
+void Network::SetSnapshotUpdates(bool enable)
+{
+    snapshotUpdates_ = enable;
+}
+
 void Network::RegisterRemoteEvent(StringHash eventType)
 {
     if (blacklistedRemoteEvents_.Find(eventType) != blacklistedRemoteEvents_.End())
@@ -433,6 +467,7 @@ bool Network::CheckRemoteEvent(StringHash eventType) const
 void Network::Update(float timeStep)
 {
     PROFILE(UpdateNetwork);
+    MEMORY_CATEGORY(MEMCAT_NETWORK);
     
     // Process server connection if it exists
     if (serverConnection_)
@@ -464,6 +499,7 @@ void Network::Update(float timeStep)
 void Network::PostUpdate(float timeStep)
 {
     PROFILE(PostUpdateNetwork);
+    MEMORY_CATEGORY(MEMCAT_NETWORK);
     
     // Check if periodic update should happen now
     updateAcc_ += timeStep;
@@ -491,19 +527,45 @@ void Network::PostUpdate(float timeStep)
                 }
                 
                 for (HashSet<Scene*>::ConstIterator i = networkScenes_.Begin(); i != networkScenes_.End(); ++i)
+                {
                     (*i)->PrepareNetworkUpdate();
+                    PrepareRelevance(*i);
+                }
+                
+                // Remove the relevance grids of scenes no longer in use
+                for (HashMap<Scene*, RelevanceGrid>::Iterator i = relevanceGrids_.Begin(); i != relevanceGrids_.End();)
+                {
+                    if (!networkScenes_.Contains(i->first_))
+                        i = relevanceGrids_.Erase(i);
+                    else
+                        ++i;
+                }
             }
             
             {
                 PROFILE(SendServerUpdate);
                 
-                // Then send server updates for each client connection
+                // Then send server updates for each client connection. The connections are processed in worker threads, with
+                // the scene being read-only, and their messages are queued to kNet afterward in the main thread
+                PODVector<Connection*> connections;
                 for (HashMap<kNet::MessageConnection*, SharedPtr<Connection> >::Iterator i = clientConnections_.Begin();
                     i != clientConnections_.End(); ++i)
                 {
-                    i->second_->SendServerUpdate();
-                    i->second_->SendRemoteEvents();
-                    i->second_->SendPackages();
+                    i->second_->SetBatchMessages(true);
+                    connections.Push(i->second_);
+                }
+                
+                SendServerUpdateTask task(connections);
+                WorkQueue* queue = GetSubsystem<WorkQueue>();
+                if (queue)
+                    queue->ParallelFor(0, connections.Size(), 1, task);
+                else
+                    task(0, connections.Size(), 0);
+                
+                for (unsigned i = 0; i < connections.Size(); ++i)
+                {
+                    connections[i]->SetBatchMessages(false);
+                    connections[i]->SendPackages();
                 }
             }
         }
@@ -566,6 +628,36 @@ void Network::OnServerDisconnected()
     }
 }
 
+const RelevanceGrid* Network::GetRelevanceGrid(Scene* scene) const
+{
+    HashMap<Scene*, RelevanceGrid>::ConstIterator i = relevanceGrids_.Find(scene);
+    return (i != relevanceGrids_.End() && i->second_.GetNumNodes()) ? &i->second_ : 0;
+}
+
+void Network::PrepareRelevance(Scene* scene)
+{
+    RelevanceGrid& grid = relevanceGrids_[scene];
+    grid.Clear();
+    
+    // Update the world positions used by interest management now, as the scene is read-only during the threaded update.
+    // Also index the nodes with limited relevance distance
+    const HashSet<Component*>& priorities = scene->GetNetworkPriorities();
+    for (HashSet<Component*>::ConstIterator i = priorities.Begin(); i != priorities.End(); ++i)
+    {
+        NetworkPriority* priority = static_cast<NetworkPriority*>(*i);
+        Node* node = priority->GetNode();
+        if (!node)
+            continue;
+        
+        Vector3 position = node->GetWorldPosition();
+        float distance = priority->GetRelevanceDistance();
+        if (distance > 0.0f)
+            grid.AddNode(node, position, distance);
+    }
+    
+    grid.Build();
+}
+
 void RegisterNetworkLibrary(Context* context)
 {
     NetworkPriority::RegisterObject(context);
@@ -25,6 +25,7 @@
 #include "Connection.h"
 #include "HashSet.h"
 #include "Object.h"
+#include "RelevanceGrid.h"
 #include "VectorBuffer.h"
 
 #include <kNet/IMessageHandler.h>
@@ -83,6 +84,8 @@ public:
     void BroadcastRemoteEvent(Node* node, StringHash eventType, bool inOrder, const VariantMap& eventData = Variant::emptyVariantMap);
     /// Set network update FPS.
     void SetUpdateFps(int fps);
+    /// Set whether to send attribute updates of existing nodes and components unreliably, as deltas against the last update each client has acknowledged for the object, instead of reliable and ordered delta updates. Avoids stalling the update stream on packet loss.
+    void SetSnapshotUpdates(bool enable);
     /// Register a remote event as allowed to be received. There is also a fixed blacklist of events that can not be allowed in any case, such as ConsoleCommand.
     void RegisterRemoteEvent(StringHash eventType);
     /// Unregister a remote event as allowed to received.
@@ -98,6 +101,8 @@ public:
 
     /// Return network update FPS.
     int GetUpdateFps() const { return updateFps_; }
+    /// Return whether attribute updates are sent as unreliable snapshot deltas.
+    bool GetSnapshotUpdates() const { return snapshotUpdates_; }
     /// Return a client or server connection by kNet MessageConnection, or null if none exist.
     Connection* GetConnection(kNet::MessageConnection* connection) const;
     /// Return the connection to the server. Null if not connected.
@@ -110,6 +115,8 @@ public:
     bool CheckRemoteEvent(StringHash eventType) const;
     /// Return the package download cache directory.
     const String& GetPackageCacheDir() const { return packageCacheDir_; }
+    /// Return the replication relevance grid of a scene, or null if the scene has no nodes with limited relevance distance. Called by Connection.
+    const RelevanceGrid* GetRelevanceGrid(Scene* scene) const;
     
     /// Process incoming messages from connections. Called by HandleBeginFrame.
     void Update(float timeStep);
@@ -125,6 +132,8 @@ private:
     void OnServerConnected();
     /// Handle server disconnection.
     void OnServerDisconnected();
+    /// Update the world positions used by interest management and rebuild the relevance grid of a scene.
+    void PrepareRelevance(Scene* scene);
     
     /// kNet instance.
     kNet::Network* network_;
@@ -138,6 +147,8 @@ private:
     HashSet<StringHash> blacklistedRemoteEvents_;
     /// Networked scenes.
     HashSet<Scene*> networkScenes_;
+    /// Replication relevance grids of the networked scenes.
+    HashMap<Scene*, RelevanceGrid> relevanceGrids_;
     /// Update FPS.
     int updateFps_;
     /// Update time interval.
@@ -146,6 +157,8 @@ private:
     float updateAcc_;
     /// Package cache directory.
     String packageCacheDir_;
+    /// Snapshot updates flag.
+    bool snapshotUpdates_;
 };
 
 /// Register Network library objects.
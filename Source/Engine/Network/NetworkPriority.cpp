@@ -23,6 +23,7 @@
 #include "Precompiled.h"
 #include "Context.h"
 #include "NetworkPriority.h"
+#include "Scene.h"
 
 #include "DebugNew.h"
 
@@ -34,13 +35,16 @@ const char* NETWORK_CATEGORY = "Network";
 static const float DEFAULT_BASE_PRIORITY = 100.0f;
 static const float DEFAULT_DISTANCE_FACTOR = 0.0f;
 static const float DEFAULT_MIN_PRIORITY = 0.0f;
+static const float DEFAULT_RELEVANCE_DISTANCE = 0.0f;
 static const float UPDATE_THRESHOLD = 100.0f;
+static const float RELEVANCE_HYSTERESIS = 1.1f;
 
 NetworkPriority::NetworkPriority(Context* context) :
     Component(context),
     basePriority_(DEFAULT_BASE_PRIORITY),
     distanceFactor_(DEFAULT_DISTANCE_FACTOR),
     minPriority_(DEFAULT_MIN_PRIORITY),
+    relevanceDistance_(DEFAULT_RELEVANCE_DISTANCE),
     alwaysUpdateOwner_(true)
 {
 }
@@ -57,6 +61,7 @@ void NetworkPriority::RegisterObject(Context* context)
     ATTRIBUTE("Distance Factor", float, distanceFactor_, DEFAULT_DISTANCE_FACTOR, AM_DEFAULT);
     ATTRIBUTE("Minimum Priority", float, minPriority_, DEFAULT_MIN_PRIORITY, AM_DEFAULT);
     ATTRIBUTE("Always Update Owner", bool, alwaysUpdateOwner_, true, AM_DEFAULT);
+    ATTRIBUTE("Relevance Distance", float, relevanceDistance_, DEFAULT_RELEVANCE_DISTANCE, AM_DEFAULT);
 }
 
 void NetworkPriority::SetBasePriority(float priority)
@@ -83,6 +88,12 @@ void NetworkPriority::SetAlwaysUpdateOwner(bool enable)
     MarkNetworkUpdate();
 }
 
+void NetworkPriority::SetRelevanceDistance(float distance)
+{
+    relevanceDistance_ = Max(distance, 0.0f);
+    MarkNetworkUpdate();
+}
+
 bool NetworkPriority::CheckUpdate(float distance, float& accumulator)
 {
     float currentPriority = Max(basePriority_ - distanceFactor_ * distance, minPriority_);
@@ -96,4 +107,23 @@ bool NetworkPriority::CheckUpdate(float distance, float& accumulator)
         return false;
 }
 
+bool NetworkPriority::CheckRelevance(float distance, bool replicated) const
+{
+    if (relevanceDistance_ <= 0.0f)
+        return true;
+    
+    // Use a longer distance for leaving relevance than for entering, so that a node at the edge is not repeatedly
+    // created and removed
+    return distance <= (replicated ? relevanceDistance_ * RELEVANCE_HYSTERESIS : relevanceDistance_);
+}
+
+void NetworkPriority::OnSceneSet(Scene* scene)
+{
+    if (scene_)
+        scene_->RemoveNetworkPriority(this);
+    scene_ = scene;
+    if (scene_)
+        scene_->AddNetworkPriority(this);
+}
+
 }
@@ -48,6 +48,8 @@ public:
     void SetMinPriority(float priority);
     /// Set whether updates to owner should be sent always at full rate. Default true.
     void SetAlwaysUpdateOwner(bool enable);
+    /// Set relevance distance. The node and its children are only replicated to connections whose observer position is within this distance. Default 0 (always relevant.)
+    void SetRelevanceDistance(float distance);
     
     /// Return base priority.
     float GetBasePriority() const { return basePriority_; }
@@ -57,17 +59,29 @@ public:
     float GetMinPriority() const { return minPriority_; }
     /// Return whether updates to owner should be sent always at full rate.
     bool GetAlwaysUpdateOwner() const { return alwaysUpdateOwner_; }
+    /// Return relevance distance.
+    float GetRelevanceDistance() const { return relevanceDistance_; }
     
     /// Increment and check priority accumulator. Return true if should update. Called by Connection.
     bool CheckUpdate(float distance, float& accumulator);
+    /// Check whether is relevant at a distance. A node already replicated to the connection stays relevant slightly further away. Called by Connection.
+    bool CheckRelevance(float distance, bool replicated) const;
+    
+protected:
+    /// Handle being added to a scene, or removed from it when the scene is null.
+    virtual void OnSceneSet(Scene* scene);
     
 private:
+    /// Scene the component is registered to for interest management.
+    WeakPtr<Scene> scene_;
     /// Base priority.
     float basePriority_;
     /// Priority reduction distance factor.
     float distanceFactor_;
     /// Minimum priority.
     float minPriority_;
+    /// Relevance distance.
+    float relevanceDistance_;
     /// Update owner at full rate flag.
     bool alwaysUpdateOwner_;
 };
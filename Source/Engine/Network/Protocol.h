@@ -42,7 +42,7 @@ static const int MSG_LOADSCENE = 0xa;
 static const int MSG_SCENECHECKSUMERROR = 0xb;
 /// Server->client: create new node.
 static const int MSG_CREATENODE = 0xc;
-/// Server->client: node delta update.
+/// Server->client: node delta update. Includes the oldest snapshot ID it does not supersede.
 static const int MSG_NODEDELTAUPDATE = 0xd;
 /// Server->client: node latest data update.
 static const int MSG_NODELATESTDATA = 0xe;
@@ -50,7 +50,7 @@ static const int MSG_NODELATESTDATA = 0xe;
 static const int MSG_REMOVENODE = 0xf;
 /// Server->client: create new component.
 static const int MSG_CREATECOMPONENT = 0x10;
-/// Server->client: component delta update.
+/// Server->client: component delta update. Includes the oldest snapshot ID it does not supersede.
 static const int MSG_COMPONENTDELTAUPDATE = 0x11;
 /// Server->client: component latest data update.
 static const int MSG_COMPONENTLATESTDATA = 0x12;
@@ -63,10 +63,18 @@ static const int MSG_REMOTEEVENT = 0x14;
 static const int MSG_REMOTENODEEVENT = 0x15;
 /// Server->client: info about package.
 static const int MSG_PACKAGEINFO = 0x16;
+/// Server->client: node attributes changed since the client last acknowledged an update of the node. Sent unreliably.
+static const int MSG_NODESNAPSHOTUPDATE = 0x17;
+/// Server->client: component attributes changed since the client last acknowledged an update of the component. Sent unreliably.
+static const int MSG_COMPONENTSNAPSHOTUPDATE = 0x18;
+/// Client->server: newest snapshot update applied to each updated node and component. Sent unreliably.
+static const int MSG_SNAPSHOTACK = 0x19;
 
 /// Fixed content ID for client controls update.
 static const unsigned CONTROLS_CONTENT_ID = 1;
 /// Package file fragment size.
 static const unsigned PACKAGE_FRAGMENT_SIZE = 1024;
+/// Maximum number of node and component acknowledgements in one snapshot acknowledgement message.
+static const unsigned MAX_SNAPSHOT_ACKS = 100;
 
 }
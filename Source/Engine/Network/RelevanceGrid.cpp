@@ -0,0 +1,113 @@
+//
+// Copyright (c) 2008-2014 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "Precompiled.h"
+#include "RelevanceGrid.h"
+
+#include <cmath>
+
+#include "DebugNew.h"
+
+namespace Urho3D
+{
+
+RelevanceGrid::RelevanceGrid() :
+    cellSize_(1.0f)
+{
+}
+
+void RelevanceGrid::Clear()
+{
+    nodes_.Clear();
+    for (HashMap<unsigned, PODVector<unsigned> >::Iterator i = cells_.Begin(); i != cells_.End(); ++i)
+        i->second_.Clear();
+}
+
+void RelevanceGrid::AddNode(Node* node, const Vector3& position, float distance)
+{
+    RelevanceGridNode gridNode;
+    gridNode.node_ = node;
+    gridNode.position_ = position;
+    gridNode.distance_ = distance;
+    nodes_.Push(gridNode);
+}
+
+void RelevanceGrid::Build()
+{
+    // Use the longest relevance distance as the cell size, so that a query only needs to check the neighbour cells
+    float cellSize = 1.0f;
+    for (unsigned i = 0; i < nodes_.Size(); ++i)
+        cellSize = Max(cellSize, nodes_[i].distance_);
+    
+    // If the cell size changed, the old cells are not valid anymore
+    if (cellSize != cellSize_)
+    {
+        cells_.Clear();
+        cellSize_ = cellSize;
+    }
+    
+    for (unsigned i = 0; i < nodes_.Size(); ++i)
+    {
+        const Vector3& position = nodes_[i].position_;
+        cells_[GetCellKey((int)floorf(position.x_ / cellSize_), (int)floorf(position.y_ / cellSize_),
+            (int)floorf(position.z_ / cellSize_))].Push(i);
+    }
+}
+
+void RelevanceGrid::GetNodes(PODVector<Node*>& dest, const Vector3& position) const
+{
+    if (nodes_.Empty())
+        return;
+    
+    int x = (int)floorf(position.x_ / cellSize_);
+    int y = (int)floorf(position.y_ / cellSize_);
+    int z = (int)floorf(position.z_ / cellSize_);
+    
+    for (int cz = z - 1; cz <= z + 1; ++cz)
+    {
+        for (int cy = y - 1; cy <= y + 1; ++cy)
+        {
+            for (int cx = x - 1; cx <= x + 1; ++cx)
+            {
+                HashMap<unsigned, PODVector<unsigned> >::ConstIterator i = cells_.Find(GetCellKey(cx, cy, cz));
+                if (i == cells_.End())
+                    continue;
+                
+                const PODVector<unsigned>& indices = i->second_;
+                for (unsigned j = 0; j < indices.Size(); ++j)
+                {
+                    const RelevanceGridNode& gridNode = nodes_[indices[j]];
+                    if ((gridNode.position_ - position).LengthSquared() <= gridNode.distance_ * gridNode.distance_)
+                        dest.Push(gridNode.node_);
+                }
+            }
+        }
+    }
+}
+
+unsigned RelevanceGrid::GetCellKey(int x, int y, int z) const
+{
+    // Different cells may share a key, which only costs extra distance checks
+    return ((unsigned)x * 73856093) ^ ((unsigned)y * 19349663) ^ ((unsigned)z * 83492791);
+}
+
+}
@@ -0,0 +1,77 @@
+//
+// Copyright (c) 2008-2014 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "HashMap.h"
+#include "Vector3.h"
+
+namespace Urho3D
+{
+
+class Node;
+
+/// Node with a limited replication relevance distance in the relevance grid.
+struct RelevanceGridNode
+{
+    /// Node.
+    Node* node_;
+    /// World position.
+    Vector3 position_;
+    /// Relevance distance.
+    float distance_;
+};
+
+/// Spatial grid of the replicated nodes that have a limited relevance distance, for finding the nodes that come into relevance for a connection. Rebuilt on each server update.
+class URHO3D_API RelevanceGrid
+{
+public:
+    /// Construct.
+    RelevanceGrid();
+    
+    /// Remove all nodes.
+    void Clear();
+    /// Add a node.
+    void AddNode(Node* node, const Vector3& position, float distance);
+    /// Sort the added nodes into the grid cells. Call after adding all nodes.
+    void Build();
+    /// Return the nodes that are within their relevance distance of a position. May return the same node twice.
+    void GetNodes(PODVector<Node*>& dest, const Vector3& position) const;
+    
+    /// Return number of nodes.
+    unsigned GetNumNodes() const { return nodes_.Size(); }
+    /// Return cell size, which equals the longest relevance distance.
+    float GetCellSize() const { return cellSize_; }
+    
+private:
+    /// Return the hash key of a cell.
+    unsigned GetCellKey(int x, int y, int z) const;
+    
+    /// Nodes.
+    PODVector<RelevanceGridNode> nodes_;
+    /// Node indices by cell key. Cells are kept allocated between rebuilds.
+    HashMap<unsigned, PODVector<unsigned> > cells_;
+    /// Cell size.
+    float cellSize_;
+};
+
+}
@@ -27,6 +27,9 @@
 namespace Urho3D
 {
 
+class Node;
+class RigidBody;
+
 /// Physics world is about to be stepped.
 EVENT(E_PHYSICSPRESTEP, PhysicsPreStep)
 {
@@ -84,6 +87,9 @@ EVENT(E_NODECOLLISIONSTART, NodeCollisionStart)
     PARAM(P_OTHERBODY, OtherBody);          // RigidBody pointer
     PARAM(P_TRIGGER, Trigger);              // bool
     PARAM(P_CONTACTS, Contacts);            // Buffer containing position (Vector3), normal (Vector3), distance (float), impulse (float) for each contact
+    
+    EVENT_DATA5(E_NODECOLLISIONSTART, P_BODY, EventPtr<RigidBody>, body_, P_OTHERNODE, EventPtr<Node>, otherNode_, P_OTHERBODY,
+        EventPtr<RigidBody>, otherBody_, P_TRIGGER, bool, trigger_, P_CONTACTS, PODVector<unsigned char>, contacts_);
 }
 
 /// Physics collision ongoing (sent to the participating scene nodes.)
@@ -94,6 +100,9 @@ EVENT(E_NODECOLLISION, NodeCollision)
     PARAM(P_OTHERBODY, OtherBody);          // RigidBody pointer
     PARAM(P_TRIGGER, Trigger);              // bool
     PARAM(P_CONTACTS, Contacts);            // Buffer containing position (Vector3), normal (Vector3), distance (float), impulse (float) for each contact
+    
+    EVENT_DATA5(E_NODECOLLISION, P_BODY, EventPtr<RigidBody>, body_, P_OTHERNODE, EventPtr<Node>, otherNode_, P_OTHERBODY,
+        EventPtr<RigidBody>, otherBody_, P_TRIGGER, bool, trigger_, P_CONTACTS, PODVector<unsigned char>, contacts_);
 }
 
 /// Physics collision ended (sent to the participating scene nodes.)
@@ -26,6 +26,8 @@
 #include "Context.h"
 #include "DebugRenderer.h"
 #include "Log.h"
+#include "MemoryBuffer.h"
+#include "MemoryTracker.h"
 #include "Model.h"
 #include "Mutex.h"
 #include "PhysicsEvents.h"
@@ -84,6 +86,24 @@ static bool CustomMaterialCombinerCallback(btManifoldPoint& cp, const btCollisio
     return true;
 }
 
+/// Write the contact points of a manifold into a collision event contact buffer, reusing its capacity. Optionally flip the normals to point from the other body.
+static void WriteContacts(PODVector<unsigned char>& dest, btPersistentManifold* manifold, bool flipNormals)
+{
+    int numContacts = manifold->getNumContacts();
+    dest.Resize(numContacts * (2 * sizeof(Vector3) + 2 * sizeof(float)));
+    MemoryBuffer buffer(dest);
+
+    for (int i = 0; i < numContacts; ++i)
+    {
+        btManifoldPoint& point = manifold->getContactPoint(i);
+        Vector3 normal = ToVector3(point.m_normalWorldOnB);
+        buffer.WriteVector3(ToVector3(point.m_positionWorldOnB));
+        buffer.WriteVector3(flipNormals ? -normal : normal);
+        buffer.WriteFloat(point.m_distance1);
+        buffer.WriteFloat(point.m_appliedImpulse);
+    }
+}
+
 /// Callback for physics world queries.
 struct PhysicsQueryCallback : public btCollisionWorld::ContactResultCallback
 {
@@ -232,6 +252,7 @@ void PhysicsWorld::draw3dText(const btVector3& location, const char* textString)
 void PhysicsWorld::Update(float timeStep)
 {
     PROFILE(UpdatePhysics);
+    MEMORY_CATEGORY(MEMCAT_PHYSICS);
 
     float internalTimeStep = 1.0f / fps_;
     int maxSubSteps = (int)(timeStep * fps_) + 1;
@@ -761,6 +782,10 @@ void PhysicsWorld::SendCollisionEvents()
             currentCollisions_[bodyPair] = contactManifold;
         }
 
+        // Node collision payloads are reused across the collision pairs to keep the contact buffer capacity
+        NodeCollisionStart::Data startData;
+        NodeCollision::Data collisionData;
+
         for (HashMap<Pair<WeakPtr<RigidBody>, WeakPtr<RigidBody> >, btPersistentManifold*>::Iterator i = currentCollisions_.Begin();
             i != currentCollisions_.End(); ++i)
         {
@@ -785,18 +810,8 @@ void PhysicsWorld::SendCollisionEvents()
             physicsCollisionData_[PhysicsCollision::P_BODYB] = bodyB;
             physicsCollisionData_[PhysicsCollision::P_TRIGGER] = trigger;
 
-            contacts_.Clear();
-
-            for (int j = 0; j < contactManifold->getNumContacts(); ++j)
-            {
-                btManifoldPoint& point = contactManifold->getContactPoint(j);
-                contacts_.WriteVector3(ToVector3(point.m_positionWorldOnB));
-                contacts_.WriteVector3(ToVector3(point.m_normalWorldOnB));
-                contacts_.WriteFloat(point.m_distance1);
-                contacts_.WriteFloat(point.m_appliedImpulse);
-            }
-
-            physicsCollisionData_[PhysicsCollision::P_CONTACTS] = contacts_.GetBuffer();
+            WriteContacts(collisionData.contacts_, contactManifold, false);
+            physicsCollisionData_[PhysicsCollision::P_CONTACTS] = collisionData.contacts_;
 
             // Send separate collision start event if collision is new
             if (newCollision)
@@ -812,46 +827,51 @@ void PhysicsWorld::SendCollisionEvents()
             if (!nodeWeakA || !nodeWeakB || !i->first_.first_ || !i->first_.second_)
                 continue;
 
-            nodeCollisionData_[NodeCollision::P_BODY] = bodyA;
-            nodeCollisionData_[NodeCollision::P_OTHERNODE] = nodeB;
-            nodeCollisionData_[NodeCollision::P_OTHERBODY] = bodyB;
-            nodeCollisionData_[NodeCollision::P_TRIGGER] = trigger;
-            nodeCollisionData_[NodeCollision::P_CONTACTS] = contacts_.GetBuffer();
+            // Send the node collision events with typed payloads, so that handlers taking them avoid VariantMap conversion.
+            // The start payload borrows the contacts by swapping buffers instead of copying them
+            collisionData.body_ = bodyA;
+            collisionData.otherNode_ = nodeB;
+            collisionData.otherBody_ = bodyB;
+            collisionData.trigger_ = trigger;
 
             if (newCollision)
             {
-                nodeA->SendEvent(E_NODECOLLISIONSTART, nodeCollisionData_);
+                startData.body_ = bodyA;
+                startData.otherNode_ = nodeB;
+                startData.otherBody_ = bodyB;
+                startData.trigger_ = trigger;
+                startData.contacts_.Swap(collisionData.contacts_);
+                nodeA->SendEvent(E_NODECOLLISIONSTART, startData);
+                startData.contacts_.Swap(collisionData.contacts_);
                 if (!nodeWeakA || !nodeWeakB || !i->first_.first_ || !i->first_.second_)
                     continue;
             }
 
-            nodeA->SendEvent(E_NODECOLLISION, nodeCollisionData_);
+            nodeA->SendEvent(E_NODECOLLISION, collisionData);
             if (!nodeWeakA || !nodeWeakB || !i->first_.first_ || !i->first_.second_)
                 continue;
 
-            contacts_.Clear();
-            for (int j = 0; j < contactManifold->getNumContacts(); ++j)
-            {
-                btManifoldPoint& point = contactManifold->getContactPoint(j);
-                contacts_.WriteVector3(ToVector3(point.m_positionWorldOnB));
-                contacts_.WriteVector3(-ToVector3(point.m_normalWorldOnB));
-                contacts_.WriteFloat(point.m_distance1);
-                contacts_.WriteFloat(point.m_appliedImpulse);
-            }
-
-            nodeCollisionData_[NodeCollision::P_BODY] = bodyB;
-            nodeCollisionData_[NodeCollision::P_OTHERNODE] = nodeA;
-            nodeCollisionData_[NodeCollision::P_OTHERBODY] = bodyA;
-            nodeCollisionData_[NodeCollision::P_CONTACTS] = contacts_.GetBuffer();
+            // Rewrite the contacts in place with the normals flipped for node B
+            WriteContacts(collisionData.contacts_, contactManifold, true);
+            collisionData.body_ = bodyB;
+            collisionData.otherNode_ = nodeA;
+            collisionData.otherBody_ = bodyA;
+            collisionData.trigger_ = trigger;
 
             if (newCollision)
             {
-                nodeB->SendEvent(E_NODECOLLISIONSTART, nodeCollisionData_);
+                startData.body_ = bodyB;
+                startData.otherNode_ = nodeA;
+                startData.otherBody_ = bodyA;
+                startData.trigger_ = trigger;
+                startData.contacts_.Swap(collisionData.contacts_);
+                nodeB->SendEvent(E_NODECOLLISIONSTART, startData);
+                startData.contacts_.Swap(collisionData.contacts_);
                 if (!nodeWeakA || !nodeWeakB || !i->first_.first_ || !i->first_.second_)
                     continue;
             }
 
-            nodeB->SendEvent(E_NODECOLLISION, nodeCollisionData_);
+            nodeB->SendEvent(E_NODECOLLISION, collisionData);
         }
     }
 
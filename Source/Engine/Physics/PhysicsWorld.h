@@ -264,8 +264,6 @@ private:
     VariantMap physicsCollisionData_;
     /// Preallocated event data map for node collision events.
     VariantMap nodeCollisionData_;
-    /// Preallocated buffer for physics collision contact data.
-    VectorBuffer contacts_;
     /// Simulation substeps per second.
     unsigned fps_;
     /// Maximum number of simulation substeps per frame. 0 (default) unlimited, or negative values for adaptive timestep.
@@ -22,95 +22,194 @@
 
 #include "Precompiled.h"
 #include "BackgroundLoader.h"
+#include "Condition.h"
 #include "Context.h"
 #include "Log.h"
+#include "ProcessUtils.h"
 #include "Profiler.h"
 #include "ResourceCache.h"
 #include "ResourceEvents.h"
-#include "Timer.h"
+#include "Thread.h"
 
 #include "DebugNew.h"
 
 namespace Urho3D
 {
 
+/// Resource loader thread managed by the background loader.
+class BackgroundLoaderThread : public Thread, public RefCounted
+{
+public:
+    /// Construct.
+    BackgroundLoaderThread(BackgroundLoader* owner) :
+        owner_(owner)
+    {
+    }
+    
+    /// Load queued resources until stopped. Wait to be woken up when there is nothing to load.
+    virtual void ThreadFunction()
+    {
+        while (shouldRun_)
+        {
+            if (!owner_->LoadNextResource(this))
+                wakeup_.Wait();
+        }
+    }
+    
+    /// Wake up the thread to load a queued resource.
+    void Wake() { wakeup_.Set(); }
+    
+    /// Stop the thread, waking it up if it is waiting, and wait for it to finish.
+    void StopLoading()
+    {
+        shouldRun_ = false;
+        wakeup_.Set();
+        Stop();
+    }
+    
+private:
+    /// Background loader.
+    BackgroundLoader* owner_;
+    /// Condition set when a resource is queued or the thread should stop.
+    Condition wakeup_;
+};
+
+/// Return whether a waiting item should be loaded before another.
+static inline bool LoadsBefore(const BackgroundLoadItem* lhs, const BackgroundLoadItem* rhs)
+{
+    if (lhs->priority_ != rhs->priority_)
+        return lhs->priority_ > rhs->priority_;
+    else
+        return lhs->sequence_ < rhs->sequence_;
+}
+
 BackgroundLoader::BackgroundLoader(ResourceCache* owner) :
-    owner_(owner)
+    owner_(owner),
+    numThreads_(Max((int)GetNumPhysicalCPUs() - 1, 1)),
+    nextSequence_(0)
+{
+}
+
+BackgroundLoader::~BackgroundLoader()
 {
+    // Stop the threads before the queue is destroyed. A thread finishes the resource it is loading first
+    for (unsigned i = 0; i < threads_.Size(); ++i)
+        threads_[i]->StopLoading();
+    threads_.Clear();
 }
 
-void BackgroundLoader::ThreadFunction()
+void BackgroundLoader::SetNumThreads(unsigned num)
 {
-    while (shouldRun_)
+    MutexLock lock(backgroundLoadMutex_);
+    
+    numThreads_ = Max((int)num, 1);
+    // If already loading, start or stop threads now. Otherwise they will be started on the first request
+    if (threads_.Size())
+        UpdateThreads();
+}
+
+bool BackgroundLoader::LoadNextResource(BackgroundLoaderThread* thread)
+{
+    backgroundLoadMutex_.Acquire();
+    
+    if (waitingItems_.Empty())
     {
-        backgroundLoadMutex_.Acquire();
-        
-        // Search for a queued resource that has not been loaded yet
-        HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Begin();
-        while (i != backgroundLoadQueue_.End())
-        {
-            if (i->second_.resource_->GetAsyncLoadState() == ASYNC_QUEUED)
-                break;
-            else
-                ++i;
-        }
+        // The next queued resource wakes up the thread
+        idleThreads_.Push(thread);
+        backgroundLoadMutex_.Release();
+        return false;
+    }
+    
+    // Take the highest priority item. Among equal priorities take the one queued first
+    BackgroundLoadItem& item = *PopWaitingItem();
+    ++stats_.numLoading_;
+    item.queueTime_ = item.timer_.GetUSec(true);
+    Resource* resource = item.resource_;
+    // We can be sure that the item is not removed from the queue as long as it is in the
+    // "queued" or "loading" state
+    backgroundLoadMutex_.Release();
+    
+    bool success = false;
+    {
+#ifdef URHO3D_PROFILING
+        String profileBlockName("Load" + resource->GetTypeName());
+        AutoProfileBlock profileBlock(owner_->GetSubsystem<Profiler>(), profileBlockName.CString());
+#endif
         
-        if (i == backgroundLoadQueue_.End())
+        SharedPtr<File> file = owner_->GetFile(resource->GetName(), item.sendEventOnFailure_);
+        if (file)
         {
-            // No resources to load found
-            backgroundLoadMutex_.Release();
-            Time::Sleep(5);
+            resource->SetAsyncLoadState(ASYNC_LOADING);
+            success = resource->BeginLoad(*file);
         }
-        else
+    }
+    
+    // Process dependencies now
+    // Need to lock the queue again when manipulating other entries
+    Pair<StringHash, StringHash> key = MakePair(resource->GetType(), resource->GetNameHash());
+    backgroundLoadMutex_.Acquire();
+    if (item.dependents_.Size())
+    {
+        for (HashSet<Pair<StringHash, StringHash> >::Iterator i = item.dependents_.Begin(); i != item.dependents_.End(); ++i)
         {
-            BackgroundLoadItem& item = i->second_;
-            Resource* resource = item.resource_;
-            // We can be sure that the item is not removed from the queue as long as it is in the
-            // "queued" or "loading" state
-            backgroundLoadMutex_.Release();
-            
-            bool success = false;
-            SharedPtr<File> file = owner_->GetFile(resource->GetName(), item.sendEventOnFailure_);
-            if (file)
-            {
-                resource->SetAsyncLoadState(ASYNC_LOADING);
-                success = resource->BeginLoad(*file);
-            }
-            
-            // Process dependencies now
-            // Need to lock the queue again when manipulating other entries
-            Pair<StringHash, StringHash> key = MakePair(resource->GetType(), resource->GetNameHash());
-            backgroundLoadMutex_.Acquire();
-            if (item.dependents_.Size())
-            {
-                for (HashSet<Pair<StringHash, StringHash> >::Iterator i = item.dependents_.Begin(); i != item.dependents_.End();
-                    ++i)
-                {
-                    HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator j =
-                        backgroundLoadQueue_.Find(*i);
-                    if (j != backgroundLoadQueue_.End())
-                        j->second_.dependencies_.Erase(key);
-                }
-                
-                item.dependents_.Clear();
-            }
-            
-            resource->SetAsyncLoadState(success ? ASYNC_SUCCESS : ASYNC_FAIL);
-            backgroundLoadMutex_.Release();
+            HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator j = backgroundLoadQueue_.Find(*i);
+            if (j != backgroundLoadQueue_.End())
+                j->second_.dependencies_.Erase(key);
         }
+        
+        item.dependents_.Clear();
     }
+    
+    item.loadTime_ = item.timer_.GetUSec(true);
+    --stats_.numLoading_;
+    resource->SetAsyncLoadState(success ? ASYNC_SUCCESS : ASYNC_FAIL);
+    backgroundLoadMutex_.Release();
+    
+    return true;
 }
 
-bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool sendEventOnFailure, Resource* caller)
+bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool sendEventOnFailure, Resource* caller,
+    unsigned priority)
 {
     StringHash nameHash(name);
     Pair<StringHash, StringHash> key = MakePair(type, nameHash);
     
     MutexLock lock(backgroundLoadMutex_);
     
-    // Check if already exists in the queue
-    if (backgroundLoadQueue_.Find(key) != backgroundLoadQueue_.End())
+    // Find the calling resource's queue item. Its dependencies are loaded before other items of the same priority, so that
+    // it can be finished sooner
+    BackgroundLoadItem* callerItem = 0;
+    if (caller)
+    {
+        Pair<StringHash, StringHash> callerKey = MakePair(caller->GetType(), caller->GetNameHash());
+        HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator j = backgroundLoadQueue_.Find(callerKey);
+        if (j != backgroundLoadQueue_.End())
+        {
+            callerItem = &j->second_;
+            if (callerItem->priority_ >= priority)
+                priority = callerItem->priority_ < M_MAX_UNSIGNED ? callerItem->priority_ + 1 : M_MAX_UNSIGNED;
+        }
+        else
+            LOGWARNING("Resource " + caller->GetName() + " requested for a background loaded resource but was not in the background load queue");
+    }
+    
+    // Check if already exists in the queue. If it has not been loaded yet, the caller still needs to wait for it
+    HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Find(key);
+    if (i != backgroundLoadQueue_.End())
+    {
+        BackgroundLoadItem& item = i->second_;
+        AsyncLoadState state = item.resource_->GetAsyncLoadState();
+        if (state == ASYNC_QUEUED || state == ASYNC_LOADING)
+        {
+            if (callerItem && callerItem != &item)
+            {
+                item.dependents_.Insert(MakePair(caller->GetType(), caller->GetNameHash()));
+                callerItem->dependencies_.Insert(key);
+            }
+            RaisePriority(item, priority);
+        }
         return false;
+    }
     
     BackgroundLoadItem& item = backgroundLoadQueue_[key];
     item.sendEventOnFailure_ = sendEventOnFailure;
@@ -138,25 +237,30 @@ bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool s
 
     item.resource_->SetName(name);
     item.resource_->SetAsyncLoadState(ASYNC_QUEUED);
+    item.priority_ = priority;
+    item.sequence_ = nextSequence_++;
+    item.queueTime_ = 0;
+    item.loadTime_ = 0;
+    item.timer_.Reset();
     
     // If this is a resource calling for the background load of more resources, mark the dependency as necessary
-    if (caller)
+    if (callerItem)
     {
-        Pair<StringHash, StringHash> callerKey = MakePair(caller->GetType(), caller->GetNameHash());
-        HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator j = backgroundLoadQueue_.Find(callerKey);
-        if (j != backgroundLoadQueue_.End())
-        {
-            BackgroundLoadItem& callerItem = j->second_;
-            item.dependents_.Insert(callerKey);
-            callerItem.dependencies_.Insert(key);
-        }
-        else
-            LOGWARNING("Resource " + caller->GetName() + " requested for a background loaded resource but was not in the background load queue");
+        item.dependents_.Insert(MakePair(caller->GetType(), caller->GetNameHash()));
+        callerItem->dependencies_.Insert(key);
     }
     
-    // Start the background loader thread now
-    if (!IsStarted())
-        Run();
+    PushWaitingItem(&item);
+    stats_.maxQueued_ = Max((int)stats_.maxQueued_, (int)waitingItems_.Size());
+    
+    // Start the loader threads now, or wake up an idle one
+    if (threads_.Empty())
+        UpdateThreads();
+    else if (idleThreads_.Size())
+    {
+        idleThreads_.Back()->Wake();
+        idleThreads_.Pop();
+    }
     
     return true;
 }
@@ -170,6 +274,8 @@ void BackgroundLoader::WaitForResource(StringHash type, StringHash nameHash)
     HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Find(key);
     if (i != backgroundLoadQueue_.End())
     {
+        // The main thread is now stalled, so move the resource and what it depends on to the front of the queue
+        RaisePriority(i->second_, M_MAX_UNSIGNED);
         backgroundLoadMutex_.Release();
         
         {
@@ -179,8 +285,14 @@ void BackgroundLoader::WaitForResource(StringHash type, StringHash nameHash)
             
             for (;;)
             {
+                backgroundLoadMutex_.Acquire();
                 unsigned numDeps = i->second_.dependencies_.Size();
                 AsyncLoadState state = resource->GetAsyncLoadState();
+                // Dependencies may have been queued after the wait began
+                if (numDeps > 0)
+                    RaisePriority(i->second_, M_MAX_UNSIGNED);
+                backgroundLoadMutex_.Release();
+                
                 if (numDeps > 0 || state == ASYNC_QUEUED || state == ASYNC_LOADING)
                 {
                     didWait = true;
@@ -207,37 +319,34 @@ void BackgroundLoader::WaitForResource(StringHash type, StringHash nameHash)
 
 void BackgroundLoader::FinishResources(int maxMs)
 {
-    if (IsStarted())
-    {
-        HiresTimer timer;
+    HiresTimer timer;
 
-        backgroundLoadMutex_.Acquire();
-        
-        for (HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Begin();
-            i != backgroundLoadQueue_.End();)
+    backgroundLoadMutex_.Acquire();
+    
+    for (HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Begin();
+        i != backgroundLoadQueue_.End();)
+    {
+        Resource* resource = i->second_.resource_;
+        unsigned numDeps = i->second_.dependencies_.Size();
+        AsyncLoadState state = resource->GetAsyncLoadState();
+        if (numDeps > 0 || state == ASYNC_QUEUED || state == ASYNC_LOADING)
+            ++i;
+        else
         {
-            Resource* resource = i->second_.resource_;
-            unsigned numDeps = i->second_.dependencies_.Size();
-            AsyncLoadState state = resource->GetAsyncLoadState();
-            if (numDeps > 0 || state == ASYNC_QUEUED || state == ASYNC_LOADING)
-                ++i;
-            else
-            {
-                // Finishing a resource may need it to wait for other resources to load, in which case we can not
-                // hold on to the mutex
-                backgroundLoadMutex_.Release();
-                FinishBackgroundLoading(i->second_);
-                backgroundLoadMutex_.Acquire();
-                i = backgroundLoadQueue_.Erase(i);
-            }
-            
-            // Break when the time limit passed so that we keep sufficient FPS
-            if (timer.GetUSec(false) >= maxMs * 1000)
-                break;
+            // Finishing a resource may need it to wait for other resources to load, in which case we can not
+            // hold on to the mutex
+            backgroundLoadMutex_.Release();
+            FinishBackgroundLoading(i->second_);
+            backgroundLoadMutex_.Acquire();
+            i = backgroundLoadQueue_.Erase(i);
         }
         
-        backgroundLoadMutex_.Release();
+        // Break when the time limit passed so that we keep sufficient FPS
+        if (timer.GetUSec(false) >= maxMs * 1000)
+            break;
     }
+    
+    backgroundLoadMutex_.Release();
 }
 
 unsigned BackgroundLoader::GetNumQueuedResources() const
@@ -246,9 +355,123 @@ unsigned BackgroundLoader::GetNumQueuedResources() const
     return backgroundLoadQueue_.Size();
 }
 
+BackgroundLoadStats BackgroundLoader::GetStats() const
+{
+    MutexLock lock(backgroundLoadMutex_);
+    
+    BackgroundLoadStats stats = stats_;
+    stats.numQueued_ = waitingItems_.Size();
+    stats.numFinishing_ = backgroundLoadQueue_.Size() - stats.numQueued_ - stats.numLoading_;
+    return stats;
+}
+
+void BackgroundLoader::UpdateThreads()
+{
+    while (threads_.Size() < numThreads_)
+    {
+        SharedPtr<BackgroundLoaderThread> thread(new BackgroundLoaderThread(this));
+        if (!thread->Run())
+            break;
+        threads_.Push(thread);
+    }
+    
+    // Stopping a thread waits for it to finish its current resource, which needs the queue mutex
+    if (threads_.Size() > numThreads_)
+    {
+        Vector<SharedPtr<BackgroundLoaderThread> > stopThreads(&threads_[numThreads_], threads_.Size() - numThreads_);
+        threads_.Resize(numThreads_);
+        for (unsigned i = 0; i < stopThreads.Size(); ++i)
+            idleThreads_.Remove(stopThreads[i]);
+        backgroundLoadMutex_.Release();
+        for (unsigned i = 0; i < stopThreads.Size(); ++i)
+            stopThreads[i]->StopLoading();
+        backgroundLoadMutex_.Acquire();
+    }
+}
+
+void BackgroundLoader::RaisePriority(BackgroundLoadItem& item, unsigned priority)
+{
+    if (item.priority_ >= priority)
+        return;
+    
+    item.priority_ = priority;
+    if (item.heapIndex_ != M_MAX_UNSIGNED)
+        SiftUp(item.heapIndex_);
+    
+    for (HashSet<Pair<StringHash, StringHash> >::Iterator i = item.dependencies_.Begin(); i != item.dependencies_.End(); ++i)
+    {
+        HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator j = backgroundLoadQueue_.Find(*i);
+        if (j != backgroundLoadQueue_.End())
+            RaisePriority(j->second_, priority);
+    }
+}
+
+void BackgroundLoader::PushWaitingItem(BackgroundLoadItem* item)
+{
+    waitingItems_.Push(item);
+    SetWaitingItem(waitingItems_.Size() - 1, item);
+    SiftUp(waitingItems_.Size() - 1);
+}
+
+BackgroundLoadItem* BackgroundLoader::PopWaitingItem()
+{
+    BackgroundLoadItem* item = waitingItems_.Front();
+    item->heapIndex_ = M_MAX_UNSIGNED;
+    
+    BackgroundLoadItem* last = waitingItems_.Back();
+    waitingItems_.Pop();
+    if (last != item)
+    {
+        SetWaitingItem(0, last);
+        SiftDown(0);
+    }
+    
+    return item;
+}
+
+void BackgroundLoader::SiftUp(unsigned index)
+{
+    BackgroundLoadItem* item = waitingItems_[index];
+    while (index > 0)
+    {
+        unsigned parent = (index - 1) >> 1;
+        if (!LoadsBefore(item, waitingItems_[parent]))
+            break;
+        SetWaitingItem(index, waitingItems_[parent]);
+        index = parent;
+    }
+    SetWaitingItem(index, item);
+}
+
+void BackgroundLoader::SiftDown(unsigned index)
+{
+    BackgroundLoadItem* item = waitingItems_[index];
+    unsigned size = waitingItems_.Size();
+    for (;;)
+    {
+        unsigned child = (index << 1) + 1;
+        if (child >= size)
+            break;
+        if (child + 1 < size && LoadsBefore(waitingItems_[child + 1], waitingItems_[child]))
+            ++child;
+        if (!LoadsBefore(waitingItems_[child], item))
+            break;
+        SetWaitingItem(index, waitingItems_[child]);
+        index = child;
+    }
+    SetWaitingItem(index, item);
+}
+
+void BackgroundLoader::SetWaitingItem(unsigned index, BackgroundLoadItem* item)
+{
+    waitingItems_[index] = item;
+    item->heapIndex_ = index;
+}
+
 void BackgroundLoader::FinishBackgroundLoading(BackgroundLoadItem& item)
 {
     Resource* resource = item.resource_;
+    HiresTimer finishTimer;
     
     bool success = resource->GetAsyncLoadState() == ASYNC_SUCCESS;
     // If BeginLoad() phase was successful, call EndLoad() and get the final success/failure result
@@ -261,7 +484,6 @@ void BackgroundLoader::FinishBackgroundLoading(BackgroundLoadItem& item)
         if (profiler)
             profiler->BeginBlock(profileBlockName.CString());
 #endif
-        LOGDEBUG("Finishing background loaded resource " + resource->GetName());
         success = resource->EndLoad();
         
 #ifdef URHO3D_PROFILING
@@ -271,6 +493,17 @@ void BackgroundLoader::FinishBackgroundLoading(BackgroundLoadItem& item)
     }
     resource->SetAsyncLoadState(ASYNC_DONE);
     
+    long long finishTime = finishTimer.GetUSec(false);
+    LOGDEBUG("Finished background loaded resource " + resource->GetName() + ", queued " + String((int)(item.queueTime_ / 1000)) +
+        " ms, loaded " + String((int)(item.loadTime_ / 1000)) + " ms, finished " + String((int)(finishTime / 1000)) + " ms");
+    {
+        MutexLock lock(backgroundLoadMutex_);
+        ++stats_.numFinished_;
+        stats_.queueTime_ += item.queueTime_;
+        stats_.loadTime_ += item.loadTime_;
+        stats_.finishTime_ += finishTime;
+    }
+    
     if (!success && item.sendEventOnFailure_)
     {
         using namespace LoadFailed;
@@ -28,11 +28,12 @@
 #include "Ptr.h"
 #include "RefCounted.h"
 #include "StringHash.h"
-#include "Thread.h"
+#include "Timer.h"
 
 namespace Urho3D
 {
 
+class BackgroundLoaderThread;
 class Resource;
 class ResourceCache;
 
@@ -45,31 +46,98 @@ struct BackgroundLoadItem
     HashSet<Pair<StringHash, StringHash> > dependencies_;
     /// Resources that depend on this resource's loading.
     HashSet<Pair<StringHash, StringHash> > dependents_;
+    /// Timer started when queued.
+    HiresTimer timer_;
+    /// Time spent in the queue in microseconds.
+    long long queueTime_;
+    /// Time spent loading in a loader thread in microseconds.
+    long long loadTime_;
+    /// Priority. Higher value = will be loaded first.
+    unsigned priority_;
+    /// Queue order among items of equal priority. Lower value = will be loaded first.
+    unsigned sequence_;
+    /// Index in the waiting item heap, or M_MAX_UNSIGNED if not waiting for a loader thread.
+    unsigned heapIndex_;
     /// Whether to send failure event.
     bool sendEventOnFailure_;
 };
 
+/// Background resource loading statistics.
+struct BackgroundLoadStats
+{
+    /// Construct.
+    BackgroundLoadStats() :
+        numQueued_(0),
+        numLoading_(0),
+        numFinishing_(0),
+        maxQueued_(0),
+        numFinished_(0),
+        queueTime_(0),
+        loadTime_(0),
+        finishTime_(0)
+    {
+    }
+    
+    /// Resources waiting for a loader thread.
+    unsigned numQueued_;
+    /// Resources being loaded in the loader threads.
+    unsigned numLoading_;
+    /// Loaded resources waiting to be finished in the main thread, either for their dependencies or for their turn.
+    unsigned numFinishing_;
+    /// Highest number of resources waiting for a loader thread at once.
+    unsigned maxQueued_;
+    /// Resources finished since startup.
+    unsigned numFinished_;
+    /// Total time finished resources spent waiting for a loader thread in microseconds.
+    long long queueTime_;
+    /// Total time finished resources spent loading in the loader threads in microseconds.
+    long long loadTime_;
+    /// Total time spent finishing resources in the main thread in microseconds.
+    long long finishTime_;
+};
+
 /// Background loader of resources. Owned by the ResourceCache.
-class BackgroundLoader : public RefCounted, public Thread
+class BackgroundLoader : public RefCounted
 {
 public:
     /// Construct.
     BackgroundLoader(ResourceCache* owner);
+    /// Destruct. Stop the loader threads.
+    ~BackgroundLoader();
     
-    /// Resource background loading loop.
-    virtual void ThreadFunction();
-    
+    /// Set number of loader threads. The threads are started on the first background load request.
+    void SetNumThreads(unsigned num);
+    /// Load the highest priority queued resource. Called by the loader threads. Return true if a resource was found, or false after registering the thread to be woken when a resource is queued.
+    bool LoadNextResource(BackgroundLoaderThread* thread);
     /// Queue loading of a resource. The name must be sanitated to ensure consistent format. Return true if queued (not a duplicate and resource was a known type).
-    bool QueueResource(StringHash type, const String& name, bool sendEventOnFailure, Resource* caller);
+    bool QueueResource(StringHash type, const String& name, bool sendEventOnFailure, Resource* caller, unsigned priority);
     /// Wait and finish possible loading of a resource when being requested from the cache.
     void WaitForResource(StringHash type, StringHash nameHash);
     /// Process resources that are ready to finish.
     void FinishResources(int maxMs);
     
+    /// Return number of loader threads.
+    unsigned GetNumThreads() const { return numThreads_; }
     /// Return amount of resources in the load queue.
     unsigned GetNumQueuedResources() const;
+    /// Return loading statistics.
+    BackgroundLoadStats GetStats() const;
     
 private:
+    /// Start or stop loader threads to match the requested number. Called with the queue mutex held.
+    void UpdateThreads();
+    /// Raise the priority of a queued item and the items it depends on. Called with the queue mutex held.
+    void RaisePriority(BackgroundLoadItem& item, unsigned priority);
+    /// Add an item to the waiting item heap. Called with the queue mutex held.
+    void PushWaitingItem(BackgroundLoadItem* item);
+    /// Remove and return the highest priority item from the waiting item heap. Called with the queue mutex held.
+    BackgroundLoadItem* PopWaitingItem();
+    /// Move a waiting item toward the top of the heap until its parent precedes it.
+    void SiftUp(unsigned index);
+    /// Move a waiting item toward the bottom of the heap until it precedes its children.
+    void SiftDown(unsigned index);
+    /// Place a waiting item in a heap position.
+    void SetWaitingItem(unsigned index, BackgroundLoadItem* item);
     /// Finish one background loaded resource.
     void FinishBackgroundLoading(BackgroundLoadItem& item);
     
@@ -79,6 +147,18 @@ private:
     mutable Mutex backgroundLoadMutex_;
     /// Resources that are queued for background loading.
     HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem> backgroundLoadQueue_;
+    /// Items waiting for a loader thread as a binary heap, highest priority first and among equal priorities the earliest queued.
+    PODVector<BackgroundLoadItem*> waitingItems_;
+    /// Loader threads.
+    Vector<SharedPtr<BackgroundLoaderThread> > threads_;
+    /// Loader threads waiting for resources to be queued.
+    PODVector<BackgroundLoaderThread*> idleThreads_;
+    /// Statistics of resources loaded so far.
+    BackgroundLoadStats stats_;
+    /// Number of loader threads.
+    unsigned numThreads_;
+    /// Queue order of the next queued item.
+    unsigned nextSequence_;
 };
 
 }
@@ -1760,6 +1760,11 @@ unsigned char* Image::GetImageData(Deserializer& source, int& width, int& height
 {
     unsigned dataSize = source.GetSize();
 
+    // If the file is in a memory-mapped package, decode directly from the mapping
+    File* file = dynamic_cast<File*>(&source);
+    if (file && file->GetMappedData())
+        return stbi_load_from_memory(file->GetMappedData(), dataSize, &width, &height, (int *)&components, 0);
+
     SharedArrayPtr<unsigned char> buffer(new unsigned char[dataSize]);
     source.Read(buffer.Get(), dataSize);
     return stbi_load_from_memory(buffer.Get(), dataSize, &width, &height, (int *)&components, 0);
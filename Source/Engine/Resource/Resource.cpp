@@ -37,7 +37,7 @@ Resource::Resource(Context* context) :
 
 bool Resource::Load(Deserializer& source)
 {
-    // Because BeginLoad() / EndLoad() can be called from worker threads, where profiling would be a no-op,
+    // Because BeginLoad() / EndLoad() can be called from worker threads, where profiling is only recorded to the timeline,
     // create a type name -based profile block here
 #ifdef URHO3D_PROFILING
     String profileBlockName("Load" + GetTypeName());
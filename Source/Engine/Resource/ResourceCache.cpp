@@ -29,6 +29,7 @@
 #include "Image.h"
 #include "JSONFile.h"
 #include "Log.h"
+#include "MemoryTracker.h"
 #include "PackageFile.h"
 #include "PListFile.h"
 #include "Profiler.h"
@@ -73,7 +74,7 @@ ResourceCache::ResourceCache(Context* context) :
     // Register Resource library object factories
     RegisterResourceLibrary(context_);
     
-    // Create resource background loader. Its thread will start on the first background request
+    // Create resource background loader. Its threads will start on the first background request
     backgroundLoader_ = new BackgroundLoader(this);
     
     // Subscribe BeginFrame for handling directory watchers and background loaded resource finalization
@@ -195,10 +196,7 @@ void ResourceCache::RemovePackageFile(PackageFile* package, bool releaseResource
     {
         if (*i == package)
         {
-            if (releaseResources)
-                ReleasePackageResources(*i, forceRelease);
-            LOGINFO("Removed resource package " + (*i)->GetName());
-            packages_.Erase(i);
+            ErasePackageFile(i, releaseResources, forceRelease);
             return;
         }
     }
@@ -215,15 +213,23 @@ void ResourceCache::RemovePackageFile(const String& fileName, bool releaseResour
     {
         if (!GetFileNameAndExtension((*i)->GetName()).Compare(fileNameNoPath, false))
         {
-            if (releaseResources)
-                ReleasePackageResources(*i, forceRelease);
-            LOGINFO("Removed resource package " + (*i)->GetName());
-            packages_.Erase(i);
+            ErasePackageFile(i, releaseResources, forceRelease);
             return;
         }
     }
 }
 
+void ResourceCache::ErasePackageFile(Vector<SharedPtr<PackageFile> >::Iterator i, bool releaseResources, bool forceRelease)
+{
+    if (releaseResources)
+        ReleasePackageResources(*i, forceRelease);
+    LOGINFO("Removed resource package " + (*i)->GetName());
+    // Files opened from the memory mapping, for example by the background loader, may still be reading from it
+    if ((*i)->GetNumMappedFiles())
+        removedPackages_.Push(*i);
+    packages_.Erase(i);
+}
+
 void ResourceCache::ReleaseResource(StringHash type, const String& name, bool force)
 {
     StringHash nameHash(name);
@@ -243,19 +249,20 @@ void ResourceCache::ReleaseResources(StringHash type, bool force)
 {
     bool released = false;
     
-    HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Find(type);
+    FlatHashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Find(type);
     if (i != resourceGroups_.End())
     {
-        for (HashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin();
+        for (FlatHashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin();
             j != i->second_.resources_.End();)
         {
-            HashMap<StringHash, SharedPtr<Resource> >::Iterator current = j++;
             // If other references exist, do not release, unless forced
-            if ((current->second_.Refs() == 1 && current->second_.WeakRefs() == 0) || force)
+            if ((j->second_.Refs() == 1 && j->second_.WeakRefs() == 0) || force)
             {
-                i->second_.resources_.Erase(current);
+                j = i->second_.resources_.Erase(j);
                 released = true;
             }
+            else
+                ++j;
         }
     }
     
@@ -267,22 +274,21 @@ void ResourceCache::ReleaseResources(StringHash type, const String& partialName,
 {
     bool released = false;
     
-    HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Find(type);
+    FlatHashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Find(type);
     if (i != resourceGroups_.End())
     {
-        for (HashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin();
+        for (FlatHashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin();
             j != i->second_.resources_.End();)
         {
-            HashMap<StringHash, SharedPtr<Resource> >::Iterator current = j++;
-            if (current->second_->GetName().Contains(partialName))
+            // If other references exist, do not release, unless forced
+            if (j->second_->GetName().Contains(partialName) && ((j->second_.Refs() == 1 && j->second_.WeakRefs() == 0) ||
+                force))
             {
-                // If other references exist, do not release, unless forced
-                if ((current->second_.Refs() == 1 && current->second_.WeakRefs() == 0) || force)
-                {
-                    i->second_.resources_.Erase(current);
-                    released = true;
-                }
+                j = i->second_.resources_.Erase(j);
+                released = true;
             }
+            else
+                ++j;
         }
     }
     
@@ -298,23 +304,22 @@ void ResourceCache::ReleaseResources(const String& partialName, bool force)
     
     while (repeat--)
     {
-        for (HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Begin(); i != resourceGroups_.End(); ++i)
+        for (FlatHashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Begin(); i != resourceGroups_.End(); ++i)
         {
             bool released = false;
             
-            for (HashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin();
+            for (FlatHashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin();
                 j != i->second_.resources_.End();)
             {
-                HashMap<StringHash, SharedPtr<Resource> >::Iterator current = j++;
-                if (current->second_->GetName().Contains(partialName))
+                // If other references exist, do not release, unless forced
+                if (j->second_->GetName().Contains(partialName) && ((j->second_.Refs() == 1 && j->second_.WeakRefs() == 0) ||
+                    force))
                 {
-                    // If other references exist, do not release, unless forced
-                    if ((current->second_.Refs() == 1 && current->second_.WeakRefs() == 0) || force)
-                    {
-                        i->second_.resources_.Erase(current);
-                        released = true;
-                    }
+                    j = i->second_.resources_.Erase(j);
+                    released = true;
                 }
+                else
+                    ++j;
             }
             if (released)
                 UpdateResourceGroup(i->first_);
@@ -328,21 +333,22 @@ void ResourceCache::ReleaseAllResources(bool force)
     
     while (repeat--)
     {
-        for (HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Begin();
+        for (FlatHashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Begin();
             i != resourceGroups_.End(); ++i)
         {
             bool released = false;
             
-            for (HashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin();
+            for (FlatHashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin();
                 j != i->second_.resources_.End();)
             {
-                HashMap<StringHash, SharedPtr<Resource> >::Iterator current = j++;
                 // If other references exist, do not release, unless forced
-                if ((current->second_.Refs() == 1 && current->second_.WeakRefs() == 0) || force)
+                if ((j->second_.Refs() == 1 && j->second_.WeakRefs() == 0) || force)
                 {
-                    i->second_.resources_.Erase(current);
+                    j = i->second_.resources_.Erase(j);
                     released = true;
                 }
+                else
+                    ++j;
             }
             if (released)
                 UpdateResourceGroup(i->first_);
@@ -379,8 +385,9 @@ bool ResourceCache::ReloadResource(Resource* resource)
 void ResourceCache::ReloadResourceWithDependencies(const String& fileName)
 {
     StringHash fileNameHash(fileName);
-    // If the filename is a resource we keep track of, reload it
-    const SharedPtr<Resource>& resource = FindResource(fileNameHash);
+    // If the filename is a resource we keep track of, reload it. Hold a copy, as reloading may insert into or evict from
+    // the resource groups and invalidate a reference into their storage
+    SharedPtr<Resource> resource = FindResource(fileNameHash);
     if (resource)
     {
         LOGDEBUG("Reloading changed resource " + fileName);
@@ -444,6 +451,11 @@ void ResourceCache::SetReturnFailedResources(bool enable)
     returnFailedResources_ = enable;
 }
 
+void ResourceCache::SetNumBackgroundLoadThreads(unsigned num)
+{
+    backgroundLoader_->SetNumThreads(num);
+}
+
 SharedPtr<File> ResourceCache::GetFile(const String& nameIn, bool sendEventOnFailure)
 {
     MutexLock lock(resourceMutex_);
@@ -516,6 +528,7 @@ Resource* ResourceCache::GetResource(StringHash type, const String& nameIn, bool
     if (existing)
         return existing;
     
+    MEMORY_CATEGORY(MEMCAT_RESOURCE);
     SharedPtr<Resource> resource;
     // Make sure the pointer is non-null and is a Resource subclass
     resource = DynamicCast<Resource>(context_->CreateObject(type));
@@ -567,7 +580,8 @@ Resource* ResourceCache::GetResource(StringHash type, const String& nameIn, bool
     return resource;
 }
 
-bool ResourceCache::BackgroundLoadResource(StringHash type, const String& nameIn, bool sendEventOnFailure, Resource* caller)
+bool ResourceCache::BackgroundLoadResource(StringHash type, const String& nameIn, bool sendEventOnFailure, Resource* caller,
+    unsigned priority)
 {
     // If empty name, fail immediately
     String name = SanitateResourceName(nameIn);
@@ -579,7 +593,7 @@ bool ResourceCache::BackgroundLoadResource(StringHash type, const String& nameIn
     if (FindResource(type, nameHash) != noResource)
         return false;
     
-    return backgroundLoader_->QueueResource(type, name, sendEventOnFailure, caller);
+    return backgroundLoader_->QueueResource(type, name, sendEventOnFailure, caller, priority);
 }
 
 SharedPtr<Resource> ResourceCache::GetTempResource(StringHash type, const String& nameIn, bool sendEventOnFailure)
@@ -590,6 +604,7 @@ SharedPtr<Resource> ResourceCache::GetTempResource(StringHash type, const String
     if (name.Empty())
         return SharedPtr<Resource>();
     
+    MEMORY_CATEGORY(MEMCAT_RESOURCE);
     SharedPtr<Resource> resource;
     // Make sure the pointer is non-null and is a Resource subclass
     resource = DynamicCast<Resource>(context_->CreateObject(type));
@@ -640,13 +655,23 @@ unsigned ResourceCache::GetNumBackgroundLoadResources() const
     return backgroundLoader_->GetNumQueuedResources();
 }
 
+unsigned ResourceCache::GetNumBackgroundLoadThreads() const
+{
+    return backgroundLoader_->GetNumThreads();
+}
+
+BackgroundLoadStats ResourceCache::GetBackgroundLoadStats() const
+{
+    return backgroundLoader_->GetStats();
+}
+
 void ResourceCache::GetResources(PODVector<Resource*>& result, StringHash type) const
 {
     result.Clear();
-    HashMap<StringHash, ResourceGroup>::ConstIterator i = resourceGroups_.Find(type);
+    FlatHashMap<StringHash, ResourceGroup>::ConstIterator i = resourceGroups_.Find(type);
     if (i != resourceGroups_.End())
     {
-        for (HashMap<StringHash, SharedPtr<Resource> >::ConstIterator j = i->second_.resources_.Begin();
+        for (FlatHashMap<StringHash, SharedPtr<Resource> >::ConstIterator j = i->second_.resources_.Begin();
             j != i->second_.resources_.End(); ++j)
             result.Push(j->second_);
     }
@@ -685,7 +710,7 @@ bool ResourceCache::Exists(const String& nameIn) const
 
 unsigned ResourceCache::GetMemoryBudget(StringHash type) const
 {
-    HashMap<StringHash, ResourceGroup>::ConstIterator i = resourceGroups_.Find(type);
+    FlatHashMap<StringHash, ResourceGroup>::ConstIterator i = resourceGroups_.Find(type);
     if (i != resourceGroups_.End())
         return i->second_.memoryBudget_;
     else
@@ -694,7 +719,7 @@ unsigned ResourceCache::GetMemoryBudget(StringHash type) const
 
 unsigned ResourceCache::GetMemoryUse(StringHash type) const
 {
-    HashMap<StringHash, ResourceGroup>::ConstIterator i = resourceGroups_.Find(type);
+    FlatHashMap<StringHash, ResourceGroup>::ConstIterator i = resourceGroups_.Find(type);
     if (i != resourceGroups_.End())
         return i->second_.memoryUse_;
     else
@@ -704,7 +729,7 @@ unsigned ResourceCache::GetMemoryUse(StringHash type) const
 unsigned ResourceCache::GetTotalMemoryUse() const
 {
     unsigned total = 0;
-    for (HashMap<StringHash, ResourceGroup>::ConstIterator i = resourceGroups_.Begin(); i != resourceGroups_.End(); ++i)
+    for (FlatHashMap<StringHash, ResourceGroup>::ConstIterator i = resourceGroups_.Begin(); i != resourceGroups_.End(); ++i)
         total += i->second_.memoryUse_;
     return total;
 }
@@ -840,10 +865,10 @@ const SharedPtr<Resource>& ResourceCache::FindResource(StringHash type, StringHa
 {
     MutexLock lock(resourceMutex_);
 
-    HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Find(type);
+    FlatHashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Find(type);
     if (i == resourceGroups_.End())
         return noResource;
-    HashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Find(nameHash);
+    FlatHashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Find(nameHash);
     if (j == i->second_.resources_.End())
         return noResource;
     
@@ -854,9 +879,9 @@ const SharedPtr<Resource>& ResourceCache::FindResource(StringHash nameHash)
 {
     MutexLock lock(resourceMutex_);
 
-    for (HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Begin(); i != resourceGroups_.End(); ++i)
+    for (FlatHashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Begin(); i != resourceGroups_.End(); ++i)
     {
-        HashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Find(nameHash);
+        FlatHashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Find(nameHash);
         if (j != i->second_.resources_.End())
             return j->second_;
     }
@@ -874,10 +899,10 @@ void ResourceCache::ReleasePackageResources(PackageFile* package, bool force)
         StringHash nameHash(i->first_);
         
         // We do not know the actual resource type, so search all type containers
-        for (HashMap<StringHash, ResourceGroup>::Iterator j = resourceGroups_.Begin();
+        for (FlatHashMap<StringHash, ResourceGroup>::Iterator j = resourceGroups_.Begin();
             j != resourceGroups_.End(); ++j)
         {
-            HashMap<StringHash, SharedPtr<Resource> >::Iterator k = j->second_.resources_.Find(nameHash);
+            FlatHashMap<StringHash, SharedPtr<Resource> >::Iterator k = j->second_.resources_.Find(nameHash);
             if (k != j->second_.resources_.End())
             {
                 // If other references exist, do not release, unless forced
@@ -897,7 +922,7 @@ void ResourceCache::ReleasePackageResources(PackageFile* package, bool force)
 
 void ResourceCache::UpdateResourceGroup(StringHash type)
 {
-    HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Find(type);
+    FlatHashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Find(type);
     if (i == resourceGroups_.End())
         return;
     
@@ -905,9 +930,9 @@ void ResourceCache::UpdateResourceGroup(StringHash type)
     {
         unsigned totalSize = 0;
         unsigned oldestTimer = 0;
-        HashMap<StringHash, SharedPtr<Resource> >::Iterator oldestResource = i->second_.resources_.End();
+        FlatHashMap<StringHash, SharedPtr<Resource> >::Iterator oldestResource = i->second_.resources_.End();
         
-        for (HashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin();
+        for (FlatHashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin();
             j != i->second_.resources_.End(); ++j)
         {
             totalSize += j->second_->GetMemoryUse();
@@ -957,8 +982,23 @@ void ResourceCache::HandleBeginFrame(StringHash eventType, VariantMap& eventData
     // Check for background loaded resources that can be finished
     {
         PROFILE(FinishBackgroundResources);
+        MEMORY_CATEGORY(MEMCAT_RESOURCE);
         backgroundLoader_->FinishResources(finishBackgroundResourcesMs_);
     }
+    
+    // Destroy the removed package files once no files are open from them. As they are no longer searched, the number of
+    // open files can only decrease
+    if (removedPackages_.Size())
+    {
+        MutexLock lock(resourceMutex_);
+        for (Vector<SharedPtr<PackageFile> >::Iterator i = removedPackages_.Begin(); i != removedPackages_.End();)
+        {
+            if (!(*i)->GetNumMappedFiles())
+                i = removedPackages_.Erase(i);
+            else
+                ++i;
+        }
+    }
 }
 
 File* ResourceCache::SearchResourceDirs(const String& nameIn)
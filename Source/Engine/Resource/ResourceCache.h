@@ -22,7 +22,9 @@
 
 #pragma once
 
+#include "BackgroundLoader.h"
 #include "File.h"
+#include "FlatHashMap.h"
 #include "HashSet.h"
 #include "List.h"
 #include "Mutex.h"
@@ -31,7 +33,6 @@
 namespace Urho3D
 {
 
-class BackgroundLoader;
 class FileWatcher;
 class PackageFile;
 
@@ -53,7 +54,7 @@ struct ResourceGroup
     /// Current memory use.
     unsigned memoryUse_;
     /// Resources.
-    HashMap<StringHash, SharedPtr<Resource> > resources_;
+    FlatHashMap<StringHash, SharedPtr<Resource> > resources_;
 };
 
 /// Resource request types.
@@ -124,6 +125,8 @@ public:
     void SetSearchPackagesFirst(bool value) { searchPackagesFirst_ = value; }
     /// Set how many milliseconds maximum per frame to spend on finishing background loaded resources.
     void SetFinishBackgroundResourcesMs(int ms) { finishBackgroundResourcesMs_ = Max(ms, 1); }
+    /// Set number of background loader threads. Default is the number of physical CPU cores minus one, at least one.
+    void SetNumBackgroundLoadThreads(unsigned num);
     /// Set the resource router object. By default there is none, so the routing process is skipped.
     void SetResourceRouter(ResourceRouter* router) { resourceRouter_ = router; }
     
@@ -133,14 +136,18 @@ public:
     Resource* GetResource(StringHash type, const String& name, bool sendEventOnFailure = true);
     /// Load a resource without storing it in the resource cache. Return null if not found or if fails. Can be called from outside the main thread if the resource itself is safe to load completely (it does not possess for example GPU data.)
     SharedPtr<Resource> GetTempResource(StringHash type, const String& name, bool sendEventOnFailure = true);
-    /// Background load a resource. An event will be sent when complete. Return true if successfully stored to the load queue, false if eg. already exists. Can be called from outside the main thread.
-    bool BackgroundLoadResource(StringHash type, const String& name, bool sendEventOnFailure = true, Resource* caller = 0);
+    /// Background load a resource. An event will be sent when complete. Return true if successfully stored to the load queue, false if eg. already exists. Can be called from outside the main thread. Resources with higher priority are loaded first. Resources requested by a background loading resource are loaded before others of the same priority.
+    bool BackgroundLoadResource(StringHash type, const String& name, bool sendEventOnFailure = true, Resource* caller = 0, unsigned priority = 0);
     /// Return number of pending background-loaded resources.
     unsigned GetNumBackgroundLoadResources() const;
+    /// Return number of background loader threads.
+    unsigned GetNumBackgroundLoadThreads() const;
+    /// Return background loading queue depth and timing statistics.
+    BackgroundLoadStats GetBackgroundLoadStats() const;
     /// Return all loaded resources of a specific type.
     void GetResources(PODVector<Resource*>& result, StringHash type) const;
     /// Return all loaded resources.
-    const HashMap<StringHash, ResourceGroup>& GetAllResources() const { return resourceGroups_; }
+    const FlatHashMap<StringHash, ResourceGroup>& GetAllResources() const { return resourceGroups_; }
     /// Return added resource load directories.
     const Vector<String>& GetResourceDirs() const { return resourceDirs_; }
     /// Return added package files.
@@ -150,7 +157,7 @@ public:
     /// Template version of loading a resource without storing it to the cache.
     template <class T> SharedPtr<T> GetTempResource(const String& name, bool sendEventOnFailure = true);
     /// Template version of queueing a resource background load.
-    template <class T> bool BackgroundLoadResource(const String& name, bool sendEventOnFailure = true, Resource* caller = 0);
+    template <class T> bool BackgroundLoadResource(const String& name, bool sendEventOnFailure = true, Resource* caller = 0, unsigned priority = 0);
     /// Template version of returning loaded resources of a specific type.
     template <class T> void GetResources(PODVector<T*>& result) const;
     /// Return whether a file exists by name.
@@ -186,15 +193,17 @@ public:
     void ResetDependencies(Resource* resource);
     
 private:
-    /// Find a resource.
+    /// Find a resource. The returned reference points into the resource group storage; copy it before modifying the cache.
     const SharedPtr<Resource>& FindResource(StringHash type, StringHash nameHash);
-    /// Find a resource by name only. Searches all type groups.
+    /// Find a resource by name only. Searches all type groups. Copy the result before modifying the cache.
     const SharedPtr<Resource>& FindResource(StringHash nameHash);
     /// Release resources loaded from a package file.
     void ReleasePackageResources(PackageFile* package, bool force = false);
     /// Update a resource group. Recalculate memory use and release resources if over memory budget.
     void UpdateResourceGroup(StringHash type);
-    /// Handle begin frame event. Automatic resource reloads and the finalization of background loaded resources are processed here.
+    /// Remove a package file from the search list. Keep it alive if files are still open from its memory mapping.
+    void ErasePackageFile(Vector<SharedPtr<PackageFile> >::Iterator i, bool releaseResources, bool forceRelease);
+    /// Handle begin frame event. Automatic resource reloads, the finalization of background loaded resources and the destruction of removed package files are processed here.
     void HandleBeginFrame(StringHash eventType, VariantMap& eventData);
     /// Search FileSystem for file.
     File* SearchResourceDirs(const String& nameIn);
@@ -204,13 +213,15 @@ private:
     /// Mutex for thread-safe access to the resource directories, resource packages and resource dependencies.
     mutable Mutex resourceMutex_;
     /// Resources by type.
-    HashMap<StringHash, ResourceGroup> resourceGroups_;
+    FlatHashMap<StringHash, ResourceGroup> resourceGroups_;
     /// Resource load directories.
     Vector<String> resourceDirs_;
     /// File watchers for resource directories, if automatic reloading enabled.
     Vector<SharedPtr<FileWatcher> > fileWatchers_;
     /// Package files.
     Vector<SharedPtr<PackageFile> > packages_;
+    /// Removed package files kept alive until the files opened from their memory mapping have been closed.
+    Vector<SharedPtr<PackageFile> > removedPackages_;
     /// Dependent resources. Only used with automatic reload to eg. trigger reload of a cube texture when any of its faces change.
     HashMap<StringHash, HashSet<StringHash> > dependentResources_;
     /// Resource background loader.
@@ -239,10 +250,10 @@ template <class T> SharedPtr<T> ResourceCache::GetTempResource(const String& nam
     return StaticCast<T>(GetTempResource(type, name, sendEventOnFailure));
 }
 
-template <class T> bool ResourceCache::BackgroundLoadResource(const String& name, bool sendEventOnFailure, Resource* caller)
+template <class T> bool ResourceCache::BackgroundLoadResource(const String& name, bool sendEventOnFailure, Resource* caller, unsigned priority)
 {
     StringHash type = T::GetTypeStatic();
-    return BackgroundLoadResource(type, name, sendEventOnFailure, caller);
+    return BackgroundLoadResource(type, name, sendEventOnFailure, caller, priority);
 }
 
 template <class T> void ResourceCache::GetResources(PODVector<T*>& result) const
@@ -133,6 +133,12 @@ void Component::AddReplicationState(ComponentReplicationState* state)
     networkState_->replicationStates_.Push(state);
 }
 
+void Component::RemoveReplicationState(ComponentReplicationState* state)
+{
+    if (networkState_)
+        networkState_->replicationStates_.Remove(state);
+}
+
 void Component::PrepareNetworkUpdate()
 {
     if (!networkState_)
@@ -148,6 +154,7 @@ void Component::PrepareNetworkUpdate()
     {
         networkState_->currentValues_.Resize(numAttributes);
         networkState_->previousValues_.Resize(numAttributes);
+        networkState_->ClearUpdateCache();
 
         // Copy the default attribute values to the previous state as a starting point
         for (unsigned i = 0; i < numAttributes; ++i)
@@ -167,6 +174,8 @@ void Component::PrepareNetworkUpdate()
         if (networkState_->currentValues_[i] != networkState_->previousValues_[i])
         {
             networkState_->previousValues_[i] = networkState_->currentValues_[i];
+            // The serialized updates are now out of date
+            networkState_->ClearUpdateCache();
 
             // Mark the attribute dirty in all replication states that are tracking this component
             for (PODVector<ReplicationState*>::Iterator j = networkState_->replicationStates_.Begin(); j !=
@@ -217,6 +226,10 @@ void Component::OnNodeSet(Node* node)
 {
 }
 
+void Component::OnSceneSet(Scene* scene)
+{
+}
+
 void Component::OnMarkedDirty(Node* node)
 {
 }
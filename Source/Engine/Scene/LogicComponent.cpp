@@ -37,7 +37,9 @@ LogicComponent::LogicComponent(Context* context) :
     Component(context),
     updateEventMask_(USE_UPDATE | USE_POSTUPDATE | USE_FIXEDUPDATE | USE_FIXEDPOSTUPDATE),
     currentEventMask_(0),
-    delayedStartCalled_(false)
+    updatePhase_(0),
+    delayedStartCalled_(false),
+    threadSafeUpdate_(false)
 {
 }
 
@@ -75,6 +77,24 @@ void LogicComponent::SetUpdateEventMask(unsigned char mask)
     }
 }
 
+void LogicComponent::SetThreadSafeUpdate(bool enable)
+{
+    if (enable != threadSafeUpdate_)
+    {
+        threadSafeUpdate_ = enable;
+        UpdateEventSubscription();
+    }
+}
+
+void LogicComponent::SetUpdatePhase(unsigned phase)
+{
+    if (phase != updatePhase_)
+    {
+        updatePhase_ = phase;
+        UpdateEventSubscription();
+    }
+}
+
 void LogicComponent::OnNodeSet(Node* node)
 {
     if (node)
@@ -106,10 +126,17 @@ void LogicComponent::UpdateEventSubscription()
     
     bool enabled = IsEnabledEffective();
     
-    bool needUpdate = enabled && ((updateEventMask_ & USE_UPDATE) || !delayedStartCalled_);
+    // After the delayed start, thread-safe components are updated by the scene instead of the update events
+    bool threaded = threadSafeUpdate_ && delayedStartCalled_;
+    if (threaded && enabled && (updateEventMask_ & (USE_UPDATE | USE_POSTUPDATE)))
+        scene->AddThreadedUpdate(this);
+    else
+        scene->RemoveThreadedUpdate(this);
+    
+    bool needUpdate = enabled && !threaded && ((updateEventMask_ & USE_UPDATE) || !delayedStartCalled_);
     if (needUpdate && !(currentEventMask_ & USE_UPDATE))
     {
-        SubscribeToEvent(scene, E_SCENEUPDATE, HANDLER(LogicComponent, HandleSceneUpdate));
+        SubscribeToEvent(scene, E_SCENEUPDATE, TYPED_HANDLER(LogicComponent, HandleSceneUpdate));
         currentEventMask_ |= USE_UPDATE;
     }
     else if (!needUpdate && (currentEventMask_ & USE_UPDATE))
@@ -118,13 +145,13 @@ void LogicComponent::UpdateEventSubscription()
         currentEventMask_ &= ~USE_UPDATE;
     }
     
-    bool needPostUpdate = enabled && (updateEventMask_ & USE_POSTUPDATE);
+    bool needPostUpdate = enabled && !threaded && (updateEventMask_ & USE_POSTUPDATE);
     if (needPostUpdate && !(currentEventMask_ & USE_POSTUPDATE))
     {
         SubscribeToEvent(scene, E_SCENEPOSTUPDATE, HANDLER(LogicComponent, HandleScenePostUpdate));
         currentEventMask_ |= USE_POSTUPDATE;
     }
-    else if (!needUpdate && (currentEventMask_ & USE_POSTUPDATE))
+    else if (!needPostUpdate && (currentEventMask_ & USE_POSTUPDATE))
     {
         UnsubscribeFromEvent(scene, E_SCENEPOSTUPDATE);
         currentEventMask_ &= ~USE_POSTUPDATE;
@@ -161,16 +188,21 @@ void LogicComponent::UpdateEventSubscription()
 #endif 
 }
 
-void LogicComponent::HandleSceneUpdate(StringHash eventType, VariantMap& eventData)
+void LogicComponent::HandleSceneUpdate(StringHash eventType, SceneUpdate::Data& eventData)
 {
-    using namespace SceneUpdate;
-    
     // Execute user-defined delayed start function before first update
     if (!delayedStartCalled_)
     {
         DelayedStart();
         delayedStartCalled_ = true;
         
+        // Thread-safe components switch to the threaded update, which will also perform this frame's update
+        if (threadSafeUpdate_)
+        {
+            UpdateEventSubscription();
+            return;
+        }
+        
         // If did not need actual update events, unsubscribe now
         if (!(updateEventMask_ & USE_UPDATE))
         {
@@ -181,7 +213,7 @@ void LogicComponent::HandleSceneUpdate(StringHash eventType, VariantMap& eventDa
     }
     
     // Then execute user-defined update function
-    Update(eventData[P_TIMESTEP].GetFloat());
+    Update(eventData.timeStep_);
 }
 
 void LogicComponent::HandleScenePostUpdate(StringHash eventType, VariantMap& eventData)
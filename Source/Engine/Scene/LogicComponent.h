@@ -23,6 +23,7 @@
 #pragma once
 
 #include "Component.h"
+#include "SceneEvents.h"
 
 namespace Urho3D
 {
@@ -65,9 +66,17 @@ class URHO3D_API LogicComponent : public Component
     
     /// Set what update events should be subscribed to. Use this for optimization: by default all are in use. Note that this is not an attribute and is not saved or network-serialized, therefore it should always be called eg. in the subclass constructor.
     void SetUpdateEventMask(unsigned char mask);
+    /// Set whether Update() and PostUpdate() are thread-safe. Thread-safe components are updated in parallel in worker threads after the scene update events, batched by update phase and type. They may only modify their own scene node and its children, and should send events via Scene::DelayedSendEvent(). DelayedStart() is still called in the main thread. Like the update event mask, this is not an attribute.
+    void SetThreadSafeUpdate(bool enable);
+    /// Set threaded update phase. Components of a lower phase are updated before a higher phase begins.
+    void SetUpdatePhase(unsigned phase);
     
     /// Return what update events are subscribed to.
     unsigned char GetUpdateEventMask() const { return updateEventMask_; }
+    /// Return whether Update() and PostUpdate() are thread-safe.
+    bool GetThreadSafeUpdate() const { return threadSafeUpdate_; }
+    /// Return threaded update phase.
+    unsigned GetUpdatePhase() const { return updatePhase_; }
     /// Return whether the DelayedStart() function has been called.
     bool IsDelayedStartCalled() const { return delayedStartCalled_; }
     
@@ -79,7 +88,7 @@ private:
     /// Subscribe/unsubscribe to update events based on current enabled state and update event mask.
     void UpdateEventSubscription();
     /// Handle scene update event.
-    void HandleSceneUpdate(StringHash eventType, VariantMap& eventData);
+    void HandleSceneUpdate(StringHash eventType, SceneUpdate::Data& eventData);
     /// Handle scene post-update event.
     void HandleScenePostUpdate(StringHash eventType, VariantMap& eventData);
 #ifdef URHO3D_PHYSICS
@@ -92,8 +101,12 @@ private:
     unsigned char updateEventMask_;
     /// Current event subscription mask.
     unsigned char currentEventMask_;
+    /// Threaded update phase.
+    unsigned updatePhase_;
     /// Flag for delayed start.
     bool delayedStartCalled_;
+    /// Thread-safe update flag.
+    bool threadSafeUpdate_;
 };
 
 }
@@ -44,6 +44,7 @@ Node::Node(Context* context) :
     networkUpdate_(false),
     worldTransform_(Matrix3x4::IDENTITY),
     dirty_(false),
+    transformIndex_(M_MAX_UNSIGNED),
     enabled_(true),
     enabledPrev_(true),
     parent_(0),
@@ -78,8 +79,10 @@ void Node::RegisterObject(Context* context)
     ACCESSOR_ATTRIBUTE("Scale", GetScale, SetScale, Vector3, Vector3::ONE, AM_DEFAULT);
     ATTRIBUTE("Variables", VariantMap, vars_, Variant::emptyVariantMap, AM_FILE); // Network replication of vars uses custom data
     ACCESSOR_ATTRIBUTE("Network Position", GetNetPositionAttr, SetNetPositionAttr, Vector3, Vector3::ZERO, AM_NET | AM_LATESTDATA | AM_NOEDIT);
-    ACCESSOR_ATTRIBUTE("Network Rotation", GetNetRotationAttr, SetNetRotationAttr, PODVector<unsigned char>, Variant::emptyBuffer, AM_NET | AM_LATESTDATA | AM_NOEDIT);
+    ACCESSOR_ATTRIBUTE("Network Rotation", GetNetRotationAttr, SetNetRotationAttr, Quaternion, Quaternion::IDENTITY, AM_NET | AM_LATESTDATA | AM_NOEDIT);
     ACCESSOR_ATTRIBUTE("Network Parent Node", GetNetParentAttr, SetNetParentAttr, PODVector<unsigned char>, Variant::emptyBuffer, AM_NET | AM_NOEDIT);
+    // Send rotation as the smallest three components, which at 15 bits each is as precise as a packed quaternion
+    UPDATE_ATTRIBUTE_QUANTIZATION("Network Rotation", 0.0f, 0.0f, 15);
 }
 
 bool Node::Load(Deserializer& source, bool setInstanceDefault)
@@ -224,6 +227,12 @@ void Node::AddReplicationState(NodeReplicationState* state)
     networkState_->replicationStates_.Push(state);
 }
 
+void Node::RemoveReplicationState(NodeReplicationState* state)
+{
+    if (networkState_)
+        networkState_->replicationStates_.Remove(state);
+}
+
 bool Node::SaveXML(Serializer& dest) const
 {
     SharedPtr<XMLFile> xml(new XMLFile(context_));
@@ -542,7 +551,15 @@ void Node::SetOwner(Connection* owner)
 
 void Node::MarkDirty()
 {
+    // Whenever a node is marked dirty, all its children are marked dirty as well, and whenever a node's dirty flag is
+    // cleared, its parent has been cleared first. Therefore if the node already is dirty, the children and listeners do
+    // not need to be visited again
+    if (dirty_)
+        return;
+
     dirty_ = true;
+    if (transformIndex_ != M_MAX_UNSIGNED)
+        scene_->MarkTransformDirty(transformIndex_);
 
     // Notify listener components first, then mark child nodes
     for (Vector<WeakPtr<Component> >::Iterator i = listeners_.Begin(); i != listeners_.End();)
@@ -616,6 +633,8 @@ void Node::AddChild(Node* node, unsigned index)
 
     node->parent_ = this;
     node->MarkDirty();
+    if (scene_)
+        scene_->MarkTransformOrderDirty();
     node->MarkNetworkUpdate();
 
     // Send change event
@@ -1073,6 +1092,7 @@ void Node::SetID(unsigned id)
 void Node::SetScene(Scene* scene)
 {
     scene_ = scene;
+    transformIndex_ = M_MAX_UNSIGNED;
 }
 
 void Node::ResetScene()
@@ -1091,14 +1111,13 @@ void Node::SetNetPositionAttr(const Vector3& value)
         SetPosition(value);
 }
 
-void Node::SetNetRotationAttr(const PODVector<unsigned char>& value)
+void Node::SetNetRotationAttr(const Quaternion& value)
 {
-    MemoryBuffer buf(value);
     SmoothedTransform* transform = GetComponent<SmoothedTransform>();
     if (transform)
-        transform->SetTargetRotation(buf.ReadPackedQuaternion());
+        transform->SetTargetRotation(value);
     else
-        SetRotation(buf.ReadPackedQuaternion());
+        SetRotation(value);
 }
 
 void Node::SetNetParentAttr(const PODVector<unsigned char>& value)
@@ -1143,11 +1162,9 @@ const Vector3& Node::GetNetPositionAttr() const
     return position_;
 }
 
-const PODVector<unsigned char>& Node::GetNetRotationAttr() const
+const Quaternion& Node::GetNetRotationAttr() const
 {
-    attrBuffer_.Clear();
-    attrBuffer_.WritePackedQuaternion(rotation_);
-    return attrBuffer_.GetBuffer();
+    return rotation_;
 }
 
 const PODVector<unsigned char>& Node::GetNetParentAttr() const
@@ -1301,6 +1318,7 @@ void Node::PrepareNetworkUpdate()
     {
         networkState_->currentValues_.Resize(numAttributes);
         networkState_->previousValues_.Resize(numAttributes);
+        networkState_->ClearUpdateCache();
 
         // Copy the default attribute values to the previous state as a starting point
         for (unsigned i = 0; i < numAttributes; ++i)
@@ -1320,6 +1338,8 @@ void Node::PrepareNetworkUpdate()
         if (networkState_->currentValues_[i] != networkState_->previousValues_[i])
         {
             networkState_->previousValues_[i] = networkState_->currentValues_[i];
+            // The serialized updates are now out of date
+            networkState_->ClearUpdateCache();
 
             // Mark the attribute dirty in all replication states that are tracking this node
             for (PODVector<ReplicationState*>::Iterator j = networkState_->replicationStates_.Begin(); j !=
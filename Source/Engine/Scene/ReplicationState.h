@@ -27,6 +27,7 @@
 #include "HashSet.h"
 #include "Ptr.h"
 #include "StringHash.h"
+#include "VectorBuffer.h"
 
 #include <cstring>
 
@@ -34,6 +35,8 @@ namespace Urho3D
 {
 
 static const unsigned MAX_NETWORK_ATTRIBUTES = 64;
+static const unsigned MAX_CACHED_DELTA_UPDATES = 16;
+static const unsigned MAX_UNACKED_SNAPSHOTS = 32;
 
 class Component;
 class Connection;
@@ -99,6 +102,22 @@ struct URHO3D_API DirtyBits
         count_ = 0;
     }
     
+    /// Add the bits set in another set of bits.
+    DirtyBits& operator |= (const DirtyBits& rhs)
+    {
+        count_ = 0;
+        for (unsigned i = 0; i < MAX_NETWORK_ATTRIBUTES / 8; ++i)
+        {
+            data_[i] |= rhs.data_[i];
+            for (unsigned char bits = data_[i]; bits; bits &= bits - 1)
+                ++count_;
+        }
+        return *this;
+    }
+    
+    /// Test for equality with another set of bits.
+    bool operator == (const DirtyBits& rhs) const { return !memcmp(data_, rhs.data_, MAX_NETWORK_ATTRIBUTES / 8); }
+    
     /// Return if bit is set.
     bool IsSet(unsigned index) const
     {
@@ -121,9 +140,42 @@ struct URHO3D_API DirtyBits
     unsigned char count_;
 };
 
+/// Serialized network delta update, cached for sending to several connections.
+struct URHO3D_API CachedDeltaUpdate
+{
+    /// Dirty attribute bits the update was written with.
+    DirtyBits attributeBits_;
+    /// Serialized update data.
+    VectorBuffer data_;
+};
+
+/// Attributes sent in a snapshot update that the client has not acknowledged yet.
+struct URHO3D_API UnackedSnapshot
+{
+    /// Snapshot ID.
+    unsigned snapshotID_;
+    /// Attribute bits that changed in the snapshot.
+    DirtyBits attributeBits_;
+};
+
 /// Per-object attribute state for network replication, allocated on demand.
 struct URHO3D_API NetworkState
 {
+    /// Construct.
+    NetworkState() :
+        attributes_(0),
+        numDeltaUpdates_(0),
+        updateCacheLock_(0)
+    {
+    }
+    
+    /// Invalidate the serialized updates. Called when the attribute values change.
+    void ClearUpdateCache()
+    {
+        numDeltaUpdates_ = 0;
+        latestData_.Clear();
+    }
+    
     /// Cached network attribute infos.
     const Vector<AttributeInfo>* attributes_;
     /// Current network attribute values.
@@ -134,6 +186,14 @@ struct URHO3D_API NetworkState
     PODVector<ReplicationState*> replicationStates_;
     /// Previous user variables.
     VariantMap previousVars_;
+    /// Serialized delta updates, shared by the connections that have the same attributes dirty.
+    Vector<CachedDeltaUpdate> deltaUpdates_;
+    /// Number of valid serialized delta updates.
+    unsigned numDeltaUpdates_;
+    /// Serialized latest data update. Empty when not valid.
+    VectorBuffer latestData_;
+    /// Spin lock for the serialized updates, as connections may be updated in worker threads.
+    volatile int updateCacheLock_;
 };
 
 /// Base class for per-user network replication states.
@@ -146,12 +206,23 @@ struct URHO3D_API ReplicationState
 /// Per-user component network replication state.
 struct URHO3D_API ComponentReplicationState : public ReplicationState
 {
+    /// Construct.
+    ComponentReplicationState() :
+        ReplicationState(),
+        ackedSnapshotID_(0)
+    {
+    }
+    
     /// Parent node replication state.
     NodeReplicationState* nodeState_;
     /// Link to the actual component.
     WeakPtr<Component> component_;
     /// Dirty attribute bits.
     DirtyBits dirtyAttributes_;
+    /// Attribute changes sent in snapshot updates but not acknowledged yet.
+    Vector<UnackedSnapshot> unackedSnapshots_;
+    /// Newest snapshot update the client has acknowledged.
+    unsigned ackedSnapshotID_;
 };
 
 /// Per-user node network replication state.
@@ -160,6 +231,7 @@ struct URHO3D_API NodeReplicationState : public ReplicationState
     /// Construct.
     NodeReplicationState() :
         ReplicationState(),
+        ackedSnapshotID_(0),
         priorityAcc_(0.0f),
         markedDirty_(false)
     {
@@ -173,6 +245,10 @@ struct URHO3D_API NodeReplicationState : public ReplicationState
     DirtyBits dirtyAttributes_;
     /// Dirty user vars.
     HashSet<StringHash> dirtyVars_;
+    /// Attribute changes sent in snapshot updates but not acknowledged yet.
+    Vector<UnackedSnapshot> unackedSnapshots_;
+    /// Newest snapshot update the client has acknowledged.
+    unsigned ackedSnapshotID_;
     /// Components by ID.
     HashMap<unsigned, ComponentReplicationState> componentStates_;
     /// Interest management priority accumulator.
@@ -188,11 +264,14 @@ struct URHO3D_API SceneReplicationState : public ReplicationState
     HashMap<unsigned, NodeReplicationState> nodeStates_;
     /// Dirty node IDs.
     HashSet<unsigned> dirtyNodes_;
+    /// Replicated node IDs whose relevance depends on distance.
+    HashSet<unsigned> relevanceNodes_;
     
     void Clear()
     {
         nodeStates_.Clear();
         dirtyNodes_.Clear();
+        relevanceNodes_.Clear();
     }
 };
 
@@ -26,6 +26,8 @@
 #include "CoreEvents.h"
 #include "File.h"
 #include "Log.h"
+#include "LogicComponent.h"
+#include "MemoryTracker.h"
 #include "ObjectAnimation.h"
 #include "PackageFile.h"
 #include "Profiler.h"
@@ -35,6 +37,7 @@
 #include "Scene.h"
 #include "SceneEvents.h"
 #include "SmoothedTransform.h"
+#include "Sort.h"
 #include "SplinePath.h"
 #include "UnknownComponent.h"
 #include "ValueAnimation.h"
@@ -52,6 +55,91 @@ const char* SUBSYSTEM_CATEGORY = "Subsystem";
 
 static const float DEFAULT_SMOOTHING_CONSTANT = 50.0f;
 static const float DEFAULT_SNAP_THRESHOLD = 5.0f;
+static const unsigned LOGIC_UPDATES_PER_WORK_RANGE = 16;
+static const unsigned SMOOTHING_UPDATES_PER_WORK_RANGE = 64;
+/// Type of the network priority component, which is defined in the optional Network library.
+
+/// Threaded logic component update task.
+struct LogicUpdateTask
+{
+    /// Construct.
+    LogicUpdateTask(const PODVector<LogicComponent*>& components, float timeStep, bool postUpdate) :
+        components_(components),
+        timeStep_(timeStep),
+        postUpdate_(postUpdate)
+    {
+    }
+    
+    /// Update a range of logic components.
+    void operator () (unsigned start, unsigned end, unsigned threadIndex)
+    {
+        if (!postUpdate_)
+        {
+            for (unsigned i = start; i < end; ++i)
+                components_[i]->Update(timeStep_);
+        }
+        else
+        {
+            for (unsigned i = start; i < end; ++i)
+                components_[i]->PostUpdate(timeStep_);
+        }
+    }
+    
+    /// Logic components.
+    const PODVector<LogicComponent*>& components_;
+    /// Timestep.
+    float timeStep_;
+    /// Post-update flag.
+    bool postUpdate_;
+};
+
+/// Threaded transform smoothing task.
+struct SmoothingUpdateTask
+{
+    /// Construct.
+    SmoothingUpdateTask(const PODVector<SmoothedTransform*>& components, float constant, float squaredSnapThreshold) :
+        components_(components),
+        constant_(constant),
+        squaredSnapThreshold_(squaredSnapThreshold)
+    {
+    }
+    
+    /// Update a range of smoothed transforms.
+    void operator () (unsigned start, unsigned end, unsigned threadIndex)
+    {
+        for (unsigned i = start; i < end; ++i)
+            components_[i]->Update(constant_, squaredSnapThreshold_);
+    }
+    
+    /// Smoothed transforms.
+    const PODVector<SmoothedTransform*>& components_;
+    /// Smoothing constant.
+    float constant_;
+    /// Squared snap threshold.
+    float squaredSnapThreshold_;
+};
+
+/// Return whether a node has an ancestor with smoothing in progress.
+static bool HasSmoothedAncestor(Node* node, const HashSet<Component*>& smoothedTransforms)
+{
+    for (Node* parent = node->GetParent(); parent; parent = parent->GetParent())
+    {
+        Component* transform = parent->GetComponent<SmoothedTransform>();
+        if (transform && smoothedTransforms.Contains(transform))
+            return true;
+    }
+    
+    return false;
+}
+
+/// Compare logic components for threaded update order: first by update phase, then by type to keep same type components together.
+static bool CompareThreadedUpdates(LogicComponent* lhs, LogicComponent* rhs)
+{
+    if (lhs->GetUpdatePhase() != rhs->GetUpdatePhase())
+        return lhs->GetUpdatePhase() < rhs->GetUpdatePhase();
+    else
+        return lhs->GetType() < rhs->GetType();
+}
 
 Scene::Scene(Context* context) :
     Node(context),
@@ -67,7 +155,10 @@ Scene::Scene(Context* context) :
     snapThreshold_(DEFAULT_SNAP_THRESHOLD),
     updateEnabled_(true),
     asyncLoading_(false),
-    threadedUpdate_(false)
+    threadedUpdate_(false),
+    threadedUpdatesDirty_(false),
+    batchedTransforms_(false),
+    transformOrderDirty_(false)
 {
     // Assign an ID to self so that nodes can refer to this node as a parent
     SetID(GetFreeNodeID(REPLICATED));
@@ -503,6 +594,32 @@ void Scene::SetAsyncLoadingMs(int ms)
     asyncLoadingMs_ = Max(ms, 1);
 }
 
+void Scene::SetBatchedTransforms(bool enable)
+{
+    if (enable == batchedTransforms_)
+        return;
+
+    batchedTransforms_ = enable;
+
+    if (enable)
+        transformOrderDirty_ = true;
+    else
+    {
+        // The arrays may contain already removed nodes, so reset the indices through the live hierarchy instead
+        PODVector<Node*> nodes;
+        GetChildren(nodes, true);
+        for (PODVector<Node*>::Iterator i = nodes.Begin(); i != nodes.End(); ++i)
+            (*i)->transformIndex_ = M_MAX_UNSIGNED;
+
+        transformNodes_.Clear();
+        transformParents_.Clear();
+        worldTransforms_.Clear();
+        worldRotations_.Clear();
+        transformDirty_.Clear();
+        transformOrderDirty_ = false;
+    }
+}
+
 void Scene::SetElapsedTime(float time)
 {
     elapsedTime_ = time;
@@ -605,6 +722,7 @@ void Scene::Update(float timeStep)
     }
 
     PROFILE(UpdateScene);
+    MEMORY_CATEGORY(MEMCAT_SCENE);
 
     timeStep *= timeScale_;
 
@@ -614,8 +732,16 @@ void Scene::Update(float timeStep)
     eventData[P_SCENE] = this;
     eventData[P_TIMESTEP] = timeStep;
 
-    // Update variable timestep logic
-    SendEvent(E_SCENEUPDATE, eventData);
+    // Update variable timestep logic. Use a typed payload, as this is sent to every logic component and script object
+    SceneUpdate::Data updateData;
+    updateData.scene_ = this;
+    updateData.timeStep_ = timeStep;
+    SendEvent(E_SCENEUPDATE, updateData);
+
+    // Update thread-safe logic components in parallel
+    if (threadedUpdatesDirty_)
+        SortThreadedUpdates();
+    UpdateThreaded(threadedUpdates_, timeStep, false);
 
     // Update scene attribute animation.
     SendEvent(E_ATTRIBUTEANIMATIONUPDATE, eventData);
@@ -630,16 +756,25 @@ void Scene::Update(float timeStep)
         float constant = 1.0f - Clamp(powf(2.0f, -timeStep * smoothingConstant_), 0.0f, 1.0f);
         float squaredSnapThreshold = snapThreshold_ * snapThreshold_;
 
-        using namespace UpdateSmoothing;
-
-        smoothingData_[P_CONSTANT] = constant;
-        smoothingData_[P_SQUAREDSNAPTHRESHOLD] = squaredSnapThreshold;
-        SendEvent(E_UPDATESMOOTHING, smoothingData_);
+        UpdateSmoothing::Data smoothingData;
+        smoothingData.constant_ = constant;
+        smoothingData.squaredSnapThreshold_ = squaredSnapThreshold;
+        SendEvent(E_UPDATESMOOTHING, smoothingData);
+        UpdateSmoothedTransforms(constant, squaredSnapThreshold);
     }
 
     // Post-update variable timestep logic
     SendEvent(E_SCENEPOSTUPDATE, eventData);
 
+    // Post-update thread-safe logic components in parallel
+    if (threadedUpdatesDirty_)
+        SortThreadedUpdates();
+    UpdateThreaded(threadedPostUpdates_, timeStep, true);
+
+    // Recalculate dirty world transforms in one pass
+    if (batchedTransforms_)
+        UpdateTransforms();
+
     // Note: using a float for elapsed time accumulation is inherently inaccurate. The purpose of this value is
     // primarily to update material animation effects, as it is available to shaders. It can be reset by calling
     // SetElapsedTime()
@@ -668,6 +803,20 @@ void Scene::EndThreadedUpdate()
             (*i)->OnMarkedDirty((*i)->GetNode());
         delayedDirtyComponents_.Clear();
     }
+
+    if (!delayedEvents_.Empty())
+    {
+        PROFILE(SendDelayedEvents);
+
+        // Swap the queue out first, as the event handlers may queue more events
+        Vector<DelayedEvent> events;
+        events.Swap(delayedEvents_);
+        for (Vector<DelayedEvent>::Iterator i = events.Begin(); i != events.End(); ++i)
+        {
+            if (i->sender_)
+                i->sender_->SendEvent(i->eventType_, i->eventData_);
+        }
+    }
 }
 
 void Scene::DelayedMarkedDirty(Component* component)
@@ -676,6 +825,116 @@ void Scene::DelayedMarkedDirty(Component* component)
     delayedDirtyComponents_.Push(component);
 }
 
+void Scene::DelayedSendEvent(Object* sender, StringHash eventType, const VariantMap& eventData)
+{
+    if (!sender)
+        return;
+
+    if (!threadedUpdate_)
+    {
+        VariantMap data = eventData;
+        sender->SendEvent(eventType, data);
+    }
+    else
+    {
+        MutexLock lock(sceneMutex_);
+        delayedEvents_.Resize(delayedEvents_.Size() + 1);
+        DelayedEvent& event = delayedEvents_.Back();
+        event.sender_ = sender;
+        event.eventType_ = eventType;
+        event.eventData_ = eventData;
+    }
+}
+
+void Scene::AddThreadedUpdate(LogicComponent* component)
+{
+    if (!component)
+        return;
+
+    // Always mark the lists dirty, as the component's update event mask or phase may have changed
+    threadedUpdateComponents_.Insert(component);
+    threadedUpdatesDirty_ = true;
+}
+
+void Scene::RemoveThreadedUpdate(LogicComponent* component)
+{
+    if (threadedUpdateComponents_.Erase(component))
+        threadedUpdatesDirty_ = true;
+}
+
+void Scene::AddSmoothedTransform(SmoothedTransform* component)
+{
+    if (component)
+        smoothedTransforms_.Insert(component);
+}
+
+void Scene::RemoveSmoothedTransform(SmoothedTransform* component)
+{
+    smoothedTransforms_.Erase(component);
+}
+
+void Scene::AddNetworkPriority(Component* component)
+{
+    if (component)
+        networkPriorities_.Insert(component);
+}
+
+void Scene::RemoveNetworkPriority(Component* component)
+{
+    networkPriorities_.Erase(component);
+}
+
+void Scene::UpdateTransforms()
+{
+    if (!batchedTransforms_)
+        return;
+
+    PROFILE(UpdateTransforms);
+
+    if (transformOrderDirty_)
+        SortTransforms();
+
+    unsigned numNodes = transformNodes_.Size();
+    if (!numNodes)
+        return;
+
+    Node** nodes = &transformNodes_[0];
+    const unsigned* parents = &transformParents_[0];
+    Matrix3x4* worldTransforms = &worldTransforms_[0];
+    Quaternion* worldRotations = &worldRotations_[0];
+    unsigned char* dirty = &transformDirty_[0];
+
+    // Parents are always before their children, so a parent's world transform is up to date when the child is reached
+    for (unsigned i = 0; i < numNodes; ++i)
+    {
+        unsigned parent = parents[i];
+        if (parent != M_MAX_UNSIGNED)
+            dirty[i] |= dirty[parent];
+        if (!dirty[i])
+            continue;
+
+        Node* node = nodes[i];
+        Matrix3x4 transform(node->position_, node->rotation_, node->scale_);
+        // Assume the root node (scene) has identity transform
+        if (parent == M_MAX_UNSIGNED)
+        {
+            worldTransforms[i] = transform;
+            worldRotations[i] = node->rotation_;
+        }
+        else
+        {
+            worldTransforms[i] = worldTransforms[parent] * transform;
+            worldRotations[i] = worldRotations[parent] * node->rotation_;
+        }
+
+        node->worldTransform_ = worldTransforms[i];
+        node->worldRotation_ = worldRotations[i];
+        node->dirty_ = false;
+    }
+
+    memset(dirty, 0, numNodes);
+}
+
 unsigned Scene::GetFreeNodeID(CreateMode mode)
 {
     if (mode == REPLICATED)
@@ -790,6 +1049,14 @@ void Scene::NodeAdded(Node* node)
 
         localNodes_[id] = node;
     }
+    
+    // Add the components and child nodes of a node created outside the scene as well
+    const Vector<SharedPtr<Component> >& components = node->GetComponents();
+    for (Vector<SharedPtr<Component> >::ConstIterator i = components.Begin(); i != components.End(); ++i)
+        ComponentAdded(*i);
+    const Vector<SharedPtr<Node> >& children = node->GetChildren();
+    for (Vector<SharedPtr<Node> >::ConstIterator i = children.Begin(); i != children.End(); ++i)
+        NodeAdded(*i);
 }
 
 void Scene::NodeRemoved(Node* node)
@@ -808,6 +1075,7 @@ void Scene::NodeRemoved(Node* node)
 
     node->SetID(0);
     node->SetScene(0);
+    transformOrderDirty_ = true;
     // Remove components and child nodes as well
     const Vector<SharedPtr<Component> >& components = node->GetComponents();
     for (Vector<SharedPtr<Component> >::ConstIterator i = components.Begin(); i != components.End(); ++i)
@@ -822,7 +1090,15 @@ void Scene::ComponentAdded(Component* component)
     if (!component)
         return;
 
+    // If the component was created outside the scene without an ID, assign one of the same kind as its node's ID
     unsigned id = component->GetID();
+    if (!id)
+    {
+        Node* node = component->GetNode();
+        id = GetFreeComponentID(node && node->GetID() >= FIRST_LOCAL_ID ? LOCAL : REPLICATED);
+        component->SetID(id);
+    }
+    
     if (id < FIRST_LOCAL_ID)
     {
         HashMap<unsigned, Component*>::Iterator i = replicatedComponents_.Find(id);
@@ -845,6 +1121,8 @@ void Scene::ComponentAdded(Component* component)
 
         localComponents_[id] = component;
     }
+    
+    component->OnSceneSet(this);
 }
 
 void Scene::ComponentRemoved(Component* component)
@@ -859,6 +1137,133 @@ void Scene::ComponentRemoved(Component* component)
         localComponents_.Erase(id);
 
     component->SetID(0);
+    component->OnSceneSet(0);
+
+    // Remove from the threaded logic and smoothing updates, if participating
+    if (!threadedUpdateComponents_.Empty() && threadedUpdateComponents_.Erase(component))
+        threadedUpdatesDirty_ = true;
+    if (!smoothedTransforms_.Empty())
+        smoothedTransforms_.Erase(component);
+}
+
+void Scene::SortThreadedUpdates()
+{
+    threadedUpdates_.Clear();
+    threadedPostUpdates_.Clear();
+
+    for (HashSet<Component*>::ConstIterator i = threadedUpdateComponents_.Begin(); i != threadedUpdateComponents_.End(); ++i)
+    {
+        LogicComponent* component = static_cast<LogicComponent*>(*i);
+        unsigned char mask = component->GetUpdateEventMask();
+        if (mask & USE_UPDATE)
+            threadedUpdates_.Push(component);
+        if (mask & USE_POSTUPDATE)
+            threadedPostUpdates_.Push(component);
+    }
+
+    Sort(threadedUpdates_.Begin(), threadedUpdates_.End(), CompareThreadedUpdates);
+    Sort(threadedPostUpdates_.Begin(), threadedPostUpdates_.End(), CompareThreadedUpdates);
+    threadedUpdatesDirty_ = false;
+}
+
+void Scene::UpdateThreaded(const PODVector<LogicComponent*>& components, float timeStep, bool postUpdate)
+{
+    if (components.Empty())
+        return;
+
+    PROFILE(UpdateThreadedLogic);
+
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    LogicUpdateTask task(components, timeStep, postUpdate);
+
+    BeginThreadedUpdate();
+
+    // Each update phase must complete before the next one begins, so that later phases can depend on the results
+    unsigned start = 0;
+    while (start < components.Size())
+    {
+        unsigned phase = components[start]->GetUpdatePhase();
+        unsigned end = start + 1;
+        while (end < components.Size() && components[end]->GetUpdatePhase() == phase)
+            ++end;
+
+        queue->ParallelFor(start, end, LOGIC_UPDATES_PER_WORK_RANGE, task);
+        start = end;
+    }
+
+    // Process delayed dirty notifications and events on the main thread
+    EndThreadedUpdate();
+}
+
+void Scene::UpdateSmoothedTransforms(float constant, float squaredSnapThreshold)
+{
+    if (smoothedTransforms_.Empty())
+        return;
+
+    // Moving a node marks its whole subtree dirty, so a smoothed transform below another one can not be updated at
+    // the same time with it. Update those serially after the independent ones
+    smoothingUpdates_.Clear();
+    nestedSmoothingUpdates_.Clear();
+    for (HashSet<Component*>::ConstIterator i = smoothedTransforms_.Begin(); i != smoothedTransforms_.End(); ++i)
+    {
+        SmoothedTransform* transform = static_cast<SmoothedTransform*>(*i);
+        if (HasSmoothedAncestor(transform->GetNode(), smoothedTransforms_))
+            nestedSmoothingUpdates_.Push(transform);
+        else
+            smoothingUpdates_.Push(transform);
+    }
+    unsigned numIndependent = smoothingUpdates_.Size();
+    smoothingUpdates_.Push(nestedSmoothingUpdates_);
+
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    SmoothingUpdateTask task(smoothingUpdates_, constant, squaredSnapThreshold);
+
+    BeginThreadedUpdate();
+    queue->ParallelFor(0, numIndependent, SMOOTHING_UPDATES_PER_WORK_RANGE, task);
+    task(numIndependent, smoothingUpdates_.Size(), 0);
+    EndThreadedUpdate();
+
+    // Remove the transforms that have finished smoothing
+    for (PODVector<SmoothedTransform*>::ConstIterator i = smoothingUpdates_.Begin(); i != smoothingUpdates_.End(); ++i)
+    {
+        if (!(*i)->IsInProgress())
+            smoothedTransforms_.Erase(*i);
+    }
+}
+
+void Scene::SortTransforms()
+{
+    transformNodes_.Clear();
+    transformParents_.Clear();
+
+    // Breadth-first traversal, so that every node is stored after its parent
+    for (Vector<SharedPtr<Node> >::ConstIterator i = children_.Begin(); i != children_.End(); ++i)
+    {
+        transformNodes_.Push(*i);
+        transformParents_.Push(M_MAX_UNSIGNED);
+    }
+    for (unsigned i = 0; i < transformNodes_.Size(); ++i)
+    {
+        Node* node = transformNodes_[i];
+        node->transformIndex_ = i;
+
+        const Vector<SharedPtr<Node> >& children = node->GetChildren();
+        for (Vector<SharedPtr<Node> >::ConstIterator j = children.Begin(); j != children.End(); ++j)
+        {
+            transformNodes_.Push(*j);
+            transformParents_.Push(i);
+        }
+    }
+
+    // Recalculate everything on the first update after rebuild
+    unsigned numNodes = transformNodes_.Size();
+    worldTransforms_.Resize(numNodes);
+    worldRotations_.Resize(numNodes);
+    transformDirty_.Resize(numNodes);
+    if (numNodes)
+        memset(&transformDirty_[0], 1, numNodes);
+
+    transformOrderDirty_ = false;
 }
 
 void Scene::SetVarNamesAttr(const String& value)
@@ -32,7 +32,9 @@ namespace Urho3D
 {
 
 class File;
+class LogicComponent;
 class PackageFile;
+class SmoothedTransform;
 
 static const unsigned FIRST_REPLICATED_ID = 0x1;
 static const unsigned LAST_REPLICATED_ID = 0xffffff;
@@ -50,6 +52,17 @@ enum LoadMode
     LOAD_SCENE_AND_RESOURCES
 };
 
+/// Event queued to be sent after a threaded update.
+struct DelayedEvent
+{
+    /// Sender.
+    WeakPtr<Object> sender_;
+    /// Event type.
+    StringHash eventType_;
+    /// Event data.
+    VariantMap eventData_;
+};
+
 /// Asynchronous loading progress of a scene.
 struct AsyncProgress
 {
@@ -130,6 +143,8 @@ public:
     void SetSnapThreshold(float threshold);
     /// Set maximum milliseconds per frame to spend on async scene loading.
     void SetAsyncLoadingMs(int ms);
+    /// Enable or disable batched world transform update. When enabled, the world transforms of dirty nodes are recalculated once per frame at the end of the scene update, in hierarchy order from contiguous arrays. Transforms that are read before that are still recalculated on demand.
+    void SetBatchedTransforms(bool enable);
     /// Add a required package file for networking. To be called on the server.
     void AddRequiredPackageFile(PackageFile* package);
     /// Clear required package files.
@@ -167,6 +182,8 @@ public:
     float GetSnapThreshold() const { return snapThreshold_; }
     /// Return maximum milliseconds per frame to spend on async loading.
     int GetAsyncLoadingMs() const { return asyncLoadingMs_; }
+    /// Return whether batched world transform update is enabled.
+    bool GetBatchedTransforms() const { return batchedTransforms_; }
     /// Return required package files.
     const Vector<SharedPtr<PackageFile> >& GetRequiredPackageFiles() const { return requiredPackageFiles_; }
     /// Return a node user variable name, or empty if not registered.
@@ -180,6 +197,28 @@ public:
     void EndThreadedUpdate();
     /// Add a component to the delayed dirty notify queue. Is thread-safe.
     void DelayedMarkedDirty(Component* component);
+    /// Send an event after the threaded update has ended, or immediately if not in threaded update. Is thread-safe. The event data should not contain RefCounted pointers, as their reference counts are not thread-safe.
+    void DelayedSendEvent(Object* sender, StringHash eventType, const VariantMap& eventData);
+    /// Add a thread-safe logic component to the threaded logic update. Called by LogicComponent.
+    void AddThreadedUpdate(LogicComponent* component);
+    /// Remove a logic component from the threaded logic update. Called by LogicComponent.
+    void RemoveThreadedUpdate(LogicComponent* component);
+    /// Add a smoothed transform to the smoothing update. Called by SmoothedTransform.
+    void AddSmoothedTransform(SmoothedTransform* component);
+    /// Remove a smoothed transform from the smoothing update. Called by SmoothedTransform.
+    void RemoveSmoothedTransform(SmoothedTransform* component);
+    /// Add a network priority component to the replication interest management. Called by NetworkPriority.
+    void AddNetworkPriority(Component* component);
+    /// Remove a network priority component from the replication interest management. Called by NetworkPriority.
+    void RemoveNetworkPriority(Component* component);
+    /// Return network priority components for the replication interest management.
+    const HashSet<Component*>& GetNetworkPriorities() const { return networkPriorities_; }
+    /// Recalculate the world transforms of all dirty nodes in hierarchy order. Called at the end of Update() when batched transforms are enabled.
+    void UpdateTransforms();
+    /// Mark a node's world transform dirty in the batched transform update. Called by Node.
+    void MarkTransformDirty(unsigned index) { transformDirty_[index] = 1; }
+    /// Mark the batched transform hierarchy order dirty. Called by Node when adding a child.
+    void MarkTransformOrderDirty() { transformOrderDirty_ = true; }
     /// Return threaded update flag.
     bool IsThreadedUpdate() const { return threadedUpdate_; }
     /// Get free node ID, either non-local or local.
@@ -202,6 +241,8 @@ public:
     void PrepareNetworkUpdate();
     /// Clean up all references to a network connection that is about to be removed.
     void CleanupConnection(Connection* connection);
+    /// Return the mutex for adding and removing network replication states while connections are updated in worker threads.
+    Mutex& GetReplicationMutex() { return replicationMutex_; }
     /// Mark a node for attribute check on the next network update.
     void MarkNetworkUpdate(Node* node);
     /// Mark a comoponent for attribute check on the next network update.
@@ -226,6 +267,14 @@ private:
     void PreloadResources(File* file, bool isSceneFile);
     /// Preload resources from an XML scene or object prefab file.
     void PreloadResourcesXML(const XMLElement& element);
+    /// Rebuild the threaded logic update lists, sorted by update phase and component type.
+    void SortThreadedUpdates();
+    /// Run threaded Update() or PostUpdate() on logic components, one update phase at a time.
+    void UpdateThreaded(const PODVector<LogicComponent*>& components, float timeStep, bool postUpdate);
+    /// Update transform smoothing of all smoothed transforms.
+    void UpdateSmoothedTransforms(float constant, float squaredSnapThreshold);
+    /// Rebuild the batched transform arrays in hierarchy order.
+    void SortTransforms();
 
     /// Replicated scene nodes by ID.
     HashMap<unsigned, Node*> replicatedNodes_;
@@ -251,10 +300,36 @@ private:
     HashSet<unsigned> networkUpdateComponents_;
     /// Delayed dirty notification queue for components.
     PODVector<Component*> delayedDirtyComponents_;
-    /// Mutex for the delayed dirty notification queue.
+    /// Delayed event queue.
+    Vector<DelayedEvent> delayedEvents_;
+    /// Mutex for the delayed dirty notification and event queues.
     Mutex sceneMutex_;
-    /// Preallocated event data map for smoothing update events.
-    VariantMap smoothingData_;
+    /// Mutex for adding and removing network replication states.
+    Mutex replicationMutex_;
+    /// Logic components participating in the threaded logic update.
+    HashSet<Component*> threadedUpdateComponents_;
+    /// Logic components for threaded Update(), sorted by update phase and type.
+    PODVector<LogicComponent*> threadedUpdates_;
+    /// Logic components for threaded PostUpdate(), sorted by update phase and type.
+    PODVector<LogicComponent*> threadedPostUpdates_;
+    /// Smoothed transforms with smoothing in progress.
+    HashSet<Component*> smoothedTransforms_;
+    /// Smoothed transforms to update this frame. The ones without a smoothed ancestor node come first.
+    PODVector<SmoothedTransform*> smoothingUpdates_;
+    /// Smoothed transforms that have a smoothed ancestor node, to be updated serially.
+    PODVector<SmoothedTransform*> nestedSmoothingUpdates_;
+    /// Network priority components for the replication interest management.
+    HashSet<Component*> networkPriorities_;
+    /// Nodes for batched transform update in hierarchy order, parents before children.
+    PODVector<Node*> transformNodes_;
+    /// Parent indices for batched transform update, or M_MAX_UNSIGNED for the scene's direct children.
+    PODVector<unsigned> transformParents_;
+    /// World transforms for batched transform update.
+    PODVector<Matrix3x4> worldTransforms_;
+    /// World rotations for batched transform update.
+    PODVector<Quaternion> worldRotations_;
+    /// Dirty flags for batched transform update.
+    PODVector<unsigned char> transformDirty_;
     /// Next free non-local node ID.
     unsigned replicatedNodeID_;
     /// Next free non-local component ID.
@@ -281,6 +356,12 @@ private:
     bool asyncLoading_;
     /// Threaded update flag.
     bool threadedUpdate_;
+    /// Threaded logic update lists need rebuild flag.
+    bool threadedUpdatesDirty_;
+    /// Batched transform update flag.
+    bool batchedTransforms_;
+    /// Batched transform arrays need rebuild flag.
+    bool transformOrderDirty_;
 };
 
 /// Register Scene library objects.
@@ -27,11 +27,15 @@
 namespace Urho3D
 {
 
+class Scene;
+
 /// Variable timestep scene update.
 EVENT(E_SCENEUPDATE, SceneUpdate)
 {
     PARAM(P_SCENE, Scene);                  // Scene pointer
     PARAM(P_TIMESTEP, TimeStep);            // float
+    
+    EVENT_DATA2(E_SCENEUPDATE, P_SCENE, EventPtr<Scene>, scene_, P_TIMESTEP, float, timeStep_);
 }
 
 /// Scene subsystem update.
@@ -46,6 +50,8 @@ EVENT(E_UPDATESMOOTHING, UpdateSmoothing)
 {
     PARAM(P_CONSTANT, Constant);            // float
     PARAM(P_SQUAREDSNAPTHRESHOLD, SquaredSnapThreshold);  // float
+    
+    EVENT_DATA2(E_UPDATESMOOTHING, P_CONSTANT, float, constant_, P_SQUAREDSNAPTHRESHOLD, float, squaredSnapThreshold_);
 }
 
 /// Scene drawable update finished. Custom animation (eg. IK) can be done at this point.
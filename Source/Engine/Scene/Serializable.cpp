@@ -21,6 +21,9 @@
 //
 
 #include "Precompiled.h"
+#include "Atomic.h"
+#include "BitReader.h"
+#include "BitWriter.h"
 #include "Context.h"
 #include "Deserializer.h"
 #include "Log.h"
@@ -28,6 +31,7 @@
 #include "SceneEvents.h"
 #include "Serializable.h"
 #include "Serializer.h"
+#include "Timer.h"
 #include "XMLElement.h"
 
 #include "DebugNew.h"
@@ -35,6 +39,205 @@
 namespace Urho3D
 {
 
+/// Number of spins on the network update cache lock before yielding the thread.
+static const unsigned UPDATE_CACHE_LOCK_SPINS = 100;
+
+/// Scoped spin lock for the network update cache. Held only while serializing one update, so cheaper than a mutex.
+class UpdateCacheLock
+{
+public:
+    /// Construct and acquire.
+    UpdateCacheLock(volatile int& lock) :
+        lock_(lock)
+    {
+        unsigned spins = 0;
+        while (AtomicExchange(&lock_, 1))
+        {
+            // Wait with plain reads until the lock looks free. If the holder was descheduled, yield instead of spinning
+            while (lock_)
+            {
+                if (++spins < UPDATE_CACHE_LOCK_SPINS)
+                    SpinPause();
+                else
+                    Time::Sleep(0);
+            }
+        }
+    }
+    
+    /// Destruct and release.
+    ~UpdateCacheLock()
+    {
+        AtomicExchange(&lock_, 0);
+    }
+    
+private:
+    /// Lock value.
+    volatile int& lock_;
+};
+
+static unsigned GetNumFloatComponents(VariantType type)
+{
+    switch (type)
+    {
+    case VAR_FLOAT:
+        return 1;
+        
+    case VAR_VECTOR2:
+        return 2;
+        
+    case VAR_VECTOR3:
+        return 3;
+        
+    case VAR_VECTOR4:
+    case VAR_COLOR:
+        return 4;
+        
+    default:
+        return 0;
+    }
+}
+
+/// Write an attribute value for network replication. Fixed-size types are bit-packed and quantized if the attribute defines it,
+/// others are written byte-aligned as usual.
+static void WriteNetworkValue(BitWriter& writer, Serializer& dest, const AttributeInfo& attr, const Variant& value)
+{
+    switch (attr.type_)
+    {
+    case VAR_INT:
+        if (attr.mode_ & (AM_NODEID | AM_COMPONENTID))
+            writer.WriteVLE((unsigned)value.GetInt());
+        else
+            writer.WriteSignedVLE(value.GetInt());
+        return;
+        
+    case VAR_BOOL:
+        writer.WriteBool(value.GetBool());
+        return;
+        
+    case VAR_FLOAT:
+    case VAR_VECTOR2:
+    case VAR_VECTOR3:
+    case VAR_VECTOR4:
+    case VAR_COLOR:
+        {
+            float floatValue = value.GetFloat();
+            const float* data = &floatValue;
+            if (attr.type_ == VAR_VECTOR2)
+                data = value.GetVector2().Data();
+            else if (attr.type_ == VAR_VECTOR3)
+                data = value.GetVector3().Data();
+            else if (attr.type_ == VAR_VECTOR4)
+                data = value.GetVector4().Data();
+            else if (attr.type_ == VAR_COLOR)
+                data = value.GetColor().Data();
+            
+            unsigned numComponents = GetNumFloatComponents(attr.type_);
+            for (unsigned i = 0; i < numComponents; ++i)
+            {
+                if (attr.quantizationBits_)
+                    writer.WriteQuantizedFloat(data[i], attr.quantizationMin_, attr.quantizationMax_, attr.quantizationBits_);
+                else
+                    writer.WriteFloat(data[i]);
+            }
+        }
+        return;
+        
+    case VAR_QUATERNION:
+        if (attr.quantizationBits_)
+            writer.WriteQuantizedQuaternion(value.GetQuaternion(), attr.quantizationBits_);
+        else
+        {
+            const float* data = value.GetQuaternion().Data();
+            for (unsigned i = 0; i < 4; ++i)
+                writer.WriteFloat(data[i]);
+        }
+        return;
+        
+    case VAR_INTVECTOR2:
+        writer.WriteSignedVLE(value.GetIntVector2().x_);
+        writer.WriteSignedVLE(value.GetIntVector2().y_);
+        return;
+        
+    default:
+        writer.Flush();
+        dest.WriteVariantData(value);
+        return;
+    }
+}
+
+/// Read an attribute value written by WriteNetworkValue().
+static Variant ReadNetworkValue(BitReader& reader, Deserializer& source, const AttributeInfo& attr)
+{
+    switch (attr.type_)
+    {
+    case VAR_INT:
+        if (attr.mode_ & (AM_NODEID | AM_COMPONENTID))
+            return Variant((int)reader.ReadVLE());
+        else
+            return Variant(reader.ReadSignedVLE());
+        
+    case VAR_BOOL:
+        return Variant(reader.ReadBool());
+        
+    case VAR_FLOAT:
+    case VAR_VECTOR2:
+    case VAR_VECTOR3:
+    case VAR_VECTOR4:
+    case VAR_COLOR:
+        {
+            float data[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            unsigned numComponents = GetNumFloatComponents(attr.type_);
+            for (unsigned i = 0; i < numComponents; ++i)
+            {
+                if (attr.quantizationBits_)
+                    data[i] = reader.ReadQuantizedFloat(attr.quantizationMin_, attr.quantizationMax_, attr.quantizationBits_);
+                else
+                    data[i] = reader.ReadFloat();
+            }
+            
+            switch (attr.type_)
+            {
+            case VAR_FLOAT:
+                return Variant(data[0]);
+                
+            case VAR_VECTOR2:
+                return Variant(Vector2(data));
+                
+            case VAR_VECTOR3:
+                return Variant(Vector3(data));
+                
+            case VAR_VECTOR4:
+                return Variant(Vector4(data));
+                
+            default:
+                return Variant(Color(data));
+            }
+        }
+        
+    case VAR_QUATERNION:
+        if (attr.quantizationBits_)
+            return Variant(reader.ReadQuantizedQuaternion(attr.quantizationBits_));
+        else
+        {
+            float data[4];
+            for (unsigned i = 0; i < 4; ++i)
+                data[i] = reader.ReadFloat();
+            return Variant(Quaternion(data));
+        }
+        
+    case VAR_INTVECTOR2:
+        {
+            int x = reader.ReadSignedVLE();
+            int y = reader.ReadSignedVLE();
+            return Variant(IntVector2(x, y));
+        }
+        
+    default:
+        reader.Align();
+        return source.ReadVariant(attr.type_);
+    }
+}
+
 Serializable::Serializable(Context* context) :
     Object(context),
     networkState_(0),
@@ -553,14 +756,8 @@ void Serializable::WriteInitialDeltaUpdate(Serializer& dest)
             attributeBits.Set(i);
     }
 
-    // First write the change bitfield, then attribute data for non-default attributes
-    dest.Write(attributeBits.data_, (numAttributes + 7) >> 3);
-
-    for (unsigned i = 0; i < numAttributes; ++i)
-    {
-        if (attributeBits.IsSet(i))
-            dest.WriteVariantData(networkState_->currentValues_[i]);
-    }
+    // The initial update is a delta update of the non-default attributes, so share the cache with it
+    WriteDeltaUpdate(dest, attributeBits);
 }
 
 void Serializable::WriteDeltaUpdate(Serializer& dest, const DirtyBits& attributeBits)
@@ -575,17 +772,32 @@ void Serializable::WriteDeltaUpdate(Serializer& dest, const DirtyBits& attribute
     if (!attributes)
         return;
 
-    unsigned numAttributes = attributes->Size();
-
-    // First write the change bitfield, then attribute data for changed attributes
-    // Note: the attribute bits should not contain LATESTDATA attributes
-    dest.Write(attributeBits.data_, (numAttributes + 7) >> 3);
+    // Usually several connections need the same update, so serialize each distinct set of dirty attributes only once
+    // until the attribute values change
+    UpdateCacheLock lock(networkState_->updateCacheLock_);
+    for (unsigned i = 0; i < networkState_->numDeltaUpdates_; ++i)
+    {
+        const CachedDeltaUpdate& update = networkState_->deltaUpdates_[i];
+        if (update.attributeBits_ == attributeBits)
+        {
+            dest.Write(update.data_.GetData(), update.data_.GetSize());
+            return;
+        }
+    }
 
-    for (unsigned i = 0; i < numAttributes; ++i)
+    if (networkState_->numDeltaUpdates_ >= MAX_CACHED_DELTA_UPDATES)
     {
-        if (attributeBits.IsSet(i))
-            dest.WriteVariantData(networkState_->currentValues_[i]);
+        WriteDeltaUpdateData(dest, attributeBits);
+        return;
     }
+
+    if (networkState_->deltaUpdates_.Size() <= networkState_->numDeltaUpdates_)
+        networkState_->deltaUpdates_.Resize(networkState_->numDeltaUpdates_ + 1);
+    CachedDeltaUpdate& update = networkState_->deltaUpdates_[networkState_->numDeltaUpdates_++];
+    update.attributeBits_ = attributeBits;
+    update.data_.Clear();
+    WriteDeltaUpdateData(update.data_, attributeBits);
+    dest.Write(update.data_.GetData(), update.data_.GetSize());
 }
 
 void Serializable::WriteLatestDataUpdate(Serializer& dest)
@@ -600,13 +812,23 @@ void Serializable::WriteLatestDataUpdate(Serializer& dest)
     if (!attributes)
         return;
 
-    unsigned numAttributes = attributes->Size();
-
-    for (unsigned i = 0; i < numAttributes; ++i)
+    // Serialize only once until the attribute values change
+    UpdateCacheLock lock(networkState_->updateCacheLock_);
+    VectorBuffer& latestData = networkState_->latestData_;
+    if (!latestData.GetSize())
     {
-        if (attributes->At(i).mode_ & AM_LATESTDATA)
-            dest.WriteVariantData(networkState_->currentValues_[i]);
+        unsigned numAttributes = attributes->Size();
+        BitWriter writer(latestData);
+
+        for (unsigned i = 0; i < numAttributes; ++i)
+        {
+            const AttributeInfo& attr = attributes->At(i);
+            if (attr.mode_ & AM_LATESTDATA)
+                WriteNetworkValue(writer, latestData, attr, networkState_->currentValues_[i]);
+        }
     }
+
+    dest.Write(latestData.GetData(), latestData.GetSize());
 }
 
 void Serializable::ReadDeltaUpdate(Deserializer& source)
@@ -619,13 +841,14 @@ void Serializable::ReadDeltaUpdate(Deserializer& source)
     DirtyBits attributeBits;
 
     source.Read(attributeBits.data_, (numAttributes + 7) >> 3);
+    BitReader reader(source);
 
-    for (unsigned i = 0; i < numAttributes && !source.IsEof(); ++i)
+    for (unsigned i = 0; i < numAttributes && !reader.IsEof(); ++i)
     {
         if (attributeBits.IsSet(i))
         {
             const AttributeInfo& attr = attributes->At(i);
-            OnSetAttribute(attr, source.ReadVariant(attr.type_));
+            OnSetAttribute(attr, ReadNetworkValue(reader, source, attr));
         }
     }
 }
@@ -637,12 +860,13 @@ void Serializable::ReadLatestDataUpdate(Deserializer& source)
         return;
 
     unsigned numAttributes = attributes->Size();
+    BitReader reader(source);
 
-    for (unsigned i = 0; i < numAttributes && !source.IsEof(); ++i)
+    for (unsigned i = 0; i < numAttributes && !reader.IsEof(); ++i)
     {
         const AttributeInfo& attr = attributes->At(i);
         if (attr.mode_ & AM_LATESTDATA)
-            OnSetAttribute(attr, source.ReadVariant(attr.type_));
+            OnSetAttribute(attr, ReadNetworkValue(reader, source, attr));
     }
 }
 
@@ -753,6 +977,22 @@ void Serializable::SetInstanceDefault(const String& name, const Variant& default
     instanceDefaultValues_->operator[] (name) = defaultValue;
 }
 
+void Serializable::WriteDeltaUpdateData(Serializer& dest, const DirtyBits& attributeBits)
+{
+    unsigned numAttributes = networkState_->attributes_->Size();
+
+    // First write the change bitfield, then bit-packed attribute data for changed attributes
+    // Note: the attribute bits should not contain LATESTDATA attributes
+    dest.Write(attributeBits.data_, (numAttributes + 7) >> 3);
+    BitWriter writer(dest);
+
+    for (unsigned i = 0; i < numAttributes; ++i)
+    {
+        if (attributeBits.IsSet(i))
+            WriteNetworkValue(writer, dest, networkState_->attributes_->At(i), networkState_->currentValues_[i]);
+    }
+}
+
 Variant Serializable::GetInstanceDefault(const String& name) const
 {
     if (instanceDefaultValues_)
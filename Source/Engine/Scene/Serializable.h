@@ -120,6 +120,8 @@ private:
     void SetInstanceDefault(const String& name, const Variant& defaultValue);
     /// Get instance-level default value.
     Variant GetInstanceDefault(const String& name) const;
+    /// Serialize a delta network update without using the update cache.
+    void WriteDeltaUpdateData(Serializer& dest, const DirtyBits& attributeBits);
 
     /// Attribute default value at each instance level.
     VariantMap* instanceDefaultValues_;
@@ -266,5 +268,7 @@ public:
 #define MIXED_ACCESSOR_ATTRIBUTE(name, getFunction, setFunction, typeName, defaultValue, mode) context->RegisterAttribute<ClassName>(Urho3D::AttributeInfo(GetVariantType<typeName >(), name, new Urho3D::AttributeAccessorImpl<ClassName, typeName, MixedAttributeTrait<typeName > >(&ClassName::getFunction, &ClassName::setFunction), defaultValue, mode))
 /// Update the default value of an already registered attribute.
 #define UPDATE_ATTRIBUTE_DEFAULT_VALUE(name, defaultValue) context->UpdateAttributeDefaultValue<ClassName>(name, defaultValue)
+/// Quantize an already registered attribute to a value range and bits per component in network replication. For quaternions the range is ignored.
+#define UPDATE_ATTRIBUTE_QUANTIZATION(name, min, max, bits) context->UpdateAttributeQuantization<ClassName>(name, min, max, bits)
 
 }
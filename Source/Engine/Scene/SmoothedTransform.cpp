@@ -35,8 +35,7 @@ SmoothedTransform::SmoothedTransform(Context* context) :
     Component(context),
     targetPosition_(Vector3::ZERO),
     targetRotation_(Quaternion::IDENTITY),
-    smoothingMask_(SMOOTH_NONE),
-    subscribed_(false)
+    smoothingMask_(SMOOTH_NONE)
 {
 }
 
@@ -89,11 +88,12 @@ void SmoothedTransform::Update(float constant, float squaredSnapThreshold)
         }
     }
 
-    // If smoothing has completed, unsubscribe from the update event
+    // If smoothing has completed, remove from the smoothing update. During threaded update the scene does this afterward
     if (!smoothingMask_)
     {
-        UnsubscribeFromEvent(GetScene(), E_UPDATESMOOTHING);
-        subscribed_ = false;
+        Scene* scene = GetScene();
+        if (scene && !scene->IsThreadedUpdate())
+            scene->RemoveSmoothedTransform(this);
     }
 }
 
@@ -102,12 +102,10 @@ void SmoothedTransform::SetTargetPosition(const Vector3& position)
     targetPosition_ = position;
     smoothingMask_ |= SMOOTH_POSITION;
 
-    // Subscribe to smoothing update if not yet subscribed
-    if (!subscribed_)
-    {
-        SubscribeToEvent(GetScene(), E_UPDATESMOOTHING, HANDLER(SmoothedTransform, HandleUpdateSmoothing));
-        subscribed_ = true;
-    }
+    // Add to the scene's smoothing update if not yet added
+    Scene* scene = GetScene();
+    if (scene)
+        scene->AddSmoothedTransform(this);
 
     SendEvent(E_TARGETPOSITION);
 }
@@ -117,11 +115,9 @@ void SmoothedTransform::SetTargetRotation(const Quaternion& rotation)
     targetRotation_ = rotation;
     smoothingMask_ |= SMOOTH_ROTATION;
 
-    if (!subscribed_)
-    {
-        SubscribeToEvent(GetScene(), E_UPDATESMOOTHING, HANDLER(SmoothedTransform, HandleUpdateSmoothing));
-        subscribed_ = true;
-    }
+    Scene* scene = GetScene();
+    if (scene)
+        scene->AddSmoothedTransform(this);
 
     SendEvent(E_TARGETROTATION);
 }
@@ -168,13 +164,4 @@ void SmoothedTransform::OnNodeSet(Node* node)
     }
 }
 
-void SmoothedTransform::HandleUpdateSmoothing(StringHash eventType, VariantMap& eventData)
-{
-    using namespace UpdateSmoothing;
-
-    float constant = eventData[P_CONSTANT].GetFloat();
-    float squaredSnapThreshold = eventData[P_SQUAREDSNAPTHRESHOLD].GetFloat();
-    Update(constant, squaredSnapThreshold);
-}
-
 }
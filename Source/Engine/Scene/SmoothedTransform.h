@@ -47,7 +47,7 @@ public:
     /// Register object factory.
     static void RegisterObject(Context* context);
     
-    /// Update smoothing.
+    /// Update smoothing. Is thread-safe during the scene's threaded update, as it only modifies the own scene node.
     void Update(float constant, float squaredSnapThreshold);
     /// Set target position in parent space.
     void SetTargetPosition(const Vector3& position);
@@ -74,17 +74,12 @@ protected:
     virtual void OnNodeSet(Node* node);
     
 private:
-    /// Handle smoothing update event.
-    void HandleUpdateSmoothing(StringHash eventType, VariantMap& eventData);
-    
     /// Target position.
     Vector3 targetPosition_;
     /// Target rotation.
     Quaternion targetRotation_;
     /// Active smoothing operations bitmask.
     unsigned char smoothingMask_;
-    /// Subscribed to smoothing update event flag.
-    bool subscribed_;
 };
 
 }
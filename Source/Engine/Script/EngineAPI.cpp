@@ -75,6 +75,7 @@ static void RegisterDebugHud(asIScriptEngine* engine)
     engine->RegisterGlobalProperty("const uint DEBUGHUD_SHOW_STATS", (void*)&DEBUGHUD_SHOW_STATS);
     engine->RegisterGlobalProperty("const uint DEBUGHUD_SHOW_MODE", (void*)&DEBUGHUD_SHOW_MODE);
     engine->RegisterGlobalProperty("const uint DEBUGHUD_SHOW_PROFILER", (void*)&DEBUGHUD_SHOW_PROFILER);
+    engine->RegisterGlobalProperty("const uint DEBUGHUD_SHOW_MEMORY", (void*)&DEBUGHUD_SHOW_MEMORY);
     engine->RegisterGlobalProperty("const uint DEBUGHUD_SHOW_ALL", (void*)&DEBUGHUD_SHOW_ALL);
 
     RegisterObject<Console>(engine, "DebugHud");
@@ -94,10 +95,14 @@ static void RegisterDebugHud(asIScriptEngine* engine)
     engine->RegisterObjectMethod("DebugHud", "Text@+ get_statsText() const", asMETHOD(DebugHud, GetStatsText), asCALL_THISCALL);
     engine->RegisterObjectMethod("DebugHud", "Text@+ get_modeText() const", asMETHOD(DebugHud, GetModeText), asCALL_THISCALL);
     engine->RegisterObjectMethod("DebugHud", "Text@+ get_profilerText() const", asMETHOD(DebugHud, GetProfilerText), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DebugHud", "Text@+ get_memoryText() const", asMETHOD(DebugHud, GetMemoryText), asCALL_THISCALL);
     engine->RegisterObjectMethod("DebugHud", "void SetAppStats(const String&in, const Variant&in)", asMETHODPR(DebugHud, SetAppStats, (const String&, const Variant&), void), asCALL_THISCALL);
     engine->RegisterObjectMethod("DebugHud", "void SetAppStats(const String&in, const String&in)", asMETHODPR(DebugHud, SetAppStats, (const String&, const String&), void), asCALL_THISCALL);
     engine->RegisterObjectMethod("DebugHud", "void ResetAppStats(const String&in)", asMETHOD(DebugHud, ResetAppStats), asCALL_THISCALL);
     engine->RegisterObjectMethod("DebugHud", "void ClearAppStats()", asMETHOD(DebugHud, ClearAppStats), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DebugHud", "bool SaveProfilerTrace(const String&in)", asMETHOD(DebugHud, SaveProfilerTrace), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DebugHud", "void set_profilerTimeline(bool)", asMETHOD(DebugHud, SetProfilerTimeline), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DebugHud", "bool get_profilerTimeline() const", asMETHOD(DebugHud, GetProfilerTimeline), asCALL_THISCALL);
     engine->RegisterGlobalFunction("DebugHud@+ get_debugHud()", asFUNCTION(GetDebugHud), asCALL_CDECL);
 }
 
@@ -108,6 +113,11 @@ static Engine* GetEngine()
 
 static void RegisterEngine(asIScriptEngine* engine)
 {
+    engine->RegisterEnum("PostedEventDispatch");
+    engine->RegisterEnumValue("PostedEventDispatch", "DISPATCH_BEGINFRAME", DISPATCH_BEGINFRAME);
+    engine->RegisterEnumValue("PostedEventDispatch", "DISPATCH_POSTUPDATE", DISPATCH_POSTUPDATE);
+    engine->RegisterEnumValue("PostedEventDispatch", "DISPATCH_ENDFRAME", DISPATCH_ENDFRAME);
+
     RegisterObject<Engine>(engine, "Engine");
     engine->RegisterObjectMethod("Engine", "void RunFrame()", asMETHOD(Engine, RunFrame), asCALL_THISCALL);
     engine->RegisterObjectMethod("Engine", "void Exit()", asMETHOD(Engine, Exit), asCALL_THISCALL);
@@ -128,6 +138,8 @@ static void RegisterEngine(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Engine", "bool get_pauseMinimized() const", asMETHOD(Engine, GetPauseMinimized), asCALL_THISCALL);
     engine->RegisterObjectMethod("Engine", "void set_autoExit(bool)", asMETHOD(Engine, SetAutoExit), asCALL_THISCALL);
     engine->RegisterObjectMethod("Engine", "bool get_autoExit() const", asMETHOD(Engine, GetAutoExit), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Engine", "void set_postedEventDispatch(PostedEventDispatch)", asMETHOD(Engine, SetPostedEventDispatch), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Engine", "PostedEventDispatch get_postedEventDispatch() const", asMETHOD(Engine, GetPostedEventDispatch), asCALL_THISCALL);
     engine->RegisterObjectMethod("Engine", "bool get_initialized() const", asMETHOD(Engine, IsInitialized), asCALL_THISCALL);
     engine->RegisterObjectMethod("Engine", "bool get_exiting() const", asMETHOD(Engine, IsExiting), asCALL_THISCALL);
     engine->RegisterObjectMethod("Engine", "bool get_headless() const", asMETHOD(Engine, IsHeadless), asCALL_THISCALL);
@@ -75,6 +75,8 @@ static void RegisterNetworkPriority(asIScriptEngine* engine)
     engine->RegisterObjectMethod("NetworkPriority", "float get_minPriority() const", asMETHOD(NetworkPriority, GetMinPriority), asCALL_THISCALL);
     engine->RegisterObjectMethod("NetworkPriority", "void set_alwaysUpdateOwner(bool)", asMETHOD(NetworkPriority, SetAlwaysUpdateOwner), asCALL_THISCALL);
     engine->RegisterObjectMethod("NetworkPriority", "bool get_alwaysUpdateOwner() const", asMETHOD(NetworkPriority, GetAlwaysUpdateOwner), asCALL_THISCALL);
+    engine->RegisterObjectMethod("NetworkPriority", "void set_relevanceDistance(float)", asMETHOD(NetworkPriority, SetRelevanceDistance), asCALL_THISCALL);
+    engine->RegisterObjectMethod("NetworkPriority", "float get_relevanceDistance() const", asMETHOD(NetworkPriority, GetRelevanceDistance), asCALL_THISCALL);
 }
 
 void SendRemoteEvent(const String& eventType, bool inOrder, const VariantMap& eventData, Connection* ptr)
@@ -209,6 +211,8 @@ void RegisterNetwork(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Network", "void SendPackageToClients(Scene@+, PackageFile@+)", asMETHOD(Network, SendPackageToClients), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "void set_updateFps(int)", asMETHOD(Network, SetUpdateFps), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "int get_updateFps() const", asMETHOD(Network, GetUpdateFps), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "void set_snapshotUpdates(bool)", asMETHOD(Network, SetSnapshotUpdates), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "bool get_snapshotUpdates() const", asMETHOD(Network, GetSnapshotUpdates), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "void set_packageCacheDir(const String&in)", asMETHOD(Network, SetPackageCacheDir), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "const String& get_packageCacheDir() const", asMETHOD(Network, GetPackageCacheDir), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "bool get_serverRunning() const", asMETHOD(Network, IsServerRunning), asCALL_THISCALL);
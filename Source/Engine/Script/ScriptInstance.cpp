@@ -627,7 +627,7 @@ void ScriptInstance::UpdateEventSubscription()
     {
         if (!subscribed_ && (methods_[METHOD_UPDATE] || methods_[METHOD_DELAYEDSTART] || delayedCalls_.Size()))
         {
-            SubscribeToEvent(scene, E_SCENEUPDATE, HANDLER(ScriptInstance, HandleSceneUpdate));
+            SubscribeToEvent(scene, E_SCENEUPDATE, TYPED_HANDLER(ScriptInstance, HandleSceneUpdate));
             subscribed_ = true;
         }
 
@@ -685,14 +685,12 @@ void ScriptInstance::UpdateEventSubscription()
     }
 }
 
-void ScriptInstance::HandleSceneUpdate(StringHash eventType, VariantMap& eventData)
+void ScriptInstance::HandleSceneUpdate(StringHash eventType, SceneUpdate::Data& eventData)
 {
     if (!scriptObject_)
         return;
 
-    using namespace SceneUpdate;
-
-    float timeStep = eventData[P_TIMESTEP].GetFloat();
+    float timeStep = eventData.timeStep_;
 
     // Execute delayed calls
     for (unsigned i = 0; i < delayedCalls_.Size();)
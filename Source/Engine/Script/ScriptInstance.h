@@ -23,6 +23,7 @@
 #pragma once
 
 #include "Component.h"
+#include "SceneEvents.h"
 #include "ScriptEventListener.h"
 
 class asIScriptFunction;
@@ -155,7 +156,7 @@ private:
     /// Subscribe/unsubscribe from scene updates as necessary.
     void UpdateEventSubscription();
     /// Handle scene update event.
-    void HandleSceneUpdate(StringHash eventType, VariantMap& eventData);
+    void HandleSceneUpdate(StringHash eventType, SceneUpdate::Data& eventData);
     /// Handle scene post-update event.
     void HandleScenePostUpdate(StringHash eventType, VariantMap& eventData);
 #ifdef URHO3D_PHYSICS
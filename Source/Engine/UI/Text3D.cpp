@@ -28,6 +28,7 @@
 #include "Log.h"
 #include "Material.h"
 #include "Node.h"
+#include "Octree.h"
 #include "ResourceCache.h"
 #include "Technique.h"
 #include "Text.h"
@@ -110,6 +111,9 @@ void Text3D::UpdateBatches(const FrameInfo& frame)
         customWorldTransform_ = Matrix3x4(worldPosition, frame.camera_->GetFaceCameraRotation(
             worldPosition, node_->GetWorldRotation(), faceCameraMode_), node_->GetWorldScale());
         worldBoundingBoxDirty_ = true;
+        // The octree is not notified of the rotation, so make batched queries test the actual bounding box
+        if (octant_)
+            octant_->MarkDrawableBoxDirty(this);
     }
 
     for (unsigned i = 0; i < batches_.Size(); ++i)
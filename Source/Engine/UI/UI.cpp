@@ -36,6 +36,7 @@
 #include "ListView.h"
 #include "Log.h"
 #include "Matrix3x4.h"
+#include "MemoryTracker.h"
 #include "MessageBox.h"
 #include "Profiler.h"
 #include "ResourceCache.h"
@@ -298,6 +299,7 @@ void UI::Update(float timeStep)
     assert(rootElement_ && rootModalElement_);
 
     PROFILE(UpdateUI);
+    MEMORY_CATEGORY(MEMCAT_UI);
 
     // Expire hovers
     for (HashMap<WeakPtr<UIElement>, bool>::Iterator i = hoveredElements_.Begin(); i != hoveredElements_.End(); ++i)
@@ -391,6 +393,7 @@ void UI::RenderUpdate()
     assert(rootElement_ && rootModalElement_ && graphics_);
 
     PROFILE(GetUIBatches);
+    MEMORY_CATEGORY(MEMCAT_UI);
 
     // If the OS cursor is visible, do not render the UI's own cursor
     bool osCursorVisible = GetSubsystem<Input>()->IsMouseVisible();
@@ -420,6 +423,7 @@ void UI::RenderUpdate()
 void UI::Render()
 {
     PROFILE(RenderUI);
+    MEMORY_CATEGORY(MEMCAT_UI);
 
     // If the OS cursor is visible, apply its shape now if changed
     bool osCursorVisible = GetSubsystem<Input>()->IsMouseVisible();
@@ -44,6 +44,8 @@
 namespace Urho3D
 {
 
+static const unsigned DRAWABLES_PER_WORK_RANGE = 32;
+
 extern const char* blendModeNames[];
 
 Renderer2D::Renderer2D(Context* context) :
@@ -236,21 +238,34 @@ void Renderer2D::OnWorldBoundingBoxUpdate()
     worldBoundingBox_ = boundingBox_;
 }
 
-static void CheckDrawableVisibility(const WorkItem* item, unsigned threadIndex)
+/// Threaded 2D drawable visibility check task.
+struct CheckDrawableVisibilityTask
 {
-    Renderer2D* renderer = reinterpret_cast<Renderer2D*>(item->aux_);
-    Drawable2D** start = reinterpret_cast<Drawable2D**>(item->start_);
-    Drawable2D** end = reinterpret_cast<Drawable2D**>(item->end_);
-
-    while (start != end)
+    /// Construct.
+    CheckDrawableVisibilityTask(Renderer2D* renderer, PODVector<Drawable2D*>& drawables) :
+        renderer_(renderer),
+        drawables_(drawables)
     {
-        Drawable2D* drawable = *start++;
-        if (renderer->CheckVisibility(drawable) && drawable->GetVertices().Size())
-            drawable->SetVisibility(true);
-        else
-            drawable->SetVisibility(false);
     }
-}
+    
+    /// Check a range of drawables.
+    void operator () (unsigned start, unsigned end, unsigned threadIndex)
+    {
+        for (unsigned i = start; i < end; ++i)
+        {
+            Drawable2D* drawable = drawables_[i];
+            if (renderer_->CheckVisibility(drawable) && drawable->GetVertices().Size())
+                drawable->SetVisibility(true);
+            else
+                drawable->SetVisibility(false);
+        }
+    }
+    
+    /// Renderer.
+    Renderer2D* renderer_;
+    /// Drawables to check.
+    PODVector<Drawable2D*>& drawables_;
+};
 
 void Renderer2D::HandleBeginViewUpdate(StringHash eventType, VariantMap& eventData)
 {
@@ -294,29 +309,8 @@ void Renderer2D::HandleBeginViewUpdate(StringHash eventType, VariantMap& eventDa
         PROFILE(CheckDrawableVisibility);
 
         WorkQueue* queue = GetSubsystem<WorkQueue>();
-        int numWorkItems = queue->GetNumThreads() + 1; // Worker threads + main thread
-        int drawablesPerItem = drawables_.Size() / numWorkItems;
-        
-        PODVector<Drawable2D*>::Iterator start = drawables_.Begin();
-        for (int i = 0; i < numWorkItems; ++i)
-        {
-            SharedPtr<WorkItem> item = queue->GetFreeItem();
-            item->priority_ = M_MAX_UNSIGNED;
-            item->workFunction_ = CheckDrawableVisibility;
-            item->aux_ = this;
-
-            PODVector<Drawable2D*>::Iterator end = drawables_.End();
-            if (i < numWorkItems - 1 && end - start > drawablesPerItem)
-                end = start + drawablesPerItem;
-            
-            item->start_ = &(*start);
-            item->end_ = &(*end);
-            queue->AddWorkItem(item);
-            
-            start = end;
-        }
-
-        queue->Complete(M_MAX_UNSIGNED);
+        CheckDrawableVisibilityTask task(this, drawables_);
+        queue->ParallelFor(0, drawables_.Size(), DRAWABLES_PER_WORK_RANGE, task);
     }
 
     vertexCount_ = 0;
@@ -55,6 +55,7 @@ String basePath_;
 Vector<FileEntry> entries_;
 unsigned checksum_ = 0;
 bool compress_ = false;
+bool fastCompress_ = false;
 unsigned blockSize_ = COMPRESSED_BLOCK_SIZE;
 
 String ignoreExtensions_[] = {
@@ -91,6 +92,7 @@ void Run(const Vector<String>& arguments)
             "\n"
             "Options:\n"
             "-c      Enable package file LZ4 compression\n"
+            "-f      Use fast LZ4 compression instead of LZ4HC, implies -c\n"
         );
     
     const String& dirName = arguments[0];
@@ -110,6 +112,11 @@ void Run(const Vector<String>& arguments)
                     case 'c':
                         compress_ = true;
                         break;
+                        
+                    case 'f':
+                        compress_ = true;
+                        fastCompress_ = true;
+                        break;
                     }
                 }
             }
@@ -214,30 +221,47 @@ void WritePackageFile(const String& fileName, const String& rootDir)
         }
         else
         {
-            SharedArrayPtr<unsigned char> compressBuffer(new unsigned char[LZ4_compressBound(blockSize_)]);
+            // Compress all blocks first, as the block index which precedes them needs their compressed sizes
+            unsigned numBlocks = (dataSize + blockSize_ - 1) / blockSize_;
+            SharedArrayPtr<unsigned char> compressBuffer(new unsigned char[numBlocks * blockSize_]);
+            PODVector<unsigned> blockOffsets(numBlocks + 1);
             
             unsigned pos = 0;
-            unsigned totalPackedBytes = 0;
+            unsigned packedPos = 0;
             
-            while (pos < dataSize)
+            for (unsigned j = 0; j < numBlocks; ++j)
             {
                 unsigned unpackedSize = blockSize_;
                 if (pos + unpackedSize > dataSize)
                     unpackedSize = dataSize - pos;
                 
-                unsigned packedSize = LZ4_compressHC((const char*)&buffer[pos], (char*)compressBuffer.Get(), unpackedSize);
+                // Blocks that do not get smaller are stored uncompressed. The reader recognizes them by their packed size
+                // being equal to the unpacked size
+                const char* src = (const char*)&buffer[pos];
+                char* packedDest = (char*)&compressBuffer[packedPos];
+                unsigned packedSize = fastCompress_ ? LZ4_compress_limitedOutput(src, packedDest, unpackedSize, unpackedSize - 1) :
+                    LZ4_compressHC_limitedOutput(src, packedDest, unpackedSize, unpackedSize - 1);
                 if (!packedSize)
-                    ErrorExit("LZ4 compression failed for file " + entries_[i].name_ + " at offset " + pos);
-                
-                dest.WriteUShort(unpackedSize);
-                dest.WriteUShort(packedSize);
-                dest.Write(compressBuffer.Get(), packedSize);
-                totalPackedBytes += 6 + packedSize;
+                {
+                    memcpy(packedDest, src, unpackedSize);
+                    packedSize = unpackedSize;
+                }
                 
+                blockOffsets[j] = packedPos;
+                packedPos += packedSize;
                 pos += unpackedSize;
             }
             
-            PrintLine(entries_[i].name_ + " in " + String(dataSize) + " out " + String(totalPackedBytes));
+            // Make the block offsets relative to the start of the file entry
+            unsigned indexSize = (numBlocks + 1) * sizeof(unsigned);
+            blockOffsets[numBlocks] = packedPos;
+            for (unsigned j = 0; j <= numBlocks; ++j)
+                blockOffsets[j] += indexSize;
+            
+            dest.Write(&blockOffsets[0], indexSize);
+            dest.Write(compressBuffer.Get(), packedPos);
+            
+            PrintLine(entries_[i].name_ + " in " + String(dataSize) + " out " + String(indexSize + packedPos));
         }
     }
     
@@ -267,7 +291,9 @@ void WriteHeader(File& dest)
     if (!compress_)
         dest.WriteFileID("UPAK");
     else
-        dest.WriteFileID("ULZ4");
+        dest.WriteFileID("ULZ2");
     dest.WriteUInt(entries_.Size());
     dest.WriteUInt(checksum_);
+    if (compress_)
+        dest.WriteUInt(blockSize_);
 }
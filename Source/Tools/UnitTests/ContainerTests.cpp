@@ -0,0 +1,337 @@
+//
+// Copyright (c) 2008-2014 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "Context.h"
+#include "FlatHashMap.h"
+#include "FlatHashSet.h"
+#include "HashMap.h"
+#include "Random.h"
+#include "Sort.h"
+#include "Timer.h"
+#include "UnitTests.h"
+#include "XMLFile.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "DebugNew.h"
+
+using namespace Urho3D;
+
+/// Key whose hash collides in groups, so that lookups have to probe past other keys.
+struct CollidingKey
+{
+    /// Construct undefined.
+    CollidingKey() :
+        value_(0)
+    {
+    }
+    
+    /// Construct with value.
+    CollidingKey(unsigned value) :
+        value_(value)
+    {
+    }
+    
+    /// Test for equality.
+    bool operator == (const CollidingKey& rhs) const { return value_ == rhs.value_; }
+    /// Test for inequality.
+    bool operator != (const CollidingKey& rhs) const { return value_ != rhs.value_; }
+    /// Return hash value. Eight keys share each hash.
+    unsigned ToHash() const { return value_ >> 3; }
+    
+    /// Key value.
+    unsigned value_;
+};
+
+/// Check that a flat hash map holds exactly the pairs of a reference map, both by lookup and by iteration.
+static bool SameContents(const FlatHashMap<CollidingKey, unsigned>& map, const HashMap<unsigned, unsigned>& reference)
+{
+    bool success = CHECK(map.Size() == reference.Size());
+    
+    for (HashMap<unsigned, unsigned>::ConstIterator i = reference.Begin(); i != reference.End(); ++i)
+    {
+        FlatHashMap<CollidingKey, unsigned>::ConstIterator j = map.Find(CollidingKey(i->first_));
+        if (!CHECK(j != map.End() && j->second_ == i->second_))
+            return false;
+    }
+    
+    for (FlatHashMap<CollidingKey, unsigned>::ConstIterator i = map.Begin(); i != map.End(); ++i)
+    {
+        HashMap<unsigned, unsigned>::ConstIterator j = reference.Find(i->first_.value_);
+        if (!CHECK(j != reference.End() && j->second_ == i->second_))
+            return false;
+    }
+    
+    return success;
+}
+
+bool TestFlatHashMap()
+{
+    bool success = true;
+    
+    // Random inserts and erases of colliding keys exercise Robin Hood displacement on insert and backward shifting on erase
+    FlatHashMap<CollidingKey, unsigned> map;
+    HashMap<unsigned, unsigned> reference;
+    SetRandomSeed(1);
+    for (unsigned i = 0; i < 20000; ++i)
+    {
+        unsigned key = Rand() % 2048;
+        if (Rand() % 3)
+        {
+            map[CollidingKey(key)] = i;
+            reference[key] = i;
+        }
+        else
+            success &= CHECK(map.Erase(CollidingKey(key)) == reference.Erase(key));
+        
+        if (!(i % 1000))
+            success &= SameContents(map, reference);
+    }
+    success &= SameContents(map, reference);
+    success &= CHECK(!map.Contains(CollidingKey(2048)));
+    
+    // Erasing by iterator moves the last pair to the erased position
+    map.Clear();
+    for (unsigned i = 0; i < 100; ++i)
+        map.Insert(MakePair(CollidingKey(i), i));
+    FlatHashMap<CollidingKey, unsigned>::Iterator it = map.Erase(map.Begin());
+    success &= CHECK(it == map.Begin() && it->first_ == CollidingKey(99) && it->second_ == 99);
+    success &= CHECK(map.Back().first_ == CollidingKey(98));
+    success &= CHECK(map.Size() == 99 && !map.Contains(CollidingKey(0)));
+    success &= CHECK(map.Find(CollidingKey(99)) == map.Begin());
+    
+    // Erasing the last pair returns the end iterator
+    it = map.Erase(map.End() - 1);
+    success &= CHECK(it == map.End() && map.Size() == 98 && !map.Contains(CollidingKey(98)));
+    
+    // Erasing while iterating visits every pair once, including the moved ones
+    unsigned visited = 0;
+    for (it = map.Begin(); it != map.End();)
+    {
+        ++visited;
+        if (it->second_ & 1)
+            it = map.Erase(it);
+        else
+            ++it;
+    }
+    success &= CHECK(visited == 98 && map.Size() == 48);
+    for (unsigned i = 1; i < 98; ++i)
+        success &= CHECK(map.Contains(CollidingKey(i)) == !(i & 1));
+    
+    // The set shares the slot table logic
+    FlatHashSet<CollidingKey> set;
+    for (unsigned i = 0; i < 1000; ++i)
+        set.Insert(CollidingKey(i));
+    for (unsigned i = 0; i < 1000; i += 2)
+        set.Erase(CollidingKey(i));
+    success &= CHECK(set.Size() == 500);
+    for (unsigned i = 0; i < 1000; ++i)
+        success &= CHECK(set.Contains(CollidingKey(i)) == ((i & 1) != 0));
+    
+    return success;
+}
+
+bool TestStringRelocation()
+{
+    bool success = true;
+    
+    // Script arrays move their elements with memcpy, so both inline and allocated strings must survive a bitwise move
+    const char* values[] = { "", "Short", "A string that is too long for the inline buffer" };
+    for (unsigned i = 0; i < sizeof values / sizeof values[0]; ++i)
+    {
+        String* original = new String(values[i]);
+        unsigned char moved[sizeof(String)];
+        memcpy(moved, original, sizeof(String));
+        // Overwrite the original storage before freeing it without destruction, as the moved copy now owns any allocation
+        memset(original, 0xcc, sizeof(String));
+        ::operator delete(original);
+        
+        String& str = *reinterpret_cast<String*>(moved);
+        success &= CHECK(str == values[i] && !strcmp(str.CString(), values[i]));
+        str += "+";
+        success &= CHECK(str == String(values[i]) + "+");
+        str.~String();
+    }
+    
+    // Short strings are stored inline without heap allocations, also when swapped with an allocated string
+    unsigned allocations = AllocatorGetHeapAllocations();
+    String a("Position");
+    String b(a);
+    b += " 2";
+    success &= CHECK(AllocatorGetHeapAllocations() == allocations);
+    String c("A string that is too long for the inline buffer");
+    b.Swap(c);
+    success &= CHECK(b == "A string that is too long for the inline buffer" && c == "Position 2");
+    b.Swap(c);
+    success &= CHECK(b == "Position 2" && c == "A string that is too long for the inline buffer");
+    
+    return success;
+}
+
+bool BenchmarkStringAllocations()
+{
+    static const unsigned NUM_NODES = 5000;
+    static const unsigned NUM_LOADS = 10;
+    static const char* attributeNames[] = { "Is Enabled", "Name", "Position", "Rotation", "Scale", "Model", "Material", "Cast Shadows", 0 };
+    static const VariantType attributeTypes[] = { VAR_BOOL, VAR_STRING, VAR_VECTOR3, VAR_QUATERNION, VAR_VECTOR3, VAR_RESOURCEREF,
+        VAR_RESOURCEREFLIST, VAR_BOOL };
+    
+    // Build a scene file shaped like the ones saved by the editor: nodes with a transform and a static model component
+    String source("<scene id=\"1\">");
+    for (unsigned i = 0; i < NUM_NODES; ++i)
+    {
+        source.AppendWithFormat("<node id=\"%u\"><attribute name=\"Is Enabled\" value=\"true\" />"
+            "<attribute name=\"Name\" value=\"Box%u\" /><attribute name=\"Position\" value=\"%u 0 1\" />"
+            "<attribute name=\"Rotation\" value=\"1 0 0 0\" /><attribute name=\"Scale\" value=\"1 1 1\" />"
+            "<component type=\"StaticModel\" id=\"%u\"><attribute name=\"Model\" value=\"Model;Models/Box.mdl\" />"
+            "<attribute name=\"Material\" value=\"Material;Materials/Stone.xml\" />"
+            "<attribute name=\"Cast Shadows\" value=\"true\" /></component></node>", i + 2, i, i, 0x1000000 + i);
+    }
+    source += "</scene>";
+    
+    SharedPtr<Context> context(new Context());
+    context->RegisterSubsystem(new Time(context));
+    SharedPtr<XMLFile> file(new XMLFile(context));
+    if (!CHECK(file->FromString(source)))
+        return false;
+    
+    // Read the attributes the way Serializable::LoadXML does, counting the heap allocations of the engine containers
+    unsigned numAttributes = 0;
+    unsigned allocations = AllocatorGetHeapAllocations();
+    HiresTimer timer;
+    for (unsigned load = 0; load < NUM_LOADS; ++load)
+    {
+        for (XMLElement node = file->GetRoot().GetChild("node"); node; node = node.GetNext("node"))
+        {
+            XMLElement elements[] = { node, node.GetChild("component") };
+            for (unsigned i = 0; i < 2; ++i)
+            {
+                for (XMLElement attrElem = elements[i].GetChild("attribute"); attrElem; attrElem = attrElem.GetNext("attribute"))
+                {
+                    String name = attrElem.GetAttribute("name");
+                    for (unsigned j = 0; attributeNames[j]; ++j)
+                    {
+                        if (!name.Compare(attributeNames[j], true))
+                        {
+                            Variant value = attrElem.GetVariantValue(attributeTypes[j]);
+                            if (!value.IsEmpty())
+                                ++numAttributes;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    long long usec = timer.GetUSec(false);
+    allocations = AllocatorGetHeapAllocations() - allocations;
+    
+    printf("Loaded %u attributes in %.2f ms with %u heap allocations (%.2f per attribute)\n", numAttributes, usec / 1000.0,
+        allocations, (float)allocations / numAttributes);
+    
+    return CHECK(numAttributes == NUM_NODES * NUM_LOADS * 8);
+}
+
+/// Stand-in for a batch with the members used by the front-to-back batch queue sort.
+struct SortBatch
+{
+    /// State sort key.
+    unsigned long long sortKey_;
+    /// Distance from camera.
+    float distance_;
+    /// Original index, to break ties the same way as a stable sort.
+    unsigned index_;
+};
+
+/// Compare batches by state, then front to back, then original order.
+static bool CompareSortBatches(SortBatch* lhs, SortBatch* rhs)
+{
+    if (lhs->sortKey_ != rhs->sortKey_)
+        return lhs->sortKey_ < rhs->sortKey_;
+    if (lhs->distance_ != rhs->distance_)
+        return lhs->distance_ < rhs->distance_;
+    return lhs->index_ < rhs->index_;
+}
+
+bool BenchmarkRadixSort()
+{
+    static const unsigned batchCounts[] = { 10000, 50000, 100000, 200000, 0 };
+    static const unsigned NUM_SORTS = 10;
+    
+    SharedPtr<Context> context(new Context());
+    context->RegisterSubsystem(new Time(context));
+    bool success = true;
+    SetRandomSeed(1);
+    
+    for (const unsigned* count = batchCounts; *count; ++count)
+    {
+        // Few distinct states and distances rounded to 0.1, so that both keys have plenty of duplicates
+        PODVector<SortBatch> batches(*count);
+        for (unsigned i = 0; i < *count; ++i)
+        {
+            batches[i].sortKey_ = ((unsigned long long)(Rand() & 0xf) << 32) | (Rand() & 0xff);
+            batches[i].distance_ = (float)(Rand() % 10000) * 0.1f;
+            batches[i].index_ = i;
+        }
+        
+        PODVector<SortBatch*> sorted(*count);
+        HiresTimer timer;
+        for (unsigned j = 0; j < NUM_SORTS; ++j)
+        {
+            for (unsigned i = 0; i < *count; ++i)
+                sorted[i] = &batches[i];
+            Sort(sorted.Begin(), sorted.End(), CompareSortBatches);
+        }
+        long long comparisonUsec = timer.GetUSec(true);
+        
+        // Sort by the secondary key first, then stable sort by the primary key, like BatchQueue does. Distances are
+        // non-negative, so their float bits sort in the same order
+        PODVector<RadixSortItem<SortBatch*> > items(*count);
+        PODVector<RadixSortItem<SortBatch*> > temp(*count);
+        for (unsigned j = 0; j < NUM_SORTS; ++j)
+        {
+            for (unsigned i = 0; i < *count; ++i)
+            {
+                unsigned distanceBits;
+                memcpy(&distanceBits, &batches[i].distance_, sizeof distanceBits);
+                items[i].key_ = distanceBits;
+                items[i].value_ = &batches[i];
+            }
+            RadixSort(&items[0], &temp[0], *count);
+            for (unsigned i = 0; i < *count; ++i)
+                items[i].key_ = items[i].value_->sortKey_;
+            RadixSort(&items[0], &temp[0], *count);
+        }
+        long long radixUsec = timer.GetUSec(false);
+        
+        bool identical = true;
+        for (unsigned i = 0; i < *count && identical; ++i)
+            identical = items[i].value_ == sorted[i];
+        success &= CHECK(identical);
+        
+        printf("%6u batches: comparison %6.2f ms, radix %6.2f ms\n", *count, comparisonUsec / 1000.0 / NUM_SORTS,
+            radixUsec / 1000.0 / NUM_SORTS);
+    }
+    
+    return success;
+}
@@ -0,0 +1,205 @@
+//
+// Copyright (c) 2008-2014 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "Context.h"
+#include "ProcessUtils.h"
+#include "Timer.h"
+#include "UnitTests.h"
+#include "WorkQueue.h"
+
+#include <cstdio>
+
+#include "DebugNew.h"
+
+using namespace Urho3D;
+
+EVENT(E_BENCHMARKEVENT, BenchmarkEvent)
+{
+}
+
+EVENT(E_BENCHMARKUNRELATED, BenchmarkUnrelated)
+{
+}
+
+/// Object which counts the events it receives.
+class EventCounter : public Object
+{
+    OBJECT(EventCounter);
+    
+public:
+    /// Construct. Subscribe to an unrelated event, so that the receiver has more than one handler.
+    EventCounter(Context* context) :
+        Object(context),
+        count_(0)
+    {
+        SubscribeToEvent(E_BENCHMARKUNRELATED, HANDLER(EventCounter, HandleEvent));
+    }
+    
+    /// Subscribe to the benchmark event from a specific sender, or from any sender if null.
+    void Subscribe(Object* sender)
+    {
+        if (sender)
+            SubscribeToEvent(sender, E_BENCHMARKEVENT, HANDLER(EventCounter, HandleEvent));
+        else
+            SubscribeToEvent(E_BENCHMARKEVENT, HANDLER(EventCounter, HandleEvent));
+    }
+    
+    /// Handle the benchmark event.
+    void HandleEvent(StringHash eventType, VariantMap& eventData)
+    {
+        ++count_;
+    }
+    
+    /// Number of events received.
+    unsigned count_;
+};
+
+/// Work function doing a small fixed amount of arithmetic and storing the result.
+static void BenchmarkWork(const WorkItem* item, unsigned threadIndex)
+{
+    unsigned value = (unsigned)(size_t)item->aux_;
+    for (unsigned i = 0; i < 256; ++i)
+        value = value * 1664525 + 1013904223;
+    *reinterpret_cast<unsigned*>(item->start_) = value | 1;
+}
+
+/// Run batches of small work items with the given priority. Return jobs per second, or 0 if some job was not executed.
+static double RunWorkQueueJobs(WorkQueue* queue, unsigned priority, PODVector<unsigned>& results, unsigned numBatches)
+{
+    HiresTimer timer;
+    for (unsigned batch = 0; batch < numBatches; ++batch)
+    {
+        for (unsigned i = 0; i < results.Size(); ++i)
+        {
+            results[i] = 0;
+            SharedPtr<WorkItem> item = queue->GetFreeItem();
+            item->workFunction_ = BenchmarkWork;
+            item->start_ = &results[i];
+            item->aux_ = (void*)(size_t)i;
+            item->priority_ = priority;
+            queue->AddWorkItem(item);
+        }
+        queue->Complete(priority);
+        
+        for (unsigned i = 0; i < results.Size(); ++i)
+        {
+            if (!results[i])
+                return 0.0;
+        }
+    }
+    
+    long long usec = timer.GetUSec(false);
+    return (double)numBatches * results.Size() * 1000000.0 / (double)Max((int)usec, 1);
+}
+
+bool BenchmarkWorkQueue()
+{
+    static const unsigned NUM_JOBS = 10000;
+    static const unsigned NUM_BATCHES = 20;
+    
+    bool success = true;
+    PODVector<unsigned> results(NUM_JOBS);
+    
+    // The worker thread count is fixed once created, so use a new work queue for each count. The main thread also
+    // executes work, so the total thread count is one more than the worker threads
+    unsigned maxThreads = Max((int)GetNumPhysicalCPUs(), 1);
+    for (unsigned numThreads = 1; numThreads <= maxThreads; ++numThreads)
+    {
+        SharedPtr<Context> context(new Context());
+        context->RegisterSubsystem(new Time(context));
+        context->RegisterSubsystem(new WorkQueue(context));
+        WorkQueue* queue = context->GetSubsystem<WorkQueue>();
+        queue->CreateThreads(numThreads - 1);
+        
+        // Immediate items go to the work-stealing deques, lower priorities to the mutex-guarded priority queue
+        double immediate = RunWorkQueueJobs(queue, M_MAX_UNSIGNED, results, NUM_BATCHES);
+        double prioritized = RunWorkQueueJobs(queue, 0, results, NUM_BATCHES);
+        success &= CHECK(immediate > 0.0 && prioritized > 0.0);
+        
+        printf("%u threads: %.0f immediate jobs/sec, %.0f prioritized jobs/sec\n", numThreads, immediate, prioritized);
+    }
+    
+    return success;
+}
+
+/// Send events from a sender to the counters and return the nanoseconds per delivery. Check that all deliveries were made.
+static double SendBenchmarkEvents(EventCounter* sender, Vector<SharedPtr<EventCounter> >& counters, unsigned numSends, bool& success)
+{
+    for (unsigned i = 0; i < counters.Size(); ++i)
+        counters[i]->count_ = 0;
+    
+    VariantMap& eventData = sender->GetEventDataMap();
+    HiresTimer timer;
+    for (unsigned i = 0; i < numSends; ++i)
+        sender->SendEvent(E_BENCHMARKEVENT, eventData);
+    long long usec = timer.GetUSec(false);
+    
+    for (unsigned i = 0; i < counters.Size(); ++i)
+        success &= CHECK(counters[i]->count_ == numSends);
+    
+    return usec * 1000.0 / ((double)numSends * counters.Size());
+}
+
+bool BenchmarkEvents()
+{
+    static const unsigned NUM_SUBSCRIBERS = 10000;
+    static const unsigned NUM_SENDS = 100;
+    static const unsigned NUM_SINGLE_SENDS = 1000000;
+    
+    SharedPtr<Context> context(new Context());
+    context->RegisterSubsystem(new Time(context));
+    SharedPtr<EventCounter> sender(new EventCounter(context));
+    bool success = true;
+    
+    Vector<SharedPtr<EventCounter> > counters(NUM_SUBSCRIBERS);
+    for (unsigned i = 0; i < NUM_SUBSCRIBERS; ++i)
+    {
+        counters[i] = new EventCounter(context);
+        counters[i]->Subscribe(sender);
+    }
+    double specific = SendBenchmarkEvents(sender, counters, NUM_SENDS, success);
+    
+    for (unsigned i = 0; i < NUM_SUBSCRIBERS; ++i)
+    {
+        counters[i]->UnsubscribeFromEvent(sender, E_BENCHMARKEVENT);
+        counters[i]->Subscribe(0);
+    }
+    double any = SendBenchmarkEvents(sender, counters, NUM_SENDS, success);
+    
+    // A receiver subscribed both to the specific sender and to any sender gets the event only once
+    for (unsigned i = 0; i < NUM_SUBSCRIBERS; i += 10)
+        counters[i]->Subscribe(sender);
+    double mixed = SendBenchmarkEvents(sender, counters, NUM_SENDS, success);
+    
+    counters.Resize(1);
+    counters[0]->UnsubscribeFromEvent(E_BENCHMARKEVENT);
+    counters[0]->Subscribe(sender);
+    double single = SendBenchmarkEvents(sender, counters, NUM_SINGLE_SENDS, success);
+    
+    printf("Specific sender:         %.2f ns per delivery\n", specific);
+    printf("Any sender:              %.2f ns per delivery\n", any);
+    printf("Mixed (10%% specific):    %.2f ns per delivery\n", mixed);
+    printf("%u sends, 1 subscriber: %.2f ms\n", NUM_SINGLE_SENDS, single * NUM_SINGLE_SENDS / 1000000.0);
+    
+    return success;
+}
@@ -0,0 +1,248 @@
+//
+// Copyright (c) 2008-2014 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "BitReader.h"
+#include "BitWriter.h"
+#include "Context.h"
+#include "File.h"
+#include "FileSystem.h"
+#include "PackageFile.h"
+#include "Quaternion.h"
+#include "Random.h"
+#include "UnitTests.h"
+#include "VectorBuffer.h"
+
+#include <cstring>
+#include <lz4.h>
+
+#include "DebugNew.h"
+
+using namespace Urho3D;
+
+static const unsigned TEST_BLOCK_SIZE = 1024;
+static const unsigned TEST_NUM_BLOCKS = 10;
+static const unsigned TEST_DATA_SIZE = TEST_NUM_BLOCKS * TEST_BLOCK_SIZE - 300;
+
+/// Write a single entry block indexed compressed package like PackageTool does. Return true on success.
+static bool WriteCompressedPackage(Context* context, const String& fileName, const String& entryName, const PODVector<unsigned char>& data)
+{
+    File dest(context, fileName, FILE_WRITE);
+    if (!dest.IsOpen())
+        return false;
+    
+    dest.WriteFileID("ULZ2");
+    dest.WriteUInt(1);
+    dest.WriteUInt(0);
+    dest.WriteUInt(TEST_BLOCK_SIZE);
+    dest.WriteString(entryName);
+    unsigned entryPos = dest.GetPosition();
+    dest.WriteUInt(0);
+    dest.WriteUInt(data.Size());
+    dest.WriteUInt(0);
+    
+    unsigned entryOffset = dest.GetSize();
+    unsigned numBlocks = (data.Size() + TEST_BLOCK_SIZE - 1) / TEST_BLOCK_SIZE;
+    unsigned indexSize = (numBlocks + 1) * sizeof(unsigned);
+    PODVector<unsigned> blockOffsets(numBlocks + 1);
+    PODVector<unsigned char> packed(numBlocks * TEST_BLOCK_SIZE);
+    unsigned packedPos = 0;
+    
+    for (unsigned i = 0; i < numBlocks; ++i)
+    {
+        unsigned unpackedSize = Min((int)TEST_BLOCK_SIZE, (int)(data.Size() - i * TEST_BLOCK_SIZE));
+        const char* src = (const char*)&data[i * TEST_BLOCK_SIZE];
+        unsigned packedSize = LZ4_compress_limitedOutput(src, (char*)&packed[packedPos], unpackedSize, unpackedSize - 1);
+        if (!packedSize)
+        {
+            memcpy(&packed[packedPos], src, unpackedSize);
+            packedSize = unpackedSize;
+        }
+        
+        blockOffsets[i] = indexSize + packedPos;
+        packedPos += packedSize;
+    }
+    blockOffsets[numBlocks] = indexSize + packedPos;
+    
+    dest.Write(&blockOffsets[0], indexSize);
+    dest.Write(&packed[0], packedPos);
+    dest.Seek(entryPos);
+    dest.WriteUInt(entryOffset);
+    return true;
+}
+
+/// Read from a file at a position and compare with the source data. Return true on success.
+static bool CheckRead(File& file, const PODVector<unsigned char>& data, unsigned position, unsigned size)
+{
+    unsigned char buffer[3 * TEST_BLOCK_SIZE];
+    size = Min((int)size, (int)(data.Size() - position));
+    if (file.Seek(position) != position)
+        return false;
+    if (file.Read(buffer, size) != size)
+        return false;
+    return !memcmp(buffer, &data[position], size) && file.GetPosition() == position + size;
+}
+
+bool TestBitStream()
+{
+    bool success = true;
+    
+    const unsigned vleValues[] = { 0, 1, 127, 128, 16383, 16384, 0x12345678, M_MAX_UNSIGNED };
+    const int signedValues[] = { 0, -1, 1, -64, 63, -65, 64, M_MIN_INT, M_MAX_INT };
+    const float floatValues[] = { -1.0f, -0.3f, 0.0f, 0.123f, 1.0f, 5.0f };
+    const Quaternion rotations[] =
+    {
+        Quaternion::IDENTITY,
+        Quaternion(90.0f, Vector3::UP),
+        Quaternion(-135.0f, Vector3(1.0f, 2.0f, -3.0f).Normalized()),
+        Quaternion(30.0f, 60.0f, -170.0f),
+        Quaternion(-0.5f, 0.5f, -0.5f, 0.5f)
+    };
+    const unsigned numVLE = sizeof vleValues / sizeof vleValues[0];
+    const unsigned numSigned = sizeof signedValues / sizeof signedValues[0];
+    const unsigned numFloats = sizeof floatValues / sizeof floatValues[0];
+    const unsigned numRotations = sizeof rotations / sizeof rotations[0];
+    const unsigned floatBits = 12;
+    const unsigned quaternionBits = 10;
+    
+    VectorBuffer buffer;
+    {
+        BitWriter writer(buffer);
+        writer.WriteBits(5, 3);
+        for (unsigned i = 0; i < numVLE; ++i)
+            writer.WriteVLE(vleValues[i]);
+        for (unsigned i = 0; i < numSigned; ++i)
+            writer.WriteSignedVLE(signedValues[i]);
+        writer.WriteBool(true);
+        writer.WriteFloat(-1234.5f);
+        for (unsigned i = 0; i < numFloats; ++i)
+            writer.WriteQuantizedFloat(floatValues[i], -1.0f, 1.0f, floatBits);
+        for (unsigned i = 0; i < numRotations; ++i)
+            writer.WriteQuantizedQuaternion(rotations[i], quaternionBits);
+        
+        // Byte-aligned data written directly to the stream must follow the padded bits
+        writer.Flush();
+        success &= CHECK(writer.GetNumBits() == buffer.GetSize() * 8);
+        buffer.WriteUInt(0xdeadbeef);
+        writer.WriteBits(0x2a, 7);
+        
+        // Flushing on a byte boundary must not write padding
+        writer.WriteBits(1, 1);
+        writer.Flush();
+        unsigned size = buffer.GetSize();
+        writer.Flush();
+        success &= CHECK(buffer.GetSize() == size);
+        buffer.WriteUByte(0x5a);
+        writer.WriteBool(false);
+    }
+    
+    buffer.Seek(0);
+    BitReader reader(buffer);
+    success &= CHECK(reader.ReadBits(3) == 5);
+    for (unsigned i = 0; i < numVLE; ++i)
+        success &= CHECK(reader.ReadVLE() == vleValues[i]);
+    for (unsigned i = 0; i < numSigned; ++i)
+        success &= CHECK(reader.ReadSignedVLE() == signedValues[i]);
+    success &= CHECK(reader.ReadBool());
+    success &= CHECK(reader.ReadFloat() == -1234.5f);
+    
+    // Quantized values must be within half a step of the original, clamped to the range
+    float step = 2.0f / (float)((1 << floatBits) - 1);
+    for (unsigned i = 0; i < numFloats; ++i)
+    {
+        float value = reader.ReadQuantizedFloat(-1.0f, 1.0f, floatBits);
+        success &= CHECK(Abs(value - Clamp(floatValues[i], -1.0f, 1.0f)) <= step * 0.5f + M_EPSILON);
+    }
+    // q and -q are the same rotation, so compare the absolute dot product
+    for (unsigned i = 0; i < numRotations; ++i)
+    {
+        Quaternion value = reader.ReadQuantizedQuaternion(quaternionBits);
+        success &= CHECK(Abs(value.DotProduct(rotations[i].Normalized())) > 0.9999f);
+    }
+    
+    reader.Align();
+    success &= CHECK(buffer.ReadUInt() == 0xdeadbeef);
+    success &= CHECK(reader.ReadBits(7) == 0x2a);
+    success &= CHECK(reader.ReadBits(1) == 1);
+    // Aligning on a byte boundary must not skip data
+    reader.Align();
+    success &= CHECK(buffer.ReadUByte() == 0x5a);
+    success &= CHECK(!reader.ReadBool());
+    reader.Align();
+    success &= CHECK(reader.IsEof());
+    
+    return success;
+}
+
+bool TestCompressedPackage()
+{
+    bool success = true;
+    
+    SharedPtr<Context> context(new Context());
+    context->RegisterSubsystem(new FileSystem(context));
+    FileSystem* fileSystem = context->GetSubsystem<FileSystem>();
+    String fileName = fileSystem->GetCurrentDir() + "CompressedPackageTest.pak";
+    
+    // Mostly compressible data, with one block of random bytes which has to be stored raw
+    PODVector<unsigned char> data(TEST_DATA_SIZE);
+    SetRandomSeed(1);
+    for (unsigned i = 0; i < TEST_DATA_SIZE; ++i)
+        data[i] = i / TEST_BLOCK_SIZE == 5 ? (unsigned char)Rand() : (unsigned char)('a' + (i * 7 / 3) % 23);
+    
+    success &= CHECK(WriteCompressedPackage(context, fileName, "Data.bin", data));
+    
+    {
+        SharedPtr<PackageFile> package(new PackageFile(context));
+        success &= CHECK(package->Open(fileName));
+        success &= CHECK(package->IsCompressed() && package->Exists("Data.bin"));
+        
+        File file(context, package, "Data.bin");
+        success &= CHECK(file.IsOpen() && file.GetSize() == TEST_DATA_SIZE);
+        
+        // Whole file in one read, decompressing straight into the destination
+        PODVector<unsigned char> whole(TEST_DATA_SIZE);
+        success &= CHECK(file.Read(&whole[0], TEST_DATA_SIZE) == TEST_DATA_SIZE && whole == data);
+        success &= CHECK(file.IsEof());
+        
+        // Backward seeks, seeks inside the current block, reads across block boundaries and into the raw block
+        success &= CHECK(CheckRead(file, data, 0, 10));
+        success &= CHECK(CheckRead(file, data, 5000, 100));
+        success &= CHECK(CheckRead(file, data, 5050, 100));
+        success &= CHECK(CheckRead(file, data, 3 * TEST_BLOCK_SIZE - 2, 4));
+        success &= CHECK(CheckRead(file, data, 5 * TEST_BLOCK_SIZE - 10, TEST_BLOCK_SIZE + 20));
+        success &= CHECK(CheckRead(file, data, 100, 2 * TEST_BLOCK_SIZE));
+        success &= CHECK(CheckRead(file, data, TEST_DATA_SIZE - 50, 50));
+        success &= CHECK(CheckRead(file, data, 7 * TEST_BLOCK_SIZE, 1));
+        
+        // Small reads straddling a block boundary
+        file.Seek(TEST_BLOCK_SIZE - 2);
+        unsigned value;
+        memcpy(&value, &data[TEST_BLOCK_SIZE - 2], sizeof value);
+        success &= CHECK(file.ReadUInt() == value);
+        
+        // Seeking past the end clamps to the size
+        success &= CHECK(file.Seek(TEST_DATA_SIZE + 100) == TEST_DATA_SIZE && file.IsEof());
+    }
+    
+    fileSystem->Delete(fileName);
+    return success;
+}
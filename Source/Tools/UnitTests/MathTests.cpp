@@ -0,0 +1,349 @@
+//
+// Copyright (c) 2008-2014 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "BoundingBox.h"
+#include "Context.h"
+#include "Matrix3x4.h"
+#include "Quaternion.h"
+#include "Random.h"
+#include "Timer.h"
+#include "UnitTests.h"
+
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+#include "DebugNew.h"
+
+using namespace Urho3D;
+
+static const unsigned NUM_ITERATIONS = 10000;
+
+/// Return whether two float arrays are identical bit for bit, treating all NaNs as equal.
+static bool Identical(const float* a, const float* b, unsigned count)
+{
+    for (unsigned i = 0; i < count; ++i)
+    {
+        if (a[i] != a[i] && b[i] != b[i])
+            continue;
+        if (memcmp(&a[i], &b[i], sizeof(float)))
+            return false;
+    }
+    
+    return true;
+}
+
+/// Return a random float, often one of the special values where SSE and scalar results could diverge.
+static float RandomValue()
+{
+    static const float special[] =
+    {
+        0.0f, -0.0f, 1.0f, -1.0f, 0.5f, std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+        std::numeric_limits<float>::min(), std::numeric_limits<float>::max()
+    };
+    
+    if (Rand() & 1)
+        return special[Rand() % (sizeof special / sizeof special[0])];
+    else
+        return Random(-1000.0f, 1000.0f);
+}
+
+static void RandomValues(float* dest, unsigned count)
+{
+    for (unsigned i = 0; i < count; ++i)
+        dest[i] = RandomValue();
+}
+
+static Matrix3x4 ScalarMultiply(const Matrix3x4& lhs, const Matrix3x4& rhs)
+{
+    return Matrix3x4(
+        lhs.m00_ * rhs.m00_ + lhs.m01_ * rhs.m10_ + lhs.m02_ * rhs.m20_,
+        lhs.m00_ * rhs.m01_ + lhs.m01_ * rhs.m11_ + lhs.m02_ * rhs.m21_,
+        lhs.m00_ * rhs.m02_ + lhs.m01_ * rhs.m12_ + lhs.m02_ * rhs.m22_,
+        lhs.m00_ * rhs.m03_ + lhs.m01_ * rhs.m13_ + lhs.m02_ * rhs.m23_ + lhs.m03_,
+        lhs.m10_ * rhs.m00_ + lhs.m11_ * rhs.m10_ + lhs.m12_ * rhs.m20_,
+        lhs.m10_ * rhs.m01_ + lhs.m11_ * rhs.m11_ + lhs.m12_ * rhs.m21_,
+        lhs.m10_ * rhs.m02_ + lhs.m11_ * rhs.m12_ + lhs.m12_ * rhs.m22_,
+        lhs.m10_ * rhs.m03_ + lhs.m11_ * rhs.m13_ + lhs.m12_ * rhs.m23_ + lhs.m13_,
+        lhs.m20_ * rhs.m00_ + lhs.m21_ * rhs.m10_ + lhs.m22_ * rhs.m20_,
+        lhs.m20_ * rhs.m01_ + lhs.m21_ * rhs.m11_ + lhs.m22_ * rhs.m21_,
+        lhs.m20_ * rhs.m02_ + lhs.m21_ * rhs.m12_ + lhs.m22_ * rhs.m22_,
+        lhs.m20_ * rhs.m03_ + lhs.m21_ * rhs.m13_ + lhs.m22_ * rhs.m23_ + lhs.m23_
+    );
+}
+
+static Matrix4 ScalarMultiply(const Matrix3x4& lhs, const Matrix4& rhs)
+{
+    return Matrix4(
+        lhs.m00_ * rhs.m00_ + lhs.m01_ * rhs.m10_ + lhs.m02_ * rhs.m20_ + lhs.m03_ * rhs.m30_,
+        lhs.m00_ * rhs.m01_ + lhs.m01_ * rhs.m11_ + lhs.m02_ * rhs.m21_ + lhs.m03_ * rhs.m31_,
+        lhs.m00_ * rhs.m02_ + lhs.m01_ * rhs.m12_ + lhs.m02_ * rhs.m22_ + lhs.m03_ * rhs.m32_,
+        lhs.m00_ * rhs.m03_ + lhs.m01_ * rhs.m13_ + lhs.m02_ * rhs.m23_ + lhs.m03_ * rhs.m33_,
+        lhs.m10_ * rhs.m00_ + lhs.m11_ * rhs.m10_ + lhs.m12_ * rhs.m20_ + lhs.m13_ * rhs.m30_,
+        lhs.m10_ * rhs.m01_ + lhs.m11_ * rhs.m11_ + lhs.m12_ * rhs.m21_ + lhs.m13_ * rhs.m31_,
+        lhs.m10_ * rhs.m02_ + lhs.m11_ * rhs.m12_ + lhs.m12_ * rhs.m22_ + lhs.m13_ * rhs.m32_,
+        lhs.m10_ * rhs.m03_ + lhs.m11_ * rhs.m13_ + lhs.m12_ * rhs.m23_ + lhs.m13_ * rhs.m33_,
+        lhs.m20_ * rhs.m00_ + lhs.m21_ * rhs.m10_ + lhs.m22_ * rhs.m20_ + lhs.m23_ * rhs.m30_,
+        lhs.m20_ * rhs.m01_ + lhs.m21_ * rhs.m11_ + lhs.m22_ * rhs.m21_ + lhs.m23_ * rhs.m31_,
+        lhs.m20_ * rhs.m02_ + lhs.m21_ * rhs.m12_ + lhs.m22_ * rhs.m22_ + lhs.m23_ * rhs.m32_,
+        lhs.m20_ * rhs.m03_ + lhs.m21_ * rhs.m13_ + lhs.m22_ * rhs.m23_ + lhs.m23_ * rhs.m33_,
+        rhs.m30_,
+        rhs.m31_,
+        rhs.m32_,
+        rhs.m33_
+    );
+}
+
+static Matrix4 ScalarMultiply(const Matrix4& lhs, const Matrix3x4& rhs)
+{
+    return Matrix4(
+        lhs.m00_ * rhs.m00_ + lhs.m01_ * rhs.m10_ + lhs.m02_ * rhs.m20_,
+        lhs.m00_ * rhs.m01_ + lhs.m01_ * rhs.m11_ + lhs.m02_ * rhs.m21_,
+        lhs.m00_ * rhs.m02_ + lhs.m01_ * rhs.m12_ + lhs.m02_ * rhs.m22_,
+        lhs.m00_ * rhs.m03_ + lhs.m01_ * rhs.m13_ + lhs.m02_ * rhs.m23_ + lhs.m03_,
+        lhs.m10_ * rhs.m00_ + lhs.m11_ * rhs.m10_ + lhs.m12_ * rhs.m20_,
+        lhs.m10_ * rhs.m01_ + lhs.m11_ * rhs.m11_ + lhs.m12_ * rhs.m21_,
+        lhs.m10_ * rhs.m02_ + lhs.m11_ * rhs.m12_ + lhs.m12_ * rhs.m22_,
+        lhs.m10_ * rhs.m03_ + lhs.m11_ * rhs.m13_ + lhs.m12_ * rhs.m23_ + lhs.m13_,
+        lhs.m20_ * rhs.m00_ + lhs.m21_ * rhs.m10_ + lhs.m22_ * rhs.m20_,
+        lhs.m20_ * rhs.m01_ + lhs.m21_ * rhs.m11_ + lhs.m22_ * rhs.m21_,
+        lhs.m20_ * rhs.m02_ + lhs.m21_ * rhs.m12_ + lhs.m22_ * rhs.m22_,
+        lhs.m20_ * rhs.m03_ + lhs.m21_ * rhs.m13_ + lhs.m22_ * rhs.m23_ + lhs.m23_,
+        lhs.m30_ * rhs.m00_ + lhs.m31_ * rhs.m10_ + lhs.m32_ * rhs.m20_,
+        lhs.m30_ * rhs.m01_ + lhs.m31_ * rhs.m11_ + lhs.m32_ * rhs.m21_,
+        lhs.m30_ * rhs.m02_ + lhs.m31_ * rhs.m12_ + lhs.m32_ * rhs.m22_,
+        lhs.m30_ * rhs.m03_ + lhs.m31_ * rhs.m13_ + lhs.m32_ * rhs.m23_ + lhs.m33_
+    );
+}
+
+static Matrix4 ScalarMultiply(const Matrix4& lhs, const Matrix4& rhs)
+{
+    Matrix4 ret;
+    const float* l = &lhs.m00_;
+    const float* r = &rhs.m00_;
+    float* dest = &ret.m00_;
+    
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        for (unsigned j = 0; j < 4; ++j)
+            dest[i * 4 + j] = l[i * 4] * r[j] + l[i * 4 + 1] * r[4 + j] + l[i * 4 + 2] * r[8 + j] + l[i * 4 + 3] * r[12 + j];
+    }
+    
+    return ret;
+}
+
+static Quaternion ScalarMultiply(const Quaternion& lhs, const Quaternion& rhs)
+{
+    return Quaternion(
+        lhs.w_ * rhs.w_ - lhs.x_ * rhs.x_ - lhs.y_ * rhs.y_ - lhs.z_ * rhs.z_,
+        lhs.w_ * rhs.x_ + lhs.x_ * rhs.w_ + lhs.y_ * rhs.z_ - lhs.z_ * rhs.y_,
+        lhs.w_ * rhs.y_ + lhs.y_ * rhs.w_ + lhs.z_ * rhs.x_ - lhs.x_ * rhs.z_,
+        lhs.w_ * rhs.z_ + lhs.z_ * rhs.w_ + lhs.x_ * rhs.y_ - lhs.y_ * rhs.x_
+    );
+}
+
+static BoundingBox ScalarTransformed(const BoundingBox& box, const Matrix3x4& transform)
+{
+    Vector3 center = box.Center();
+    Vector3 newCenter(
+        transform.m00_ * center.x_ + transform.m01_ * center.y_ + transform.m02_ * center.z_ + transform.m03_,
+        transform.m10_ * center.x_ + transform.m11_ * center.y_ + transform.m12_ * center.z_ + transform.m13_,
+        transform.m20_ * center.x_ + transform.m21_ * center.y_ + transform.m22_ * center.z_ + transform.m23_
+    );
+    Vector3 oldEdge = box.Size() * 0.5f;
+    Vector3 newEdge(
+        Abs(transform.m00_) * oldEdge.x_ + Abs(transform.m01_) * oldEdge.y_ + Abs(transform.m02_) * oldEdge.z_,
+        Abs(transform.m10_) * oldEdge.x_ + Abs(transform.m11_) * oldEdge.y_ + Abs(transform.m12_) * oldEdge.z_,
+        Abs(transform.m20_) * oldEdge.x_ + Abs(transform.m21_) * oldEdge.y_ + Abs(transform.m22_) * oldEdge.z_
+    );
+    
+    return BoundingBox(newCenter - newEdge, newCenter + newEdge);
+}
+
+bool TestMathSSE()
+{
+    bool success = true;
+    SetRandomSeed(1);
+    
+    for (unsigned i = 0; i < NUM_ITERATIONS; ++i)
+    {
+        Matrix3x4 a, b;
+        Matrix4 c, d;
+        Quaternion q, r;
+        Vector3 min, max;
+        RandomValues(&a.m00_, 12);
+        RandomValues(&b.m00_, 12);
+        RandomValues(&c.m00_, 16);
+        RandomValues(&d.m00_, 16);
+        RandomValues(&q.w_, 4);
+        RandomValues(&r.w_, 4);
+        RandomValues(&min.x_, 3);
+        RandomValues(&max.x_, 3);
+        BoundingBox box(min, max);
+        
+        Matrix3x4 ab = a * b;
+        Matrix3x4 abRef = ScalarMultiply(a, b);
+        success &= CHECK(Identical(&ab.m00_, &abRef.m00_, 12));
+        
+        Matrix4 ac = a * c;
+        Matrix4 acRef = ScalarMultiply(a, c);
+        success &= CHECK(Identical(&ac.m00_, &acRef.m00_, 16));
+        
+        Matrix4 ca = c * a;
+        Matrix4 caRef = ScalarMultiply(c, a);
+        success &= CHECK(Identical(&ca.m00_, &caRef.m00_, 16));
+        
+        Matrix4 cd = c * d;
+        Matrix4 cdRef = ScalarMultiply(c, d);
+        success &= CHECK(Identical(&cd.m00_, &cdRef.m00_, 16));
+        
+        Quaternion qr = q * r;
+        Quaternion qrRef = ScalarMultiply(q, r);
+        success &= CHECK(Identical(&qr.w_, &qrRef.w_, 4));
+        
+        BoundingBox transformed = box.Transformed(a);
+        BoundingBox transformedRef = ScalarTransformed(box, a);
+        success &= CHECK(Identical(&transformed.min_.x_, &transformedRef.min_.x_, 3));
+        success &= CHECK(Identical(&transformed.max_.x_, &transformedRef.max_.x_, 3));
+        
+        if (!success)
+            break;
+    }
+    
+    return success;
+}
+
+/// Print the time of an engine math operation against its scalar reference.
+static void PrintMathTiming(const char* name, long long usec, long long scalarUsec, unsigned numOperations)
+{
+    printf("%-24s %7.2f ns, scalar %7.2f ns (%.2fx)\n", name, usec * 1000.0 / numOperations, scalarUsec * 1000.0 / numOperations,
+        (double)scalarUsec / (double)Max((int)usec, 1));
+}
+
+bool BenchmarkMathSSE()
+{
+    static const unsigned NUM_VALUES = 1024;
+    static const unsigned NUM_REPEATS = 2000;
+    static const unsigned NUM_OPERATIONS = NUM_VALUES * NUM_REPEATS;
+    
+    #ifdef URHO3D_SSE
+    printf("SSE enabled\n");
+    #else
+    printf("SSE disabled, both columns measure scalar code\n");
+    #endif
+    
+    // Use finite values in a moderate range, so that no time is spent on denormals or NaNs
+    PODVector<Matrix3x4> matrices3x4(NUM_VALUES);
+    PODVector<Matrix4> matrices4(NUM_VALUES);
+    PODVector<Quaternion> quaternions(NUM_VALUES);
+    PODVector<BoundingBox> boxes(NUM_VALUES);
+    SetRandomSeed(1);
+    for (unsigned i = 0; i < NUM_VALUES; ++i)
+    {
+        for (unsigned j = 0; j < 12; ++j)
+            (&matrices3x4[i].m00_)[j] = Random(-2.0f, 2.0f);
+        for (unsigned j = 0; j < 16; ++j)
+            (&matrices4[i].m00_)[j] = Random(-2.0f, 2.0f);
+        quaternions[i] = Quaternion(Random(360.0f), Vector3(Random(1.0f), Random(1.0f), 1.0f).Normalized());
+        Vector3 center(Random(-10.0f, 10.0f), Random(-10.0f, 10.0f), Random(-10.0f, 10.0f));
+        boxes[i] = BoundingBox(center - Vector3::ONE, center + Vector3::ONE);
+    }
+    
+    SharedPtr<Context> context(new Context());
+    context->RegisterSubsystem(new Time(context));
+    
+    // Store the results so that the compiler can not skip the work, and compare them to check that both versions agree
+    PODVector<Matrix3x4> results3x4(NUM_VALUES), scalarResults3x4(NUM_VALUES);
+    PODVector<Matrix4> results4(NUM_VALUES), scalarResults4(NUM_VALUES);
+    PODVector<Quaternion> quaternionResults(NUM_VALUES), scalarQuaternionResults(NUM_VALUES);
+    PODVector<BoundingBox> boxResults(NUM_VALUES), scalarBoxResults(NUM_VALUES);
+    bool success = true;
+    HiresTimer timer;
+    long long usec, scalarUsec;
+    
+    timer.Reset();
+    for (unsigned r = 0; r < NUM_REPEATS; ++r)
+        for (unsigned i = 0; i < NUM_VALUES; ++i)
+            results3x4[i] = matrices3x4[i] * matrices3x4[(i + r) % NUM_VALUES];
+    usec = timer.GetUSec(true);
+    for (unsigned r = 0; r < NUM_REPEATS; ++r)
+        for (unsigned i = 0; i < NUM_VALUES; ++i)
+            scalarResults3x4[i] = ScalarMultiply(matrices3x4[i], matrices3x4[(i + r) % NUM_VALUES]);
+    scalarUsec = timer.GetUSec(false);
+    success &= CHECK(Identical(&results3x4[0].m00_, &scalarResults3x4[0].m00_, NUM_VALUES * 12));
+    PrintMathTiming("Matrix3x4 * Matrix3x4", usec, scalarUsec, NUM_OPERATIONS);
+    
+    timer.Reset();
+    for (unsigned r = 0; r < NUM_REPEATS; ++r)
+        for (unsigned i = 0; i < NUM_VALUES; ++i)
+            results4[i] = matrices4[i] * matrices4[(i + r) % NUM_VALUES];
+    usec = timer.GetUSec(true);
+    for (unsigned r = 0; r < NUM_REPEATS; ++r)
+        for (unsigned i = 0; i < NUM_VALUES; ++i)
+            scalarResults4[i] = ScalarMultiply(matrices4[i], matrices4[(i + r) % NUM_VALUES]);
+    scalarUsec = timer.GetUSec(false);
+    success &= CHECK(Identical(&results4[0].m00_, &scalarResults4[0].m00_, NUM_VALUES * 16));
+    PrintMathTiming("Matrix4 * Matrix4", usec, scalarUsec, NUM_OPERATIONS);
+    
+    timer.Reset();
+    for (unsigned r = 0; r < NUM_REPEATS; ++r)
+        for (unsigned i = 0; i < NUM_VALUES; ++i)
+            results4[i] = matrices4[i] * matrices3x4[(i + r) % NUM_VALUES];
+    usec = timer.GetUSec(true);
+    for (unsigned r = 0; r < NUM_REPEATS; ++r)
+        for (unsigned i = 0; i < NUM_VALUES; ++i)
+            scalarResults4[i] = ScalarMultiply(matrices4[i], matrices3x4[(i + r) % NUM_VALUES]);
+    scalarUsec = timer.GetUSec(false);
+    success &= CHECK(Identical(&results4[0].m00_, &scalarResults4[0].m00_, NUM_VALUES * 16));
+    PrintMathTiming("Matrix4 * Matrix3x4", usec, scalarUsec, NUM_OPERATIONS);
+    
+    timer.Reset();
+    for (unsigned r = 0; r < NUM_REPEATS; ++r)
+        for (unsigned i = 0; i < NUM_VALUES; ++i)
+            quaternionResults[i] = quaternions[i] * quaternions[(i + r) % NUM_VALUES];
+    usec = timer.GetUSec(true);
+    for (unsigned r = 0; r < NUM_REPEATS; ++r)
+        for (unsigned i = 0; i < NUM_VALUES; ++i)
+            scalarQuaternionResults[i] = ScalarMultiply(quaternions[i], quaternions[(i + r) % NUM_VALUES]);
+    scalarUsec = timer.GetUSec(false);
+    success &= CHECK(Identical(&quaternionResults[0].w_, &scalarQuaternionResults[0].w_, NUM_VALUES * 4));
+    PrintMathTiming("Quaternion * Quaternion", usec, scalarUsec, NUM_OPERATIONS);
+    
+    timer.Reset();
+    for (unsigned r = 0; r < NUM_REPEATS; ++r)
+        for (unsigned i = 0; i < NUM_VALUES; ++i)
+            boxResults[i] = boxes[i].Transformed(matrices3x4[(i + r) % NUM_VALUES]);
+    usec = timer.GetUSec(true);
+    for (unsigned r = 0; r < NUM_REPEATS; ++r)
+        for (unsigned i = 0; i < NUM_VALUES; ++i)
+            scalarBoxResults[i] = ScalarTransformed(boxes[i], matrices3x4[(i + r) % NUM_VALUES]);
+    scalarUsec = timer.GetUSec(false);
+    for (unsigned i = 0; i < NUM_VALUES; ++i)
+    {
+        success &= CHECK(Identical(&boxResults[i].min_.x_, &scalarBoxResults[i].min_.x_, 3));
+        success &= CHECK(Identical(&boxResults[i].max_.x_, &scalarBoxResults[i].max_.x_, 3));
+    }
+    PrintMathTiming("BoundingBox::Transformed", usec, scalarUsec, NUM_OPERATIONS);
+    
+    return success;
+}
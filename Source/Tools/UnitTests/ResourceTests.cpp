@@ -0,0 +1,134 @@
+//
+// Copyright (c) 2008-2014 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "Context.h"
+#include "File.h"
+#include "FileSystem.h"
+#include "Mutex.h"
+#include "ResourceCache.h"
+#include "Timer.h"
+#include "UnitTests.h"
+
+#include "DebugNew.h"
+
+using namespace Urho3D;
+
+static const char* testFileNames[] = { "ResourceTestA.txt", "ResourceTestB.txt", "ResourceTestC.txt", "ResourceTestD.txt", 0 };
+static const unsigned LOAD_TIMEOUT_MS = 10000;
+
+/// Names of the test resources in the order their background loading began.
+static Vector<String> loadOrder;
+/// Mutex for the load order.
+static Mutex loadOrderMutex;
+/// Flag set once all test resources except the dependency have been queued.
+static volatile bool allQueued = false;
+
+/// Resource which records its background loading order. The first resource requests the last one as its dependency.
+class TestResource : public Resource
+{
+    OBJECT(TestResource);
+    
+public:
+    /// Construct.
+    TestResource(Context* context) :
+        Resource(context)
+    {
+    }
+    
+    /// Load resource from stream. Called from a background loader thread.
+    virtual bool BeginLoad(Deserializer& source)
+    {
+        {
+            MutexLock lock(loadOrderMutex);
+            loadOrder.Push(GetName());
+        }
+        
+        if (GetName() == testFileNames[0])
+        {
+            // Wait until the other resources are queued, so that the dependency has to be ordered before them
+            Timer timer;
+            while (!allQueued && timer.GetMSec(false) < LOAD_TIMEOUT_MS)
+                Time::Sleep(1);
+            GetSubsystem<ResourceCache>()->BackgroundLoadResource<TestResource>(testFileNames[3], false, this);
+        }
+        
+        return true;
+    }
+};
+
+bool TestBackgroundLoadPriority()
+{
+    bool success = true;
+    
+    SharedPtr<Context> context(new Context());
+    context->RegisterSubsystem(new FileSystem(context));
+    context->RegisterSubsystem(new ResourceCache(context));
+    context->RegisterFactory<TestResource>();
+    
+    FileSystem* fileSystem = context->GetSubsystem<FileSystem>();
+    ResourceCache* cache = context->GetSubsystem<ResourceCache>();
+    String dir = fileSystem->GetCurrentDir();
+    for (const char** name = testFileNames; *name; ++name)
+    {
+        File file(context, dir + *name, FILE_WRITE);
+        file.WriteLine("test");
+    }
+    cache->AddResourceDir(dir);
+    
+    // With a single loader thread, a dependency requested with the same priority as its caller must be loaded before the
+    // other resources of that priority, even though they were queued earlier
+    cache->SetNumBackgroundLoadThreads(1);
+    for (unsigned i = 0; i < 3; ++i)
+        success &= CHECK(cache->BackgroundLoadResource<TestResource>(testFileNames[i], false));
+    allQueued = true;
+    
+    Timer timer;
+    for (;;)
+    {
+        {
+            MutexLock lock(loadOrderMutex);
+            if (loadOrder.Size() == 4 || timer.GetMSec(false) >= LOAD_TIMEOUT_MS)
+                break;
+        }
+        Time::Sleep(1);
+    }
+    
+    {
+        MutexLock lock(loadOrderMutex);
+        success &= CHECK(loadOrder.Size() == 4);
+        if (loadOrder.Size() == 4)
+        {
+            success &= CHECK(loadOrder[0] == testFileNames[0]);
+            success &= CHECK(loadOrder[1] == testFileNames[3]);
+            success &= CHECK(loadOrder[2] == testFileNames[1]);
+            success &= CHECK(loadOrder[3] == testFileNames[2]);
+        }
+    }
+    
+    // Destroy the cache to stop the loader thread before removing the files
+    context->RemoveSubsystem<ResourceCache>();
+    for (const char** name = testFileNames; *name; ++name)
+        fileSystem->Delete(dir + *name);
+    
+    return success;
+}
@@ -0,0 +1,106 @@
+//
+// Copyright (c) 2008-2014 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "ProcessUtils.h"
+#include "UnitTests.h"
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include <cstdio>
+
+#include "DebugNew.h"
+
+using namespace Urho3D;
+
+int main(int argc, char** argv);
+int Run(const Vector<String>& arguments);
+
+struct TestCase
+{
+    const char* name_;
+    bool (*function_)();
+    /// Benchmarks print their timings and are only run when named.
+    bool benchmark_;
+};
+
+static const TestCase testCases[] =
+{
+    {"MathSSE", TestMathSSE, false},
+    {"BackgroundLoadPriority", TestBackgroundLoadPriority, false},
+    {"FlatHashMap", TestFlatHashMap, false},
+    {"StringRelocation", TestStringRelocation, false},
+    {"BitStream", TestBitStream, false},
+    {"CompressedPackage", TestCompressedPackage, false},
+    {"BenchmarkStringAllocations", BenchmarkStringAllocations, true},
+    {"BenchmarkWorkQueue", BenchmarkWorkQueue, true},
+    {"BenchmarkMathSSE", BenchmarkMathSSE, true},
+    {"BenchmarkRadixSort", BenchmarkRadixSort, true},
+    {"BenchmarkEvents", BenchmarkEvents, true},
+    {0, 0, false}
+};
+
+bool Check(bool condition, const char* description, const char* file, int line)
+{
+    if (!condition)
+        printf("%s(%d): check failed: %s\n", file, line, description);
+    return condition;
+}
+
+int main(int argc, char** argv)
+{
+    Vector<String> arguments;
+    
+    #ifdef WIN32
+    arguments = ParseArguments(GetCommandLineW());
+    #else
+    arguments = ParseArguments(argc, argv);
+    #endif
+    
+    return Run(arguments);
+}
+
+int Run(const Vector<String>& arguments)
+{
+    unsigned numFailed = 0;
+    unsigned numRun = 0;
+    
+    for (const TestCase* test = testCases; test->name_; ++test)
+    {
+        // Run all tests except benchmarks when no names are given
+        if (arguments.Empty() ? test->benchmark_ : !arguments.Contains(String(test->name_)))
+            continue;
+        
+        bool success = test->function_();
+        printf("%s: %s\n", test->name_, success ? "passed" : "FAILED");
+        ++numRun;
+        if (!success)
+            ++numFailed;
+    }
+    
+    if (!numRun)
+        ErrorExit("Usage: UnitTests [test names]\n");
+    
+    return numFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,52 @@
+//
+// Copyright (c) 2008-2014 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+/// Check a test condition and print the failure location if it does not hold. Return the condition.
+bool Check(bool condition, const char* description, const char* file, int line);
+
+#define CHECK(condition) Check(condition, #condition, __FILE__, __LINE__)
+
+/// Compare the SSE and scalar versions of matrix, quaternion and bounding box math. Return true on success.
+bool TestMathSSE();
+/// Check that a background loaded dependency is loaded before the other resources of its caller's priority. Return true on success.
+bool TestBackgroundLoadPriority();
+/// Check flat hash map lookups with colliding hashes against HashMap, and erasing by moving the last pair. Return true on success.
+bool TestFlatHashMap();
+/// Check that strings survive being moved with memcpy and that short strings do not allocate. Return true on success.
+bool TestStringRelocation();
+/// Check bit stream round trips of variable-length, quantized and byte-aligned data. Return true on success.
+bool TestBitStream();
+/// Check reads and seeks of a block indexed compressed package entry against the source data. Return true on success.
+bool TestCompressedPackage();
+/// Count the heap allocations of reading the attributes of a generated scene file. Return true on success.
+bool BenchmarkStringAllocations();
+/// Measure work queue throughput of small jobs against the number of threads. Return true on success.
+bool BenchmarkWorkQueue();
+/// Measure the SSE versions of matrix, quaternion and bounding box math against scalar code. Return true on success.
+bool BenchmarkMathSSE();
+/// Measure the radix sort of batch keys against the comparison sort with different batch counts. Return true on success.
+bool BenchmarkRadixSort();
+/// Measure event delivery to many subscribers, with and without a specific sender. Return true on success.
+bool BenchmarkEvents();